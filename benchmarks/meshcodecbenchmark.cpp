@@ -0,0 +1,133 @@
+// the mesh codec's compression ratio and decode throughput on the streams the model cache keeps
+// (vertices, tangents, triangle lists and a LOD's), against copying them raw. The meshes are
+// bumpy UV spheres, baked the way the import bakes them so the indices come in the cache order
+
+#include "meshcodec.h"
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+constexpr int Repetitions = 100;
+
+// the best of the repetitions, in s
+double bestTime(const std::function<void()> &run)
+{
+    double best = 1e9;
+    for (int r = 0; r < Repetitions; ++r)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+void report(const char *stream, const void *raw, size_t rawSize,
+            const std::vector<uint8_t> &encoded, const std::function<bool(void *)> &decode)
+{
+    std::vector<uint8_t> decoded(rawSize);
+    bool correct = decode(decoded.data()) && std::memcmp(decoded.data(), raw, rawSize) == 0;
+
+    const double decodeTime = bestTime([&] { correct = decode(decoded.data()) && correct; });
+    const double copyTime = bestTime([&] { std::memcpy(decoded.data(), raw, rawSize); });
+
+    std::printf("%-13s %10zu %10zu %7.2fx %11.2f %9.2f%s\n", stream, rawSize, encoded.size(),
+                static_cast<double>(rawSize) / encoded.size(), rawSize / decodeTime / 1e9,
+                rawSize / copyTime / 1e9, correct ? "" : "  (doesn't decode back!)");
+}
+
+void benchmarkSphere(uint32_t columns, uint32_t rows)
+{
+    std::vector<Vertex> vertices;
+    std::vector<glm::vec3> tangents;
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y <= rows; ++y)
+    {
+        for (uint32_t x = 0; x <= columns; ++x)
+        {
+            const float u = static_cast<float>(x) / columns;
+            const float v = static_cast<float>(y) / rows;
+            const float theta = u * 6.2831853f, phi = v * 3.1415927f;
+            const float radius = 1.0f + 0.05f * std::sin(8.0f * theta) * std::sin(6.0f * phi);
+
+            Vertex vertex;
+            vertex.normal[0] = std::sin(phi) * std::cos(theta);
+            vertex.normal[1] = std::cos(phi);
+            vertex.normal[2] = std::sin(phi) * std::sin(theta);
+            for (int c = 0; c < 3; ++c)
+                vertex.coordinates[c] = radius * vertex.normal[c];
+            vertex.texCoordinates[0] = u;
+            vertex.texCoordinates[1] = v;
+            vertices.push_back(vertex);
+            tangents.emplace_back(-std::sin(theta), 0.0f, std::cos(theta));
+        }
+    }
+
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        for (uint32_t x = 0; x < columns; ++x)
+        {
+            const uint32_t corner = y * (columns + 1) + x, below = corner + columns + 1;
+            indices.insert(indices.end(),
+                           { corner, below, corner + 1, corner + 1, below, below + 1 });
+        }
+    }
+
+    std::vector<uint32_t> clusterStarts;
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size(), clusterStarts);
+    MeshOptimizer::optimizeOverdraw(indices, vertices, clusterStarts);
+    MeshOptimizer::optimizeVertexFetch(vertices, indices, tangents);
+    const std::vector<MeshLod> lods = MeshOptimizer::generateLodChain(indices, vertices);
+
+    std::printf("%zu triangles\n", indices.size() / 3);
+    std::printf("%-13s %10s %10s %8s %11s %9s\n", "stream", "raw bytes", "encoded", "ratio",
+                "decode GB/s", "copy GB/s");
+
+    const std::vector<uint8_t> encodedVertices
+        = MeshCodec::encodeVertices(vertices.data(), vertices.size(), sizeof(Vertex));
+    report("vertices", vertices.data(), vertices.size() * sizeof(Vertex), encodedVertices,
+           [&](void *decoded) {
+               return MeshCodec::decodeVertices(decoded, vertices.size(), sizeof(Vertex),
+                                                encodedVertices.data(), encodedVertices.size());
+           });
+
+    const std::vector<uint8_t> encodedTangents
+        = MeshCodec::encodeVertices(tangents.data(), tangents.size(), sizeof(glm::vec3));
+    report("tangents", tangents.data(), tangents.size() * sizeof(glm::vec3), encodedTangents,
+           [&](void *decoded) {
+               return MeshCodec::decodeVertices(decoded, tangents.size(), sizeof(glm::vec3),
+                                                encodedTangents.data(), encodedTangents.size());
+           });
+
+    const auto reportIndices = [](const char *stream, const std::vector<uint32_t> &triangles) {
+        const std::vector<uint8_t> encoded
+            = MeshCodec::encodeIndices(triangles.data(), triangles.size());
+        report(stream, triangles.data(), triangles.size() * sizeof(uint32_t), encoded,
+               [&](void *decoded) {
+                   return MeshCodec::decodeIndices(static_cast<uint32_t *>(decoded),
+                                                   triangles.size(), encoded.data(),
+                                                   encoded.size());
+               });
+    };
+    reportIndices("indices", indices);
+    if (!lods.empty())
+        reportIndices("LOD 1 indices", lods[0].indices);
+}
+} // namespace
+
+int main()
+{
+    for (const uint32_t columns : { 100, 400 })
+    {
+        benchmarkSphere(columns, columns / 2);
+        std::printf("\n");
+    }
+}
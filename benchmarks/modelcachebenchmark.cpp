@@ -0,0 +1,111 @@
+// times a model's cold load against its warm one: cold, the mesh is baked the way ModelLoader
+// bakes an import (vertex cache, overdraw and fetch order, LOD chain, meshlets) and stored in the
+// model cache; warm, it is loaded from there. Assimp's own parse, which the warm load also skips,
+// comes on top of the cold column. The meshes are UV spheres of growing resolution
+
+#include "meshoptimizer.h"
+#include "modelcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double millisecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+BakedModel sphere(uint32_t columns, uint32_t rows)
+{
+    BakedModel model;
+    model.materials.emplace_back().textures.emplace_back(1, "albedo.png");
+    model.nodes.emplace_back().meshes.push_back(0);
+
+    BakedModel::MeshData &mesh = model.meshes.emplace_back();
+    mesh.name = "sphere";
+    for (uint32_t y = 0; y <= rows; ++y)
+    {
+        for (uint32_t x = 0; x <= columns; ++x)
+        {
+            const float u = static_cast<float>(x) / columns;
+            const float v = static_cast<float>(y) / rows;
+            const float theta = u * 6.2831853f, phi = v * 3.1415927f;
+
+            Vertex vertex;
+            vertex.coordinates[0] = std::sin(phi) * std::cos(theta);
+            vertex.coordinates[1] = std::cos(phi);
+            vertex.coordinates[2] = std::sin(phi) * std::sin(theta);
+            std::copy(vertex.coordinates, vertex.coordinates + 3, vertex.normal);
+            vertex.texCoordinates[0] = u;
+            vertex.texCoordinates[1] = v;
+            mesh.vertices.push_back(vertex);
+            mesh.tangents.emplace_back(-std::sin(theta), 0.0f, std::cos(theta));
+        }
+    }
+
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        for (uint32_t x = 0; x < columns; ++x)
+        {
+            const uint32_t corner = y * (columns + 1) + x, below = corner + columns + 1;
+            mesh.indices.insert(mesh.indices.end(),
+                                { corner, below, corner + 1, corner + 1, below, below + 1 });
+        }
+    }
+
+    return model;
+}
+
+void bake(BakedModel::MeshData &mesh)
+{
+    std::vector<uint32_t> clusterStarts;
+    MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size(), clusterStarts);
+    MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices, clusterStarts);
+    MeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices, mesh.tangents);
+    mesh.lods = MeshOptimizer::generateLodChain(mesh.indices, mesh.vertices);
+    mesh.meshlets = MeshOptimizer::buildMeshlets(mesh.indices, mesh.vertices);
+}
+} // namespace
+
+int main()
+{
+    // the cache entries depend on their source; this one only has to exist
+    const std::filesystem::path source = std::filesystem::path(ENGINE_CACHE) / "sphere.obj";
+    std::filesystem::create_directories(source.parent_path());
+    std::ofstream(source) << "# generated\n";
+
+    const uint64_t key = ModelCache::sourceKey(source, 0);
+    const std::filesystem::path cacheFile = ModelCache::cachePath(source);
+
+    std::printf("%10s %9s %9s %8s %9s\n", "triangles", "bake ms", "store ms", "load ms",
+                "file KiB");
+    for (const uint32_t columns : { 50, 100, 200, 400 })
+    {
+        BakedModel model = sphere(columns, columns / 2);
+
+        const auto start = Clock::now();
+        bake(model.meshes[0]);
+        const auto baked = Clock::now();
+        const bool stored = ModelCache::store(cacheFile, key, { source }, model);
+        const auto written = Clock::now();
+        const std::optional<BakedModel> loaded = ModelCache::load(cacheFile, key);
+        const auto end = Clock::now();
+
+        const BakedModel::MeshData &mesh = model.meshes[0];
+        const bool correct = stored && loaded && loaded->meshes[0].indices == mesh.indices
+                             && loaded->meshes[0].lods.size() == mesh.lods.size()
+                             && loaded->meshes[0].meshlets.size() == mesh.meshlets.size();
+
+        std::printf("%10zu %9.1f %9.1f %8.2f %9zu%s\n", mesh.indices.size() / 3,
+                    millisecondsBetween(start, baked), millisecondsBetween(baked, written),
+                    millisecondsBetween(written, end),
+                    static_cast<size_t>(std::filesystem::file_size(cacheFile) / 1024),
+                    correct ? "" : "  (doesn't load back!)");
+    }
+}
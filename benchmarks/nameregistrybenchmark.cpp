@@ -0,0 +1,110 @@
+// times the ModelLoader's pattern of name lookups (look a resource up by name, register it if it
+// isn't there) with the names interned in NameRegistry, against the string scan the managers
+// used to do. Every object has a mesh and three texture slots, each texture shared by two objects
+
+#include "nameregistry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+struct Resource
+{
+    int data = 0;
+};
+
+// the old managers: the resources carry their names, a lookup compares them one by one
+class ScanningManager
+{
+public:
+    uint64_t registered(const std::string &name) const
+    {
+        const auto resourcePtr = std::ranges::find_if(
+            _resources, [&name](const auto &resource) { return resource.second.first == name; });
+        return resourcePtr == _resources.end() ? 0 : resourcePtr->first;
+    }
+
+    uint64_t registerResource(const std::string &name)
+    {
+        if (const uint64_t id = registered(name); id != 0)
+            return id;
+
+        _resources.emplace(++_identifiers, std::make_pair(name, Resource{}));
+        return _identifiers;
+    }
+
+private:
+    uint64_t _identifiers = 0;
+    std::unordered_map<uint64_t, std::pair<std::string, Resource>> _resources;
+};
+
+// the managers now: the resources carry the interned names, and the names map to the resources
+class InterningManager
+{
+public:
+    uint64_t registered(const std::string &name) const
+    {
+        const auto namePtr = _resourcesByName.find(NameRegistry::instance()->find(name));
+        return namePtr == _resourcesByName.end() ? 0 : namePtr->second;
+    }
+
+    uint64_t registerResource(const std::string &name)
+    {
+        const NameIdentifier nameId = NameRegistry::instance()->intern(name);
+        if (const auto namePtr = _resourcesByName.find(nameId); namePtr != _resourcesByName.end())
+            return namePtr->second;
+
+        _resources.emplace(++_identifiers, std::make_pair(nameId, Resource{}));
+        _resourcesByName.emplace(nameId, _identifiers);
+        return _identifiers;
+    }
+
+private:
+    uint64_t _identifiers = 0;
+    std::unordered_map<uint64_t, std::pair<NameIdentifier, Resource>> _resources;
+    std::unordered_map<NameIdentifier, uint64_t> _resourcesByName;
+};
+
+// in ms
+template <typename Manager>
+double loadObjects(size_t numObjects)
+{
+    Manager meshes;
+    Manager textures;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t o = 0; o < numObjects; ++o)
+    {
+        const std::string meshName = "Object_" + std::to_string(o) + "_mesh";
+        if (meshes.registered(meshName) == 0)
+            meshes.registerResource(meshName);
+
+        for (size_t slot = 0; slot < 3; ++slot)
+        {
+            const std::string textureName = "textures/material_" + std::to_string(o / 2) + "_"
+                                            + std::to_string(slot) + ".png";
+            if (textures.registered(textureName) == 0)
+                textures.registerResource(textureName);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+} // namespace
+
+int main()
+{
+    std::printf("%8s %9s %12s %15s\n", "meshes", "textures", "scan ms", "interned ms");
+    for (const size_t numObjects : { 1000, 2000, 4000, 8000, 16000 })
+    {
+        std::printf("%8zu %9zu %12.1f %15.2f\n", numObjects, numObjects * 3 / 2,
+                    loadObjects<ScanningManager>(numObjects),
+                    loadObjects<InterningManager>(numObjects));
+    }
+}
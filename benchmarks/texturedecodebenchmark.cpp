@@ -0,0 +1,83 @@
+// times the decoding of a texture-heavy model's images (DecodedImage::decode, stb_image into the
+// PixelPool) spread over 1, 4 and the default number of loader threads, the way the ModelLoader
+// prefetches a model's textures. The images are those of models/suzuki, or of the directory given
+
+#include "pixelpool.h"
+#include "texturecache.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int Repetitions = 3;
+
+// the best of the repetitions, in ms
+double decodeAll(const std::vector<std::string> &files, size_t numThreads, bool &decoded)
+{
+    // parallelFor works on the calling thread too
+    ThreadPool pool(numThreads - 1);
+
+    double best = 1e9;
+    for (int r = 0; r < Repetitions; ++r)
+    {
+        std::vector<DecodedImage> images(files.size());
+        const auto start = std::chrono::steady_clock::now();
+        pool.parallelFor(files.size(),
+                         [&](size_t i) { images[i] = DecodedImage::decode(files[i]); });
+        const auto end = std::chrono::steady_clock::now();
+
+        decoded = std::ranges::all_of(images, [](const DecodedImage &image) { return !!image; });
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::filesystem::path directory =
+        argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::path(ENGINE_MODELS) / "suzuki";
+
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        const std::filesystem::path extension = entry.path().extension();
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+            files.emplace_back(entry.path().string());
+    }
+    if (files.empty())
+    {
+        std::fprintf(stderr, "no images in %s\n", directory.string().c_str());
+        return 1;
+    }
+
+    std::printf("%zu images in %s\n", files.size(), directory.string().c_str());
+    std::printf("%8s %10s %9s\n", "threads", "decode ms", "speed-up");
+
+    std::vector<size_t> threadCounts = { 1, 4, ThreadPool::defaultThreadCount() };
+    std::ranges::sort(threadCounts);
+    threadCounts.erase(std::ranges::unique(threadCounts).begin(), threadCounts.end());
+
+    double singleThreaded = 0.0;
+    for (const size_t numThreads : threadCounts)
+    {
+        bool decoded = true;
+        const double time = decodeAll(files, numThreads, decoded);
+        if (numThreads == 1)
+            singleThreaded = time;
+
+        std::printf("%8zu %10.1f %8.2fx%s\n", numThreads, time, singleThreaded / time,
+                    decoded ? "" : "  (some didn't decode!)");
+    }
+
+    const PixelPool::Statistics statistics = PixelPool::statistics();
+    std::printf("pixel pool: %zu allocations, %zu reuses, %.1f MiB held\n",
+                statistics.allocations, statistics.reuses,
+                statistics.heldBytes / (1024.0 * 1024.0));
+}
@@ -61,21 +61,18 @@ layout(binding = 1, std140) uniform DirectionalLights
 {
     DirectionalLight dirLights[NUM_DIRECTIONAL];
 };
-uniform int numDirectionalLightsBound;
 
 #define NUM_POINT 8
 layout(binding = 2, std140) uniform PointLights
 {
     PointLight pointLights[NUM_POINT];
 };
-uniform int numPointLightsBound;
 
 #define NUM_SPOT 8
 layout(binding = 3, std140) uniform SpotLights
 {
     SpotLight spotLights[NUM_SPOT];
 };
-uniform int numSpotLightsBound;
 
 layout(rgba16f, binding = 0) uniform image2D colorOutput;
 layout(r32f, binding = 1) uniform image2D depthOutputImage;
@@ -91,11 +88,6 @@ uniform float maxMarchDistance;
 uniform vec3 viewSpherePos;
 uniform float sphereRadius;
 
-uniform mat4 viewMatrix;
-uniform mat4 inverseViewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 clipToView;
-
 uniform float densityScale;
 
 uniform vec3 fogColor;
@@ -187,11 +179,11 @@ float Value3D(vec3 P)
 
 float computeDensityContributionWithinTexture(vec3 rayPosition, float inscribedRadius)
 {
-    vec3 localFogVector = fogVolumeWorldToModelRotation * mat3(inverseViewMatrix) * ((rayPosition - viewSpherePos) / inscribedRadius);
+    vec3 localFogVector = fogVolumeWorldToModelRotation * mat3(inverseView) * ((rayPosition - viewSpherePos) / inscribedRadius);
 
     localFogVector += 0.5;
 
-    vec3 unnormalizedLocalFogVector = fogVolumeWorldToModelRotation * mat3(inverseViewMatrix) * (rayPosition - viewSpherePos);
+    vec3 unnormalizedLocalFogVector = fogVolumeWorldToModelRotation * mat3(inverseView) * (rayPosition - viewSpherePos);
     float coeff = max(Perlin3D(unnormalizedLocalFogVector) * Value3D(unnormalizedLocalFogVector), 1.0 - noiseInfluence);
 
     //trilinear filtering
@@ -313,7 +305,7 @@ void main()
 
     //// per ray
     const vec3 ndcEndpoint = vec3((vec2(imgCoords) / vec2(resolutionX, resolutionY)) * 2.0 - 1.0, 1.0);
-    const vec4 viewEndpoint = clipToView * vec4(ndcEndpoint, 1.0);
+    const vec4 viewEndpoint = inverseProjection * vec4(ndcEndpoint, 1.0);
     const vec3 rayDirection = normalize(viewEndpoint.xyz / viewEndpoint.w);
 
     //// shared
@@ -345,7 +337,7 @@ void main()
         if(!inSphere)
             continue;
 
-        vec4 clip = projectionMatrix * vec4(rayPosition, 1.0);
+        vec4 clip = projection * vec4(rayPosition, 1.0);
         float depth = clip.z / clip.w;
         depth = depth * 0.5 + 0.5;
         fragmentDepth = min(fragmentDepth, depth);
@@ -359,7 +351,7 @@ void main()
         //directional light effect
         for(int d = 0; d < numDirectionalLightsBound; ++d)
         {
-            vec3 lightDirection = normalize(mat3(viewMatrix) * (-dirLights[d].direction)); //the light direction also has to be transformed to view space, with no translation
+            vec3 lightDirection = normalize(mat3(view) * (-dirLights[d].direction)); //the light direction also has to be transformed to view space, with no translation
             float mu = dot(rayDirection, lightDirection);
             vec3 srcLuminance = dirLights[d].diffuse * CalculateLightEnergy(rayPosition, lightDirection, mu, marchStepSize, maxLightMarchDistance / marchStepSize, inscribedRadius, radiusSquared);
 
@@ -370,7 +362,7 @@ void main()
         for(int p = 0; p < numPointLightsBound; ++p)
         {
             PointLight testedLight = pointLights[p];
-            vec3 lightViewPosition = (viewMatrix * vec4(testedLight.position, 1.0)).xyz;
+            vec3 lightViewPosition = (view * vec4(testedLight.position, 1.0)).xyz;
             float distToLight = length(lightViewPosition - rayPosition);
 
             float attenuation = clamp(1.0 / (testedLight.attenuationConstantTerm + testedLight.attenuationLinearTerm * distToLight + testedLight.attenuationQuadraticTerm * (distToLight * distToLight)), 0.0, 1.0);
@@ -389,7 +381,7 @@ void main()
         for(int s = 0; s < numSpotLightsBound; ++s)
         {
             SpotLight testedLight = spotLights[s];
-            vec3 lightViewPosition = (viewMatrix * vec4(testedLight.position, 1.0)).xyz;
+            vec3 lightViewPosition = (view * vec4(testedLight.position, 1.0)).xyz;
             float distToLight = length(lightViewPosition - rayPosition);
 
             float attenuation = clamp(1.0 / (testedLight.attenuationConstantTerm + testedLight.attenuationLinearTerm * distToLight + testedLight.attenuationQuadraticTerm * (distToLight * distToLight)), 0.0, 1.0);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// the binary files the caches keep (ModelCache, TextureCache, ProgramCache, SceneFile): plain
+// values as they are in memory, the arrays and strings behind a uint32_t count
+class BlobWriter
+{
+public:
+    explicit BlobWriter(std::ostream &stream) : _stream(stream) {}
+
+    template <typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        _stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void writeArray(const std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        writeArray(values.data(), values.size());
+    }
+
+    template <typename T>
+    void writeArray(const T *values, size_t size)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(static_cast<uint32_t>(size));
+        _stream.write(reinterpret_cast<const char *>(values), size * sizeof(T));
+    }
+
+    void writeString(const std::string &value) { writeArray(value.data(), value.size()); }
+
+private:
+    std::ostream &_stream;
+};
+
+// reads from a mapped file (see MappedFile); every read is bounds checked, so a truncated or
+// damaged file only fails to load
+class BlobReader
+{
+public:
+    BlobReader(const std::byte *data, size_t size) : _cursor(data), _end(data + size) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const std::byte *bytes = readBytes(sizeof(T));
+        if (bytes == nullptr)
+            return false;
+
+        std::memcpy(&value, bytes, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool readArray(std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint32_t size = 0;
+        if (!read(size) || remaining() / sizeof(T) < size)
+            return false;
+
+        values.resize(size);
+        std::memcpy(values.data(), readBytes(size * sizeof(T)), size * sizeof(T));
+        return true;
+    }
+
+    bool readString(std::string &value)
+    {
+        uint32_t size = 0;
+        const std::byte *bytes = readArray(size);
+        if (bytes == nullptr)
+            return false;
+
+        value.assign(reinterpret_cast<const char *>(bytes), size);
+        return true;
+    }
+
+    // the next bytes in place, nullptr if they run past the end
+    const std::byte *readBytes(size_t size)
+    {
+        if (remaining() < size)
+            return nullptr;
+
+        const std::byte *bytes = _cursor;
+        _cursor += size;
+        return bytes;
+    }
+
+    // a byte array in place, its size read into `size`
+    const std::byte *readArray(uint32_t &size)
+    {
+        return read(size) ? readBytes(size) : nullptr;
+    }
+
+    size_t remaining() const noexcept { return static_cast<size_t>(_end - _cursor); }
+
+private:
+    const std::byte *_cursor;
+    const std::byte *_end;
+};
+
+// writes the file aside and renames it over, so that a crash never leaves a half-written file
+// behind; the directories are created as needed. False, and nothing written, if `write` returns
+// false or the stream fails
+bool writeAtomically(const std::filesystem::path &file,
+                     const std::function<bool(BlobWriter &writer)> &write);
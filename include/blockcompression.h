@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU encoders for the block-compressed texture formats, so that the texture cache can be built
+// without a GPU. Every format stores 4x4 texel blocks:
+//  BC1: RGB at 4 bits per texel, two 5:6:5 endpoints and four shades between them
+//  BC3: BC1's colours, plus alpha the way BC4 stores it; 8 bits per texel
+//  BC4: a single channel at 4 bits per texel, two 8-bit endpoints and eight shades
+//  BC5: two BC4 channels, e.g. the X and Y of a normal map; 8 bits per texel
+//  BC7: RGBA at 8 bits per texel. Only the modes without partitions are encoded: mode 6 (a pair
+//       of 7.7.7.7 endpoints with a bit shared between the channels, and 16 shades), and for the
+//       translucent blocks mode 5 where it fits better (7.7.7 colour endpoints and 8-bit alpha
+//       ones, with four shades each)
+// The endpoints are fitted along the principal axis of the block's colours, then refined by
+// least squares against the chosen shades
+namespace BlockCompression
+{
+enum class BlockFormat : uint8_t
+{
+    BC1,
+    BC3,
+    BC4,
+    BC5,
+    BC7,
+};
+
+size_t blockSize(BlockFormat format); // in bytes
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// the image is RGBA8, row by row; the blocks over its edges repeat the last row and column.
+// `channels` picks the source channels BC4 (the first one) and BC5 store
+std::vector<uint8_t> compress(const uint8_t *rgba, uint32_t width, uint32_t height,
+                              BlockFormat format, std::array<uint8_t, 2> channels = { 0, 1 });
+} // namespace BlockCompression
@@ -27,7 +27,8 @@ public:
     GLuint getCurrentFramebuffer();
 
     void bindDepthTexture(GLenum target, GLenum textureType, GLuint texIdx) const;
-    void bindColorTexture(GLenum target, GLenum textureType, GLuint texIdx) const;
+    void bindColorTexture(GLenum target, GLenum textureType, GLuint texIdx,
+                          GLuint attachmentIdx = 0) const;
     void setColorMode(GLuint mode) const;
     void setReadMode(GLuint mode) const;
     std::array<GLint, 4> getViewportDims() const;
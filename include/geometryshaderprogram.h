@@ -19,6 +19,8 @@ private:
     const char *_fragmentPath = nullptr;
     const char *_geometryPath = nullptr;
 
+    uint32_t _vertexArray = 0; // the instanced attributes are attached to it
+
     uint32_t _vertexShaderId = 0;
     uint32_t _geometryShaderId = 0;
     uint32_t _fragmentShaderId = 0;
@@ -0,0 +1,10 @@
+#pragma once
+
+// counts the GL objects created for the StartupProfiler, by pointing glad's entry points that
+// create them (the glGen* and glCreate* ones) at counting wrappers until stop restores them, so
+// that nothing is counted or slowed down past the startup. Started once glad is loaded
+namespace GlObjectCounting
+{
+void start();
+void stop();
+} // namespace GlObjectCounting
@@ -2,11 +2,14 @@
 
 #include "instancer.h"
 #include "material.h"
+#include "meshletculler.h"
 #include "shaderprogram.h"
 
 #include <unordered_map>
 #include <unordered_set>
 
+class Camera;
+
 template <typename MaterialStruct>
 class InstancedShader : public ShaderProgram
 {
@@ -14,12 +17,41 @@ public:
     InstancedShader(const char *vertexPath, const char *fragmentPath);
     ~InstancedShader();
 
-    void
-    runTextureMapping();  // this computes the textures used by the objects and puts them into SSBO
-    void runInstancing(); // this instances all the necessary data for the shader.
+    void runTextureMapping(); // this looks up the handle table slots of the objects' textures
+    void runInstancing();     // this instances all the necessary data for the shader.
 
     void updateInstancedBuffer(const std::unordered_set<GameObjectIdentifier> &bjsToUpdate);
 
+    // picks the LOD of every instance from its projected size and regroups the instances into
+    // per-LOD runs when any of them switched
+    void selectLods(const Camera *camera, float viewportHeight);
+
+    // tells TextureStreamer at what resolution the textures of every instance are seen, from its
+    // projected size and the UV density of its mesh; every frame the textures stream
+    void requestTextureResolutions(const Camera *camera, float viewportHeight);
+
+    void setLodsEnabled(bool enabled);
+    bool lodsEnabled() const;
+
+    // the screen-space error (in pixels) the LOD of an instance may have
+    void setLodPixelError(float pixelError);
+    float lodPixelError() const;
+
+    // rejects the off-screen and back-facing meshlets of the instances drawn at the full detail;
+    // for the next runShader, after selectLods
+    void cullMeshlets(const Camera *camera);
+
+    void setMeshletCullingEnabled(bool enabled);
+    bool meshletCullingEnabled() const;
+
+    // in the last runShader
+    size_t numTrianglesDrawn() const;
+    size_t numTrianglesAtFullDetail() const;
+    size_t numMeshletsTested() const;
+    size_t numMeshletsVisible() const;
+    // the instanced draws: one per mesh and LOD
+    size_t numDrawRuns() const;
+
     void runShader() override;
 
 protected:
@@ -27,13 +59,27 @@ protected:
     void deleteShaders() override;
 
 protected:
-    uint32_t _texturesSSBO = 0;
+    // the slots of the objects' textures in the texture handle table
     std::unordered_map<GameObjectIdentifier,
                        std::array<int, getNumTexturesInMaterial<MaterialStruct>()>>
         _objectsTextureMappings;
 
-    std::unordered_map<MeshIdentifier, size_t> _instancedMeshes;
-    std::vector<GLuint> _instancedBufferIds;
+    // a run of objects (in the mesh order) that share a mesh and its LOD
+    struct InstancedMeshRun
+    {
+        MeshIdentifier meshId = InvalidIdentifier;
+        GLuint baseInstance = 0;
+        GLsizei instanceCount = 0;
+        size_t lod = 0;
+    };
+
+    // all the objects share one instanced buffer and one VAO over the mesh arenas, every mesh is
+    // drawn from its base instance
+    std::vector<InstancedMeshRun> _instancedMeshes;
+    std::vector<GameObjectIdentifier> _instancedObjects; // in the order of the instanced buffer
+    std::vector<size_t> _instancedLods;                  // parallel to _instancedObjects
+    GLuint _instancedBufferId = 0;
+    uint32_t _vertexArray = 0;
     const std::vector<GameObjectIdentifier> &getShaderObjectsAsVector();
 
     virtual std::vector<InstancedDataGenerator> getDataGenerators();
@@ -41,6 +87,33 @@ protected:
     size_t _textureHandlesbindingPoint = 0;
 
 private:
+    void regroupLods();
+    glm::mat4 modelMatrixOf(GameObjectIdentifier gId) const;
+
+    // the smaller meshes are drawn whole
+    static constexpr size_t MinMeshletsForCulling = 2;
+
+    // the indirect draws of a run after the meshlet culling, parallel to _instancedMeshes
+    struct CulledRun
+    {
+        bool culled = false;
+        size_t firstCommand = 0;
+        GLsizei numCommands = 0;
+        size_t numTriangles = 0;
+    };
+
+    MeshletCuller _meshletCuller;
+    std::vector<CulledRun> _culledRuns;
+    bool _meshletCullingEnabled = true;
+
+    // a switch needs the error this much past the threshold, so the LODs don't pop back and forth
+    static constexpr float LodHysteresis = 0.25f;
+
+    bool _lodsEnabled = true;
+    float _lodPixelError = 1.0f;
+    size_t _numTrianglesDrawn = 0;
+    size_t _numTrianglesAtFullDetail = 0;
+
     const char *_vertexPath = nullptr;
     const char *_fragmentPath = nullptr;
 
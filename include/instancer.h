@@ -99,13 +99,27 @@ public:
                 bytesAccumulated += generators[g].dataByteSize;
             }
         }
-        glBindVertexArray(targetVertexArray);
 
         GLuint vertexBuffer;
         glGenBuffers(1, &vertexBuffer);
 
         glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, totalBufferLength, buffer, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        attachInstancedBuffer(vertexBuffer, generators, targetVertexArray);
+        return vertexBuffer;
+    }
+
+    // points the instanced attributes of the vertex array at the buffer laid out by `generators`
+    void attachInstancedBuffer(const GLuint instancedBuffer,
+                               const std::vector<InstancedDataGenerator> &generators,
+                               const uint32_t targetVertexArray)
+    {
+        const size_t dataSizePerObject = dataSizeForGenerators(generators);
+
+        glBindVertexArray(targetVertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, instancedBuffer);
 
         size_t bytesMapped = 0;
         for (const InstancedDataGenerator &gen : generators)
@@ -125,7 +139,60 @@ public:
         }
 
         glBindVertexArray(0);
-        return vertexBuffer;
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // regenerates the data of all the objects in one go (in the given order). The buffer is
+    // reallocated only when it has to grow
+    void rewriteInstancedData(
+        const GLuint instancedBuffer,
+        const std::span<const GameObjectIdentifier, std::dynamic_extent> &instancedObjects,
+        const std::vector<InstancedDataGenerator> &generators, size_t &bufferCapacity)
+    {
+        const size_t dataSizePerObject = dataSizeForGenerators(generators);
+        const size_t totalBufferLength = instancedObjects.size() * dataSizePerObject;
+        if (totalBufferLength == 0)
+            return;
+
+#ifdef LINUX
+        void *buffer = std::aligned_alloc(16, totalBufferLength);
+        const auto cleanUp = Utilities::ScopeGuard([buffer]() { std::free(buffer); });
+#endif
+
+#ifdef WINDOWS
+        void *buffer = _aligned_malloc(totalBufferLength, 16);
+        const auto cleanUp = Utilities::ScopeGuard([buffer]() { _aligned_free(buffer); });
+#endif
+
+        size_t bytesAccumulated = 0;
+        for (const GameObjectIdentifier id : instancedObjects)
+        {
+            for (size_t g = 0; g < generators.size(); ++g)
+            {
+                generators[g].func((int8_t *)(buffer) + bytesAccumulated, id);
+                bytesAccumulated += generators[g].dataByteSize;
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instancedBuffer);
+        if (totalBufferLength > bufferCapacity)
+        {
+            glBufferData(GL_ARRAY_BUFFER, totalBufferLength, buffer, GL_DYNAMIC_DRAW);
+            bufferCapacity = totalBufferLength;
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, totalBufferLength, buffer);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    static size_t dataSizeForGenerators(const std::vector<InstancedDataGenerator> &generators)
+    {
+        return std::accumulate(generators.cbegin(), generators.cend(), (size_t)0,
+                               [](size_t rSum, const InstancedDataGenerator &gen) -> size_t {
+                                   return rSum + gen.dataByteSize;
+                               });
     }
 
 private:
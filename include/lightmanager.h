@@ -4,7 +4,7 @@
 
 #include "framebuffermanager.h"
 #include "lightdefs.h"
-#include "randomnamer.h"
+#include "nameregistry.h"
 #include "singleton.h"
 #include "texturemanager.h"
 #include "transformmanager.h"
@@ -154,7 +154,8 @@ public:
 
     void updateLightSourceTransform(LightSourceIdentifier lId)
     {
-        if (_lBufferId == 0)
+        // the free slots of _boundSources hold InvalidIdentifier
+        if (_lBufferId == 0 || lId == InvalidIdentifier)
             return;
 
         auto lightPtr = std::ranges::find(_boundSources, lId);
@@ -186,7 +187,9 @@ public:
             .emplace(++_identifiers,
                      LightComponent{
                          NamedComponent<LightStruct>{
-                             name.empty() ? RandomNamer::instance()->getRandomName(7) : name,
+                             name.empty()
+                                 ? NameRegistry::instance()->internAnonymous("light")
+                                 : NameRegistry::instance()->intern(name),
                              LightStruct() },
                          lightTId })
             .first->first;
@@ -196,8 +199,9 @@ public:
     {
         auto lightPtr = _lightComponents.find(lId);
 
-        return lightPtr == _lightComponents.end() ? std::string()
-                                                  : lightPtr->second.first.componentName;
+        return lightPtr == _lightComponents.end()
+                   ? std::string()
+                   : NameRegistry::instance()->name(lightPtr->second.first.componentName);
     }
 
     LightStruct *getLight(LightSourceIdentifier lId)
@@ -14,6 +14,7 @@ protected:
 
 private:
     MeshIdentifier _lightMesh = InvalidIdentifier;
+    uint32_t _vertexArray = 0; // the instanced attributes are attached to it
 
     const char *_vertexPath = ENGINE_SHADERS "/light_source.vs";
     const char *_fragmentPath = ENGINE_SHADERS "/light_source.fs";
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+// a read-only view of a whole file. It is memory-mapped where the platform allows it (so the
+// pages are only read in as they're touched), and read into memory elsewhere
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    // false for the files that couldn't be opened, and for the empty ones
+    bool isOpen() const noexcept { return _data != nullptr; }
+
+    const std::byte *data() const noexcept { return _data; }
+    size_t size() const noexcept { return _size; }
+
+private:
+    const std::byte *_data = nullptr;
+    size_t _size = 0;
+
+#if defined(WINDOWS)
+    void *_file = nullptr;
+    void *_mapping = nullptr;
+#elif !defined(LINUX)
+    std::vector<std::byte> _contents;
+#endif
+};
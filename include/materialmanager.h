@@ -2,11 +2,12 @@
 
 #include "glad/glad.h"
 
+#include "nameregistry.h"
 #include "objectmanager.h"
-#include "randomnamer.h"
 #include "singleton.h"
 #include "texturemanager.h"
 #include "types.h"
+#include "utils.h"
 
 #include <array>
 #include <concepts>
@@ -14,6 +15,7 @@
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 template <typename MaterialStruct>
 concept HasTextures = requires(MaterialStruct mS) {
@@ -33,125 +35,111 @@ public:
     friend class SystemSingleton<MaterialManager<MaterialStruct, MaterialType>>;
     using NamedMaterial = NamedComponent<MaterialStruct>;
 
-    // TODO: I may want to compute hashes of the enclosed texure identifiers to check if the
-    // porvided material exists already
+    // a material with the same textures as one registered before gets its identifier, under the
+    // new name too, unless the deduplication is off. The material's textures get their slots in
+    // the texture handle table here
     std::pair<std::string, MaterialIdentifier> registerMaterial(MaterialStruct &&newMaterial)
     {
-        const auto rName = RandomNamer::instance()->getRandomName(10);
-        const auto id = registerMaterial(std::move(newMaterial), rName);
-        return std::make_pair(rName, id);
+        const NameIdentifier nameId = NameRegistry::instance()->internAnonymous("material");
+        const auto id = registerMaterial(std::move(newMaterial), nameId);
+        return std::make_pair(NameRegistry::instance()->name(nameId), id);
     }
 
     MaterialIdentifier registerMaterial(MaterialStruct &&newMaterial, const std::string &matName)
     {
-        if (const MeshIdentifier mi = materialRegistered(matName); mi != InvalidIdentifier)
-            return mi;
-
-        _materials.emplace(++_identifiers, NamedMaterial{ matName, std::move(newMaterial) });
-        return _identifiers;
+        return registerMaterial(std::move(newMaterial), NameRegistry::instance()->intern(matName));
     }
 
-    // for each of the provided objects, returns an array listing the indices for the textures
-    // of its material in the uniform buffer of texture handles
-    std::unordered_map<GameObjectIdentifier, std::array<int, textureCount>> bindTextures(
-        const std::vector<GameObjectIdentifier> &objects, uint32_t bindingPoint,
-        uint32_t &textureBufferIdx)
+    // every name the material was registered under is a reference to it, and unregistering drops
+    // one; with the last, the material releases its slots in the texture handle table and goes,
+    // along with all its names
+    void unregisterMaterial(MaterialIdentifier id)
     {
-        using TextureHandle = GLuint64;
-
-        // run over all objects and determine the required textures + obtain handles
-        std::unordered_map<TextureIdentifier, TextureHandle> texturesToHandles;
-        std::ranges::for_each(objects, [&, this](GameObjectIdentifier gId) {
-            const MaterialIdentifier mId
-                = ObjectManager::instance()->getObject(gId).getIdentifierForComponent(MaterialType);
-
-            if (mId == InvalidIdentifier)
-                return; // some objects may not have materials on them
-
-            const MaterialStruct &mS = getMaterial(mId);
-
-            for (const TextureIdentifier tId : mS.textures())
-            {
-                if (tId == InvalidIdentifier || texturesToHandles.contains(tId))
-                    continue;
-
-                TextureManager::instance()->allocateTexture(tId);
-#if ENGINE_DISABLE_BINDLESS_TEXTURES
-                texturesToHandles.emplace(std::make_pair(tId, tId));
-#else
-                const TextureHandle texHandle = glGetTextureHandleARB(
-                    *TextureManager::instance()->getTexture(tId)); //stuff in the parentheses obtains the gl texture id
-                assert(texHandle != 0);
+        const auto materialPtr = _materials.find(id);
+        if (materialPtr == _materials.end())
+            return;
 
-                texturesToHandles.emplace(std::make_pair(tId, texHandle));
-
-                glMakeTextureHandleResidentARB(texHandle);
-#endif
-            }
-        });
-
-        // create an array of handles -> bind them
-        std::vector<TextureHandle> uniformHandles;
-        uniformHandles.reserve(texturesToHandles.size());
-
-        std::unordered_map<TextureHandle, int> handleToIndex;
-        handleToIndex.reserve(texturesToHandles.size());
+        if (const auto references = _numReferences.find(id);
+            references != _numReferences.end() && --references->second > 0)
+        {
+            return;
+        }
+        _numReferences.erase(id);
 
-        for (int m = 0; m < texturesToHandles.size(); ++m)
+        for (const TextureIdentifier tId : materialPtr->second.componentData.textures())
         {
-            const TextureHandle handle = std::next(texturesToHandles.begin(), m)->second;
-            uniformHandles.emplace_back(handle);
-            handleToIndex.emplace(std::make_pair(handle, m));
+            if (tId != InvalidIdentifier)
+                TextureManager::instance()->releaseHandleSlot(tId);
         }
 
-        glCreateBuffers(1, &textureBufferIdx);
-        glNamedBufferStorage(textureBufferIdx, uniformHandles.size() * sizeof(TextureHandle),
-                             (const void *)uniformHandles.data(), GL_DYNAMIC_STORAGE_BIT);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, textureBufferIdx);
+        std::erase_if(_materialsByName, [id](const auto &name) { return name.second == id; });
+        std::erase_if(_materialsByContent,
+                      [id](const auto &shared) { return shared.second == id; });
+        _materials.erase(materialPtr);
+    }
 
-        // run over all objects and for each determine the indices of the textures in the bound buffer
-        std::unordered_map<GameObjectIdentifier, std::array<int, textureCount>> objectIndices;
-        objectIndices.reserve(objects.size());
+    // for the materials registered from now on
+    void setContentDeduplication(bool enabled) { _deduplicate = enabled; }
+    // materials take no GPU memory of their own, only their texture slots
+    DeduplicationStatistics deduplicationStatistics() const noexcept { return _deduplication; }
+
+    // for each of the provided objects, returns an array listing the slots of the textures of its
+    // material in the texture handle table (see TextureManager::acquireHandleSlot), -1 where there
+    // is none. The slots stay put, so the arrays stay valid while the materials are registered;
+    // the textures not uploaded yet are uploaded here
+    std::unordered_map<GameObjectIdentifier, std::array<int, textureCount>> textureSlots(
+        const std::vector<GameObjectIdentifier> &objects)
+    {
+        // the textures not allocated yet are decoded in parallel up front, so that the
+        // allocations below only upload them
+        std::vector<TextureIdentifier> objectTextures;
+        for (const GameObjectIdentifier gId : objects)
+        {
+            const MaterialIdentifier mId
+                = ObjectManager::instance()->getObject(gId).getIdentifierForComponent(MaterialType);
+            if (mId == InvalidIdentifier)
+                continue;
+
+            const auto materialTextures = getMaterial(mId).textures();
+            objectTextures.insert(objectTextures.end(), materialTextures.begin(),
+                                  materialTextures.end());
+        }
+        TextureManager::instance()->prefetchTextures(objectTextures);
 
-        std::ranges::for_each(objects, [&, this](GameObjectIdentifier gId) {
+        std::unordered_map<GameObjectIdentifier, std::array<int, textureCount>> objectSlots;
+        objectSlots.reserve(objects.size());
+        for (const GameObjectIdentifier gId : objects)
+        {
             const MaterialIdentifier mId
                 = ObjectManager::instance()->getObject(gId).getIdentifierForComponent(MaterialType);
-            std::array<int, textureCount> objArray;
 
-            if (mId == InvalidIdentifier)
+            std::array<int, textureCount> slots;
+            slots.fill(-1); // some objects may not have materials on them
+            if (mId != InvalidIdentifier)
             {
-                for (int g = 0; g < textureCount; ++g) // object has no material bound
+                const std::array<TextureIdentifier, textureCount> textures
+                    = getMaterial(mId).textures();
+                for (size_t t = 0; t < textureCount; ++t)
                 {
-                    objArray[g] = -1;
-                }
-            }
-            else
-            {
-                const MaterialStruct &mS = getMaterial(mId);
-
-                const std::array<TextureIdentifier, textureCount> objTextures = mS.textures();
+                    if (textures[t] == InvalidIdentifier)
+                        continue;
 
-                for (int g = 0; g < textureCount; ++g)
-                {
-                    if (objTextures[g] == InvalidIdentifier)
-                        objArray[g] = -1;
-                    else
-                        objArray[g] = handleToIndex[texturesToHandles[objTextures[g]]];
+                    // the slot gets the handle with the upload
+                    TextureManager::instance()->allocateTexture(textures[t]);
+                    slots[t] = TextureManager::instance()->handleSlot(textures[t]);
                 }
             }
 
-            objectIndices.emplace(std::make_pair(gId, objArray));
-        });
+            objectSlots.emplace(gId, slots);
+        }
 
-        return objectIndices;
+        return objectSlots;
     }
 
     MaterialIdentifier materialRegistered(const std::string &matName) const
     {
-        const auto matPtr = std::ranges::find_if(_materials, [&matName](const auto &pair) {
-            return pair.second.componentName == matName;
-        });
-        return matPtr == _materials.end() ? InvalidIdentifier : matPtr->first;
+        const auto namePtr = _materialsByName.find(NameRegistry::instance()->find(matName));
+        return namePtr == _materialsByName.end() ? InvalidIdentifier : namePtr->second;
     }
 
     const MaterialStruct &getMaterial(MaterialIdentifier id)
@@ -164,8 +152,48 @@ public:
 private:
     MaterialManager() = default;
 
+    MaterialIdentifier registerMaterial(MaterialStruct &&newMaterial, NameIdentifier nameId)
+    {
+        if (const auto namePtr = _materialsByName.find(nameId); namePtr != _materialsByName.end())
+            return namePtr->second;
+
+        // the textures are deduplicated already, so their identifiers are the content
+        const std::array<TextureIdentifier, textureCount> textures = newMaterial.textures();
+        uint64_t hash = Utilities::HashBasis;
+        for (const TextureIdentifier tId : textures)
+            hash = Utilities::hashCombine(hash, tId);
+
+        if (const auto shared = _materialsByContent.find(hash);
+            _deduplicate && shared != _materialsByContent.end()
+            && getMaterial(shared->second).textures() == textures)
+        {
+            _materialsByName.emplace(nameId, shared->second);
+            ++_numReferences[shared->second];
+            ++_deduplication.numShared;
+            return shared->second;
+        }
+
+        // the textures are referenced from the handle table for as long as the material lives
+        for (const TextureIdentifier tId : textures)
+        {
+            if (tId != InvalidIdentifier)
+                TextureManager::instance()->acquireHandleSlot(tId);
+        }
+
+        _materials.emplace(++_identifiers, NamedMaterial{ nameId, std::move(newMaterial) });
+        _materialsByName.emplace(nameId, _identifiers);
+        _numReferences.emplace(_identifiers, 1);
+        _materialsByContent.try_emplace(hash, _identifiers);
+        return _identifiers;
+    }
+
 private:
     MaterialIdentifier _identifiers = InvalidIdentifier;
 
     std::unordered_map<MaterialIdentifier, NamedMaterial> _materials;
+    std::unordered_map<NameIdentifier, MaterialIdentifier> _materialsByName;
+    std::unordered_map<uint64_t, MaterialIdentifier> _materialsByContent;
+    std::unordered_map<MaterialIdentifier, uint32_t> _numReferences; // the names of each
+    bool _deduplicate = true;
+    DeduplicationStatistics _deduplication;
 };
@@ -5,6 +5,9 @@
 #include <cstdint>
 #include <vector>
 
+class BlobReader;
+class BlobWriter;
+
 #pragma pack(push, 1)
 struct Vertex
 {
@@ -12,27 +15,85 @@ struct Vertex
     float texCoordinates[2] = { 0.0f, 0.0f };
     float normal[3] = { 0.0f, 0.0f, 0.0f };
 };
+
+// the GPU encoding of Vertex (+ tangent) unless ENGINE_FULL_FLOAT_VERTICES is set; 20 bytes
+// instead of 44. The shaders decode it (see the vertex shaders)
+struct CompactVertex
+{
+    uint16_t position[4] = { 0, 0, 0, 0 }; // unorm, relative to the mesh bounds; w pads
+    int16_t normal[2] = { 0, 0 };          // octahedral, snorm
+    uint16_t texCoordinates[2] = { 0, 0 }; // half floats
+    int8_t tangent[4] = { 0, 0, 0, 0 };    // octahedral snorm, then the handedness; w pads
+};
 #pragma pack(pop)
 
+static_assert(sizeof(CompactVertex) == 20);
+
+// a coarser version of a mesh, indexing the same vertices
+struct MeshLod
+{
+    std::vector<uint32_t> indices;
+    float error = 0.0f; // the geometric deviation, relative to the bounding radius of the mesh
+};
+
+// a cluster of the triangles of a mesh, contiguous in its index buffer, with the bounds to cull it
+struct Meshlet
+{
+    uint32_t firstIndex = 0; // relative to the mesh
+    uint32_t numIndices = 0;
+
+    glm::vec3 center = glm::vec3(0.0f); // bounding sphere
+    float radius = 0.0f;
+
+    // the triangle normals are within the cone around the axis; a zero axis never culls
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f; // sine of the cone's angle
+};
+
+// what happens to the CPU copy of a mesh once it's in the arenas
+enum class MeshResidency : uint8_t
+{
+    KeepCpuCopy,
+    ReleaseAfterUpload, // whatever is needed later is read back from the arenas
+    ReloadFromCache,    // spilled to the mesh cache and read from there when needed
+};
+
+// the CPU side of a mesh. The GPU data lives in the shared arenas of MeshManager, where the mesh
+// is a range of indices (drawn with its base vertex), followed by the ranges of its LODs
 struct Mesh
 {
+    friend class MeshManager;
+
     Mesh() = default;
+    // move-only: the streams are large and the managers own the only copy
+    Mesh(const Mesh &other) = delete;
+    Mesh &operator=(const Mesh &other) = delete;
+    Mesh(Mesh &&other) = default;
+    Mesh &operator=(Mesh &&other) = default;
+
     Mesh(std::vector<Vertex> &&meshVertices, std::vector<uint32_t> &&meshIndices,
-         std::vector<glm::vec3> &&tangentVectors = {});
-    ~Mesh();
+         std::vector<glm::vec3> &&tangentVectors = {}, std::vector<MeshLod> &&lodChain = {},
+         std::vector<Meshlet> &&meshletList = {});
 
     bool isAllocated() const noexcept;
-    void allocateMesh();
-    void deallocateMesh();
 
-    void bindMesh() const;
+    MeshResidency residency() const noexcept;
+    // whether the vertices and indices are (still) on the CPU; the counts always are
+    bool isCpuResident() const noexcept;
+    // the bytes held by the CPU copy
+    size_t cpuSize() const noexcept;
 
-    void enableInstancing();
-    bool instancingEnabled() const;
-    void bindMeshInstanced();
+    // offset (in bytes) of the first index in the index arena
+    uint32_t indexByteOffset() const noexcept;
+    uint32_t indexByteOffset(size_t lod) const noexcept;
+    // GL_UNSIGNED_SHORT for the meshes of up to 65536 vertices, GL_UNSIGNED_INT otherwise
+    uint32_t indexType() const noexcept;
+    // added to every index of the mesh; the vertices of the meshes are laid one after another
+    int32_t baseVertex() const noexcept;
 
-    uint32_t standardArrayId() const noexcept;
-    uint32_t instancedArrayId() const noexcept;
+    // the positions in the arena are decoded as offset + position * scale
+    glm::vec3 positionScale() const noexcept;
+    glm::vec3 positionOffset() const noexcept;
 
     // size in bytes
     uint32_t verticesSize() const;
@@ -44,15 +105,60 @@ struct Mesh
 
     uint32_t numIndices() const;
 
+    // the base mesh is the level 0; the levels get coarser from there
+    size_t numLods() const noexcept;
+    uint32_t numIndices(size_t lod) const;
+    float lodError(size_t lod) const;
+
+    // the meshlets of the base level; empty for the meshes that weren't split
+    const std::vector<Meshlet> &meshletData() const noexcept;
+
+    // the bounding sphere of the vertices, in model space
+    glm::vec3 boundsCenter() const noexcept;
+    float boundsRadius() const noexcept;
+    // the texture coordinates' units per model-space unit, on average over the surface; 0 for
+    // the meshes without texture coordinates
+    float uvDensity() const noexcept;
+    // of the vertex, index and tangent streams, which the mesh manager shares the identical
+    // meshes by; 0 for the empty meshes
+    uint64_t contentHash() const noexcept;
+
     uint32_t tangentsSize() const;
 
+    // CPU copies of the streams; empty once released, see MeshManager::meshPositions
+    std::vector<glm::vec3> positions() const;
+    const std::vector<uint32_t> &indexData() const noexcept;
+
+private:
+    void releaseCpuData();
+
+    // the streams (and the LOD indices) as a flat binary blob, for the mesh cache
+    void writeCpuData(BlobWriter &writer) const;
+    bool readCpuData(BlobReader &reader);
+
 private:
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::vector<glm::vec3> tangents;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    float uvsPerUnit = 0.0f;
+    uint64_t hash = 0;
 
-    uint32_t vId = 0; // vbo
-    uint32_t id = 0;  // vao
+    MeshResidency residencyPolicy = MeshResidency::KeepCpuCopy;
+    bool cpuResident = true;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    std::vector<uint32_t> lodIndexCounts;
 
-    uint32_t instancedId = 0;
+    bool allocated = false;
+    uint32_t arenaIndexByteOffset = 0;
+    std::vector<uint32_t> arenaLodIndexByteOffsets;
+    uint32_t arenaIndexType = 0;
+    int32_t arenaBaseVertex = 0;
+    glm::vec3 arenaPositionScale = glm::vec3(1.0f);
+    glm::vec3 arenaPositionOffset = glm::vec3(0.0f);
 };
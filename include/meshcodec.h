@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// lossless compression of the mesh streams, for the baked models on disk.
+//
+// Vertices: the streams are taken as 32-bit words. Every word is delta coded against the same
+// word of the previous vertex and zigzagged, so the small changes between neighbouring vertices
+// (which the vertex fetch optimization makes the common case) become small numbers. The bytes
+// are then transposed into planes per block of vertices, and every 16 bytes of a plane are
+// stored with the fewest bits (0, 2, 4 or 8) that fit all of them. The decoder has no branches
+// per value, and its loops run over plain arrays the compiler can vectorize.
+//
+// Indices: a triangle mostly shares an edge with one of the last few triangles, and its third
+// vertex is mostly either the next vertex not seen yet or a recent one. A byte per triangle says
+// which edge (in a FIFO of the recent ones) and which kind of third vertex, so a well ordered
+// mesh takes little more than a byte per triangle. The triangle order and winding are kept
+// exactly, the rotation of each triangle included
+namespace MeshCodec
+{
+// the stride has to be a multiple of 4
+std::vector<uint8_t> encodeVertices(const void *vertices, size_t numVertices, size_t stride);
+// false if the data is damaged or doesn't have the expected vertex count
+bool decodeVertices(void *vertices, size_t numVertices, size_t stride, const uint8_t *data,
+                    size_t size);
+
+// triangle lists only: the index count has to be a multiple of 3
+std::vector<uint8_t> encodeIndices(const uint32_t *indices, size_t numIndices);
+bool decodeIndices(uint32_t *indices, size_t numIndices, const uint8_t *data, size_t size);
+} // namespace MeshCodec
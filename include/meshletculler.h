@@ -0,0 +1,50 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "meshmanager.h"
+#include "types.h"
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// culls the meshlets of mesh instances against the frustum (bounding spheres) and the camera
+// position (normal cones) on the CPU, and collects indirect draws of the visible ones. Adjacent
+// visible meshlets are merged into one draw, so a fully visible instance is still a single draw.
+// The tests run in the model space of the instance, so any (non-mirroring) transform works
+class MeshletCuller
+{
+public:
+    ~MeshletCuller();
+
+    void beginFrame(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+
+    // appends the draws of the visible meshlets of the instance; returns their count
+    size_t cullInstance(const Mesh &mesh, const glm::mat4 &modelMatrix, GLuint instance);
+
+    // uploads the commands of the frame; they're drawn with the buffer bound to
+    // GL_DRAW_INDIRECT_BUFFER
+    void uploadCommands();
+    GLuint commandBuffer() const noexcept { return _commandBuffer; }
+    size_t numCommands() const noexcept { return _commands.size(); }
+
+    // of the frame, for the statistics
+    size_t numMeshletsTested() const noexcept { return _numMeshletsTested; }
+    size_t numMeshletsVisible() const noexcept { return _numMeshletsVisible; }
+    size_t numTrianglesVisible() const noexcept { return _numTrianglesVisible; }
+
+private:
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+    glm::vec3 _cameraPosition = glm::vec3(0.0f);
+
+    std::vector<MeshManager::DrawElementsIndirectCommand> _commands;
+    GLuint _commandBuffer = 0;
+    size_t _commandCapacity = 0;
+
+    size_t _numMeshletsTested = 0;
+    size_t _numMeshletsVisible = 0;
+    size_t _numTrianglesVisible = 0;
+};
@@ -4,33 +4,104 @@
 #include "singleton.h"
 #include "types.h"
 
+#include <glad/glad.h>
+
+#include <array>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+// all the allocated meshes are packed into shared vertex, tangent and index arenas with a single
+// vertex format. A mesh is then only an (index offset, base vertex, count) record, so switching
+// meshes needs no VAO rebind and several meshes can be drawn by one multi-draw
 class MeshManager : public SystemSingleton<MeshManager>
 {
 public:
     friend class SystemSingleton;
     using NamedMesh = NamedComponent<Mesh>;
 
-    MeshIdentifier registerMesh(const Mesh &&mesh, const std::string &name);
-    [[nodiscard]] std::pair<std::string, MeshIdentifier> registerMesh(const Mesh &&mesh);
+    // the vertex buffer bindings of the arena streams; high enough not to collide with the
+    // instanced attributes set up through glVertexAttribPointer (which use binding = location)
+    static constexpr GLuint VertexStreamBinding = 14;
+    static constexpr GLuint TangentStreamBinding = 15; // only used by the full float vertices
+
+    // generic (non-array) attributes the vertex shaders decode the positions with; set per draw
+    static constexpr GLuint PositionScaleLocation = 14;
+    static constexpr GLuint PositionOffsetLocation = 15;
+
+    // the layout glMultiDrawElementsIndirect expects
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count = 0;
+        GLuint instanceCount = 0;
+        GLuint firstIndex = 0; // in indices of the mesh's index type, from the arena start
+        GLint baseVertex = 0;
+        GLuint baseInstance = 0;
+    };
+
+    // the CPU memory per residency policy, and what the arenas hold on the GPU
+    struct MemoryReport
+    {
+        std::array<size_t, 3> cpuBytes = {}; // indexed by MeshResidency
+        std::array<size_t, 3> numMeshes = {};
+        size_t gpuBytes = 0;
+    };
+
+    // the mesh is moved in; it gets the default residency policy. A mesh with the same streams as
+    // one registered before (see Mesh::contentHash) is dropped, and the name refers to the first
+    // one, unless the deduplication is off or the first one has released its CPU copy
+    MeshIdentifier registerMesh(Mesh &&mesh, const std::string &name);
+    [[nodiscard]] std::pair<std::string, MeshIdentifier> registerMesh(Mesh &&mesh);
 
+    // every name the mesh was registered under is a reference to it, and unregistering drops one;
+    // with the last, the mesh gives its arena ranges back and goes, along with all its names
     void unregisterMesh(MeshIdentifier id);
-    [[nodiscard]] MeshIdentifier meshRegistered(const std::string &meshName);
+    [[nodiscard]] MeshIdentifier meshRegistered(const std::string &meshName) const;
 
+    // uploads the mesh to the arenas, then applies its residency policy to the CPU copy
     void allocateMesh(MeshIdentifier id);
     void deallocateMesh(MeshIdentifier id);
 
+    // for the meshes registered from now on
+    void setDefaultResidency(MeshResidency residency);
+    MeshResidency defaultResidency() const noexcept { return _defaultResidency; }
+    // an allocated mesh releases its CPU copy right away if the new policy asks for it
+    void setMeshResidency(MeshIdentifier id, MeshResidency residency);
+
+    // the positions and indices of the base level, wherever they are: the CPU copy, the mesh
+    // cache or (read back from) the arenas. Empty if the mesh is gone from all of them. The read
+    // back waits for the GPU, so it's for the loading and the tools rather than for a frame
+    std::vector<glm::vec3> meshPositions(MeshIdentifier id) const;
+    std::vector<uint32_t> meshIndices(MeshIdentifier id) const;
+
+    MemoryReport memoryReport() const;
+
+    // for the meshes registered from now on
+    void setContentDeduplication(bool enabled);
+    DeduplicationStatistics deduplicationStatistics() const noexcept { return _deduplication; }
+
+    // binds the shared VAO (the same one for every mesh)
     int bindMesh(MeshIdentifier id);
-    int bindMeshInstanced(MeshIdentifier id);
     void unbindMesh();
     MeshIdentifier getDummyMesh() const;
 
-    void enableMeshInstancing(MeshIdentifier id);
+    // draws the range of the mesh from the arenas; expects a VAO over the arenas to be bound.
+    // The LODs past the coarsest one of the mesh draw the coarsest one
+    void drawMesh(MeshIdentifier id) const;
+    void drawMeshInstanced(MeshIdentifier id, GLsizei instanceCount, GLuint baseInstance,
+                           size_t lod = 0) const;
+    // draws commands over the ranges of a single mesh (e.g. its meshlets) from the bound
+    // GL_DRAW_INDIRECT_BUFFER
+    void drawMeshIndirect(MeshIdentifier id, size_t firstCommand, GLsizei numCommands) const;
+
+    // one more VAO over the arenas, for the shaders that attach their instanced attributes to it.
+    // It is kept pointing at the arenas when they grow, until released
+    uint32_t createVertexArray();
+    // the same over the positions only (location 0), for the depth-only passes
+    uint32_t createPositionVertexArray();
+    void releaseVertexArray(uint32_t vertexArray);
 
     void cleanUpGracefully();
 
@@ -43,10 +114,68 @@ private:
         allocateMesh(_dummyMesh);
     }
 
+    MeshIdentifier registerMesh(Mesh &&mesh, NameIdentifier nameId);
+    // the same streams as a registered mesh with the same hash, which could be a collision: the
+    // bytes are compared if the registered mesh still has them on the CPU or in the mesh cache
+    bool sameContent(MeshIdentifier sharedId, const Mesh &mesh) const;
+    static bool sameStreams(const Mesh &shared, const Mesh &mesh);
+    // in the arenas
+    static size_t gpuSize(const Mesh &mesh);
+
+    // releases the CPU copy of an allocated mesh if its policy asks for it; the meshes to be
+    // reloaded are written to the cache first, and kept if that fails
+    void applyResidency(MeshIdentifier id, Mesh &mesh) const;
+    // a mesh with the CPU copy of a cached one; not CPU resident if the cache misses
+    Mesh loadCachedMesh(MeshIdentifier id, const Mesh &mesh) const;
+
+    // a run of unused space in an arena, in vertices or in bytes
+    struct ArenaRange
+    {
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    // the offset for `size` units aligned to `alignment`: the first free range that fits, which
+    // is taken out of the list, else the (aligned) end of the arena
+    static size_t placeInArena(std::vector<ArenaRange> &freeRanges, size_t arenaEnd, size_t size,
+                               size_t alignment);
+    // the range joins its free neighbours; what ends up at the end of the arena shrinks it
+    static void returnToArena(std::vector<ArenaRange> &freeRanges, size_t &arenaEnd,
+                              ArenaRange range);
+    // the base level and all the LODs
+    static size_t arenaIndexBytes(const Mesh &mesh);
+
+    void reserveArenas(size_t numVertices, size_t numIndexBytes);
+    void attachArenas(uint32_t vertexArray) const;
+    void setPositionDecoding(const Mesh &mesh) const;
+
 private:
     MeshIdentifier _identifiers = 0;
     std::unordered_map<MeshIdentifier, NamedMesh> _meshes;
+    std::unordered_map<NameIdentifier, MeshIdentifier> _meshesByName;
+    std::unordered_map<uint64_t, MeshIdentifier> _meshesByContent;
+    std::unordered_map<MeshIdentifier, uint32_t> _numReferences; // the names of each
+    bool _deduplicate = true;
+    DeduplicationStatistics _deduplication;
     MeshIdentifier _boundMesh = 0;
 
     MeshIdentifier _dummyMesh = InvalidIdentifier;
+    MeshResidency _defaultResidency = MeshResidency::KeepCpuCopy;
+
+    // the arenas only grow. A deallocated mesh keeps its ranges for when it's allocated again;
+    // an unregistered one's go to the free lists, where the new meshes are placed first.
+    // The index arena mixes 16 and 32-bit ranges, so it is measured in bytes
+    GLuint _vertexArena = 0;
+    GLuint _tangentArena = 0;
+    GLuint _indexArena = 0;
+    size_t _vertexCapacity = 0;
+    size_t _indexByteCapacity = 0;
+    // the ends of the used parts, the free ranges included
+    size_t _numArenaVertices = 0;
+    size_t _numArenaIndexBytes = 0;
+    std::vector<ArenaRange> _freeVertexRanges; // ordered by offset, never adjacent
+    std::vector<ArenaRange> _freeIndexRanges;  // likewise
+
+    uint32_t _sharedVertexArray = 0;
+    std::vector<uint32_t> _vertexArrays; // all the VAOs over the arenas, the shared one included
 };
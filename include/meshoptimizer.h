@@ -0,0 +1,68 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+// import-time reordering of the mesh data for the GPU: triangles for the post-transform vertex
+// cache (Tipsify) and then for overdraw, vertices for the pre-transform fetch. Also builds the
+// LOD chains by simplifying the index buffers, and splits the meshes into meshlets
+namespace MeshOptimizer
+{
+constexpr size_t DefaultCacheSize = 16;
+constexpr size_t DefaultMaxLods = 4;
+constexpr float DefaultMaxLodError = 0.05f;
+constexpr size_t MaxMeshletVertices = 64;
+constexpr size_t MaxMeshletTriangles = 124;
+
+struct VertexCacheStatistics
+{
+    float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle
+    float atvr = 0.0f; // average transform to vertex ratio: transformed vertices per vertex
+};
+
+// simulates a FIFO post-transform cache of the given size
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                         size_t numVertices,
+                                         size_t cacheSize = DefaultCacheSize);
+
+// Tipsify (Sander et al., 2007). Fills `clusterStarts` (in triangles) with the points where the
+// fanning had to jump to a vertex no longer in the cache
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t numVertices,
+                         std::vector<uint32_t> &clusterStarts,
+                         size_t cacheSize = DefaultCacheSize);
+
+// splits the clusters further wherever that costs at most `threshold` x the cache efficiency,
+// then orders them so that the outward facing ones (which occlude the rest) are drawn first
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+                      const std::vector<uint32_t> &clusterStarts, float threshold = 1.05f,
+                      size_t cacheSize = DefaultCacheSize);
+
+// lays the vertices out in the order they are first referenced and remaps the indices; the
+// tangents (if present) are kept parallel to the vertices. Unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                         std::vector<glm::vec3> &tangents);
+
+// quadric error edge collapses (Garland & Heckbert, 1997) onto the existing vertices, so the
+// result indexes the same vertex buffer. Vertices on the UV / normal seams stay in place and the
+// open borders only collapse along themselves. Stops at `targetIndexCount` or before the error
+// (relative to the bounding radius) would exceed `maxError`; returns the error reached
+float simplify(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+               size_t targetIndexCount, float maxError);
+
+// halves the triangles for every level (each simplified from the base indices and ordered for
+// the vertex cache) until the simplification stops paying off
+std::vector<MeshLod> generateLodChain(const std::vector<uint32_t> &indices,
+                                     const std::vector<Vertex> &vertices,
+                                     size_t maxLods = DefaultMaxLods,
+                                     float maxError = DefaultMaxLodError);
+
+// cuts the triangles, in their current order, into runs of at most MaxMeshletVertices distinct
+// vertices and MaxMeshletTriangles triangles, so every meshlet is a range of the index buffer.
+// After the cache optimization these runs are compact fans, i.e. tight spheres and narrow cones
+std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t> &indices,
+                                   const std::vector<Vertex> &vertices);
+} // namespace MeshOptimizer
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// the mip chains of the textures, built on the CPU so that they can be baked into the texture
+// cache and no upload has to generate them. Every level is filtered from the one above it in
+// floating point: the sRGB colours in linear light, the normals as vectors, renormalized on
+// every level. The rows of a level are spread over the loader threads
+namespace MipChain
+{
+enum class Filter : uint8_t
+{
+    Box,    // the average of the 2x2 texels above
+    Kaiser, // a Kaiser-windowed sinc over 6x6 texels: sharper, with a little ringing
+};
+
+struct Settings
+{
+    Filter filter = Filter::Kaiser;
+    bool srgb = false;      // the RGB is sRGB encoded; the alpha is always linear
+    bool normalMap = false; // the RGB is a unit vector, 0 to 255 for -1 to 1
+    // the alpha test's reference (0 to 1), or 0 if the alpha is blended. The alpha of every level
+    // is then scaled so that as many of its texels pass the test as in the full size, rather
+    // than the alpha-tested details thinning out in the distance
+    float alphaCutoff = 0.0f;
+};
+
+// the levels down to 1x1, each half the size of the one above (rounded down)
+uint32_t numLevels(uint32_t width, uint32_t height, uint32_t depth = 1);
+
+// the image is RGBA8, row by row, and becomes the first level
+std::vector<std::vector<uint8_t>> generate(std::vector<uint8_t> &&rgba, uint32_t width,
+                                           uint32_t height, const Settings &settings);
+
+// for a volume of 8-bit texels with `numChannels` channels, the slices one after another; box
+// filtered, the depth halving too. The first channels are sRGB encoded colours if `srgb`
+std::vector<std::vector<uint8_t>> generateVolume(std::vector<uint8_t> &&texels, uint32_t width,
+                                                 uint32_t height, uint32_t depth,
+                                                 uint32_t numChannels, bool srgb);
+} // namespace MipChain
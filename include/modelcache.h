@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// an imported model as the loader instantiates it: the meshes after the GPU optimizations, the
+// texture references of the materials and the node hierarchy
+struct BakedModel
+{
+    struct Material
+    {
+        // the first texture of every type the loader looks for, as (aiTextureType, path
+        // relative to the model root)
+        std::vector<std::pair<uint32_t, std::string>> textures;
+    };
+
+    struct MeshData
+    {
+        std::string name; // empty for the anonymous meshes
+        uint32_t material = 0;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<glm::vec3> tangents;
+        std::vector<MeshLod> lods;
+        std::vector<Meshlet> meshlets;
+    };
+
+    struct Node
+    {
+        std::vector<uint32_t> meshes;
+        std::vector<uint32_t> children; // always after the node itself
+    };
+
+    std::vector<Material> materials;
+    std::vector<MeshData> meshes;
+    std::vector<Node> nodes; // the root first
+};
+
+// the baked models on disk, so that loading a model again skips assimp and the mesh
+// optimizations. A cache file is keyed by the hash of the source file and the import settings,
+// and it also lists the other files the import read (buffers, material libraries): it is stale
+// once any of them changes. The file is memory-mapped; the vertex streams and the index buffers
+// are stored through MeshCodec, and decoded straight into the streams of the meshes
+namespace ModelCache
+{
+// bumped whenever the format or the baking (e.g. the mesh optimizations) changes
+constexpr uint32_t Version = 2;
+
+// the hash of the source file's content and the settings; 0 if the file can't be read
+uint64_t sourceKey(const std::filesystem::path &source, uint64_t settings);
+
+// where the baked version of the source goes
+std::filesystem::path cachePath(const std::filesystem::path &source);
+
+// nothing if there's no cache file, or it is stale or damaged
+std::optional<BakedModel> load(const std::filesystem::path &cacheFile, uint64_t key);
+
+bool store(const std::filesystem::path &cacheFile, uint64_t key,
+           const std::vector<std::filesystem::path> &dependencies, const BakedModel &model);
+} // namespace ModelCache
@@ -4,13 +4,24 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "material.h"
 #include "meshmanager.h"
+#include "modelcache.h"
 #include "object.h"
-#include "randomnamer.h"
 #include "singleton.h"
 #include "texturemanager.h"
 #include "utils.h"
@@ -18,6 +29,8 @@
 // shamefully adapted from learnopengl
 
 // TODO: add mesh transform loading
+// a model is baked once (imported with assimp, its meshes optimized) and kept in the model
+// cache; the later loads instantiate it straight from there
 class ModelLoader : public SystemSingleton<ModelLoader>
 {
 public:
@@ -26,15 +39,91 @@ public:
     GameObjectIdentifier loadModel(std::string const &path, bool flipTexturesOnLoad = false,
                                    bool loadAsPbr = false);
 
+    // the baking (or the read back from the cache) and the preparation of the textures (see
+    // TextureCache::prepare) run on the loader threads, the textures in parallel; the objects are
+    // created and the meshes and textures uploaded on the render thread, from processUploads. The
+    // future is ready once the model is on the GPU, so poll it rather than wait for it on the
+    // render thread. Invalid if the model can't be loaded
+    std::future<GameObjectIdentifier> loadModelAsync(std::string const &path,
+                                                     bool flipTexturesOnLoad = false,
+                                                     bool loadAsPbr = false);
+
+    // runs the render thread's part of the asynchronous loads, one step (a model's objects, a
+    // mesh or a texture upload) after another until the budget is spent; at least one step per
+    // call, so that the loads always progress. Returns whether steps are left
+    bool processUploads(std::chrono::microseconds budget);
+
 private:
+    struct PendingModel
+    {
+        std::string path;
+        bool loadAsPbr = false;
+        bool flipTextures = false;
+        TextureCompression textureCompression = TextureCompression::High;
+        // prepared with only the levels up to TextureStreamer::TailSize
+        bool streamTextures = false;
+        std::chrono::steady_clock::time_point loadStart;
+
+        // filled on the loader threads
+        std::optional<BakedModel> model;
+        bool fromCache = false;
+        std::vector<std::pair<std::string, TextureData>> textures; // by the texture names
+        std::atomic<size_t> texturesLeft = 0;
+        std::chrono::duration<double, std::milli> prepareTime{ 0.0 };
+
+        std::promise<GameObjectIdentifier> loaded;
+    };
+
     ModelLoader();
 
-    GameObjectIdentifier processNode(aiNode *node, const aiScene *scene,
+    // from the cache, or imported and stored there; touches no manager, so any thread may bake
+    std::optional<BakedModel> bakeModel(const std::string &path, bool loadAsPbr, bool &fromCache);
+    void prepareTextures(const std::shared_ptr<PendingModel> &pending);
+    void queueInstantiation(const std::shared_ptr<PendingModel> &pending);
+
+    // the meshes are registered up front, since the nodes may share them
+    std::vector<MeshIdentifier> registerMeshes(BakedModel &model);
+    GameObjectIdentifier instantiateModel(const BakedModel &model,
+                                          const std::vector<MeshIdentifier> &meshIds,
+                                          const std::string &path, bool flipTextures,
+                                          bool loadAsPbr, bool streamTextures);
+    void instantiatePending(const std::shared_ptr<PendingModel> &pending);
+
+    // runs assimp and the mesh optimizations; `dependencies` gets every file the import read
+    std::optional<BakedModel> importModel(const std::string &path, bool loadAsPbr,
+                                          std::vector<std::filesystem::path> &dependencies);
+    uint32_t bakeNode(const aiNode *node, BakedModel &model);
+    BakedModel::MeshData bakeMesh(const aiMesh *mesh, bool loadAsPbr);
+    BakedModel::Material bakeMaterial(const aiMaterial *material);
+
+    GameObjectIdentifier processNode(const BakedModel &model, uint32_t node,
+                                     const std::vector<MeshIdentifier> &meshIds,
                                      const std::string &modelRoot,
                                      GameObjectIdentifier parentObject, bool loadAsPbr);
-    GameObjectIdentifier processMesh(aiMesh *mesh, const aiScene *scene,
+    GameObjectIdentifier processMesh(const BakedModel::Material &material, MeshIdentifier meshId,
                                      const std::string &modelRoot, bool loadAsPbr);
+
+    // reorders the triangles for the post-transform cache and overdraw, then the vertices for
+    // the fetch; reports the cache efficiency before and after
+    void optimizeForGpu(const std::string &meshName, std::vector<Vertex> &vertices,
+                        std::vector<uint32_t> &indices, std::vector<glm::vec3> &tangents);
+
+    // simplified versions of the mesh for the distant instances; reports the triangle counts
+    std::vector<MeshLod> buildLodChain(const std::string &meshName,
+                                       const std::vector<Vertex> &vertices,
+                                       const std::vector<uint32_t> &indices);
     
-    TextureIdentifier loadMaterialTextures(aiMaterial *mat, const std::initializer_list<aiTextureType> &types,
-                                           const std::string &modelRoot, bool loadAsSrgb = true);
+    TextureIdentifier loadMaterialTextures(const BakedModel::Material &material,
+                                           const std::initializer_list<aiTextureType> &types,
+                                           const std::string &modelRoot);
+
+private:
+    std::mutex _bakedModelsMutex;
+    std::vector<std::shared_ptr<PendingModel>> _bakedModels; // handed over by the loader threads
+
+    std::deque<std::function<void()>> _uploads; // the render thread's steps
+
+    // of the textures of the model being instantiated, as the loader threads hashed them while
+    // preparing them (see TextureData::contentHash), by the texture names
+    std::unordered_map<std::string, uint64_t> _preparedContentHashes;
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "singleton.h"
+#include "types.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// interns the resource names: every distinct name is stored once, under a compact identifier.
+// The managers index their resources by these identifiers, so a lookup by name is two hash
+// lookups rather than a scan comparing strings
+class NameRegistry : public SystemSingleton<NameRegistry>
+{
+public:
+    friend class SystemSingleton;
+
+    // the identifier of the name, interning it if it's new
+    NameIdentifier intern(std::string_view name);
+    // InvalidName for the names that were never interned
+    [[nodiscard]] NameIdentifier find(std::string_view name) const;
+
+    // a new unique name for an anonymous resource, like "#mesh12"
+    NameIdentifier internAnonymous(std::string_view kind);
+
+    const std::string &name(NameIdentifier id) const;
+    size_t size() const noexcept { return _names.size(); }
+
+private:
+    NameRegistry() = default;
+
+    struct NameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+private:
+    // the keys are the interned strings; the nodes (and so the strings) never move
+    std::unordered_map<std::string, NameIdentifier, NameHash, std::equal_to<>> _identifiers;
+    std::vector<const std::string *> _names; // by identifier - 1
+    size_t _numAnonymous = 0;
+};
@@ -58,6 +58,10 @@ public:
 
     const std::vector<GameObjectIdentifier> &children() const { return _objectChildren; }
 
+    // non-casters (e.g. the light gizmos) are left out of the shadow maps
+    void setCastsShadows(bool castsShadows) { _castsShadows = castsShadows; }
+    bool castsShadows() const { return _castsShadows; }
+
 private:
     GameObject(GameObjectIdentifier newId) : _objectId(newId) {}
 
@@ -65,4 +69,5 @@ private:
     GameObjectIdentifier _objectId;
     std::unordered_set<Component, ComponentPairHash, ComponentPairEqual> _objectComponents;
     std::vector<GameObjectIdentifier> _objectChildren;
+    bool _castsShadows = true;
 };
@@ -14,6 +14,8 @@ public:
     friend class SystemSingleton;
 
     GameObjectIdentifier addObject();
+    // `count` new objects in a row; the identifier of the first one
+    GameObjectIdentifier addObjects(size_t count);
     GameObjectIdentifier copyObject(GameObjectIdentifier gTemplate);
     GameObject &getObject(GameObjectIdentifier id);
 
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+// measures the cpu time spent submitting a pass and the gpu time spent executing it. The gpu
+// results are read a few frames late so that querying them never stalls the pipeline
+class PassTimer
+{
+public:
+    PassTimer() = default;
+    ~PassTimer();
+
+    PassTimer(const PassTimer &other) = delete;
+    PassTimer &operator=(const PassTimer &other) = delete;
+
+    void begin();
+    void end();
+
+    // exponentially smoothed, in milliseconds
+    double cpuMilliseconds() const noexcept { return _cpuMilliseconds; }
+    double gpuMilliseconds() const noexcept { return _gpuMilliseconds; }
+
+    void reset();
+
+private:
+    static constexpr size_t QueriesInFlight = 4;
+    static constexpr double SmoothingFactor = 0.1;
+
+    std::array<GLuint, QueriesInFlight> _queries{};
+    std::array<bool, QueriesInFlight> _queryPending{};
+    size_t _currentQuery = 0;
+
+    std::chrono::steady_clock::time_point _cpuStart;
+
+    double _cpuMilliseconds = 0.0;
+    double _gpuMilliseconds = 0.0;
+};
@@ -8,7 +8,6 @@ class PbrShader : public InstancedShader<PbrMaterial>
 {
 public:
     PbrShader(const char *vertexPath, const char *fragmentPath);
-    void runShader() override;
 
 protected:
     std::vector<InstancedDataGenerator> getDataGenerators() override;
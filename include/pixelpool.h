@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// the memory stb_image decodes into (see stb.cpp). The large blocks, i.e. the decoded images and
+// the decoder's intermediate buffers, are kept on free lists by size class once released, so that
+// the textures decoded one after another reuse the same pages rather than map and fault in fresh
+// ones for every image. Thread-safe, since the textures are decoded on the loader threads
+namespace PixelPool
+{
+void *allocate(size_t size);
+// keeps the block if it is already large enough
+void *reallocate(void *block, size_t size);
+void release(void *block);
+
+struct Statistics
+{
+    size_t allocations = 0; // of the large blocks
+    size_t reuses = 0;      // of the large blocks, served from the free lists
+    size_t heldBytes = 0;   // on the free lists
+};
+Statistics statistics();
+
+// hands the blocks on the free lists back to the system, e.g. once the scene is loaded
+void trim();
+} // namespace PixelPool
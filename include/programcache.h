@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <filesystem>
+
+// the linked shader programs on disk, as the driver's own binaries (glGetProgramBinary), so that
+// a program seen before is loaded rather than compiled and linked again. A program is keyed by
+// the sources its stages were given, which are the preprocessed ones with the engine's defines
+// (see ShaderProgram::readShaderSource), and by the driver, which only reads back the binaries it
+// wrote. A binary it rejects anyway, say after an update, is compiled again and replaced
+namespace ProgramCache
+{
+// bumped whenever the format changes
+constexpr uint32_t Version = 1;
+
+// on by default; also off when the driver has no binary formats
+void setEnabled(bool enabled);
+bool isEnabled();
+
+// of the program with its stages attached, their sources set but not necessarily compiled
+uint64_t programKey(GLuint program);
+
+std::filesystem::path cachePath(uint64_t key);
+
+// links the program from its cached binary and detaches its stages, which it no longer needs;
+// false if there's no cache file, it is stale or the driver doesn't take it
+bool load(GLuint program, uint64_t key);
+
+// of a linked program; see GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+bool store(GLuint program, uint64_t key);
+} // namespace ProgramCache
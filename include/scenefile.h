@@ -0,0 +1,170 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a scene as flat tables of records: the textures, materials, models and lights it uses, and its
+// objects with their hierarchy, transforms and components. The records refer to each other (and
+// to their names and paths in `strings`) by index, so that the whole description is plain data
+// and the binary form is read back with a copy per table; see SceneLoader for the instantiation
+struct SceneDescription
+{
+    static constexpr uint32_t None = ~0u;
+
+    // the demo's shaders, which the objects are handed to once they are instantiated
+    enum class Shader : uint8_t
+    {
+        None,
+        BlinnPhong,
+        Pbr,
+        Transparent,
+        LightGizmo,
+        Axes,
+    };
+    static constexpr size_t NumShaders = 6;
+
+    enum class LightType : uint8_t
+    {
+        Point,
+        Directional,
+        Spot,
+        TexturedSpot,
+    };
+
+    enum class Wrapping : uint8_t
+    {
+        Default, // the mirrored repeat every texture gets
+        Repeat,
+        MirroredRepeat,
+        Clamp,
+    };
+
+    struct Texture
+    {
+        uint32_t name = None;
+        uint32_t path = None;
+        uint32_t anisotropy = 0; // the anisotropic filtering level, 0 for none
+        Wrapping wrapping = Wrapping::Default;
+    };
+
+    struct Cubemap
+    {
+        uint32_t name = None;
+        // +x, -x, +y, -y, +z, -z
+        std::array<uint32_t, 6> faces = { None, None, None, None, None, None };
+    };
+
+    struct Material
+    {
+        uint32_t name = None;
+        // the diffuse, specular and emission textures of a BasicMaterial, or the albedo, normal,
+        // roughness, metallic and ao ones of a PbrMaterial
+        std::array<uint32_t, 5> textures = { None, None, None, None, None };
+        uint8_t pbr = false;
+    };
+
+    // loaded through ModelLoader: its meshes get registered under their names, and the objects
+    // may instance it
+    struct Model
+    {
+        uint32_t name = None;
+        uint32_t path = None;
+        uint8_t flipTextures = false;
+        uint8_t pbr = false;
+    };
+
+    struct Light
+    {
+        uint32_t name = None;
+        glm::vec3 ambient = glm::vec3(0.0f);
+        glm::vec3 diffuse = glm::vec3(0.0f);
+        glm::vec3 specular = glm::vec3(0.0f);
+        glm::vec3 attenuation = glm::vec3(0.0f); // the constant, linear and quadratic terms
+        glm::vec2 cutOff = glm::vec2(0.0f);      // the inner and outer angles, in degrees
+        // the directional lights' shadow map (none if 0) and its orthographic projection
+        uint32_t shadowMapSize = 0;
+        std::array<float, 6> ortho = {}; // left, right, bottom, top, near, far
+        uint32_t texture = None;         // the one a textured spot light projects
+        LightType type = LightType::Point;
+    };
+
+    struct Object
+    {
+        uint32_t name = None;   // into strings; None for the anonymous objects
+        uint32_t parent = None; // always before the object itself
+        uint32_t model = None;  // an instance of the model, with all its nodes
+        uint32_t mesh = None;   // the name of a registered mesh, into strings
+        uint32_t material = None;
+        uint32_t light = None;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+        Shader shader = Shader::None;
+        uint8_t castsShadows = true;
+    };
+
+    struct Camera
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 target = glm::vec3(0.0f, 0.0f, -1.0f);
+    };
+
+    std::vector<std::string> strings;
+    std::vector<Texture> textures;
+    std::vector<Cubemap> cubemaps;
+    std::vector<Material> materials;
+    std::vector<Model> models;
+    std::vector<Light> lights;
+    std::vector<Object> objects;
+
+    std::optional<Camera> camera;
+    uint32_t skybox = None; // into cubemaps
+
+    const std::string &string(uint32_t index) const { return strings[index]; }
+};
+
+// the scene files. The text form is for authoring, a record per line:
+//
+//   texture <name> <path> [anisotropy=<level>] [wrap=repeat|mirrored-repeat|clamp]
+//   cubemap <name> <+x> <-x> <+y> <-y> <+z> <-z>
+//   material <name> [diffuse=<texture>] [specular=<texture>] [emission=<texture>]
+//   material <name> pbr [albedo=<texture>] [normal=...] [roughness=...] [metallic=...] [ao=...]
+//   model <name> <path> [pbr] [flip-textures]
+//   light <name> point|directional|spot|textured-spot [ambient=r,g,b] [diffuse=r,g,b]
+//         [specular=r,g,b] [attenuation=c,l,q] [cut-off=inner,outer] [shadow-map=<size>]
+//         [ortho=l,r,b,t,n,f] [texture=<texture>]
+//   object [<name>] [parent=<object>] [model=<model>] [mesh=<mesh>] [material=<material>]
+//          [light=<light>] [position=x,y,z] [rotation=degrees,x,y,z] [scale=s|x,y,z]
+//          [shader=blinn-phong|pbr|transparent|light|axes] [shadows=off]
+//   camera position=x,y,z look-at=x,y,z
+//   skybox <cubemap>
+//
+// with the '#' comments, the indented lines continuing the record above, and the paths relative
+// to the scene file; a record only refers to the ones above it. The binary form is what loads:
+// the text is parsed once and cached, keyed by its hash like the models are (see ModelCache),
+// and a binary file may also be loaded directly
+namespace SceneFile
+{
+// bumped whenever the binary layout changes
+constexpr uint32_t Version = 1;
+
+// the errors are reported with the source's name and the line
+std::optional<SceneDescription> parse(std::string_view text, const std::filesystem::path &source);
+
+// a text scene through the cache, or a binary one as it is
+std::optional<SceneDescription> load(const std::filesystem::path &source);
+
+// where the binary form of a text scene goes
+std::filesystem::path cachePath(const std::filesystem::path &source);
+
+// writes the binary form, which load reads as it is
+bool store(const std::filesystem::path &file, const SceneDescription &scene);
+} // namespace SceneFile
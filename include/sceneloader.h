@@ -0,0 +1,38 @@
+#pragma once
+
+#include "scenefile.h"
+#include "types.h"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the objects of an instantiated scene
+struct LoadedScene
+{
+    std::vector<GameObjectIdentifier> objects; // parallel to SceneDescription::objects
+    // what every shader draws, with all the nodes of the model instances
+    std::array<std::vector<GameObjectIdentifier>, SceneDescription::NumShaders> shaderObjects;
+    std::unordered_map<std::string, GameObjectIdentifier> namedObjects;
+    TextureIdentifier3D skybox = InvalidIdentifier;
+
+    const std::vector<GameObjectIdentifier> &drawnBy(SceneDescription::Shader shader) const
+    {
+        return shaderObjects[static_cast<size_t>(shader)];
+    }
+
+    // InvalidIdentifier if the scene has no such object
+    GameObjectIdentifier object(const std::string &name) const;
+};
+
+// creates what a scene describes in the managers: the textures, materials and lights get
+// registered, and the objects with their transforms are created in one go rather than one by one
+namespace SceneLoader
+{
+// the caller loads the models (see ModelLoader), so it decides how; `models` has the root object
+// of every model of the scene, or InvalidIdentifier for the ones that failed to load. The first
+// object instancing a model takes that root, the others copy it
+LoadedScene instantiate(const SceneDescription &scene,
+                        const std::vector<GameObjectIdentifier> &models);
+} // namespace SceneLoader
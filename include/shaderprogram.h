@@ -12,6 +12,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "meshmanager.h"
 #include "objectmanager.h"
@@ -23,8 +24,20 @@ public:
     ShaderProgram();
     virtual ~ShaderProgram();
 
+    // compiles and links the program, unless it is loaded from the cache (see ProgramCache)
     void initializeShaderProgram();
 
+    // the halves of initializeShaderProgram, which ShaderProgramBatch calls apart: the compiles
+    // and the link are only submitted to the driver, and their statuses checked later
+    void submitShaderProgram();
+    // without waiting; always true without parallel compilation
+    bool isShaderProgramCompleted() const;
+    void completeShaderProgram();
+
+    // GL_KHR_parallel_shader_compile (or the ARB one) when the driver has it, so that the programs
+    // submitted together compile on the driver's threads; called once glad is loaded
+    static void enableParallelCompilation(GLADloadproc load);
+
     void use() const;
     GLuint programId() const;
 
@@ -57,8 +70,10 @@ protected:
     virtual void compileAndAttachNecessaryShaders(uint32_t id) = 0;
     virtual void deleteShaders() = 0;
 
-    void compileShader(uint32_t shaderId);
-    void linkProgram(uint32_t programId);
+    // only records the stage, which submitShaderProgram compiles unless the cache has the program
+    void deferShader(uint32_t shaderId);
+    bool checkCompileStatus(uint32_t shaderId);
+    bool checkLinkStatus(uint32_t programId);
 
     std::string readShaderSource(const char *shaderSource);
 
@@ -81,7 +96,31 @@ protected:
     // the objects of the shader are ordered by meshes to enable easier batching of meshes
     std::multiset<GameObjectIdentifier, MeshOrderer> _orderedShaderObjects;
 
+public:
+    const std::multiset<GameObjectIdentifier, MeshOrderer> &shaderObjects() const
+    {
+        return _orderedShaderObjects;
+    }
+
 private:
     unsigned int _id = 0;
     std::optional<GLuint> _shaderOverride = std::nullopt;
+
+    std::vector<uint32_t> _deferredShaders;
+    bool _linkPending = false;
+    uint64_t _cacheKey = 0;
+};
+
+// initializes shader programs together: the compiles and links of all of them are submitted
+// first and their statuses checked at the end, so that the driver works on them (on its own
+// threads with parallel compilation) while the render thread goes on with the startup
+class ShaderProgramBatch
+{
+public:
+    void add(ShaderProgram &program);
+    // waits for the driver to be done with them all
+    void complete();
+
+private:
+    std::vector<ShaderProgram *> _programs;
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "instancer.h"
+#include "shaderprogram.h"
+
+#include <unordered_set>
+#include <vector>
+
+// depth-only rendering of the shadow casters of all the source shaders, straight from the mesh
+// arenas. Its VAO reads the positions only, instead of the full vertex (and tangent), and each
+// light view is drawn by one multi-draw per index type of the arenas
+class ShadowCasterShader : public ShaderProgram
+{
+public:
+    ShadowCasterShader() = default;
+    ~ShadowCasterShader();
+
+    void runShader() override;
+
+    // the casters are regathered whenever the number of the sources' objects changes
+    void addCasterSource(const ShaderProgram *source);
+
+    // the instance data is regenerated on the next run if any of the casters is among these
+    void updateInstancedBuffer(const std::unordered_set<GameObjectIdentifier> &objsToUpdate);
+
+protected:
+    void compileAndAttachNecessaryShaders(uint32_t id) override;
+    void deleteShaders() override;
+
+private:
+    using DrawElementsIndirectCommand = MeshManager::DrawElementsIndirectCommand;
+
+    void rebuildCasters();
+    void rebuildCommands();
+    void rebuildInstances();
+
+private:
+    std::vector<const ShaderProgram *> _sources;
+    size_t _numSourceObjects = 0;
+
+    std::vector<GameObjectIdentifier> _casters; // grouped by index type, then by mesh
+    std::unordered_set<GameObjectIdentifier> _casterSet;
+    std::vector<DrawElementsIndirectCommand> _drawCommands; // the 16-bit index ranges first
+    size_t _numShortIndexCommands = 0;
+    bool _instancesDirty = true;
+
+    GLuint _vertexArray = 0;
+    GLuint _indirectBuffer = 0;
+    GLuint _instancedBufferId = 0;
+    size_t _instancedBufferCapacity = 0;
+
+    const char *_vertexPath = ENGINE_SHADERS "/depth_only.vs";
+    const char *_fragmentPath = ENGINE_SHADERS "/depth_pass_through.fs";
+
+    uint32_t _vertexShaderId = 0;
+    uint32_t _fragmentShaderId = 0;
+};
@@ -2,25 +2,31 @@
 
 #include "framepass.h"
 #include "instancedshader.h"
-#include "passthroughshader.h"
+#include "shadowcastershader.h"
+
+#include <unordered_set>
 
 class WorldPlaneShader;
 class LightVisualizationShader;
 class SkyboxShader;
 class PbrShader;
+class ShaderProgramBatch;
 
 class ShadowPass : public FramePass
 {
 public:
+    // the caster shader is submitted with `batch`, and completed with it
     ShadowPass(InstancedBlinnPhongShader *ins, LightVisualizationShader *lightVis,
-               PbrShader *pbrShader);
+               PbrShader *pbrShader, ShaderProgramBatch &batch);
     void runPass() override;
 
+    void updateInstancedBuffer(const std::unordered_set<GameObjectIdentifier> &objsToUpdate);
+
 private:
+    // the objects of these shaders are drawn, depth-only, by the caster shader
     // TODO: ideally, these shouldn't be set by name from constructor
     InstancedBlinnPhongShader *_shaderProgramMain = nullptr;
     LightVisualizationShader *_lightVisualizationShader = nullptr;
     PbrShader *_pbrShader = nullptr;
-    PassThroughShader _passThroughOverride{ nullptr, nullptr };
-    PassThroughShader _passThroughOverridePbr{ nullptr, nullptr };
+    ShadowCasterShader _shadowCasters;
 };
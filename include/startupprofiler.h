@@ -0,0 +1,98 @@
+#pragma once
+
+#include "singleton.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// where the startup goes: the phases it is split into, nested in one another, with the time each
+// took and the bytes read from the files and the GL objects created while it was open. The counts
+// are process-wide, so a phase also gets what the loader threads did in the meantime. Once the
+// initialization is over, finish prints the phases as a tree and may write them as a trace for
+// chrome://tracing or Perfetto
+class StartupProfiler : public SystemSingleton<StartupProfiler>
+{
+public:
+    // times the scope it lives in, or up to end; phases are opened on the render thread only
+    class Phase
+    {
+    public:
+        explicit Phase(std::string_view name) : _open(StartupProfiler::instance()->begin(name)) {}
+        ~Phase() { end(); }
+
+        Phase(const Phase &other) = delete;
+        Phase &operator=(const Phase &other) = delete;
+
+        void end()
+        {
+            if (_open)
+                StartupProfiler::instance()->end();
+            _open = false;
+        }
+
+    private:
+        bool _open = false;
+    };
+
+    // opens the phase around all the others
+    void start();
+    // closes the phases left open, prints the report and writes the trace unless `tracePath` is
+    // empty; the phases opened after it aren't recorded
+    void finish(const std::filesystem::path &tracePath);
+
+    // false when the profiler isn't running, in which case there's no phase to end
+    bool begin(std::string_view name);
+    void end();
+
+    void addBytesLoaded(size_t bytes) noexcept
+    {
+        _bytesLoaded.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    // for the files read other than through MappedFile, which counts its own
+    void addFileLoaded(const std::filesystem::path &path) noexcept;
+
+    // see GlObjectCounting
+    void addGlObjects(size_t count) noexcept
+    {
+        _glObjects.fetch_add(count, std::memory_order_relaxed);
+    }
+
+private:
+    friend class SystemSingleton;
+    StartupProfiler() = default;
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t NoParent = ~size_t(0);
+
+    struct Record
+    {
+        std::string name;
+        size_t parent = NoParent;
+        Clock::time_point start;
+        Clock::time_point end;
+        uint64_t bytesAtStart = 0;
+        uint64_t bytesAtEnd = 0;
+        uint64_t glObjectsAtStart = 0;
+        uint64_t glObjectsAtEnd = 0;
+    };
+
+    void printReport() const;
+    // the siblings of the same name are shown together, like the shader programs are
+    void printGroup(const std::vector<size_t> &group,
+                    const std::vector<std::vector<size_t>> &children, size_t depth) const;
+    bool writeTrace(const std::filesystem::path &tracePath) const;
+
+    bool _running = false;
+    std::vector<Record> _records; // in the order they were opened, so the parents come first
+    std::vector<size_t> _openRecords;
+
+    std::atomic<uint64_t> _bytesLoaded = 0;
+    std::atomic<uint64_t> _glObjects = 0;
+};
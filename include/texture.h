@@ -1,7 +1,7 @@
 #pragma once
 
 #include "glad/glad.h"
-#include "stb_image.h"
+#include "texturecache.h"
 
 #include <array>
 #include <cstdint>
@@ -24,8 +24,29 @@ class Texture2D
 public:
     void setUseAnisotropic(bool useAniso, size_t level);
     void setUseSrgb(bool ifUseSrgb);
+    void setFlipOnLoad(bool ifFlip);
+    void addUsage(TextureUsage usage);
+    void setCompression(TextureCompression compression);
+    // all of the above that decide what the source turns into
+    void setSettings(const TextureSettings &settings);
+    const TextureSettings &settings() const noexcept { return _settings; }
     void setParameters(Texture2DParameters params);
 
+    // before the allocation: the texture then starts with its smaller levels only, and the finer
+    // ones come and go with TextureStreamer. Only the textures in the cache stream
+    void setStreamed(bool streamed);
+    bool isStreamed() const noexcept;
+
+    // of the uploaded texture: its full size, and the finest of its levels on the GPU
+    const BakedTexture &layout() const noexcept { return _layout; }
+    uint32_t residentLevel() const noexcept { return _residentLevel; }
+    // the GPU memory of the levels from `level` on
+    size_t levelsBytes(uint32_t level) const;
+
+    // where the levels that aren't resident are read from
+    const std::filesystem::path &cacheFile() const noexcept { return _cacheFile; }
+    uint64_t cacheKey() const noexcept { return _cacheKey; }
+
     operator int() const { return _textureId; }
 
 private:
@@ -34,7 +55,27 @@ private:
                                                       GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR });
     explicit Texture2D(uint32_t textureId);
 
+    // uploads the data handed over with setData if there is one, prepares the source otherwise.
+    // The mips come with the data; a block format the GL lacks falls back to RGBA8
     void allocateTexture();
+    // ignored unless the data was prepared with the texture's current settings
+    void setData(TextureData &&data);
+
+    // whether allocating the texture would prepare its source, which prepareSource does on any
+    // thread
+    bool needsPreparing() const noexcept;
+    TextureData prepareSource() const;
+
+    // replaces the GL texture with one holding the levels from `level` on: the coarser ones are
+    // copied over on the GPU, the finer ones have to come with `finerLevels`. The handles of the
+    // old texture are invalid afterwards
+    bool setResidentLevel(uint32_t level, const BakedTexture *finerLevels);
+
+    // a texture with storage for the levels from `firstLevel` on and the parameters applied,
+    // left bound
+    GLuint createTexture(uint32_t firstLevel) const;
+    // into the bound texture, which starts at `firstLevel`
+    void uploadLevel(uint32_t level, uint32_t firstLevel, const std::vector<uint8_t> &data) const;
 
     void deallocateTexture();
 
@@ -44,8 +85,16 @@ private:
     uint32_t _textureId = 0;
     std::string _textureSourcePath;
     Texture2DParameters _params;
+    TextureSettings _settings;
+    TextureData _data; // only until the upload
+
+    bool _streamed = false;
+    BakedTexture _layout; // without the levels
+    GLenum _internalFormat = 0;
+    uint32_t _residentLevel = 0;
+    std::filesystem::path _cacheFile;
+    uint64_t _cacheKey = 0;
 
     bool _useAnisotropic = false;
-    bool _useSrgb = false;
     float _anisoLevel = 8.0f;
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "blockcompression.h"
+#include "mipchain.h"
+#include "stb_image.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// the pixels of a texture source as stb_image decodes them, in PixelPool's blocks. Decoding
+// doesn't touch GL, so it may run on any thread
+struct DecodedImage
+{
+    static DecodedImage decode(const std::string &path, bool flipVertically = false);
+
+    explicit operator bool() const noexcept { return pixels != nullptr; }
+
+    int width = 0;
+    int height = 0;
+    int numChannels = 0;
+    std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> pixels{ nullptr, &stbi_image_free };
+};
+
+// what the shaders read from a texture, which picks its block format. The data textures follow
+// glTF's packing: the occlusion in red, the roughness in green, the metalness in blue
+enum class TextureUsage : uint8_t
+{
+    Color = 1 << 0,
+    Normal = 1 << 1, // only the X and Y are kept, the shaders rebuild the Z
+    Occlusion = 1 << 2,
+    Roughness = 1 << 3,
+    Metalness = 1 << 4,
+};
+
+enum class TextureCompression : uint8_t
+{
+    None, // RGBA8
+    Fast, // BC1, or BC3 for the translucent colours
+    High, // BC7 for the colours
+};
+
+// everything that changes what a source turns into
+struct TextureSettings
+{
+    uint8_t usages = 0; // of TextureUsage; none is taken as a colour
+    bool srgb = false;
+    bool flipVertically = false;
+    TextureCompression compression = TextureCompression::High;
+    MipChain::Filter mipFilter = MipChain::Filter::Kaiser;
+    // the alpha test's reference (out of 255) the mips keep the coverage of, 0 for none
+    uint8_t alphaCutoff = 0;
+
+    void addUsage(TextureUsage usage) { usages |= static_cast<uint8_t>(usage); }
+    bool hasUsage(TextureUsage usage) const { return usages & static_cast<uint8_t>(usage); }
+
+    bool operator==(const TextureSettings &other) const = default;
+};
+
+// where a texel the shaders sample comes from
+enum class TextureChannel : uint8_t
+{
+    Red,
+    Green,
+    Blue,
+    Alpha,
+    Zero,
+    One,
+};
+
+// a texture as it is uploaded, with its mips, or a part of them
+struct BakedTexture
+{
+    // of the whole chain, down to 1x1
+    uint32_t numLevels() const;
+    uint32_t levelWidth(uint32_t level) const;
+    uint32_t levelHeight(uint32_t level) const;
+    size_t levelBytes(uint32_t level) const;
+
+    std::optional<BlockCompression::BlockFormat> format; // none for RGBA8
+    uint32_t width = 0; // of the full size, even if the levels start further down
+    uint32_t height = 0;
+    std::array<TextureChannel, 4> swizzle = { TextureChannel::Red, TextureChannel::Green,
+                                              TextureChannel::Blue, TextureChannel::Alpha };
+    uint32_t firstLevel = 0;
+    std::vector<std::vector<uint8_t>> levels; // from the first level on, the finest first
+};
+
+// a texture ready to be uploaded
+struct TextureData
+{
+    explicit operator bool() const noexcept { return texture.has_value(); }
+
+    TextureSettings settings;
+    std::optional<BakedTexture> texture;
+
+    // where the levels left out can be read from later (see TextureStreamer); no key if the
+    // texture isn't in the cache
+    std::filesystem::path cacheFile;
+    uint64_t cacheKey = 0;
+
+    // of the source (see TextureCache::contentHash), so that the texture manager can share the
+    // texture without reading the file again
+    uint64_t contentHash = 0;
+};
+
+// the baked textures on disk, block compressed (unless the settings ask for none) with their
+// mips, so that loading a texture again is only an upload: no decoding, no filtering of the mips
+// and no encoding. A cache file is keyed by the hash of the source file and the settings. Nothing
+// here touches GL: the loader threads prepare the textures, and the cache can be built ahead on a
+// machine without a GPU (see tools/texturebaker.cpp)
+namespace TextureCache
+{
+// bumped whenever the format or the encoding changes
+constexpr uint32_t Version = 2;
+
+// the hash of the source file's content, whatever its path; 0 if the file can't be read
+uint64_t contentHash(const std::filesystem::path &source);
+// of a source with that content hash and the settings; 0 if the source couldn't be read
+uint64_t sourceKey(uint64_t contentHash, const TextureSettings &settings);
+
+// where the baked version of the source goes; the settings are part of the name, since a
+// source may be used in several ways
+std::filesystem::path cachePath(const std::filesystem::path &source,
+                                const TextureSettings &settings);
+
+// the levels from the first one no larger than maxSize (0 for the full size) on, up to endLevel
+// (excluded); nothing if there's no cache file, or it is stale or damaged
+std::optional<BakedTexture> load(const std::filesystem::path &cacheFile, uint64_t key,
+                                 uint32_t maxSize = 0,
+                                 uint32_t endLevel = std::numeric_limits<uint32_t>::max());
+
+bool store(const std::filesystem::path &cacheFile, uint64_t key, const BakedTexture &texture);
+
+// generates the mips (see MipChain), then picks the block format for the usages and compresses
+// every level, the rows spread over the loader threads
+BakedTexture bake(const DecodedImage &image, const TextureSettings &settings);
+
+// from the cache, or decoded, baked and stored there; the levels larger than maxSize (unless 0)
+// are left out. The data is empty if the source can't be decoded
+TextureData prepare(const std::filesystem::path &source, const TextureSettings &settings,
+                    uint32_t maxSize = 0);
+} // namespace TextureCache
@@ -6,9 +6,11 @@
 #include "types.h"
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <vector>
 
 class TextureManager : public SystemSingleton<TextureManager> // crtp
 {
@@ -16,16 +18,56 @@ public:
     friend class SystemSingleton; // so that the singleton can access the private constructor
     using NamedTexture = NamedComponent<Texture2D>;
 
-    TextureIdentifier registerTexture(const char *textureSource, const std::string &texName);
+    // a source file with the same content as one registered before (e.g. a copy in another model's
+    // directory) gets its texture, under the new name too, unless the deduplication is off. The
+    // shared texture keeps the settings it is uploaded with. The source is hashed here unless its
+    // hash is given (see TextureData::contentHash)
+    TextureIdentifier registerTexture(const char *textureSource, const std::string &texName,
+                                      std::optional<uint64_t> contentHash = std::nullopt);
     TextureIdentifier registerTexture(uint32_t textureId);
     std::pair<std::string, TextureIdentifier> registerTexture(const char *textureSource);
 
+    // along with all the names the deduplication gave it
     void unregisterTexture(TextureIdentifier id);
     TextureIdentifier textureRegistered(const std::string &texName) const;
 
+    // for the textures registered from now on, and the ones not allocated yet
+    void setCompression(TextureCompression compression);
+    TextureCompression compression() const noexcept { return _compression; }
+
+    // for the textures registered from now on
+    void setContentDeduplication(bool enabled);
+    // the bytes are those of the shared textures' resident levels
+    DeduplicationStatistics deduplicationStatistics() const;
+
     void allocateTexture(TextureIdentifier id);
+    // hands over the data prepared ahead of time (e.g. on a worker thread), so that allocating
+    // the texture only uploads it; ignored once the texture is allocated, or if the data doesn't
+    // match the texture's settings
+    void provideData(TextureIdentifier id, TextureData &&data);
+    // prepares the sources of the textures not allocated yet (see TextureCache::prepare) in
+    // parallel on the loader threads, and returns once all of them are ready; the allocations
+    // then only upload them. For the render thread: a loader thread waiting here could wait for
+    // itself
+    void prefetchTextures(const std::vector<TextureIdentifier> &ids);
     void deallocateTexture(TextureIdentifier id);
 
+    // see Texture2D::setResidentLevel; the texture's slot in the handle table gets the new handle
+    bool setResidentLevel(TextureIdentifier id, uint32_t level, const BakedTexture *finerLevels);
+
+    // the handle table: one shader storage buffer of the bindless handles (the texture
+    // identifiers with ENGINE_DISABLE_BINDLESS_TEXTURES) the materials sample through. A texture
+    // keeps its slot while referenced, whatever else comes and goes, and the slot always holds
+    // its current handle (0 while it isn't uploaded); the handle is resident meanwhile. Returns
+    // the slot, -1 for the textures not registered
+    int acquireHandleSlot(TextureIdentifier id);
+    // the slot is reused once the last reference is released
+    void releaseHandleSlot(TextureIdentifier id);
+    // -1 without one
+    int handleSlot(TextureIdentifier id) const;
+    // the buffer changes as the table grows, so it is bound before every use
+    void bindHandleTable(uint32_t bindingPoint) const;
+
     int bindTexture(TextureIdentifier id, GLuint bindingType = GL_TEXTURE_2D);
     void unbindTexture(TextureIdentifier id);
     void unbindAllTextures();
@@ -37,12 +79,37 @@ public:
 private:
     TextureManager();
 
+    TextureIdentifier registerTexture(const char *textureSource, NameIdentifier nameId,
+                                      std::optional<uint64_t> contentHash = std::nullopt);
+
     // returns -1 if is not bound and the binding index otherwise
     int isTextureBound(const Texture2D &texture) const;
 
+    // into the texture's slot, if it has one
+    void writeHandle(TextureIdentifier id);
+    void growHandleTable(uint32_t numSlots);
+
 private:
     TextureIdentifier _identifiers = 0; // TODO: add some defragmentation logic
     std::unordered_map<TextureIdentifier, NamedTexture> _textures;
+    std::unordered_map<NameIdentifier, TextureIdentifier> _texturesByName;
+    std::unordered_map<uint64_t, TextureIdentifier> _texturesByContent; // TextureCache::contentHash
+    std::unordered_map<TextureIdentifier, size_t> _numSharedRegistrations;
+    bool _deduplicate = true;
+    TextureCompression _compression = TextureCompression::High;
+
+    struct HandleSlot
+    {
+        uint32_t index = 0;
+        uint32_t references = 0;
+    };
+
+    static constexpr uint32_t MinHandleSlots = 64;
+    std::unordered_map<TextureIdentifier, HandleSlot> _handleSlots;
+    std::vector<uint32_t> _freeHandleSlots;
+    uint32_t _numHandleSlots = 0; // the slots ever used, free ones included
+    uint32_t _handleCapacity = 0;
+    uint32_t _handleBuffer = 0;
 
     constexpr static uint32_t MAX_TEXTURES = 16;
     uint32_t _boundTextures[MAX_TEXTURES];
@@ -36,12 +36,16 @@ public:
 private:
     CubemapManager();
 
+    TextureIdentifier3D registerTexture(const std::array<const char *, 6> &cubemapSources,
+                                        NameIdentifier nameId);
+
     // returns -1 if is not bound and the binding index otherwise
     int isTextureBound(const Cubemap &texture) const;
 
 private:
     TextureIdentifier3D _identifiers = 0; // TODO: add some defragmentation logic
     std::unordered_map<TextureIdentifier3D, NamedTexture> _textures;
+    std::unordered_map<NameIdentifier, TextureIdentifier3D> _texturesByName;
 
     constexpr static uint32_t MAX_TEXTURES = 16;
     uint32_t _boundTextures[MAX_TEXTURES];
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "singleton.h"
+#include "texturecache.h"
+#include "types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// the residency of the finer mips of the streamed textures (see Texture2D::setStreamed). The
+// renderers report at what resolution every texture is seen, every frame; the levels that are
+// missing for it are read from the texture cache on the loader threads and swapped in on the
+// render thread, while the textures not seen for the longest give their finer levels back
+// whenever the budget runs out
+class TextureStreamer : public SystemSingleton<TextureStreamer>
+{
+public:
+    friend class SystemSingleton;
+
+    // the streamed textures start with the levels up to this size, and always keep them
+    static constexpr uint32_t TailSize = 128;
+
+    struct Statistics
+    {
+        size_t numTextures = 0; // streamed and allocated
+        size_t numLoading = 0;
+        size_t residentBytes = 0;
+        size_t fullBytes = 0; // were every level resident
+        size_t numLoads = 0;  // since the start
+        size_t numEvictions = 0;
+    };
+
+    // for the textures the models register from now on; otherwise they are uploaded whole
+    void setEnabled(bool enabled);
+    bool enabled() const noexcept { return _enabled; }
+
+    // the GPU memory all the streamed textures together may take
+    void setBudget(size_t bytes);
+    size_t budget() const noexcept { return _budget; }
+
+    // the texture is sampled at up to `pixelsPerUv` pixels per unit of its texture coordinates
+    // (e.g. an object's projected size over the texture coordinates' density on it) this frame
+    void requestResolution(TextureIdentifier id, float pixelsPerUv);
+
+    // once per frame, after the requests: swaps in the levels loaded since the last call for up
+    // to `uploadBudget` of the render thread's time (at least one texture), then evicts and
+    // queues the loads for the levels requested
+    void update(std::chrono::microseconds uploadBudget);
+
+    Statistics statistics() const;
+
+private:
+    struct StreamedTexture
+    {
+        float pixelsPerUv = 0.0f; // the highest requested this frame
+        uint64_t lastRequested = 0;
+        uint32_t wantedLevel = 0;
+        bool loading = false;
+        bool failed = false; // the cache couldn't provide the levels; it stays as it is
+    };
+
+    // the levels from the first one wanted up to the resident ones, read on a loader thread
+    struct LoadedLevels
+    {
+        TextureIdentifier id = InvalidIdentifier;
+        uint32_t residentLevel = 0; // when the load was queued
+        size_t reservedBytes = 0;
+        std::optional<BakedTexture> levels;
+    };
+
+    TextureStreamer() = default;
+
+    void applyLoads(std::chrono::microseconds uploadBudget);
+    // drops the levels the least recently requested textures don't need, until `bytes` more fit
+    // in the budget; whether they do
+    bool makeRoom(size_t bytes);
+    void queueLoad(TextureIdentifier id, StreamedTexture &streamed, uint32_t level,
+                   size_t bytes);
+
+private:
+    bool _enabled = true;
+    size_t _budget = 512ull * 1024 * 1024;
+    uint64_t _frame = 1;
+
+    std::unordered_map<TextureIdentifier, StreamedTexture> _textures;
+    size_t _residentBytes = 0; // of the textures above
+    size_t _reservedBytes = 0; // for the loads not swapped in yet
+    size_t _numLoads = 0;
+    size_t _numEvictions = 0;
+
+    std::mutex _loadedMutex;
+    std::vector<LoadedLevels> _loaded; // handed over by the loader threads
+    std::vector<LoadedLevels> _uploads; // taken over by the render thread
+};
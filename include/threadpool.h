@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// a fixed set of worker threads running the queued jobs in order. The jobs must not touch GL or
+// the managers, which all live on the render thread: they hand their results back through
+// futures or queues of their own. Destroying the pool drops the jobs that haven't started and
+// waits for the running ones
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t numThreads = defaultThreadCount());
+
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool &operator=(const ThreadPool &other) = delete;
+
+    void enqueue(std::function<void()> job);
+
+    // runs job(0) to job(count - 1) on the workers and the calling thread, and returns once all
+    // of them are done. The calling thread works through the indices rather than wait, so that a
+    // job of the pool may call it too: with every worker busy, it simply runs them all itself
+    void parallelFor(size_t count, const std::function<void(size_t)> &job);
+
+    size_t numThreads() const noexcept { return _threads.size(); }
+
+    // every core but the one of the render thread
+    static size_t defaultThreadCount();
+
+    // the workers the loaders share (the model imports, the texture decoding), started on the
+    // first use with setLoaderThreadCount's count, or the default one
+    static ThreadPool &loaders();
+    static void setLoaderThreadCount(size_t numThreads);
+
+private:
+    void work(std::stop_token stopToken);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable_any _jobQueued;
+    std::deque<std::function<void()>> _jobs;
+
+    std::vector<std::jthread> _threads; // last, so that they're stopped before the queue goes
+};
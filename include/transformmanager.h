@@ -91,6 +91,9 @@ public:
     friend class SystemSingleton;
 
     TransformIdentifier registerNewTransform(GameObjectIdentifier parentId);
+    // a transform for each of the `count` objects from `firstParentId` on, in a row; the
+    // identifier of the first one
+    TransformIdentifier registerNewTransforms(GameObjectIdentifier firstParentId, size_t count);
     Transform *getTransform(TransformIdentifier tId);
     std::vector<TransformIdentifier> getChildTransforms(GameObjectIdentifier parentId);
     std::unordered_set<GameObjectIdentifier> flushUpdates();
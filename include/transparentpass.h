@@ -1,6 +1,9 @@
 #pragma once
 
 #include "framepass.h"
+#include "passthroughshader.h"
+#include "shaderprogram.h"
+#include "types.h"
 
 class TransparentShader;
 class Camera;
@@ -18,3 +21,54 @@ private:
     FullscreenFogShader *_fogShader = nullptr;
     const Camera *_currentCamera = nullptr;
 };
+
+// weighted blended order-independent transparency: the transparent objects are accumulated into
+// two off-screen targets in any order and then composited over the scene. The pass itself is the
+// composite shader
+class WeightedBlendedTransparentPass : public FramePass, public ShaderProgram
+{
+public:
+    // the accumulation shader is submitted with `batch`, and completed with it
+    WeightedBlendedTransparentPass(TransparentShader *transparentShader,
+                                   FullscreenFogShader *fogShader, ShaderProgramBatch &batch);
+    ~WeightedBlendedTransparentPass();
+
+    void runPass() override;
+    void setCamera(const Camera *currentCamera) override;
+    void runShader() override;
+
+    // the targets follow the scene framebuffer's size; they are checked against it again on the
+    // next frame
+    void sceneResized();
+
+protected:
+    void compileAndAttachNecessaryShaders(uint32_t id) override;
+    void deleteShaders() override;
+
+private:
+    // the accumulation has to be depth-tested against the opaque geometry, so the depth attachment
+    // of the scene framebuffer is shared (read-only); the targets are sized after it
+    bool attachSceneDepth(GLuint sceneFrameBuffer);
+
+private:
+    TransparentShader *_transparentShader = nullptr;
+    FullscreenFogShader *_fogShader = nullptr;
+
+    PassThroughShader _accumulationOverride{ ENGINE_SHADERS "/simple_transparent_vertex.vs",
+                                             ENGINE_SHADERS "/weighted_blended_transparent.fs" };
+
+    GLuint _oitFb = 0;
+    GLuint _sceneFb = 0;
+    GLuint _accumulationBuf = 0;
+    GLuint _revealageBuf = 0;
+    GLint _targetWidth = 0;
+    GLint _targetHeight = 0;
+    TextureIdentifier _accumulationTexture = InvalidIdentifier;
+    TextureIdentifier _revealageTexture = InvalidIdentifier;
+
+    const char *_vertexPath = ENGINE_SHADERS "/fog_renderer.vs"; // just a full-screen triangle
+    const char *_fragmentPath = ENGINE_SHADERS "/weighted_blended_composite.fs";
+
+    uint32_t _vertexShaderId = 0;
+    uint32_t _fragmentShaderId = 0;
+};
@@ -3,28 +3,75 @@
 #include "glm/glm.hpp"
 
 #include "camera.h"
+#include "depthsorter.h"
+#include "instancer.h"
+#include "material.h"
 #include "shaderprogram.h"
 #include "types.h"
 
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class TransparentShader : public ShaderProgram
 {
 public:
     TransparentShader(const char *vertexPath, const char *fragmentPath);
+    ~TransparentShader();
+
     void runShader() override;
     void setCamera(const Camera *newCamera);
 
+    // order-independent techniques don't need the back-to-front order; objects are then kept
+    // grouped by mesh, which gives the fewest draws
+    void setSortingEnabled(bool sortingEnabled);
+    bool sortingEnabled() const { return _sortingEnabled; }
+
+    // the instance data is regenerated on the next run if any of the objects is among these
+    void updateInstancedBuffer(const std::unordered_set<GameObjectIdentifier> &objsToUpdate);
+
 protected:
     void compileAndAttachNecessaryShaders(uint32_t id) override;
     void deleteShaders() override;
 
+private:
+    // a run of consecutive (in the sorted order) objects that share a mesh
+    struct DrawBatch
+    {
+        MeshIdentifier meshId = InvalidIdentifier;
+        GLuint baseInstance = 0;
+        GLsizei instanceCount = 0;
+    };
+
+    void rebuildObjects();
+    void rebuildBatches();
+    std::vector<InstancedDataGenerator> getDataGenerators();
+
 private:
     const Camera *_currentCamera = nullptr;
-    glm::vec3 _previousCameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-    float _minimalPreviousDistance = 0.0f;
+    DepthSorter _depthSorter;
+    glm::mat4 _previousView = glm::mat4(1.0f);
+    bool _needsResorting = true;
+
+    size_t _numShaderObjects = 0;
+    std::vector<GameObjectIdentifier> _sortedObjects; // farthest first, i.e. in the drawing order
+    std::vector<DrawBatch> _drawBatches;
+    bool _instancesDirty = true;
+    bool _sortingEnabled = true;
+
+    // the texture slots are resolved once, when the set of objects changes
+    std::unordered_map<GameObjectIdentifier,
+                       std::array<int, getNumTexturesInMaterial<BasicMaterial>()>>
+        _objectsTextureMappings;
+
+    // all the objects share one instanced buffer (in the sorted order), attached to a VAO of its
+    // own over the mesh arenas so that the instanced attributes don't clash with other shaders
+    GLuint _instancedBufferId = 0;
+    size_t _instancedBufferCapacity = 0;
+    uint32_t _vertexArray = 0;
 
-    std::vector<GameObjectIdentifier> _sortedObjects;
+    size_t _textureHandlesbindingPoint = 0;
 
     std::string _vertexPath;
     std::string _fragmentPath;
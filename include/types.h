@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -16,6 +17,10 @@ using LightSourceIdentifier = ComponentIdentifier;
 
 constexpr ComponentIdentifier InvalidIdentifier = 0;
 
+// an interned name, see NameRegistry
+using NameIdentifier = uint32_t;
+constexpr NameIdentifier InvalidName = 0;
+
 enum class ComponentType
 {
     MESH,
@@ -32,6 +37,14 @@ using Component = std::pair<ComponentType, ComponentIdentifier>;
 template <typename ComponentData>
 struct NamedComponent
 {
-    std::string componentName;
+    NameIdentifier componentName = InvalidName;
     ComponentData componentData;
 };
+
+// the registrations of the managers that found the same content under another name, and got its
+// identifier instead of a copy
+struct DeduplicationStatistics
+{
+    size_t numShared = 0;
+    size_t bytesSaved = 0; // of the GPU memory the copies would take
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace Utilities
@@ -15,4 +18,25 @@ struct ScopeGuard
 private:
     std::function<void()> cleanupFunction;
 };
+
+constexpr uint64_t HashBasis = 0xcbf29ce484222325ull;
+constexpr uint64_t HashPrime = 0x100000001b3ull;
+
+// FNV-1a, taking 8 bytes a step; for the caches, which only have to spot changes in large files
+inline uint64_t hashBytes(const std::byte *data, size_t size, uint64_t hash = HashBasis)
+{
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        hash = (hash ^ word) * HashPrime;
+    }
+    for (; offset < size; ++offset)
+        hash = (hash ^ static_cast<uint64_t>(data[offset])) * HashPrime;
+
+    return hash;
+}
+
+inline uint64_t hashCombine(uint64_t hash, uint64_t value) { return (hash ^ value) * HashPrime; }
 } // namespace Utilities
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "singleton.h"
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+class Camera;
+
+// mirrors the std140 ViewConstants block declared by the shaders
+struct ViewConstants
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+
+    glm::vec3 viewPos;
+    float directionalShadowBias;
+
+    int numDirectionalLightsBound;
+    int numPointLightsBound;
+    int numSpotLightsBound;
+    int numTexturedLightsBound;
+};
+
+// the block itself, which ShaderProgram::readShaderSource adds to every shader it reads
+inline constexpr std::string_view ViewConstantsDeclaration = R"(
+layout(binding = 0, std140) uniform ViewConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+
+    vec3 viewPos;
+    float directionalShadowBias;
+
+    int numDirectionalLightsBound;
+    int numPointLightsBound;
+    int numSpotLightsBound;
+    int numTexturedLightsBound;
+};
+)";
+
+class ViewConstantsManager : public SystemSingleton<ViewConstantsManager>
+{
+public:
+    friend class SystemSingleton<ViewConstantsManager>;
+
+    // the binding ViewConstantsDeclaration declares the block at
+    static constexpr GLuint ViewConstantsBindingPoint = 0;
+
+    static constexpr size_t CameraView = 0;
+    static size_t directionalLightView(size_t lightIdx) { return CameraView + 1 + lightIdx; }
+
+    void initializeViewBuffer();
+
+    // fills in the camera-independent part (light counts, shadow bias) and uploads the view into
+    // its slot, unless the slot already holds the same constants
+    void updateView(size_t viewSlot, const glm::mat4 &view, const glm::mat4 &projection,
+                    const glm::vec3 &viewPos);
+    void updateCameraView(const Camera *camera);
+
+    // binds the slot to the shared binding point, so that all the subsequent draws see it
+    void bindView(size_t viewSlot) const;
+
+    void setDirectionalShadowBias(float bias) { _directionalShadowBias = bias; }
+    float directionalShadowBias() const { return _directionalShadowBias; }
+
+    void cleanUpGracefully();
+
+private:
+    ViewConstantsManager() = default;
+
+    size_t _maxViews = 0;
+    size_t _slotStride = 0; // sizeof(ViewConstants) rounded up to the uniform offset alignment
+    float _directionalShadowBias = 0.0f;
+
+    GLuint _vBufferId = 0;
+    std::vector<std::optional<ViewConstants>> _uploadedViews; // per slot, as last uploaded
+};
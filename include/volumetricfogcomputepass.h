@@ -4,10 +4,13 @@
 #include "framepass.h"
 #include "types.h"
 
+class ShaderProgramBatch;
+
 class VolumetricFogPass : public FramePass
 {
 public:
-    VolumetricFogPass();
+    // the fog sphere shader is submitted with `batch`, and completed with it
+    VolumetricFogPass(ShaderProgramBatch &batch);
     void runPass() override;
     void syncTextureAccess(uint32_t syncBits) const;
     TextureIdentifier colorTextureId() const;
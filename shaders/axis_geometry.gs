@@ -1,11 +1,8 @@
-#version 400 core
+#version 460 core
 
 uniform float thickness;
 uniform float axisLength;
 
-uniform mat4 viewMat;
-uniform mat4 projectionMat;
-
 layout(points) in;
 layout(triangle_strip, max_vertices = 18) out;
 
@@ -21,8 +18,8 @@ out vec4 outColor;
 // rescales the vertex so that is appears to be of the same size in ndc
 vec4 rescaleVertex(vec3 inputVertex, vec3 linearDimensions)
 {
-    float scale = -(viewMat * gsIn[0].modelMat * vec4(inputVertex, 1.0)).z;
-    return projectionMat * viewMat * gsIn[0].modelMat
+    float scale = -(view * gsIn[0].modelMat * vec4(inputVertex, 1.0)).z;
+    return projection * view * gsIn[0].modelMat
            * vec4(linearDimensions * scale * inputVertex, 1.0);
 }
 
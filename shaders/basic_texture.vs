@@ -1,19 +0,0 @@
-#version 460 core
-
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec2 aTexCoord;
-layout(location = 2) in vec3 aNormal;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-out vec2 texCoord;
-
-void main()
-{
-    vec4 vWorldPos = (model * vec4(aPos, 1.0f));
-    gl_Position = projection * view * vWorldPos;
-
-    texCoord = aTexCoord;
-}
@@ -0,0 +1,24 @@
+#version 460 core
+
+// position-only stream, the depth pass needs nothing else
+layout(location = 0) in vec3 aPos;
+
+layout(location = 1) in mat4 model;            // instanced
+
+#ifdef ENGINE_COMPACT_VERTICES
+// the positions are quantized relative to the mesh bounds; one multi-draw spans many meshes, so
+// the decode comes with the instance instead of being set per draw
+layout(location = 5) in vec3 positionScale;    // instanced
+layout(location = 6) in vec3 positionOffset;   // instanced
+#endif
+
+void main()
+{
+#ifdef ENGINE_COMPACT_VERTICES
+    vec3 position = positionOffset + aPos * positionScale;
+#else
+    vec3 position = aPos;
+#endif
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
@@ -10,8 +10,6 @@ in vec2 texCoord;
 in vec3 vPos; //fragment world position
 in vec3 vNorm; //fragment world normal
 
-uniform vec3 viewPos;
-
 flat in ivec3 instanceMaterialIndices;
 
 layout(binding = 0, std430) readonly buffer TextureHandles { uvec2 textures[]; };
@@ -89,23 +87,18 @@ layout(binding = 1, std140) uniform DirectionalLights
 {
     DirectionalLight dirLights[NUM_DIRECTIONAL];
 };
-uniform int numDirectionalLightsBound;
 
 #define NUM_POINT 8
 layout(binding = 2, std140) uniform PointLights { PointLight pointLights[NUM_POINT]; };
-uniform int numPointLightsBound;
 
 #define NUM_SPOT 8
 layout(binding = 3, std140) uniform SpotLights { SpotLight spotLights[NUM_SPOT]; };
-uniform int numSpotLightsBound;
 
 #define NUM_TEXTURED_SPOT 4
 layout(binding = 4, std140) uniform TexturedSpotLights { TexturedSpotLight texturedSpotLights[NUM_TEXTURED_SPOT]; };
-uniform int numTexturedLightsBound;
 
 uniform sampler2DShadow directionalShadowMaps[NUM_DIRECTIONAL];
 // uniform sampler2D directionalShadowMaps[NUM_DIRECTIONAL];
-uniform float directionalShadowBias;
 
 float fragmentInDirectionalShadow(DirectionalLight light, int lightIdx, vec3 fragWorldPos, vec3 norm)
 {
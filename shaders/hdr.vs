@@ -8,8 +8,14 @@ uniform mat4 modelToNdc; //just transforms the plane into NDC
 
 out vec2 fragTexCoords;
 
+// the positions are quantized relative to the mesh bounds, the decode is set per draw
+layout(location = 14) in vec3 positionScale;
+layout(location = 15) in vec3 positionOffset;
+
 void main()
 {
-    gl_Position = modelToNdc * vec4(aPos, 1.0);
+    vec3 position = positionOffset + aPos * positionScale;
+
+    gl_Position = modelToNdc * vec4(position, 1.0);
     fragTexCoords = vec2((gl_Position.x + 1.0) / 2.0, (gl_Position.y + 1.0) / 2.0);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#version 400 core
+#version 460 core
 
 // ins
 layout(location = 0) in vec3 aPos;
@@ -8,13 +8,16 @@ layout(location = 2) in vec3 normal;
 layout(location = 3) in mat4 lightModel; // instanced
 layout(location = 7) in vec4 lightColor; // instanced
 
-uniform mat4 view;
-uniform mat4 projection;
-
 out vec4 outLightColor;
 
+// the positions are quantized relative to the mesh bounds, the decode is set per draw
+layout(location = 14) in vec3 positionScale;
+layout(location = 15) in vec3 positionOffset;
+
 void main()
 {
-    gl_Position = projection * view * lightModel * vec4(aPos, 1.0f);
+    vec3 position = positionOffset + aPos * positionScale;
+
+    gl_Position = projection * view * lightModel * vec4(position, 1.0f);
     outLightColor = lightColor;
 }
@@ -3,8 +3,6 @@
 
 out vec4 FragColor;
 
-uniform vec3 viewPos;
-
 struct DirectionalLight
 {
     vec3 ambient;
@@ -80,23 +78,18 @@ layout(binding = 1, std140) uniform DirectionalLights
 {
     DirectionalLight dirLights[NUM_DIRECTIONAL];
 };
-uniform int numDirectionalLightsBound;
 
 #define NUM_POINT 8
 layout(binding = 2, std140) uniform PointLights { PointLight pointLights[NUM_POINT]; };
-uniform int numPointLightsBound;
 
 #define NUM_SPOT 8
 layout(binding = 3, std140) uniform SpotLights { SpotLight spotLights[NUM_SPOT]; };
-uniform int numSpotLightsBound;
 
 #define NUM_TEXTURED_SPOT 4
 layout(binding = 4, std140) uniform TexturedSpotLights { TexturedSpotLight texturedSpotLights[NUM_TEXTURED_SPOT]; };
-uniform int numTexturedLightsBound;
 
 uniform sampler2DShadow directionalShadowMaps[NUM_DIRECTIONAL];
 // uniform sampler2D directionalShadowMaps[NUM_DIRECTIONAL];
-uniform float directionalShadowBias;
 
 const float PI = 3.14159265359;
 
@@ -340,10 +333,14 @@ void main()
     renormalizedTbn[1] = normalize(renormalizedTbn[1] - dot(renormalizedTbn[0], renormalizedTbn[1]) * renormalizedTbn[0]);
     renormalizedTbn[2] = normalize(renormalizedTbn[2] - dot(renormalizedTbn[0], renormalizedTbn[2]) * renormalizedTbn[0] - dot(renormalizedTbn[1], renormalizedTbn[2]) * renormalizedTbn[1]);
 
-    vec3 fNormal = normalHandle == -1 ? normalize(vec3(1.0)) : normalize(renormalizedTbn * ((texture(sampler2D(pbrTextures[normalHandle]), fs_in.texCoord).rgb * 2.0) - 1.0)).rgb;
+    // the normal maps may only keep X and Y (BC5), so Z is rebuilt
+    vec2 normalXY = normalHandle == -1 ? vec2(0.0) : texture(sampler2D(pbrTextures[normalHandle]), fs_in.texCoord).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+    vec3 fNormal = normalHandle == -1 ? normalize(vec3(1.0)) : normalize(renormalizedTbn * tangentNormal);
     vec3 albedo = albedoHandle == -1 ? vec3(0.0) : texture(sampler2D(pbrTextures[albedoHandle]), fs_in.texCoord).rgb;
-    vec3 metallic = metallicHandle == -1 ? vec3(0.0) : texture(sampler2D(pbrTextures[metallicHandle]), fs_in.texCoord).rgb;
-    vec3 roughness = roughnessHandle == -1 ? vec3(0.0) : texture(sampler2D(pbrTextures[roughnessHandle]), fs_in.texCoord).rgb;
+    // glTF's packing: the roughness in green, the metalness in blue (the grey maps have both)
+    vec3 metallic = metallicHandle == -1 ? vec3(0.0) : vec3(texture(sampler2D(pbrTextures[metallicHandle]), fs_in.texCoord).b);
+    vec3 roughness = roughnessHandle == -1 ? vec3(0.0) : vec3(texture(sampler2D(pbrTextures[roughnessHandle]), fs_in.texCoord).g);
     float ao = aoHandle == -1 ? 1.0 : texture(sampler2D(pbrTextures[aoHandle]), fs_in.texCoord).r;
 
     vec3 F0 = vec3(0.04); 
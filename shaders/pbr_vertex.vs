@@ -3,8 +3,13 @@
 // ins
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
+#ifdef ENGINE_COMPACT_VERTICES
+layout(location = 2) in vec2 normal;  // octahedral
+layout(location = 3) in vec4 tangent; // octahedral, then the handedness
+#else
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec3 tangent;
+#endif
 
 layout(location = 4) in mat4 model; //instanced
 layout(location = 8) in ivec4 materialIndicesPart1; //instanced
@@ -21,22 +26,45 @@ out VertexParamPack
 } vs_out;
 
 // uniforms
-uniform mat4 view;
-uniform mat4 projection;
 // uniform mat4 model;
 
+// the positions are quantized relative to the mesh bounds, the decode is set per draw
+layout(location = 14) in vec3 positionScale;
+layout(location = 15) in vec3 positionOffset;
+
+// full float normals pass through, the compact ones are octahedral encoded
+vec3 decodeDirection(vec3 direction) { return direction; }
+vec3 decodeDirection(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-direction.z, 0.0);
+    direction.xy += vec2(direction.x >= 0.0 ? -t : t, direction.y >= 0.0 ? -t : t);
+    return normalize(direction);
+}
+
 void main()
 {
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 decodedNormal = decodeDirection(normal);
+#ifdef ENGINE_COMPACT_VERTICES
+    vec3 decodedTangent = decodeDirection(tangent.xy);
+    float handedness = tangent.z >= 0.0 ? 1.0 : -1.0;
+#else
+    vec3 decodedTangent = tangent;
+    float handedness = 1.0;
+#endif
+
     // position
-    vec4 vWorldPos = (model * vec4(aPos, 1.0f));
+    vec4 vWorldPos = (model * vec4(position, 1.0f));
     gl_Position = projection * view * vWorldPos;
 
     mat3 normalTransformationMat = mat3(transpose(inverse(model)));
 
     //transformation of normals
-    vec3 tBitangent = normalize(normalTransformationMat * cross(normal, tangent));
-    vec3 tNormal = normalize(normalTransformationMat * normal);
-    vec3 tTangent = normalize(normalTransformationMat * tangent);
+    vec3 tBitangent = normalize(normalTransformationMat * cross(decodedNormal, decodedTangent)
+                                        * handedness);
+    vec3 tNormal = normalize(normalTransformationMat * decodedNormal);
+    vec3 tTangent = normalize(normalTransformationMat * decodedTangent);
 
     // forwarding to fragment
     vs_out.vPos = vWorldPos.xyz;
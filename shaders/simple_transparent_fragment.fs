@@ -5,10 +5,9 @@
 in vec3 vPos;
 in vec3 vNorm;
 in vec2 texCoord;
+flat in ivec3 instanceMaterialIndices;
 
-uniform uvec2 diffuseTextureHandle;
-uniform uvec2 specularTextureHandle;
-uniform vec3 viewPos;
+layout(binding = 0, std430) readonly buffer TextureHandles { uvec2 textures[]; };
 
 out vec4 fragColor;
 
@@ -27,7 +26,6 @@ struct PointLight
 
 #define NUM_POINT 8
 layout(binding = 2, std140) uniform PointLights { PointLight pointLights[NUM_POINT]; };
-uniform int numPointLightsBound;
 
 vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor,
                                vec3 ambientColor, vec3 specularColor)
@@ -58,6 +56,9 @@ void main()
     vec3 effectiveColor = vec3(0.0f, 0.0f, 0.0f);
     vec3 viewDir = normalize(viewPos - vPos.xyz);
 
+    uvec2 diffuseTextureHandle = instanceMaterialIndices.x < 0 ? uvec2(0, 0) : textures[instanceMaterialIndices.x];
+    uvec2 specularTextureHandle = instanceMaterialIndices.y < 0 ? uvec2(0, 0) : textures[instanceMaterialIndices.y];
+
     vec4 diffuseColor = diffuseTextureHandle == uvec2(0, 0) ? vec4(0.0) : texture(sampler2D(diffuseTextureHandle), texCoord);
 
     vec3 specularColor = specularTextureHandle == uvec2(0, 0) ? vec3(0.0) : texture(sampler2D(specularTextureHandle), texCoord).xyz;
@@ -6,13 +6,17 @@ layout(location = 2) in vec3 normal;
 
 out vec3 TexCoords;
 
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 model;
 
+// the positions are quantized relative to the mesh bounds, the decode is set per draw
+layout(location = 14) in vec3 positionScale;
+layout(location = 15) in vec3 positionOffset;
+
 void main()
 {
-    TexCoords = aPos;
-    vec4 pos = projection * view * model * vec4(aPos, 1.0);
+    vec3 position = positionOffset + aPos * positionScale;
+
+    TexCoords = position;
+    vec4 pos = projection * mat4(mat3(view)) * model * vec4(position, 1.0);
     gl_Position = pos.xyww;
 }  
\ No newline at end of file
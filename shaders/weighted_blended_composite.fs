@@ -0,0 +1,27 @@
+#version 460 core
+
+uniform sampler2D accumulationTexture;
+uniform sampler2D revealageTexture;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    // the oit targets match the hdr buffer texel for texel
+    ivec2 texelCoord = ivec2(gl_FragCoord.xy);
+
+    float revealage = texelFetch(revealageTexture, texelCoord, 0).r;
+    if (revealage >= 1.0)
+        discard; // nothing transparent covers this pixel
+
+    vec4 accumulation = texelFetch(accumulationTexture, texelCoord, 0);
+
+    // guards against overflow of the half-float target
+    if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b))))
+        accumulation.rgb = vec3(accumulation.a);
+
+    vec3 averageColor = accumulation.rgb / max(accumulation.a, 1e-5);
+
+    // blended as src_alpha, one_minus_src_alpha over the opaque image
+    fragColor = vec4(averageColor, 1.0 - revealage);
+}
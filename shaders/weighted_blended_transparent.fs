@@ -0,0 +1,84 @@
+#version 460 core
+
+#extension GL_ARB_bindless_texture : require
+
+in vec3 vPos;
+in vec3 vNorm;
+in vec2 texCoord;
+flat in ivec3 instanceMaterialIndices;
+
+layout(binding = 0, std430) readonly buffer TextureHandles { uvec2 textures[]; };
+
+// weighted blended OIT targets
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out float revealage;
+
+struct PointLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float attenuationConstantTerm;
+    float attenuationLinearTerm;
+    float attenuationQuadraticTerm;
+
+    vec3 position;
+};
+
+#define NUM_POINT 8
+layout(binding = 2, std140) uniform PointLights { PointLight pointLights[NUM_POINT]; };
+
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor,
+                               vec3 ambientColor, vec3 specularColor)
+{
+    vec3 fragToLight = normalize(light.position - fragPos);
+    // diffuse bit
+    float diff = max(dot(normal, fragToLight), 0.0);
+    // specular bit
+    vec3 halfVector = normalize(viewDir+fragToLight);
+    float spec = pow(max(dot(halfVector, normal), 0.0), 64);
+    // attenuation computation
+    float distance = length(light.position - fragPos);
+    float attenuation = clamp(1.0
+                                  / (light.attenuationConstantTerm
+                                     + light.attenuationLinearTerm * distance
+                                     + light.attenuationQuadraticTerm * (distance * distance)),
+                              0.0, 1.0);
+    // combination
+    vec3 ambient = light.ambient * ambientColor * attenuation;
+    vec3 diffuse = light.diffuse * diff *diffuseColor * attenuation;
+    vec3 specular = light.specular * spec * specularColor * attenuation;
+
+    return (ambient + diffuse + specular);
+}
+
+void main()
+{
+    vec3 effectiveColor = vec3(0.0f, 0.0f, 0.0f);
+    vec3 viewDir = normalize(viewPos - vPos.xyz);
+
+    uvec2 diffuseTextureHandle = instanceMaterialIndices.x < 0 ? uvec2(0, 0) : textures[instanceMaterialIndices.x];
+    uvec2 specularTextureHandle = instanceMaterialIndices.y < 0 ? uvec2(0, 0) : textures[instanceMaterialIndices.y];
+
+    vec4 diffuseColor = diffuseTextureHandle == uvec2(0, 0) ? vec4(0.0) : texture(sampler2D(diffuseTextureHandle), texCoord);
+
+    vec3 specularColor = specularTextureHandle == uvec2(0, 0) ? vec3(0.0) : texture(sampler2D(specularTextureHandle), texCoord).xyz;
+
+    vec3 ambientColor = diffuseTextureHandle == uvec2(0, 0) ? vec3(0.0) : texture(sampler2D(diffuseTextureHandle), texCoord).xyz;
+
+    for (int p = 0; p < numPointLightsBound; ++p)
+    {
+        effectiveColor += CalculatePointLight(pointLights[p], normalize(vNorm), vPos, viewDir,
+                                              diffuseColor.xyz, ambientColor, specularColor);
+    }
+
+    // weight function from the weighted blended oit paper (McGuire & Bavoil, 2013); favours the
+    // closer and more opaque surfaces without any sorting
+    float alpha = diffuseColor.a;
+    float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+
+    accumulation = vec4(effectiveColor * alpha, alpha) * weight;
+    revealage = alpha;
+}
+
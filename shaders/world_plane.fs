@@ -5,7 +5,6 @@
 uniform sampler2D planeTexture;
 uniform float checkerUnitWidth;
 uniform float checkerUnitHeight;
-uniform vec3 viewPos;
 
 in vec3 fragmentPos;
 in vec3 vNorm;
@@ -34,10 +33,8 @@ layout(binding = 1, std140) uniform DirectionalLights
 {
     DirectionalLight dirLights[NUM_DIRECTIONAL];
 };
-uniform int numDirectionalLightsBound;
 
 uniform sampler2DShadow directionalShadowMaps[NUM_DIRECTIONAL];
-uniform float directionalShadowBias;
 
 float fragmentInDirectionalShadow(DirectionalLight light, int lightIdx, vec3 fragWorldPos, vec3 norm)
 {
@@ -2,20 +2,39 @@
 
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
+#ifdef ENGINE_COMPACT_VERTICES
+layout(location = 2) in vec2 normal; // octahedral
+#else
 layout(location = 2) in vec3 normal;
+#endif
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 out vec3 fragmentPos;
 out vec3 vNorm;
 
+// the positions are quantized relative to the mesh bounds, the decode is set per draw
+layout(location = 14) in vec3 positionScale;
+layout(location = 15) in vec3 positionOffset;
+
+// full float normals pass through, the compact ones are octahedral encoded
+vec3 decodeDirection(vec3 direction) { return direction; }
+vec3 decodeDirection(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-direction.z, 0.0);
+    direction.xy += vec2(direction.x >= 0.0 ? -t : t, direction.y >= 0.0 ? -t : t);
+    return normalize(direction);
+}
+
 void main()
 {
-    vec4 vWorldPos = (model * vec4(aPos, 1.0f));
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 decodedNormal = decodeDirection(normal);
+
+    vec4 vWorldPos = (model * vec4(position, 1.0f));
 
     fragmentPos = vWorldPos.xyz;
-    vNorm = mat3(transpose(inverse(model))) * normal;
+    vNorm = mat3(transpose(inverse(model))) * decodedNormal;
     gl_Position = projection * view * vWorldPos;
 }
@@ -0,0 +1,35 @@
+#include "blobfile.h"
+
+#include <fstream>
+
+bool writeAtomically(const std::filesystem::path &file,
+                     const std::function<bool(BlobWriter &writer)> &write)
+{
+    std::error_code error;
+    if (file.has_parent_path())
+        std::filesystem::create_directories(file.parent_path(), error);
+
+    std::filesystem::path temporaryFile = file;
+    temporaryFile += ".tmp";
+    {
+        std::ofstream stream(temporaryFile, std::ios::binary | std::ios::trunc);
+        if (!stream)
+            return false;
+
+        BlobWriter writer(stream);
+        if (!write(writer) || !stream.flush())
+        {
+            stream.close();
+            std::filesystem::remove(temporaryFile, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryFile, file, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryFile, error);
+        return false;
+    }
+    return true;
+}
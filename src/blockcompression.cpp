@@ -0,0 +1,586 @@
+#include "blockcompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+using Block = std::array<uint8_t, 64>; // 4x4 RGBA texels, row by row
+
+template <size_t Channels>
+using Texel = std::array<float, Channels>;
+
+template <size_t Channels>
+using Texels = std::array<Texel<Channels>, 16>;
+
+void loadBlock(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t blockX,
+               uint32_t blockY, Block &block)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        const uint32_t row = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            const uint32_t column = std::min(blockX * 4 + x, width - 1);
+            std::memcpy(&block[(y * 4 + x) * 4], rgba + (size_t(row) * width + column) * 4, 4);
+        }
+    }
+}
+
+template <size_t Channels>
+Texels<Channels> texelsOf(const Block &block, size_t firstChannel = 0)
+{
+    Texels<Channels> texels;
+    for (size_t t = 0; t < 16; ++t)
+    {
+        for (size_t c = 0; c < Channels; ++c)
+            texels[t][c] = block[t * 4 + firstChannel + c];
+    }
+    return texels;
+}
+
+template <size_t Channels>
+Texel<Channels> meanOf(const Texels<Channels> &texels)
+{
+    Texel<Channels> mean = {};
+    for (const Texel<Channels> &texel : texels)
+    {
+        for (size_t c = 0; c < Channels; ++c)
+            mean[c] += texel[c] / 16.0f;
+    }
+    return mean;
+}
+
+// the direction the colours spread along the most, by power iteration on their covariance; zero
+// for a flat block
+template <size_t Channels>
+Texel<Channels> principalAxis(const Texels<Channels> &texels, const Texel<Channels> &mean)
+{
+    std::array<Texel<Channels>, Channels> covariance = {};
+    for (const Texel<Channels> &texel : texels)
+    {
+        for (size_t i = 0; i < Channels; ++i)
+        {
+            for (size_t j = i; j < Channels; ++j)
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+        }
+    }
+    for (size_t i = 0; i < Channels; ++i)
+    {
+        for (size_t j = 0; j < i; ++j)
+            covariance[i][j] = covariance[j][i];
+    }
+
+    // starting from the widest channel's row converges in a few steps
+    size_t widest = 0;
+    for (size_t c = 1; c < Channels; ++c)
+    {
+        if (covariance[c][c] > covariance[widest][widest])
+            widest = c;
+    }
+
+    Texel<Channels> axis = covariance[widest];
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        Texel<Channels> next = {};
+        float lengthSquared = 0.0f;
+        for (size_t i = 0; i < Channels; ++i)
+        {
+            for (size_t j = 0; j < Channels; ++j)
+                next[i] += covariance[i][j] * axis[j];
+            lengthSquared += next[i] * next[i];
+        }
+        if (lengthSquared < 1e-12f)
+            return Texel<Channels>{};
+
+        const float inverseLength = 1.0f / std::sqrt(lengthSquared);
+        for (size_t c = 0; c < Channels; ++c)
+            axis[c] = next[c] * inverseLength;
+    }
+
+    return axis;
+}
+
+// the extremes of the colours along the principal axis
+template <size_t Channels>
+void axisEndpoints(const Texels<Channels> &texels, Texel<Channels> &endpoint0,
+                   Texel<Channels> &endpoint1)
+{
+    const Texel<Channels> mean = meanOf(texels);
+    const Texel<Channels> axis = principalAxis(texels, mean);
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for (const Texel<Channels> &texel : texels)
+    {
+        float projection = 0.0f;
+        for (size_t c = 0; c < Channels; ++c)
+            projection += (texel[c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    for (size_t c = 0; c < Channels; ++c)
+    {
+        endpoint0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        endpoint1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+// the endpoints that best reproduce the texels with the given interpolation weights (0 for the
+// first endpoint, 1 for the second); false if the weights can't tell the endpoints apart
+template <size_t Channels>
+bool fitEndpoints(const Texels<Channels> &texels, const std::array<float, 16> &weights,
+                  Texel<Channels> &endpoint0, Texel<Channels> &endpoint1)
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    Texel<Channels> ax = {}, bx = {};
+    for (size_t t = 0; t < 16; ++t)
+    {
+        const float b = weights[t];
+        const float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (size_t c = 0; c < Channels; ++c)
+        {
+            ax[c] += a * texels[t][c];
+            bx[c] += b * texels[t][c];
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+
+    for (size_t c = 0; c < Channels; ++c)
+    {
+        endpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        endpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+template <size_t Channels>
+float distanceSquared(const Texel<Channels> &texel, const Texel<Channels> &color)
+{
+    float distance = 0.0f;
+    for (size_t c = 0; c < Channels; ++c)
+        distance += (texel[c] - color[c]) * (texel[c] - color[c]);
+    return distance;
+}
+
+// the bits of a block, least significant first
+class BitWriter
+{
+public:
+    explicit BitWriter(uint8_t *block) : _block(block) {}
+
+    void write(uint32_t value, int numBits)
+    {
+        for (int b = 0; b < numBits; ++b, ++_bit)
+        {
+            if ((value >> b) & 1)
+                _block[_bit >> 3] |= static_cast<uint8_t>(1 << (_bit & 7));
+        }
+    }
+
+private:
+    uint8_t *_block;
+    size_t _bit = 0;
+};
+
+// BC1
+
+uint16_t packRgb565(const Texel<3> &color)
+{
+    const auto quantize = [](float value, int maximum) {
+        return static_cast<uint16_t>(std::lround(value * maximum / 255.0f));
+    };
+    return static_cast<uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5
+                                 | quantize(color[2], 31));
+}
+
+Texel<3> unpackRgb565(uint16_t color)
+{
+    const int red = color >> 11, green = (color >> 5) & 63, blue = color & 31;
+    return { static_cast<float>(red << 3 | red >> 2), static_cast<float>(green << 2 | green >> 4),
+             static_cast<float>(blue << 3 | blue >> 2) };
+}
+
+struct ColorFit
+{
+    uint16_t color0 = 0;
+    uint16_t color1 = 0;
+    std::array<uint8_t, 16> indices = {};
+    float error = 0.0f;
+};
+
+// the four colour mode needs the first endpoint to be the larger one; BC3 always uses it
+ColorFit fitColors(const Texels<3> &texels, uint16_t color0, uint16_t color1)
+{
+    ColorFit fit;
+    fit.color0 = std::max(color0, color1);
+    fit.color1 = std::min(color0, color1);
+
+    const Texel<3> endpoint0 = unpackRgb565(fit.color0);
+    const Texel<3> endpoint1 = unpackRgb565(fit.color1);
+    std::array<Texel<3>, 4> palette = { endpoint0, endpoint1 };
+    for (size_t c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2.0f * endpoint0[c] + endpoint1[c]) / 3.0f;
+        palette[3][c] = (endpoint0[c] + 2.0f * endpoint1[c]) / 3.0f;
+    }
+    // equal endpoints would switch to the three colour mode, where the last shade is black
+    const size_t numColors = fit.color0 == fit.color1 ? 1 : 4;
+
+    for (size_t t = 0; t < 16; ++t)
+    {
+        float bestDistance = distanceSquared(texels[t], palette[0]);
+        for (size_t p = 1; p < numColors; ++p)
+        {
+            if (const float distance = distanceSquared(texels[t], palette[p]);
+                distance < bestDistance)
+            {
+                bestDistance = distance;
+                fit.indices[t] = static_cast<uint8_t>(p);
+            }
+        }
+        fit.error += bestDistance;
+    }
+
+    return fit;
+}
+
+void encodeColorBlock(const Block &block, uint8_t *encoded)
+{
+    const Texels<3> texels = texelsOf<3>(block);
+
+    Texel<3> endpoint0, endpoint1;
+    axisEndpoints(texels, endpoint0, endpoint1);
+
+    // the extremes are inset a little, since the shades between them cover more of the texels
+    for (size_t c = 0; c < 3; ++c)
+    {
+        const float inset = (endpoint1[c] - endpoint0[c]) / 16.0f;
+        endpoint0[c] += inset;
+        endpoint1[c] -= inset;
+    }
+
+    ColorFit best = fitColors(texels, packRgb565(endpoint1), packRgb565(endpoint0));
+    for (int iteration = 0; iteration < 2; ++iteration)
+    {
+        // the palette's order: the endpoints, then the shades at a third and two thirds
+        constexpr std::array<float, 4> IndexWeights = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        std::array<float, 16> weights;
+        for (size_t t = 0; t < 16; ++t)
+            weights[t] = IndexWeights[best.indices[t]];
+
+        if (!fitEndpoints(texels, weights, endpoint0, endpoint1))
+            break;
+
+        const ColorFit refined = fitColors(texels, packRgb565(endpoint0), packRgb565(endpoint1));
+        if (refined.error >= best.error)
+            break;
+        best = refined;
+    }
+
+    std::memset(encoded, 0, 8);
+    BitWriter writer(encoded);
+    writer.write(best.color0, 16);
+    writer.write(best.color1, 16);
+    for (const uint8_t index : best.indices)
+        writer.write(index, 2);
+}
+
+// BC4
+
+void encodeChannelBlock(const Block &block, uint8_t channel, uint8_t *encoded)
+{
+    std::array<uint8_t, 16> values;
+    for (size_t t = 0; t < 16; ++t)
+        values[t] = block[t * 4 + channel];
+
+    const auto [minValue, maxValue] = std::ranges::minmax(values);
+
+    // the eight shades mode: the larger endpoint first, then the smaller, then the six shades
+    // between them from the larger one on
+    std::memset(encoded, 0, 8);
+    BitWriter writer(encoded);
+    writer.write(maxValue, 8);
+    writer.write(minValue, 8);
+    if (maxValue == minValue)
+        return;
+
+    const float step = (maxValue - minValue) / 7.0f;
+    for (const uint8_t value : values)
+    {
+        const int shade = static_cast<int>(std::lround((maxValue - value) / step));
+        writer.write(shade == 0 ? 0 : shade == 7 ? 1 : shade + 1, 3);
+    }
+}
+
+// BC7: mode 6 fits the four channels along a single line, mode 5 gives the alpha its own, for
+// the blocks where it varies independently of the colour
+
+constexpr std::array<int, 4> Bc7Weights2 = { 0, 21, 43, 64 };
+constexpr std::array<int, 16> Bc7Weights4 = { 0,  4,  9,  13, 17, 21, 26, 30,
+                                              34, 38, 43, 47, 51, 55, 60, 64 };
+
+template <size_t Channels>
+struct Bc7Endpoint
+{
+    std::array<int, Channels> bits = {}; // as stored
+    int pBit = 0;                        // mode 6 only
+    std::array<int, Channels> value = {};
+};
+
+// mode 6: 7 bits per channel plus the shared bit closest to the endpoint
+Bc7Endpoint<4> quantizeShared(const Texel<4> &endpoint)
+{
+    Bc7Endpoint<4> best;
+    float bestError = -1.0f;
+    for (int pBit = 0; pBit < 2; ++pBit)
+    {
+        Bc7Endpoint<4> candidate;
+        candidate.pBit = pBit;
+        float error = 0.0f;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            candidate.bits[c] = std::clamp(
+                static_cast<int>(std::lround((endpoint[c] - pBit) / 2.0f)), 0, 127);
+            candidate.value[c] = candidate.bits[c] << 1 | pBit;
+            const float difference = candidate.value[c] - endpoint[c];
+            error += difference * difference;
+        }
+        if (bestError < 0.0f || error < bestError)
+        {
+            best = candidate;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+// mode 5: 7 bits per colour channel, with the top bit repeated below them
+Bc7Endpoint<3> quantizeColor(const Texel<3> &endpoint)
+{
+    Bc7Endpoint<3> quantized;
+    for (size_t c = 0; c < 3; ++c)
+    {
+        quantized.bits[c] = std::clamp(static_cast<int>(std::lround(endpoint[c] / 2.0f)), 0, 127);
+        quantized.value[c] = quantized.bits[c] << 1 | quantized.bits[c] >> 6;
+    }
+    return quantized;
+}
+
+// mode 5: 8 bits of alpha
+Bc7Endpoint<1> quantizeAlpha(const Texel<1> &endpoint)
+{
+    Bc7Endpoint<1> quantized;
+    quantized.bits[0] = static_cast<int>(std::lround(endpoint[0]));
+    quantized.value[0] = quantized.bits[0];
+    return quantized;
+}
+
+template <size_t Channels>
+struct Bc7Fit
+{
+    Bc7Endpoint<Channels> endpoint0;
+    Bc7Endpoint<Channels> endpoint1;
+    std::array<uint8_t, 16> indices = {};
+    float error = 0.0f;
+};
+
+template <size_t Channels, size_t NumWeights>
+Bc7Fit<Channels> fitBc7(const Texels<Channels> &texels, const Bc7Endpoint<Channels> &endpoint0,
+                        const Bc7Endpoint<Channels> &endpoint1,
+                        const std::array<int, NumWeights> &weights)
+{
+    Bc7Fit<Channels> fit;
+    fit.endpoint0 = endpoint0;
+    fit.endpoint1 = endpoint1;
+
+    std::array<Texel<Channels>, NumWeights> palette;
+    Texel<Channels> direction;
+    float directionLengthSquared = 0.0f;
+    for (size_t c = 0; c < Channels; ++c)
+    {
+        const int value0 = endpoint0.value[c], value1 = endpoint1.value[c];
+        for (size_t p = 0; p < NumWeights; ++p)
+        {
+            palette[p][c] = static_cast<float>(
+                ((64 - weights[p]) * value0 + weights[p] * value1 + 32) >> 6);
+        }
+        direction[c] = static_cast<float>(value1 - value0);
+        directionLengthSquared += direction[c] * direction[c];
+    }
+
+    for (size_t t = 0; t < 16; ++t)
+    {
+        // the shade nearest to the texel's projection, or one of its neighbours once rounded
+        int guess = 0;
+        if (directionLengthSquared > 0.0f)
+        {
+            float projection = 0.0f;
+            for (size_t c = 0; c < Channels; ++c)
+                projection += (texels[t][c] - palette[0][c]) * direction[c];
+            const float weight = std::clamp(projection / directionLengthSquared, 0.0f, 1.0f) * 64;
+            guess = static_cast<int>(std::ranges::lower_bound(weights, weight) - weights.begin());
+        }
+
+        float bestDistance = -1.0f;
+        for (int p = std::max(guess - 1, 0); p <= std::min<int>(guess + 1, NumWeights - 1); ++p)
+        {
+            const float distance = distanceSquared(texels[t], palette[p]);
+            if (bestDistance < 0.0f || distance < bestDistance)
+            {
+                bestDistance = distance;
+                fit.indices[t] = static_cast<uint8_t>(p);
+            }
+        }
+        fit.error += bestDistance;
+    }
+
+    return fit;
+}
+
+template <size_t Channels, size_t NumWeights>
+Bc7Fit<Channels> encodeBc7Line(const Texels<Channels> &texels,
+                               const std::array<int, NumWeights> &weights,
+                               Bc7Endpoint<Channels> (*quantize)(const Texel<Channels> &))
+{
+    Texel<Channels> endpoint0, endpoint1;
+    axisEndpoints(texels, endpoint0, endpoint1);
+
+    Bc7Fit<Channels> best = fitBc7(texels, quantize(endpoint0), quantize(endpoint1), weights);
+    for (int iteration = 0; iteration < 2; ++iteration)
+    {
+        std::array<float, 16> indexWeights;
+        for (size_t t = 0; t < 16; ++t)
+            indexWeights[t] = weights[best.indices[t]] / 64.0f;
+
+        if (!fitEndpoints(texels, indexWeights, endpoint0, endpoint1))
+            break;
+
+        const Bc7Fit<Channels> refined =
+            fitBc7(texels, quantize(endpoint0), quantize(endpoint1), weights);
+        if (refined.error >= best.error)
+            break;
+        best = refined;
+    }
+
+    // the first texel's index drops its top bit, so it has to be in the lower half
+    if (best.indices[0] >= NumWeights / 2)
+    {
+        std::swap(best.endpoint0, best.endpoint1);
+        for (uint8_t &index : best.indices)
+            index = static_cast<uint8_t>(NumWeights - 1 - index);
+    }
+
+    return best;
+}
+
+template <size_t Channels>
+void writeIndices(BitWriter &writer, const Bc7Fit<Channels> &fit, int numBits)
+{
+    for (size_t t = 0; t < 16; ++t)
+        writer.write(fit.indices[t], t == 0 ? numBits - 1 : numBits);
+}
+
+void encodeBc7Block(const Block &block, uint8_t *encoded)
+{
+    const Texels<4> texels = texelsOf<4>(block);
+    const Bc7Fit<4> shared = encodeBc7Line(texels, Bc7Weights4, quantizeShared);
+
+    Bc7Fit<3> color;
+    Bc7Fit<1> alpha;
+    const bool opaque = std::ranges::all_of(texels, [](const Texel<4> &t) { return t[3] == 255; });
+    if (!opaque)
+    {
+        color = encodeBc7Line(texelsOf<3>(block), Bc7Weights2, quantizeColor);
+        alpha = encodeBc7Line(texelsOf<1>(block, 3), Bc7Weights2, quantizeAlpha);
+    }
+
+    std::memset(encoded, 0, 16);
+    BitWriter writer(encoded);
+    if (opaque || shared.error <= color.error + alpha.error)
+    {
+        writer.write(1 << 6, 7);
+        for (size_t c = 0; c < 4; ++c)
+        {
+            writer.write(shared.endpoint0.bits[c], 7);
+            writer.write(shared.endpoint1.bits[c], 7);
+        }
+        writer.write(shared.endpoint0.pBit, 1);
+        writer.write(shared.endpoint1.pBit, 1);
+        writeIndices(writer, shared, 4);
+    }
+    else
+    {
+        writer.write(1 << 5, 6);
+        writer.write(0, 2); // no channel rotation
+        for (size_t c = 0; c < 3; ++c)
+        {
+            writer.write(color.endpoint0.bits[c], 7);
+            writer.write(color.endpoint1.bits[c], 7);
+        }
+        writer.write(alpha.endpoint0.bits[0], 8);
+        writer.write(alpha.endpoint1.bits[0], 8);
+        writeIndices(writer, color, 2);
+        writeIndices(writer, alpha, 2);
+    }
+}
+} // namespace
+
+namespace BlockCompression
+{
+size_t blockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+std::vector<uint8_t> compress(const uint8_t *rgba, uint32_t width, uint32_t height,
+                              BlockFormat format, std::array<uint8_t, 2> channels)
+{
+    std::vector<uint8_t> compressed(compressedSize(format, width, height));
+    uint8_t *encoded = compressed.data();
+
+    Block block;
+    for (uint32_t blockY = 0; blockY < (height + 3) / 4; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < (width + 3) / 4; ++blockX)
+        {
+            loadBlock(rgba, width, height, blockX, blockY, block);
+            switch (format)
+            {
+            case BlockFormat::BC1:
+                encodeColorBlock(block, encoded);
+                break;
+            case BlockFormat::BC3:
+                encodeChannelBlock(block, 3, encoded);
+                encodeColorBlock(block, encoded + 8);
+                break;
+            case BlockFormat::BC4:
+                encodeChannelBlock(block, channels[0], encoded);
+                break;
+            case BlockFormat::BC5:
+                encodeChannelBlock(block, channels[0], encoded);
+                encodeChannelBlock(block, channels[1], encoded + 8);
+                break;
+            case BlockFormat::BC7:
+                encodeBc7Block(block, encoded);
+                break;
+            }
+            encoded += blockSize(format);
+        }
+    }
+
+    return compressed;
+}
+} // namespace BlockCompression
@@ -34,7 +34,7 @@ void ComputeShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _computeShaderId = glCreateShader(GL_COMPUTE_SHADER);
         glShaderSource(_computeShaderId, 1, &vPtr, NULL);
-        compileShader(_computeShaderId);
+        deferShader(_computeShaderId);
     }
 
     glAttachShader(id, _computeShaderId);
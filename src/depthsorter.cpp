@@ -0,0 +1,186 @@
+#include "depthsorter.h"
+
+#include "objectmanager.h"
+#include "transformmanager.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+constexpr size_t RadixBits = 8;
+constexpr size_t RadixBuckets = 1 << RadixBits;
+constexpr size_t RadixPasses = DepthSorter::KeyBits / RadixBits;
+static_assert(RadixPasses * RadixBits == DepthSorter::KeyBits);
+
+uint32_t itemKey(uint64_t item) { return static_cast<uint32_t>(item >> 32); }
+uint32_t itemIndex(uint64_t item) { return static_cast<uint32_t>(item); }
+} // namespace
+
+void DepthSorter::setObjects(std::span<const GameObjectIdentifier> objects)
+{
+    _objects.assign(objects.begin(), objects.end());
+
+    _items.resize(_objects.size());
+    std::iota(_items.begin(), _items.end(), 0);
+    _hasOrder = false;
+
+    refreshPositions();
+}
+
+void DepthSorter::refreshPositions()
+{
+    _positions.resize(_objects.size());
+    for (size_t o = 0; o < _objects.size(); ++o)
+    {
+        _positions[o] = TransformManager::instance()
+                            ->getTransform(ObjectManager::instance()
+                                               ->getObject(_objects[o])
+                                               .getIdentifierForComponent(ComponentType::TRANSFORM))
+                            ->position();
+    }
+}
+
+void DepthSorter::setCoherenceThresholds(float maxPositionDelta, float maxDirectionDelta)
+{
+    _maxPositionDelta = maxPositionDelta;
+    _maxDirectionDelta = maxDirectionDelta;
+}
+
+void DepthSorter::computeKeys(const glm::mat4 &view)
+{
+    // view depth of a point = the z row of the view matrix applied to it
+    const glm::vec4 depthRow = glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = std::numeric_limits<float>::lowest();
+    for (uint64_t &item : _items)
+    {
+        const glm::vec3 &p = _positions[itemIndex(item)];
+        const float depth = depthRow.x * p.x + depthRow.y * p.y + depthRow.z * p.z + depthRow.w;
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(float)); // the keys double as the depth storage
+        item = static_cast<uint64_t>(depthBits) << 32 | itemIndex(item);
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // view space looks down -z: the most negative depth is the farthest and gets the smallest key
+    const double range = std::max(static_cast<double>(maxDepth) - minDepth, 1e-6);
+    // the nearest lands on the largest key at most, the truncation never rounds up
+    const double scale = static_cast<double>((1u << KeyBits) - 1) / range;
+    for (uint64_t &item : _items)
+    {
+        const uint32_t depthBits = itemKey(item);
+        float depth;
+        std::memcpy(&depth, &depthBits, sizeof(float));
+        const auto key = static_cast<uint32_t>((static_cast<double>(depth) - minDepth) * scale);
+        item = static_cast<uint64_t>(key) << 32 | itemIndex(item);
+    }
+}
+
+bool DepthSorter::sortBackToFront(const glm::mat4 &view)
+{
+    if (_items.size() < 2)
+        return false;
+
+    const glm::mat4 inverseView = glm::inverse(view);
+    const glm::vec3 viewPosition = glm::vec3(inverseView[3]);
+    const glm::vec3 viewDirection = -glm::vec3(inverseView[2]);
+
+    const glm::vec3 positionDelta = viewPosition - _previousViewPosition;
+    const bool coherent = _hasOrder
+                          && glm::dot(positionDelta, positionDelta)
+                                 < _maxPositionDelta * _maxPositionDelta
+                          && 1.0f - glm::dot(viewDirection, _previousViewDirection)
+                                 < _maxDirectionDelta;
+
+    _previousViewPosition = viewPosition;
+    _previousViewDirection = viewDirection;
+
+    _previousOrder.resize(_items.size());
+    std::ranges::transform(_items, _previousOrder.begin(), itemIndex);
+    computeKeys(view);
+
+    // a nearly sorted order costs a handful of moves per element; anything beyond is cheaper to
+    // radix sort from scratch
+    if (!coherent || !insertionSort(_items, _items.size() * 4))
+        radixSort(_items, _itemsScratch);
+
+    _hasOrder = true;
+    return !std::ranges::equal(_items, _previousOrder, {}, itemIndex);
+}
+
+void DepthSorter::writeOrder(std::vector<GameObjectIdentifier> &target) const
+{
+    target.resize(_items.size());
+    for (size_t o = 0; o < _items.size(); ++o)
+        target[o] = _objects[itemIndex(_items[o])];
+}
+
+void DepthSorter::radixSort(std::vector<uint64_t> &items, std::vector<uint64_t> &scratch)
+{
+    const size_t count = items.size();
+    scratch.resize(count);
+
+    // all the histograms in one read of the keys
+    std::array<std::array<uint32_t, RadixBuckets>, RadixPasses> histograms{};
+    for (const uint64_t item : items)
+    {
+        const uint32_t key = itemKey(item);
+        for (size_t pass = 0; pass < RadixPasses; ++pass)
+            ++histograms[pass][(key >> (pass * RadixBits)) & (RadixBuckets - 1)];
+    }
+
+    // lsd passes; stable, so the ties keep the incoming order
+    for (size_t pass = 0; pass < RadixPasses; ++pass)
+    {
+        const size_t shift = 32 + pass * RadixBits;
+        auto &histogram = histograms[pass];
+        if (histogram[(items[0] >> shift) & (RadixBuckets - 1)] == count)
+            continue; // every key has the same digit -> the pass wouldn't move anything
+
+        uint32_t offset = 0;
+        for (uint32_t &bucket : histogram)
+        {
+            const uint32_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+
+        for (const uint64_t item : items)
+            scratch[histogram[(item >> shift) & (RadixBuckets - 1)]++] = item;
+
+        items.swap(scratch);
+    }
+}
+
+bool DepthSorter::insertionSort(std::vector<uint64_t> &items, size_t maxMoves)
+{
+    size_t moves = 0;
+    for (size_t i = 1; i < items.size(); ++i)
+    {
+        const uint64_t item = items[i];
+        const uint32_t key = itemKey(item);
+
+        size_t j = i;
+        while (j > 0 && itemKey(items[j - 1]) > key)
+        {
+            items[j] = items[j - 1];
+            --j;
+
+            if (++moves > maxMoves)
+            {
+                // keeps the array a valid permutation for the fallback
+                items[j] = item;
+                return false;
+            }
+        }
+
+        items[j] = item;
+    }
+    return true;
+}
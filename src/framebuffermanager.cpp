@@ -27,9 +27,10 @@ void FrameBufferManager::bindDepthTexture(GLenum target, GLenum textureType, GLu
     glFramebufferTexture2D(target, GL_DEPTH_ATTACHMENT, textureType, texIdx, 0);
 }
 
-void FrameBufferManager::bindColorTexture(GLenum target, GLenum textureType, GLuint texIdx) const
+void FrameBufferManager::bindColorTexture(GLenum target, GLenum textureType, GLuint texIdx,
+                                          GLuint attachmentIdx) const
 {
-    glFramebufferTexture2D(target, GL_COLOR_ATTACHMENT0, textureType, texIdx, 0);
+    glFramebufferTexture2D(target, GL_COLOR_ATTACHMENT0 + attachmentIdx, textureType, texIdx, 0);
 }
 
 void FrameBufferManager::setColorMode(GLuint mode) const { glDrawBuffer(mode); }
@@ -54,7 +54,7 @@ void FullscreenFogShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, 0);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -67,7 +67,7 @@ void FullscreenFogShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, 0);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
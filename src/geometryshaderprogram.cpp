@@ -89,23 +89,21 @@ void GeometryShaderProgram::runShader()
     };
 
     use();
-    MeshIdentifier dummyMesh = MeshManager::instance()->getDummyMesh();
 
     const std::vector<GameObjectIdentifier> shaderObjects(_orderedShaderObjects.cbegin(),
                                                           _orderedShaderObjects.cend());
 
-    MeshManager::instance()->enableMeshInstancing(dummyMesh);
-    const Mesh &mesh = *MeshManager::instance()->getMesh(dummyMesh);
+    if (_vertexArray == 0)
+        _vertexArray = MeshManager::instance()->createVertexArray();
 
     const uint32_t vertexBufferId = Instancer::instance()->instanceData(shaderObjects,
                                                                         { modelMatrixCol0,
                                                                           modelMatrixCol1,
                                                                           modelMatrixCol2,
                                                                           modelMatrixCol3 },
-                                                                        mesh.instancedArrayId());
+                                                                        _vertexArray);
 
-    MeshManager::instance()->allocateMesh(dummyMesh);
-    MeshManager::instance()->bindMeshInstanced(dummyMesh);
+    glBindVertexArray(_vertexArray);
 
     setFloat("axisLength", 0.25l);
     setFloat("thickness", 0.002l);
@@ -114,7 +112,7 @@ void GeometryShaderProgram::runShader()
 
     glDeleteBuffers(1, &vertexBufferId); // presumably, it will anyway be regenerated
 
-    MeshManager::instance()->unbindMesh();
+    glBindVertexArray(0);
 }
 
 void GeometryShaderProgram::compileAndAttachNecessaryShaders(uint32_t id)
@@ -130,7 +128,7 @@ void GeometryShaderProgram::compileAndAttachNecessaryShaders(uint32_t id)
 
         _geometryShaderId = glCreateShader(GL_GEOMETRY_SHADER);
         glShaderSource(_geometryShaderId, 1, &gPtr, NULL);
-        compileShader(_geometryShaderId);
+        deferShader(_geometryShaderId);
     }
 
     glAttachShader(id, _geometryShaderId);
@@ -143,7 +141,7 @@ void GeometryShaderProgram::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -156,7 +154,7 @@ void GeometryShaderProgram::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
@@ -30,9 +30,6 @@ void GizmosPass::runPass()
     {
         glDisable(GL_DEPTH_TEST);
         _axesShader->use();
-
-        _axesShader->setMatrix4("viewMat", _currentCamera->getViewMatrix());
-        _axesShader->setMatrix4("projectionMat", _currentCamera->projectionMatrix());
         _axesShader->runShader();
 
         glEnable(GL_DEPTH_TEST);
@@ -0,0 +1,73 @@
+#include "globjectcounting.h"
+
+#include "startupprofiler.h"
+
+#include "glad/glad.h"
+
+#include <type_traits>
+
+namespace
+{
+// the wrapper of a glad entry point, which counts the objects it creates: as many as its GLsizei
+// argument says for the glGen* and glCreate* ones, or the one glCreateShader and glCreateProgram
+// return
+template <auto *EntryPoint>
+struct CountingEntryPoint;
+
+template <typename Result, typename... Arguments, Result(APIENTRYP *EntryPoint)(Arguments...)>
+struct CountingEntryPoint<EntryPoint>
+{
+    static inline Result(APIENTRYP original)(Arguments...) = nullptr;
+
+    static Result APIENTRY call(Arguments... arguments)
+    {
+        GLsizei count = 1;
+        ([&] {
+            if constexpr (std::is_same_v<Arguments, GLsizei>)
+                count = arguments;
+        }(),
+         ...);
+        StartupProfiler::instance()->addGlObjects(count);
+
+        return original(arguments...);
+    }
+
+    static void start()
+    {
+        if (original != nullptr || *EntryPoint == nullptr)
+            return;
+        original = *EntryPoint;
+        *EntryPoint = &call;
+    }
+
+    static void stop()
+    {
+        if (original == nullptr)
+            return;
+        *EntryPoint = original;
+        original = nullptr;
+    }
+};
+
+template <auto *...EntryPoints>
+struct CountingEntryPoints
+{
+    static void start() { (CountingEntryPoint<EntryPoints>::start(), ...); }
+    static void stop() { (CountingEntryPoint<EntryPoints>::stop(), ...); }
+};
+
+using ObjectCreation = CountingEntryPoints<
+    &glad_glGenBuffers, &glad_glCreateBuffers, &glad_glGenTextures, &glad_glCreateTextures,
+    &glad_glGenFramebuffers, &glad_glCreateFramebuffers, &glad_glGenRenderbuffers,
+    &glad_glCreateRenderbuffers, &glad_glGenVertexArrays, &glad_glCreateVertexArrays,
+    &glad_glGenQueries, &glad_glCreateQueries, &glad_glGenSamplers, &glad_glCreateSamplers,
+    &glad_glGenProgramPipelines, &glad_glCreateProgramPipelines, &glad_glCreateShader,
+    &glad_glCreateProgram>;
+} // namespace
+
+namespace GlObjectCounting
+{
+void start() { ObjectCreation::start(); }
+
+void stop() { ObjectCreation::stop(); }
+} // namespace GlObjectCounting
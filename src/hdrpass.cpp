@@ -117,8 +117,7 @@ void HdrPass::runShader()
     setFloat("viewportYScale", (float)viewportY / 1080.0f);
     setInt("tonemappingAlgo", tonemappingAlgo < 0 ? 0 : tonemappingAlgo);
 
-    glDrawElements(GL_TRIANGLES, MeshManager::instance()->getMesh(_planeMeshId)->numIndices(),
-                   GL_UNSIGNED_INT, 0);
+    MeshManager::instance()->drawMesh(_planeMeshId);
 
     MeshManager::instance()->unbindMesh();
     TextureManager::instance()->unbindTexture(_colorTextureId);
@@ -134,7 +133,7 @@ void HdrPass::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -147,7 +146,7 @@ void HdrPass::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
@@ -1,6 +1,12 @@
 #include "instancedshader.h"
+#include "camera.h"
 #include "instancer.h"
 #include "materialmanager.h"
+#include "texturestreamer.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
 
 template <typename MaterialStruct>
 InstancedShader<MaterialStruct>::InstancedShader(const char *vertexPath, const char *fragmentPath)
@@ -11,76 +17,343 @@ InstancedShader<MaterialStruct>::InstancedShader(const char *vertexPath, const c
 template <typename MaterialStruct>
 InstancedShader<MaterialStruct>::~InstancedShader()
 {
-    glDeleteBuffers(1, &_texturesSSBO);
-    glDeleteBuffers(_instancedBufferIds.size(), _instancedBufferIds.data());
+    glDeleteBuffers(1, &_instancedBufferId);
+    MeshManager::instance()->releaseVertexArray(_vertexArray);
 }
 
 template <typename MaterialStruct>
 void InstancedShader<MaterialStruct>::updateInstancedBuffer(
     const std::unordered_set<GameObjectIdentifier> &objsToUpdate)
 {
-    if (_instancedBufferIds.empty())
+    if (_instancedBufferId == 0)
         return;
 
-    const std::vector<GameObjectIdentifier> shaderObjects(_orderedShaderObjects.cbegin(),
-                                                          _orderedShaderObjects.cend());
-
     std::vector<std::pair<GameObjectIdentifier, uint32_t>> objsToReinstance;
-    size_t meshCounter = 0;
-    auto meshStart = shaderObjects.cbegin();
-    auto meshEnd = shaderObjects.cbegin();
-    while (meshEnd <= shaderObjects.cend())
+    for (uint32_t o = 0; o < _instancedObjects.size(); ++o)
+    {
+        if (objsToUpdate.contains(_instancedObjects[o]))
+            objsToReinstance.emplace_back(_instancedObjects[o], o);
+    }
+
+    if (!objsToReinstance.empty())
+    {
+        Instancer::instance()->updateInstancedData(_instancedBufferId, getDataGenerators(),
+                                                   objsToReinstance);
+    }
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::selectLods(const Camera *camera, float viewportHeight)
+{
+    if (camera == nullptr || _instancedObjects.empty())
+        return;
+
+    // pixels per world unit at a distance of one
+    const float pixelsPerUnit = camera->projectionMatrix()[1][1] * viewportHeight * 0.5f;
+    const glm::vec3 cameraPosition = camera->position();
+
+    bool lodsChanged = false;
+    for (const InstancedMeshRun &run : _instancedMeshes)
     {
-        // submits ranges of objects that share the same mesh
-        if (meshEnd == shaderObjects.cend()
-            || (ObjectManager::instance()
-                    ->getObject(*meshStart)
-                    .getIdentifierForComponent(ComponentType::MESH)
-                != ObjectManager::instance()->getObject(*meshEnd).getIdentifierForComponent(
-                    ComponentType::MESH)))
+        const Mesh *mesh = MeshManager::instance()->getMesh(run.meshId);
+        const size_t numLods = mesh == nullptr ? 1 : mesh->numLods();
+
+        for (GLuint o = run.baseInstance; o < run.baseInstance + run.instanceCount; ++o)
         {
-            const MeshIdentifier sharedMesh = ObjectManager::instance()
-                                                  ->getObject(*meshStart)
-                                                  .getIdentifierForComponent(ComponentType::MESH);
-            if (sharedMesh != InvalidIdentifier)
+            size_t lod = 0;
+            if (_lodsEnabled && numLods > 1)
             {
-                Instancer::instance()->updateInstancedData(_instancedBufferIds[meshCounter++],
-                                                           getDataGenerators(), objsToReinstance);
+                const glm::mat4 modelMatrix = modelMatrixOf(_instancedObjects[o]);
+                const glm::vec3 center = modelMatrix * glm::vec4(mesh->boundsCenter(), 1.0f);
+                const float scale = std::max({ glm::length(glm::vec3(modelMatrix[0])),
+                                               glm::length(glm::vec3(modelMatrix[1])),
+                                               glm::length(glm::vec3(modelMatrix[2])) });
+                const float radius = mesh->boundsRadius() * scale;
+
+                // the nearest point of the bounding sphere; inside it, the full detail
+                const float distance = glm::length(center - cameraPosition) - radius;
+                const float projectedRadius = distance > 0.0f
+                                                  ? radius * pixelsPerUnit / distance
+                                                  : std::numeric_limits<float>::max();
+
+                // the errors are relative to the bounding radius
+                lod = std::min(_instancedLods[o], numLods - 1);
+                while (lod > 0
+                       && mesh->lodError(lod) * projectedRadius
+                              > _lodPixelError * (1.0f + LodHysteresis))
+                {
+                    --lod;
+                }
+                while (lod + 1 < numLods
+                       && mesh->lodError(lod + 1) * projectedRadius
+                              < _lodPixelError * (1.0f - LodHysteresis))
+                {
+                    ++lod;
+                }
             }
-            objsToReinstance.clear();
-            meshStart = meshEnd;
+
+            lodsChanged |= lod != _instancedLods[o];
+            _instancedLods[o] = lod;
         }
+    }
+
+    if (lodsChanged)
+        regroupLods();
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::requestTextureResolutions(const Camera *camera,
+                                                                float viewportHeight)
+{
+    if (camera == nullptr || !TextureStreamer::instance()->enabled())
+        return;
+
+    constexpr ComponentType MaterialType = getComponentTypeForStruct<MaterialStruct>();
+    const float pixelsPerUnit = camera->projectionMatrix()[1][1] * viewportHeight * 0.5f;
+    const glm::vec3 cameraPosition = camera->position();
 
-        if (meshEnd == shaderObjects.cend())
-            break;
+    for (const InstancedMeshRun &run : _instancedMeshes)
+    {
+        const Mesh *mesh = MeshManager::instance()->getMesh(run.meshId);
+        if (mesh == nullptr || mesh->uvDensity() <= 0.0f)
+            continue;
 
-        if (objsToUpdate.contains(*meshEnd))
+        for (GLuint o = run.baseInstance; o < run.baseInstance + run.instanceCount; ++o)
         {
-            const size_t objIdx = meshEnd - meshStart;
-            objsToReinstance.emplace_back(*meshEnd, objIdx);
+            const MaterialIdentifier mId = ObjectManager::instance()
+                                               ->getObject(_instancedObjects[o])
+                                               .getIdentifierForComponent(MaterialType);
+            if (mId == InvalidIdentifier)
+                continue;
+
+            // as in selectLods: the nearest point of the bounds, which ignores the frustum
+            const glm::mat4 modelMatrix = modelMatrixOf(_instancedObjects[o]);
+            const glm::vec3 center = modelMatrix * glm::vec4(mesh->boundsCenter(), 1.0f);
+            const float scale = std::max({ glm::length(glm::vec3(modelMatrix[0])),
+                                           glm::length(glm::vec3(modelMatrix[1])),
+                                           glm::length(glm::vec3(modelMatrix[2])) });
+            const float distance
+                = glm::length(center - cameraPosition) - mesh->boundsRadius() * scale;
+            const float pixelsPerUv = distance > 0.0f
+                                          ? pixelsPerUnit * scale / (distance * mesh->uvDensity())
+                                          : std::numeric_limits<float>::infinity();
+
+            for (const TextureIdentifier tId :
+                 MaterialManager<MaterialStruct, MaterialType>::instance()
+                     ->getMaterial(mId)
+                     .textures())
+            {
+                if (tId != InvalidIdentifier)
+                    TextureStreamer::instance()->requestResolution(tId, pixelsPerUv);
+            }
         }
-        ++meshEnd;
     }
 }
 
 template <typename MaterialStruct>
-void InstancedShader<MaterialStruct>::runShader()
+void InstancedShader<MaterialStruct>::cullMeshlets(const Camera *camera)
 {
-    use();
+    _culledRuns.clear();
+    if (!_meshletCullingEnabled || camera == nullptr || _instancedObjects.empty())
+        return;
 
-    for (auto &[meshId, count] : _instancedMeshes)
+    _meshletCuller.beginFrame(camera->projectionMatrix() * camera->getViewMatrix(),
+                              camera->position());
+    _culledRuns.resize(_instancedMeshes.size());
+
+    for (size_t r = 0; r < _instancedMeshes.size(); ++r)
     {
-        const Mesh &mesh = *MeshManager::instance()->getMesh(meshId);
+        const InstancedMeshRun &run = _instancedMeshes[r];
+        const Mesh *mesh = MeshManager::instance()->getMesh(run.meshId);
+        if (mesh == nullptr || run.lod != 0 || mesh->meshletData().size() < MinMeshletsForCulling)
+            continue;
+
+        CulledRun &culledRun = _culledRuns[r];
+        culledRun.culled = true;
+        culledRun.firstCommand = _meshletCuller.numCommands();
+        const size_t trianglesBefore = _meshletCuller.numTrianglesVisible();
+
+        for (GLuint o = run.baseInstance; o < run.baseInstance + run.instanceCount; ++o)
+            _meshletCuller.cullInstance(*mesh, modelMatrixOf(_instancedObjects[o]), o);
+
+        culledRun.numCommands = static_cast<GLsizei>(_meshletCuller.numCommands()
+                                                     - culledRun.firstCommand);
+        culledRun.numTriangles = _meshletCuller.numTrianglesVisible() - trianglesBefore;
+    }
 
-        MeshManager::instance()->bindMeshInstanced(meshId);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _texturesSSBO);
+    _meshletCuller.uploadCommands();
+}
+
+template <typename MaterialStruct>
+glm::mat4 InstancedShader<MaterialStruct>::modelMatrixOf(GameObjectIdentifier gId) const
+{
+    return TransformManager::instance()
+        ->getTransform(ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+            ComponentType::TRANSFORM))
+        ->computeModelMatrix();
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::regroupLods()
+{
+    std::vector<InstancedMeshRun> runs;
+    std::vector<GameObjectIdentifier> objects;
+    std::vector<size_t> lods;
+    objects.reserve(_instancedObjects.size());
+    lods.reserve(_instancedLods.size());
 
-        glDrawElementsInstanced(GL_TRIANGLES, mesh.indicesSize(), GL_UNSIGNED_INT, 0, count);
+    // the instanced data of the objects that moved to another slot
+    std::vector<std::pair<GameObjectIdentifier, uint32_t>> objsToReinstance;
+
+    // the runs of a mesh are adjacent; its instances are regrouped by the LOD
+    for (size_t r = 0; r < _instancedMeshes.size();)
+    {
+        const MeshIdentifier meshId = _instancedMeshes[r].meshId;
+        const GLuint firstInstance = _instancedMeshes[r].baseInstance;
+        GLuint endInstance = firstInstance;
+        for (; r < _instancedMeshes.size() && _instancedMeshes[r].meshId == meshId; ++r)
+            endInstance = _instancedMeshes[r].baseInstance + _instancedMeshes[r].instanceCount;
+
+        std::vector<uint32_t> order(endInstance - firstInstance);
+        std::iota(order.begin(), order.end(), firstInstance);
+        std::ranges::stable_sort(order, {}, [this](uint32_t o) { return _instancedLods[o]; });
 
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        for (const uint32_t o : order)
+        {
+            const size_t lod = _instancedLods[o];
+            if (!runs.empty() && runs.back().meshId == meshId && runs.back().lod == lod)
+                ++runs.back().instanceCount;
+            else
+                runs.emplace_back(meshId, static_cast<GLuint>(objects.size()), 1, lod);
+
+            if (o != objects.size())
+                objsToReinstance.emplace_back(_instancedObjects[o], objects.size());
 
-        MeshManager::instance()->unbindMesh();
+            objects.emplace_back(_instancedObjects[o]);
+            lods.emplace_back(lod);
+        }
     }
+
+    _instancedMeshes = std::move(runs);
+    _instancedObjects = std::move(objects);
+    _instancedLods = std::move(lods);
+
+    if (!objsToReinstance.empty())
+    {
+        Instancer::instance()->updateInstancedData(_instancedBufferId, getDataGenerators(),
+                                                   objsToReinstance);
+    }
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::setLodsEnabled(bool enabled)
+{
+    _lodsEnabled = enabled;
+}
+
+template <typename MaterialStruct>
+bool InstancedShader<MaterialStruct>::lodsEnabled() const
+{
+    return _lodsEnabled;
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::setLodPixelError(float pixelError)
+{
+    _lodPixelError = pixelError;
+}
+
+template <typename MaterialStruct>
+float InstancedShader<MaterialStruct>::lodPixelError() const
+{
+    return _lodPixelError;
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::setMeshletCullingEnabled(bool enabled)
+{
+    _meshletCullingEnabled = enabled;
+}
+
+template <typename MaterialStruct>
+bool InstancedShader<MaterialStruct>::meshletCullingEnabled() const
+{
+    return _meshletCullingEnabled;
+}
+
+template <typename MaterialStruct>
+size_t InstancedShader<MaterialStruct>::numMeshletsTested() const
+{
+    return _meshletCuller.numMeshletsTested();
+}
+
+template <typename MaterialStruct>
+size_t InstancedShader<MaterialStruct>::numMeshletsVisible() const
+{
+    return _meshletCuller.numMeshletsVisible();
+}
+
+template <typename MaterialStruct>
+size_t InstancedShader<MaterialStruct>::numDrawRuns() const
+{
+    return _instancedMeshes.size();
+}
+
+template <typename MaterialStruct>
+size_t InstancedShader<MaterialStruct>::numTrianglesDrawn() const
+{
+    return _numTrianglesDrawn;
+}
+
+template <typename MaterialStruct>
+size_t InstancedShader<MaterialStruct>::numTrianglesAtFullDetail() const
+{
+    return _numTrianglesAtFullDetail;
+}
+
+template <typename MaterialStruct>
+void InstancedShader<MaterialStruct>::runShader()
+{
+    use();
+
+    glBindVertexArray(_vertexArray);
+    TextureManager::instance()->bindHandleTable(_textureHandlesbindingPoint);
+
+    // the culling results are only valid for the runs they were made for
+    const bool meshletsCulled = _culledRuns.size() == _instancedMeshes.size();
+    if (meshletsCulled)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _meshletCuller.commandBuffer());
+
+    _numTrianglesDrawn = _numTrianglesAtFullDetail = 0;
+    for (size_t r = 0; r < _instancedMeshes.size(); ++r)
+    {
+        const InstancedMeshRun &run = _instancedMeshes[r];
+        const Mesh *mesh = MeshManager::instance()->getMesh(run.meshId);
+        if (mesh == nullptr)
+            continue;
+
+        if (meshletsCulled && _culledRuns[r].culled)
+        {
+            const CulledRun &culledRun = _culledRuns[r];
+            MeshManager::instance()->drawMeshIndirect(run.meshId, culledRun.firstCommand,
+                                                      culledRun.numCommands);
+            _numTrianglesDrawn += culledRun.numTriangles;
+        }
+        else
+        {
+            MeshManager::instance()->drawMeshInstanced(run.meshId, run.instanceCount,
+                                                       run.baseInstance, run.lod);
+            _numTrianglesDrawn += mesh->numIndices(run.lod) / 3 * run.instanceCount;
+        }
+        _numTrianglesAtFullDetail += mesh->numIndices() / 3 * run.instanceCount;
+    }
+
+    // the culling was for this camera and frame
+    _culledRuns.clear();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, _textureHandlesbindingPoint, 0);
+    glBindVertexArray(0);
 }
 
 template <typename MaterialStruct>
@@ -94,7 +367,7 @@ void InstancedShader<MaterialStruct>::compileAndAttachNecessaryShaders(uint32_t
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -107,7 +380,7 @@ void InstancedShader<MaterialStruct>::compileAndAttachNecessaryShaders(uint32_t
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
@@ -126,13 +399,10 @@ void InstancedShader<MaterialStruct>::deleteShaders()
 template <typename MaterialStruct>
 void InstancedShader<MaterialStruct>::runTextureMapping()
 {
-    glDeleteBuffers(1, &_texturesSSBO);
     _objectsTextureMappings
         = MaterialManager<MaterialStruct, getComponentTypeForStruct<MaterialStruct>()>::instance()
-              ->bindTextures(std::vector<GameObjectIdentifier>(_orderedShaderObjects.cbegin(),
-                                                               _orderedShaderObjects.cend()),
-                             _textureHandlesbindingPoint, _texturesSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+              ->textureSlots(std::vector<GameObjectIdentifier>(_orderedShaderObjects.cbegin(),
+                                                               _orderedShaderObjects.cend()));
 }
 
 template <typename MaterialStruct>
@@ -244,47 +514,41 @@ std::vector<InstancedDataGenerator> InstancedShader<MaterialStruct>::getDataGene
 template <typename MaterialStruct>
 void InstancedShader<MaterialStruct>::runInstancing()
 {
-    const std::vector<GameObjectIdentifier> shaderObjects
-        = std::vector<GameObjectIdentifier>(_orderedShaderObjects.cbegin(),
-                                            _orderedShaderObjects.cend());
-
     _instancedMeshes.clear();
-    _instancedBufferIds.clear();
+    _instancedObjects.clear();
+    _instancedLods.clear();
 
-    auto meshStart = shaderObjects.cbegin();
-    auto meshEnd = shaderObjects.cbegin();
-    while (meshEnd <= shaderObjects.cend())
+    // the objects are already ordered by mesh, so the runs are contiguous
+    for (const GameObjectIdentifier gId : _orderedShaderObjects)
     {
-        // submits ranges of objects that share the same mesh
-        if (meshEnd == shaderObjects.cend()
-            || (ObjectManager::instance()
-                    ->getObject(*meshStart)
-                    .getIdentifierForComponent(ComponentType::MESH)
-                != ObjectManager::instance()->getObject(*meshEnd).getIdentifierForComponent(
-                    ComponentType::MESH)))
-        {
-            const MeshIdentifier sharedMesh = ObjectManager::instance()
-                                                  ->getObject(*meshStart)
-                                                  .getIdentifierForComponent(ComponentType::MESH);
-            if (sharedMesh != InvalidIdentifier)
-            {
-                MeshManager::instance()->enableMeshInstancing(sharedMesh);
-                const Mesh &mesh = *MeshManager::instance()->getMesh(sharedMesh);
+        const MeshIdentifier meshId = ObjectManager::instance()
+                                          ->getObject(gId)
+                                          .getIdentifierForComponent(ComponentType::MESH);
+        if (meshId == InvalidIdentifier)
+            continue;
 
-                const GLuint vertexBufferid = Instancer::instance()
-                                                  ->instanceData(std::span(meshStart, meshEnd),
-                                                                 getDataGenerators(),
-                                                                 mesh.instancedArrayId());
+        MeshManager::instance()->allocateMesh(meshId);
 
-                _instancedMeshes.emplace(sharedMesh, meshEnd - meshStart);
-                _instancedBufferIds.emplace_back(vertexBufferid);
-            }
-            meshStart = meshEnd;
-        }
+        if (!_instancedMeshes.empty() && _instancedMeshes.back().meshId == meshId)
+            ++_instancedMeshes.back().instanceCount;
+        else
+            _instancedMeshes.emplace_back(meshId, static_cast<GLuint>(_instancedObjects.size()), 1);
 
-        if (meshEnd == shaderObjects.cend())
-            break;
-
-        ++meshEnd;
+        _instancedObjects.emplace_back(gId);
     }
+
+    // the LODs are picked again with the next selectLods
+    _instancedLods.assign(_instancedObjects.size(), 0);
+
+    if (_vertexArray == 0)
+        _vertexArray = MeshManager::instance()->createVertexArray();
+
+    glDeleteBuffers(1, &_instancedBufferId);
+    _instancedBufferId = 0;
+
+    if (_instancedObjects.empty())
+        return;
+
+    _instancedBufferId = Instancer::instance()->instanceData(_instancedObjects, getDataGenerators(),
+                                                             _vertexArray);
 }
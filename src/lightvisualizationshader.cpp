@@ -140,8 +140,9 @@ void LightVisualizationShader::runShader()
         const std::vector<GameObjectIdentifier> shaderObjects(_orderedShaderObjects.cbegin(),
                                                               _orderedShaderObjects.cend());
 
-        MeshManager::instance()->enableMeshInstancing(_lightMesh);
-        const Mesh &mesh = *MeshManager::instance()->getMesh(_lightMesh);
+        MeshManager::instance()->allocateMesh(_lightMesh);
+        if (_vertexArray == 0)
+            _vertexArray = MeshManager::instance()->createVertexArray();
 
         const uint32_t vertexBufferId = Instancer::instance()->instanceData(shaderObjects,
                                                                             { modelMatrixCol0,
@@ -149,13 +150,12 @@ void LightVisualizationShader::runShader()
                                                                               modelMatrixCol2,
                                                                               modelMatrixCol3,
                                                                               lightSourceColor },
-                                                                            mesh.instancedArrayId());
-        MeshManager::instance()->bindMeshInstanced(_lightMesh);
+                                                                            _vertexArray);
+        glBindVertexArray(_vertexArray);
 
-        glDrawElementsInstanced(GL_TRIANGLES, mesh.indicesSize(), GL_UNSIGNED_INT, 0,
-                                shaderObjects.size());
+        MeshManager::instance()->drawMeshInstanced(_lightMesh, shaderObjects.size(), 0);
 
-        MeshManager::instance()->unbindMesh();
+        glBindVertexArray(0);
         glDeleteBuffers(1, &vertexBufferId); // presumably, it will anyway be regenerated
     }
 }
@@ -170,7 +170,7 @@ void LightVisualizationShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -183,7 +183,7 @@ void LightVisualizationShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
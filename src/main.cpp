@@ -11,11 +11,11 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
-#include "basicshader.h"
 #include "camera.h"
 #include "fullscreenfogshader.h"
 #include "geometryshaderprogram.h"
 #include "gizmospass.h"
+#include "globjectcounting.h"
 #include "hdrpass.h"
 #include "instancedshader.h"
 #include "instancer.h"
@@ -25,36 +25,61 @@
 #include "meshmanager.h"
 #include "modelloader.h"
 #include "object.h"
+#include "passtimer.h"
 #include "objectmanager.h"
+#include "pixelpool.h"
 #include "pbrshader.h"
+#include "programcache.h"
 #include "quaternioncamera.h"
+#include "scenefile.h"
+#include "sceneloader.h"
 #include "shadowpass.h"
 #include "skyboxshader.h"
 #include "standardpass.h"
+#include "startupprofiler.h"
 #include "texture.h"
 #include "texturemanager.h"
 #include "texturemanager3d.h"
+#include "texturestreamer.h"
+#include "threadpool.h"
 #include "timemanager.h"
 #include "transformmanager.h"
 #include "transparentpass.h"
 #include "transparentshader.h"
+#include "viewconstantsmanager.h"
 #include "volumetricfogcomputepass.h"
 #include "window.h"
 #include "worldplaneshader.h"
 
+#include <array>
+#include <charconv>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <numbers>
+#include <optional>
+#include <string_view>
 #include <tuple>
 #include <unordered_set>
 
+#ifdef LINUX
+#include <unistd.h>
+#endif
+
 namespace
 {
 constexpr size_t windowWidth = 1440;
 constexpr size_t windowHeight = 810;
 
+// --transparency-benchmark: the glass pane counts it times the passes at, and over how many frames
+constexpr std::array<size_t, 5> transparencyBenchmarkPanes = { 16, 64, 256, 1024, 4096 };
+constexpr int transparencyBenchmarkWarmUpFrames = 10;
+constexpr int transparencyBenchmarkFrames = 100;
+
 const char *vertexShaderSource = ENGINE_SHADERS "/vertex_standard.vs";
 const char *fragmentShaderSource = ENGINE_SHADERS "/fragment_standard.fs";
 
@@ -169,22 +194,277 @@ void imGuiInitialization(Window *windowToBindTo)
     ImGui_ImplOpenGL3_Init();
 }
 
-uint32_t nextRandomInt()
+uint32_t xorshift(uint32_t &x)
 {
-    static uint32_t x = std::chrono::duration_cast<std::chrono::seconds>(
-                            std::chrono::system_clock::now().time_since_epoch())
-                            .count();
     x ^= x << 13;
     x ^= x >> 17;
     x ^= x << 5;
     return x;
 }
 
+uint32_t nextRandomInt()
+{
+    static uint32_t x = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    return xorshift(x);
+}
+
+// the same sequence on every run, for the benchmarks
+uint32_t nextSeededInt()
+{
+    static uint32_t x = 2463534242u;
+    return xorshift(x);
+}
+
+bool hasArgument(int argc, const char *argv[], std::string_view option)
+{
+    for (int a = 1; a < argc; ++a)
+    {
+        if (argv[a] == option)
+            return true;
+    }
+    return false;
+}
+
+// --mesh-residency=keep|release|reload picks what the meshes do with their CPU copies
+MeshResidency meshResidencyFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--mesh-residency=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (!argument.starts_with(option))
+            continue;
+
+        const std::string_view value = argument.substr(option.size());
+        if (value == "release")
+            return MeshResidency::ReleaseAfterUpload;
+        if (value == "reload")
+            return MeshResidency::ReloadFromCache;
+        if (value != "keep")
+            std::cerr << "Unknown mesh residency '" << value << "', keeping the CPU copies\n";
+    }
+
+    return MeshResidency::KeepCpuCopy;
+}
+
+// --texture-compression=none|fast|high picks the block formats of the colour textures (see
+// TextureCompression); none keeps them RGBA8
+TextureCompression textureCompressionFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--texture-compression=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (!argument.starts_with(option))
+            continue;
+
+        const std::string_view value = argument.substr(option.size());
+        if (value == "none")
+            return TextureCompression::None;
+        if (value == "fast")
+            return TextureCompression::Fast;
+        if (value != "high")
+            std::cerr << "Unknown texture compression '" << value << "', using high\n";
+    }
+
+    return TextureCompression::High;
+}
+
+// --loader-threads=N sizes the pool that imports the models and decodes the textures; 0 (the
+// default) for all the cores but one. Compare the models phase of the startup report at 1, 4 and
+// N threads
+size_t loaderThreadsFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--loader-threads=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (!argument.starts_with(option))
+            continue;
+
+        const std::string_view value = argument.substr(option.size());
+        size_t numThreads = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                                                  numThreads);
+        if (error == std::errc() && end == value.data() + value.size())
+            return numThreads;
+        std::cerr << "Invalid loader thread count '" << value << "', using the default\n";
+    }
+
+    return 0;
+}
+
+// --texture-budget=MiB bounds the GPU memory of the streamed model textures, whose finer mips
+// are loaded as they are seen up close (see TextureStreamer); --no-texture-streaming uploads them
+// whole instead
+void configureTextureStreaming(int argc, const char *argv[])
+{
+    TextureStreamer::instance()->setEnabled(!hasArgument(argc, argv, "--no-texture-streaming"));
+
+    constexpr std::string_view option = "--texture-budget=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (!argument.starts_with(option))
+            continue;
+
+        const std::string_view value = argument.substr(option.size());
+        size_t budget = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                                                  budget);
+        if (error == std::errc() && end == value.data() + value.size())
+            TextureStreamer::instance()->setBudget(budget * 1024 * 1024);
+        else
+            std::cerr << "Invalid texture budget '" << value << "', using the default\n";
+    }
+}
+
+// --model-copies=N loads the PBR models N more times, like a scene that pulls in the same asset
+// pack several times; with --no-dedup the copies don't share their meshes, textures and
+// materials, to compare the memory and the draws
+size_t modelCopiesFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--model-copies=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (!argument.starts_with(option))
+            continue;
+
+        const std::string_view value = argument.substr(option.size());
+        size_t numCopies = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                                                  numCopies);
+        if (error == std::errc() && end == value.data() + value.size())
+            return numCopies;
+        std::cerr << "Invalid model copy count '" << value << "', loading none\n";
+    }
+
+    return 0;
+}
+
+// --scene=path loads another scene file (see SceneFile) instead of the demo one
+std::filesystem::path sceneFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--scene=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (argument.starts_with(option))
+            return argument.substr(option.size());
+    }
+
+    return ENGINE_SCENES "/demo.scene";
+}
+
+// --startup-trace=path writes the startup phases for chrome://tracing or Perfetto too (see
+// StartupProfiler); the report is printed either way
+std::filesystem::path startupTraceFromArguments(int argc, const char *argv[])
+{
+    constexpr std::string_view option = "--startup-trace=";
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (argument.starts_with(option))
+            return argument.substr(option.size());
+    }
+
+    return {};
+}
+
+// 0 where it isn't known
+size_t residentSetBytes()
+{
+#ifdef LINUX
+    // the second field is the resident set, in pages
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (statm >> totalPages >> residentPages)
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+void printMeshMemoryReport()
+{
+    constexpr std::array<const char *, 3> policyNames = { "kept", "released", "cached" };
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    const MeshManager::MemoryReport report = MeshManager::instance()->memoryReport();
+    std::cout << "Mesh memory:";
+    for (size_t policy = 0; policy < policyNames.size(); ++policy)
+    {
+        if (report.numMeshes[policy] == 0)
+            continue;
+
+        std::cout << " " << report.numMeshes[policy] << " " << policyNames[policy] << " ("
+                  << report.cpuBytes[policy] / MiB << " MiB on the CPU),";
+    }
+    std::cout << " arenas " << report.gpuBytes / MiB << " MiB";
+
+    if (const size_t residentSet = residentSetBytes(); residentSet > 0)
+        std::cout << ", process resident set " << residentSet / MiB << " MiB";
+    std::cout << std::endl;
+}
+
+void printDeduplicationReport(const InstancedBlinnPhongShader &blinnPhongShader,
+                              const PbrShader &pbrShader)
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    const DeduplicationStatistics meshes = MeshManager::instance()->deduplicationStatistics();
+    const DeduplicationStatistics textures = TextureManager::instance()->deduplicationStatistics();
+    const size_t numSharedMaterials
+        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+              ->deduplicationStatistics()
+              .numShared
+          + MaterialManager<PbrMaterial, ComponentType::PBR_MATERIAL>::instance()
+                ->deduplicationStatistics()
+                .numShared;
+
+    std::cout << "Shared by content: " << meshes.numShared << " meshes ("
+              << meshes.bytesSaved / MiB << " MiB), " << textures.numShared << " textures ("
+              << textures.bytesSaved / MiB << " MiB), " << numSharedMaterials
+              << " materials; draw runs: " << blinnPhongShader.numDrawRuns() << " Blinn-Phong, "
+              << pbrShader.numDrawRuns() << " PBR" << std::endl;
+}
+
+// the render thread's share of the asynchronous model loads, per frame
+constexpr std::chrono::microseconds modelUploadBudget{ 2000 };
+// and of the texture mips streamed in
+constexpr std::chrono::microseconds textureUploadBudget{ 1000 };
+
+// the asynchronous loads only finish while the render thread runs their uploads, so waiting for a
+// model keeps running them, and keeps polling the window events so that it doesn't look hung
+GameObjectIdentifier awaitModel(std::future<GameObjectIdentifier> &model)
+{
+    std::future_status status = std::future_status::timeout;
+    while (status != std::future_status::ready)
+    {
+        const bool uploadsLeft = ModelLoader::instance()->processUploads(modelUploadBudget);
+        glfwPollEvents();
+        status = model.wait_for(uploadsLeft ? std::chrono::milliseconds(0)
+                                            : std::chrono::milliseconds(1));
+    }
+    return model.get();
+}
+
 } // namespace
 
 int main(int argc, const char *argv[])
 {
+    StartupProfiler::instance()->start();
+    StartupProfiler::Phase windowPhase("window and context");
+
+    // --headless initializes everything in a hidden window and exits before the first frame, to
+    // time the startup (see the cold_start target)
+    const bool headless = hasArgument(argc, argv, "--headless");
+
     glfwInit();
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
     Window mainWindow(windowWidth, windowHeight, "opengl-mischiefs");
 
     if (mainWindow.getRawWindow() == nullptr)
@@ -198,6 +478,8 @@ int main(int argc, const char *argv[])
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    GlObjectCounting::start();
+    ShaderProgram::enableParallelCompilation((GLADloadproc)glfwGetProcAddress);
 
     imGuiInitialization(&mainWindow);
 
@@ -223,187 +505,185 @@ int main(int argc, const char *argv[])
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-    // Textures
-
-    const TextureIdentifier polyBlack = TextureManager::instance()
-                                            ->registerTexture(ENGINE_TEXTURES "/poly_black.jpg",
-                                                              "polyBlack");
-
-    const TextureIdentifier catDiff = TextureManager::instance()->registerTexture(ENGINE_TEXTURES
-                                                                                  "/silly_cat.jpg",
-                                                                                  "cat_diffuse");
-    const TextureIdentifier black = TextureManager::instance()->registerTexture(ENGINE_TEXTURES
-                                                                                "/black.jpg",
-                                                                                "black");
-
-    const TextureIdentifier specular
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/specular_squiggle.png",
-                                                      "tex_specular");
-    const TextureIdentifier floppaEm = TextureManager::instance()
-                                           ->registerTexture(ENGINE_TEXTURES "/floppa_emission.jpg",
-                                                             "big_floppa_emission");
-
-    const TextureIdentifier3D simpleSkybox = CubemapManager::instance()->registerTexture(
-        { ENGINE_TEXTURES "/blue_skybox/right1.png", ENGINE_TEXTURES "/blue_skybox/left2.png",
-          ENGINE_TEXTURES "/blue_skybox/top3.png", ENGINE_TEXTURES "/blue_skybox/bottom4.png",
-          ENGINE_TEXTURES "/blue_skybox/front5.png", ENGINE_TEXTURES "/blue_skybox/back6.png" },
-        "simple_skybox");
-
-    const TextureIdentifier checkerboardTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/checkerboard_pattern.jpg",
-                                                      "checkerboard");
+    MeshManager::instance()->setDefaultResidency(meshResidencyFromArguments(argc, argv));
+    if (hasArgument(argc, argv, "--no-dedup"))
     {
-        auto checkerTexture = TextureManager::instance()->getTexture(checkerboardTexture);
-        checkerTexture->setUseAnisotropic(true, 8);
-        checkerTexture->setParameters(Texture2DParameters{ .wrappingS = GL_MIRRORED_REPEAT,
-                                                           .wrappingT = GL_MIRRORED_REPEAT,
-                                                           .filteringMin = GL_LINEAR_MIPMAP_LINEAR,
-                                                           .filteringMag = GL_LINEAR });
+        MeshManager::instance()->setContentDeduplication(false);
+        TextureManager::instance()->setContentDeduplication(false);
+        MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+            ->setContentDeduplication(false);
+        MaterialManager<PbrMaterial, ComponentType::PBR_MATERIAL>::instance()
+            ->setContentDeduplication(false);
     }
+    TextureManager::instance()->setCompression(textureCompressionFromArguments(argc, argv));
+    configureTextureStreaming(argc, argv);
+    // --no-program-cache compiles and links every shader program, to compare the startup with the
+    // cached binaries (see ProgramCache)
+    ProgramCache::setEnabled(!hasArgument(argc, argv, "--no-program-cache"));
+    windowPhase.end();
 
-    const TextureIdentifier spotLightTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/bill.jpg", "bill");
-
-    const TextureIdentifier greenGlassTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/green_glass.png",
-                                                      "green_glass_diffuse");
-    const TextureIdentifier yellowGlassTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/yellow_glass.png",
-                                                      "yellow_glass_diffuse");
-    const TextureIdentifier purpleGlassTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/purple_glass.png",
-                                                      "purple_glass_diffuse");
-    const TextureIdentifier blueGlassTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/blue_glass.png",
-                                                      "blue_glass_diffuse");
-    const TextureIdentifier glassSpecularTexture
-        = TextureManager::instance()->registerTexture(ENGINE_TEXTURES "/glass_specular.png",
-                                                      "glass_specular");
-
-    // Materials
-    const MaterialIdentifier floppaMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ polyBlack, specular, floppaEm }, "floppa_material");
-
-    const MaterialIdentifier catMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ catDiff, specular, black }, "cat_material");
+    // Models
 
-    const MaterialIdentifier checkerMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ checkerboardTexture, InvalidIdentifier,
-                                                InvalidIdentifier },
-                                 "checker_material");
+    // --cold-start drops the baked models, the compressed textures, the binary scenes and the
+    // program binaries, so that every model is imported, every texture encoded, the scene parsed
+    // and the shaders compiled again; run with and without it to compare the cold and warm startup
+    if (hasArgument(argc, argv, "--cold-start"))
+    {
+        std::error_code error;
+        std::filesystem::remove_all(ENGINE_CACHE "/models", error);
+        std::filesystem::remove_all(ENGINE_CACHE "/textures", error);
+        std::filesystem::remove_all(ENGINE_CACHE "/scenes", error);
+        std::filesystem::remove_all(ENGINE_CACHE "/programs", error);
+    }
 
-    const MaterialIdentifier greenGlassMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ greenGlassTexture, glassSpecularTexture,
-                                                InvalidIdentifier },
-                                 "green_glass_material");
+    // Scene
 
-    const MaterialIdentifier yellowGlassMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ yellowGlassTexture, glassSpecularTexture,
-                                                InvalidIdentifier },
-                                 "yellow_glass_material");
+    StartupProfiler::Phase scenePhase("scene file");
+    const std::filesystem::path scenePath = sceneFromArguments(argc, argv);
+    const std::optional<SceneDescription> sceneDescription = SceneFile::load(scenePath);
+    if (!sceneDescription)
+    {
+        std::cerr << "Failed to load the scene " << scenePath.string() << std::endl;
+        return -1;
+    }
+    scenePhase.end();
 
-    const MaterialIdentifier purpleGlassMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ purpleGlassTexture, glassSpecularTexture,
-                                                InvalidIdentifier },
-                                 "purple_glass_material");
+    if (const size_t loaderThreads = loaderThreadsFromArguments(argc, argv); loaderThreads > 0)
+        ThreadPool::setLoaderThreadCount(loaderThreads);
+    std::cout << "Loading with " << ThreadPool::loaders().numThreads() << " loader threads"
+              << std::endl;
 
-    const MaterialIdentifier blueGlassMaterial
-        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-              ->registerMaterial(BasicMaterial{ blueGlassTexture, glassSpecularTexture,
-                                                InvalidIdentifier },
-                                 "blue_glass_material");
+    {
+        StartupProfiler::Phase modelsPhase("models");
+
+        // the models load in parallel on the workers; --sync-model-loads loads them one after
+        // another on the render thread instead, to compare
+        const bool syncModelLoads = hasArgument(argc, argv, "--sync-model-loads");
+        const auto startModelLoad = [syncModelLoads](const char *path, bool flipTextures,
+                                                     bool loadAsPbr) {
+            if (!syncModelLoads)
+                return ModelLoader::instance()->loadModelAsync(path, flipTextures, loadAsPbr);
+
+            std::promise<GameObjectIdentifier> loaded;
+            loaded.set_value(ModelLoader::instance()->loadModel(path, flipTextures, loadAsPbr));
+            return loaded.get_future();
+        };
+
+        // the scene's models, and the primitives the passes draw with
+        std::vector<std::future<GameObjectIdentifier>> sceneModelLoads;
+        for (const SceneDescription::Model &model : sceneDescription->models)
+        {
+            sceneModelLoads.emplace_back(
+                startModelLoad(sceneDescription->string(model.path).c_str(), model.flipTextures,
+                               model.pbr));
+        }
+        auto sphereLoad = startModelLoad(ENGINE_MODELS "/sphere/sphere.obj", false, false);
+        auto planeLoad = startModelLoad(ENGINE_MODELS "/plane/plane.obj", false, false);
+        auto cubeLoad = startModelLoad(ENGINE_MODELS "/cube/cube.obj", false, false);
+        std::vector<std::future<GameObjectIdentifier>> suzukiCopyLoads;
+        for (size_t c = modelCopiesFromArguments(argc, argv); c > 0; --c)
+        {
+            suzukiCopyLoads.emplace_back(
+                startModelLoad(ENGINE_MODELS "/suzuki/scene.gltf", false, true));
+        }
 
-    // Models
+        //// Shaders
 
-    // Attribution: Bill Cipher 3D by Coolguy5SuperDuperCool from sketchfab
-    // const GameObjectIdentifier billModel = ModelLoader::instance()->loadModel(
-    //     ENGINE_MODELS
-    //     "/bill/bill_cipher.obj"); // put "/tank/tank.obj" here to test a different model.
-    //                               // Surprisingly, it seems to be better optimized than bill
+        // the programs are all submitted together and completed before the first frame, so that
+        // the driver compiles them while the startup goes on (see ShaderProgramBatch); the ones
+        // that only need their sources while the models load, the others once the meshes are in
+        ShaderProgramBatch shaderBatch;
 
-    const GameObjectIdentifier gunModelId
-        = ModelLoader::instance()->loadModel(ENGINE_MODELS "/firearm/scene.gltf", false, true);
+        InstancedBlinnPhongShader shaderProgramMain{ vertexShaderSource, fragmentShaderSource };
+        shaderBatch.add(shaderProgramMain);
 
-    const GameObjectIdentifier suzukiModelId
-        = ModelLoader::instance()->loadModel(ENGINE_MODELS "/suzuki/scene.gltf", false, true);
+        GeometryShaderProgram worldAxesShader{ axesVertexShaderSource, axesFragmentShaderSource,
+                                               axesGeometryShaderSource };
+        shaderBatch.add(worldAxesShader);
 
-    const GameObjectIdentifier gameboyModelId
-        = ModelLoader::instance()->loadModel(ENGINE_MODELS "/gameboy/gameboy.obj", false, true);
+        TransparentShader simpleTransparentShader{ simpleTransparentVertexShaderSource,
+                                                   simpleTransparentFragmentShaderSource };
+        shaderBatch.add(simpleTransparentShader);
 
-    const GameObjectIdentifier sphereModel = ModelLoader::instance()->loadModel(
-        ENGINE_MODELS "/sphere/sphere.obj");
-    const MeshIdentifier sphereMesh = MeshManager::instance()->meshRegistered("Sphere");
+        PbrShader mainPbrShader{ pbrVertexShaderSource, pbrFragmentShaderSource };
+        shaderBatch.add(mainPbrShader);
 
-    const GameObjectIdentifier planeModel = ModelLoader::instance()->loadModel(ENGINE_MODELS
-                                                                               "/plane/plane.obj");
-    const MeshIdentifier planeMesh = MeshManager::instance()->meshRegistered("Plane");
+        std::vector<GameObjectIdentifier> sceneModels;
+        for (std::future<GameObjectIdentifier> &modelLoad : sceneModelLoads)
+            sceneModels.emplace_back(awaitModel(modelLoad));
 
-    const GameObjectIdentifier cubeModel = ModelLoader::instance()->loadModel(ENGINE_MODELS
-                                                                              "/cube/cube.obj");
-    const MeshIdentifier cubeMesh = MeshManager::instance()->meshRegistered("Cube");
+        awaitModel(sphereLoad);
+        const MeshIdentifier sphereMesh = MeshManager::instance()->meshRegistered("Sphere");
 
-    const GameObjectIdentifier pyramidModel = ModelLoader::instance()->loadModel(
-        ENGINE_MODELS "/pyramid/pyramid.obj");
-    const MeshIdentifier pyramidMesh = MeshManager::instance()->meshRegistered("Pyramid");
+        awaitModel(planeLoad);
+        const MeshIdentifier planeMesh = MeshManager::instance()->meshRegistered("Plane");
 
-    {
-        //// Shaders
+        awaitModel(cubeLoad);
+        const MeshIdentifier cubeMesh = MeshManager::instance()->meshRegistered("Cube");
 
-        InstancedBlinnPhongShader shaderProgramMain{ vertexShaderSource, fragmentShaderSource };
-        shaderProgramMain.initializeShaderProgram();
+        std::vector<GameObjectIdentifier> suzukiCopies;
+        for (std::future<GameObjectIdentifier> &copyLoad : suzukiCopyLoads)
+            suzukiCopies.emplace_back(awaitModel(copyLoad));
 
-        WorldPlaneShader worldPlaneShader{ cubeMesh, checkerboardTexture };
-        worldPlaneShader.initializeShaderProgram();
+        modelsPhase.end();
 
-        LightVisualizationShader lightVisualizationShader{ sphereMesh };
-        lightVisualizationShader.initializeShaderProgram();
+        StartupProfiler::Phase instantiationPhase("scene instantiation");
+        const LoadedScene scene = SceneLoader::instantiate(*sceneDescription, sceneModels);
+        instantiationPhase.end();
 
-        SkyboxShader mainSkybox{ cubeMesh, simpleSkybox };
-        mainSkybox.initializeShaderProgram();
+        StartupProfiler::Phase shadersPhase("shaders");
+        WorldPlaneShader worldPlaneShader{
+            cubeMesh, TextureManager::instance()->textureRegistered("checkerboard")
+        };
+        shaderBatch.add(worldPlaneShader);
 
-        GeometryShaderProgram worldAxesShader{ axesVertexShaderSource, axesFragmentShaderSource,
-                                               axesGeometryShaderSource };
-        worldAxesShader.initializeShaderProgram();
-
-        TransparentShader simpleTransparentShader{ simpleTransparentVertexShaderSource,
-                                                   simpleTransparentFragmentShaderSource };
-        simpleTransparentShader.initializeShaderProgram();
+        LightVisualizationShader lightVisualizationShader{ sphereMesh };
+        shaderBatch.add(lightVisualizationShader);
 
-        PbrShader mainPbrShader{ pbrVertexShaderSource, pbrFragmentShaderSource };
-        mainPbrShader.initializeShaderProgram();
+        SkyboxShader mainSkybox{ cubeMesh, scene.skybox };
+        shaderBatch.add(mainSkybox);
+        shadersPhase.end();
 
-        VolumetricFogPass _volumetricFogPass{};
+        StartupProfiler::Phase fogPhase("volumetric fog");
+        VolumetricFogPass _volumetricFogPass{ shaderBatch };
         _volumetricFogPass.setCamera(camera);
         _volumetricFogPass.setWindow(&mainWindow);
 
         FullscreenFogShader fogShader{ &_volumetricFogPass };
-        fogShader.initializeShaderProgram();
+        shaderBatch.add(fogShader);
+        fogPhase.end();
 
         // passes
+        StartupProfiler::Phase passesPhase("passes");
         StandardPass _standardRenderingPass{ &shaderProgramMain, &worldPlaneShader,
                                              &lightVisualizationShader, &mainSkybox,
                                              &mainPbrShader };
         _standardRenderingPass.setCamera(camera);
         _standardRenderingPass.setWindow(&mainWindow);
 
-        ShadowPass _shadowPass{ &shaderProgramMain, &lightVisualizationShader, &mainPbrShader };
+        ShadowPass _shadowPass{ &shaderProgramMain, &lightVisualizationShader, &mainPbrShader,
+                                 shaderBatch };
 
         SortingTransparentPass _sortingTransparentPass{ &simpleTransparentShader, &fogShader };
         _sortingTransparentPass.setCamera(camera);
 
+        WeightedBlendedTransparentPass _weightedBlendedTransparentPass{ &simpleTransparentShader,
+                                                                        &fogShader, shaderBatch };
+        shaderBatch.add(_weightedBlendedTransparentPass);
+        _weightedBlendedTransparentPass.setCamera(camera);
+
+        // sorted / weighted blended OIT; timed separately to compare the two
+        int transparencyMode = 0;
+        std::array<PassTimer, 2> transparencyTimers;
+
         HdrPass _hdrPass(planeMesh);
-        _hdrPass.initializeShaderProgram();
+        shaderBatch.add(_hdrPass);
         _hdrPass.setWindow(&mainWindow);
 
         GizmosPass _gizmosPass(&worldAxesShader);
         _gizmosPass.setCamera(camera);
         _gizmosPass.setWindow(&mainWindow);
+        passesPhase.end();
 
         // Events
         {
@@ -434,357 +714,120 @@ int main(int argc, const char *argv[])
                 [camPtr = camera](KeyboardInput input, Window::ScrollDescriptor descriptor) {
                     camPtr->processMouseScroll(descriptor.deltaScrollY);
                 });
-            mainWindow.subscribeEventListener([camPtr = camera](int w, int h) {
-                glViewport(0, 0, w, h);
-                camPtr->setProjectionMatrix(
-                    glm::perspective(glm::radians(camPtr->zoom()), (float)w / h, 0.1f, 1000.0f));
-            });
-        }
-
-        // lights
-
-        GameObject &pointLight1 = ObjectManager::instance()->getObject(
-            ObjectManager::instance()->addObject());
-        const auto pointLight1Transform = TransformManager::instance()->registerNewTransform(
-            pointLight1);
-        const LightSourceIdentifier pointLight1Light
-            = LightManager<ComponentType::LIGHT_POINT>::instance()
-                  ->registerNewLight("test_point_light_1", pointLight1Transform);
-        {
-            pointLight1.addComponent(Component(ComponentType::LIGHT_POINT, pointLight1Light));
-            pointLight1.addComponent(Component(ComponentType::TRANSFORM, pointLight1Transform));
-            auto lightStruct = LightManager<ComponentType::LIGHT_POINT>::instance()->getLight(
-                pointLight1Light);
-            lightStruct->ambient = glm::vec3(0.229f, 0.378f, 0.275f);
-            lightStruct->diffuse = glm::vec3(0.622f, 0.535f, 0.198f);
-            lightStruct->specular = glm::vec3(0.791f, 0.478f, 0.757f);
-            lightStruct->attenuationConstantTerm = 1.0e-2;
-            lightStruct->attenuationLinearTerm = 1.0e-2;
-            lightStruct->attenuationQuadraticTerm = 1.0e-3;
-
-            auto transformStruct = TransformManager::instance()->getTransform(pointLight1Transform);
-            transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-            transformStruct->setPosition(glm::vec3(-20.0f, -20.0f, -20.0f));
-
-            lightVisualizationShader.addObject(pointLight1);
+            mainWindow.subscribeEventListener(
+                [camPtr = camera, &_weightedBlendedTransparentPass](int w, int h) {
+                    glViewport(0, 0, w, h);
+                    camPtr->setProjectionMatrix(glm::perspective(glm::radians(camPtr->zoom()),
+                                                                 (float)w / h, 0.1f, 1000.0f));
+                    _weightedBlendedTransparentPass.sceneResized();
+                });
         }
 
-        GameObject &pointLight2 = ObjectManager::instance()->getObject(
-            ObjectManager::instance()->addObject());
-        const auto pointLight2Transform = TransformManager::instance()->registerNewTransform(
-            pointLight2);
-        const LightSourceIdentifier pointLight2Light
-            = LightManager<ComponentType::LIGHT_POINT>::instance()
-                  ->registerNewLight("test_point_light_2", pointLight2Transform);
-        {
-            pointLight2.addComponent(Component(ComponentType::LIGHT_POINT, pointLight2Light));
-            pointLight2.addComponent(Component(ComponentType::TRANSFORM, pointLight2Transform));
-
-            auto lightStruct = LightManager<ComponentType::LIGHT_POINT>::instance()->getLight(
-                pointLight2Light);
-            lightStruct->ambient = glm::vec3(0.189f, 0.239f, 0.269f);
-            lightStruct->diffuse = glm::vec3(0.469f, 0.345f, 0.271f);
-            lightStruct->specular = glm::vec3(0.398f, 0.902f, 0.608f);
-            lightStruct->attenuationConstantTerm = 1.0e-2;
-            lightStruct->attenuationLinearTerm = 1.0e-2;
-            lightStruct->attenuationQuadraticTerm = 1.0e-3;
-
-            auto transformStruct = TransformManager::instance()->getTransform(pointLight2Transform);
-            transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-            transformStruct->setPosition(glm::vec3(20.0f, 20.0f, 20.0f));
-
-            lightVisualizationShader.addObject(pointLight2);
-        }
+        // the scene's objects
         {
+            const std::array<std::pair<SceneDescription::Shader, ShaderProgram *>, 5>
+                sceneShaders = { { { SceneDescription::Shader::BlinnPhong, &shaderProgramMain },
+                                   { SceneDescription::Shader::Pbr, &mainPbrShader },
+                                   { SceneDescription::Shader::Transparent,
+                                     &simpleTransparentShader },
+                                   { SceneDescription::Shader::LightGizmo,
+                                     &lightVisualizationShader },
+                                   { SceneDescription::Shader::Axes, &worldAxesShader } } };
+            for (const auto &[shader, shaderProgram] : sceneShaders)
             {
-                GameObject &dirLight1 = ObjectManager::instance()->getObject(
-                    ObjectManager::instance()->addObject());
-                const auto lightTransform = TransformManager::instance()->registerNewTransform(
-                    dirLight1);
-                const LightSourceIdentifier lId
-                    = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                          ->registerNewLight("test_dir_light_1", lightTransform);
-                dirLight1.addComponent(Component(ComponentType::LIGHT_DIRECTIONAL, lId));
-                dirLight1.addComponent(Component(ComponentType::TRANSFORM, lightTransform));
-                auto lightStruct = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                                       ->getLight(lId);
-                lightStruct->ambient = glm::vec3(0.029f, 0.058f, 0.055f);
-                lightStruct->diffuse = glm::vec3(0.322f, 0.335f, 0.498f);
-                lightStruct->specular = glm::vec3(0.091f, 0.078f, 0.057f);
-
-                const auto [bufId, textureIdentifier]
-                    = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                          ->createShadowMapPremises(2048, 2048);
-                lightStruct->frameBufferId = bufId;
-                lightStruct->shadowMapIdentifier = textureIdentifier;
-
-                auto transformStruct = TransformManager::instance()->getTransform(lightTransform);
-                transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-                transformStruct->setPosition(glm::vec3(0.0f, 30.0f, 0.0f));
-                transformStruct->setRotation(glm::rotate(glm::identity<glm::mat4>(),
-                                                         glm::radians(90.0f),
-                                                         glm::vec3(1.0f, 0.0f, 0.0f)));
-
-                lightStruct->setProjectionMatrix(
-                    glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 0.01f, 300.0f));
-
-                lightVisualizationShader.addObject(dirLight1);
+                for (const GameObjectIdentifier gId : scene.drawnBy(shader))
+                    shaderProgram->addObject(gId);
             }
+        }
 
-            {
-                GameObject &dirLight2 = ObjectManager::instance()->getObject(
-                    ObjectManager::instance()->addObject());
-                const auto lightTransform = TransformManager::instance()->registerNewTransform(
-                    dirLight2);
-                const LightSourceIdentifier lId
-                    = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                          ->registerNewLight("test_dir_light_2", lightTransform);
-                dirLight2.addComponent(Component(ComponentType::LIGHT_DIRECTIONAL, lId));
-                dirLight2.addComponent(Component(ComponentType::TRANSFORM, lightTransform));
-                auto lightStruct = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                                       ->getLight(lId);
-                lightStruct->ambient = glm::vec3(0.089f, 0.039f, 0.069f);
-                lightStruct->diffuse = glm::vec3(0.369f, 0.445f, 0.371f);
-                lightStruct->specular = glm::vec3(0.098f, 0.002f, 0.008f);
-                const auto [bufId, textureIdentifier]
-                    = LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                          ->createShadowMapPremises(2048, 2048);
-                lightStruct->frameBufferId = bufId;
-                lightStruct->shadowMapIdentifier = textureIdentifier;
-
-                auto transformStruct = TransformManager::instance()->getTransform(lightTransform);
-                transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-                transformStruct->setPosition(glm::vec3(0.0f, -30.0f, 0.0f));
-                transformStruct->setRotation(glm::rotate(glm::identity<glm::mat4>(),
-                                                         glm::radians(90.0f),
-                                                         glm::vec3(-1.0f, 0.0f, 0.0f)));
-
-                lightStruct->setProjectionMatrix(
-                    glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 0.01f, 300.0f));
-
-                lightVisualizationShader.addObject(dirLight2);
-            }
+        // the lights orbiting and turning, when the scene has them
+        const auto componentOf = [&scene](const std::string &objectName, ComponentType type) {
+            const GameObjectIdentifier gId = scene.object(objectName);
+            return gId == InvalidIdentifier
+                       ? InvalidIdentifier
+                       : ObjectManager::instance()->getObject(gId).getIdentifierForComponent(type);
+        };
+        const TransformIdentifier pointLight1Transform = componentOf("point_light_1",
+                                                                     ComponentType::TRANSFORM);
+        const LightSourceIdentifier pointLight1Light = componentOf("point_light_1",
+                                                                   ComponentType::LIGHT_POINT);
+        const TransformIdentifier pointLight2Transform = componentOf("point_light_2",
+                                                                     ComponentType::TRANSFORM);
+        const LightSourceIdentifier pointLight2Light = componentOf("point_light_2",
+                                                                   ComponentType::LIGHT_POINT);
+        const TransformIdentifier texturedLight1Transform = componentOf("textured_light_1",
+                                                                        ComponentType::TRANSFORM);
+        const LightSourceIdentifier texturedLight1Light
+            = componentOf("textured_light_1", ComponentType::LIGHT_TEXTURED_SPOT);
 
-            {
-                // yellow
-                GameObject &spotLight1 = ObjectManager::instance()->getObject(
-                    ObjectManager::instance()->addObject());
-                const auto lightTransform = TransformManager::instance()->registerNewTransform(
-                    spotLight1);
-                const LightSourceIdentifier lId
-                    = LightManager<ComponentType::LIGHT_SPOT>::instance()
-                          ->registerNewLight("test_spot_light_1", lightTransform);
-                spotLight1.addComponent(Component(ComponentType::LIGHT_SPOT, lId));
-                spotLight1.addComponent(Component(ComponentType::TRANSFORM, lightTransform));
-                auto lightStruct = LightManager<ComponentType::LIGHT_SPOT>::instance()->getLight(
-                    lId);
-                lightStruct->ambient = glm::vec3(0.151f, 0.151f, 0.012f);
-                lightStruct->diffuse = glm::vec3(0.671f, 0.871f, 0.063f);
-                lightStruct->specular = glm::vec3(0.6f, 0.6f, 0.655f);
-                lightStruct->attenuationConstantTerm = 1.0e-4;
-                lightStruct->attenuationLinearTerm = 1.0e-4;
-                lightStruct->attenuationQuadraticTerm = 1.0e-4;
-                lightStruct->computeIntrinsics(45, 60);
-
-                auto transformStruct = TransformManager::instance()->getTransform(lightTransform);
-                transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-                transformStruct->setPosition(glm::vec3(0.0f, 0.0f, 60.0f));
-                transformStruct->setRotation(glm::rotate(transformStruct->rotation(),
-                                                         glm::radians(180.0f),
-                                                         glm::vec3(0.0f, 1.0f, 0.0f)));
-
-                lightVisualizationShader.addObject(spotLight1);
-            }
+        // spun around to test the instanced buffer updates
+        const std::vector<GameObjectIdentifier> movingObjects = scene.drawnBy(
+            SceneDescription::Shader::BlinnPhong);
 
+        {
+            // in a row behind the scene's suzuki
+            for (size_t c = 0; c < suzukiCopies.size(); ++c)
             {
-                // blue
-                GameObject &spotLight2 = ObjectManager::instance()->getObject(
-                    ObjectManager::instance()->addObject());
-                const auto lightTransform = TransformManager::instance()->registerNewTransform(
-                    spotLight2);
-                const LightSourceIdentifier lId
-                    = LightManager<ComponentType::LIGHT_SPOT>::instance()
-                          ->registerNewLight("test_spot_light_2", lightTransform);
-                spotLight2.addComponent(Component(ComponentType::LIGHT_SPOT, lId));
-                spotLight2.addComponent(Component(ComponentType::TRANSFORM, lightTransform));
-                auto lightStruct = LightManager<ComponentType::LIGHT_SPOT>::instance()->getLight(
-                    lId);
-                lightStruct->ambient = glm::vec3(0.016f, 0.012f, 0.188f);
-                lightStruct->diffuse = glm::vec3(0.075f, 0.059f, 0.91f);
-                lightStruct->specular = glm::vec3(0.102f, 0.098f, 0.329f);
-                lightStruct->attenuationConstantTerm = 1.0e-4;
-                lightStruct->attenuationLinearTerm = 1.0e-4;
-                lightStruct->attenuationQuadraticTerm = 1.0e-4;
-                lightStruct->computeIntrinsics(45, 60);
-
-                auto transformStruct = TransformManager::instance()->getTransform(lightTransform);
-                transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-                transformStruct->setPosition(glm::vec3(0.0f, 0.0f, -60.0f));
-
-                lightVisualizationShader.addObject(spotLight2);
+                if (suzukiCopies[c] == InvalidIdentifier)
+                    continue;
+
+                auto copyTransform = TransformManager::instance()->getTransform(
+                    ObjectManager::instance()
+                        ->getObject(suzukiCopies[c])
+                        .getIdentifierForComponent(ComponentType::TRANSFORM));
+                copyTransform->setPosition(glm::vec3(15.0f - 12.0f * (c + 1), 2.0f, -30.0f));
+                copyTransform->setRotation(glm::rotate(glm::identity<glm::mat4>(),
+                                                       glm::radians(-90.0f),
+                                                       glm::vec3(1.0f, 0.0f, 0.0f)));
+                copyTransform->setScale(glm::vec3(10.0f));
+
+                mainPbrShader.addObjectWithChildren(suzukiCopies[c]);
             }
         }
-        GameObject &texturedLight1 = ObjectManager::instance()->getObject(
-            ObjectManager::instance()->addObject());
-        const auto texturedLight1Transform = TransformManager::instance()->registerNewTransform(
-            texturedLight1);
-        const LightSourceIdentifier texturedLight1Light
-            = LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()
-                  ->registerNewLight("bill_texture_spot_1", texturedLight1Transform);
-        {
-            texturedLight1.addComponent(
-                Component(ComponentType::LIGHT_TEXTURED_SPOT, texturedLight1Light));
-            texturedLight1.addComponent(
-                Component(ComponentType::TRANSFORM, texturedLight1Transform));
-
-            auto lightStruct = LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()
-                                   ->getLight(texturedLight1Light);
-            lightStruct->ambient = glm::vec3(0.016f, 0.012f, 0.088f);
-            lightStruct->specular = glm::vec3(0.102f, 0.098f, 0.129f);
-            lightStruct->attenuationConstantTerm = 1.0e-5;
-            lightStruct->attenuationLinearTerm = 1.0e-5;
-            lightStruct->attenuationQuadraticTerm = 1.0e-6;
-            lightStruct->computeIntrinsics(20, 25, texturedLight1Transform);
-
-            TextureManager::instance()->allocateTexture(spotLightTexture);
-#if ENGINE_DISABLE_BINDLESS_TEXTURES
-            lightStruct->textureIdx = 0xFF00FF00FF00FF00;
-#else
-            const auto texHandle = glGetTextureHandleARB(
-                *TextureManager::instance()->getTexture(spotLightTexture));
-            glMakeTextureHandleResidentARB(texHandle);
-            lightStruct->textureIdx = texHandle;
-#endif
-
-            auto transformStruct = TransformManager::instance()->getTransform(
-                texturedLight1Transform);
-            transformStruct->setScale(glm::vec3(2.0f, 2.0f, 2.0f));
-            transformStruct->setPosition(glm::vec3(45.0f, 0.0f, 0.0f));
-            transformStruct->setRotation(glm::rotate(transformStruct->rotation(),
-                                                     glm::radians(90.0f),
-                                                     glm::vec3(0.0f, -1.0f, 0.0f)));
-
-            lightVisualizationShader.addObject(texturedLight1);
-        }
-
-        std::vector<GameObjectIdentifier> movingObjects;
-        for (int k = 20; k < 50; ++k)
-        {
-            const float fK = static_cast<float>(k);
-            // add cubes and pyramids
-            GameObject &standardObject = ObjectManager::instance()->getObject(
+        const auto spawnGlassPane = [&simpleTransparentShader, planeMesh](
+                                        MaterialIdentifier materialId, glm::vec3 rotationAxis,
+                                        glm::vec3 position) {
+            GameObject &glassObject = ObjectManager::instance()->getObject(
                 ObjectManager::instance()->addObject());
 
-            standardObject.addComponent(
-                Component(ComponentType::MESH, (k % 20 < 10) ? cubeMesh : pyramidMesh));
-            standardObject.addComponent(Component(ComponentType::BASIC_MATERIAL,
-                                                  (k % 20 < 10) ? floppaMaterial : catMaterial));
+            glassObject.addComponent(Component(ComponentType::MESH, planeMesh));
+            glassObject.addComponent(Component(ComponentType::BASIC_MATERIAL, materialId));
 
             const TransformIdentifier tId = TransformManager::instance()->registerNewTransform(
-                standardObject);
-            standardObject.addComponent(Component(ComponentType::TRANSFORM, tId));
+                glassObject);
+            glassObject.addComponent(Component(ComponentType::TRANSFORM, tId));
 
             Transform *t = TransformManager::instance()->getTransform(tId);
-            t->setPosition(glm::vec3(nextRandomInt() % static_cast<int>(lightRotationRadius),
-                                     (fK / 2) * std::cos(k), (fK / 2) * std::sin(k)));
-            t->setRotation(glm::rotate(t->rotation(), glm::radians((float)k),
-                                       glm::vec3(50.0f - k, 1.0f, 0.0f)));
-            t->setScale(glm::vec3(std::max(static_cast<int>(nextRandomInt()) % 5, 1)));
-
-            shaderProgramMain.addObject(standardObject);
-            movingObjects.emplace_back(standardObject);
-
-            /// add axes for cubes and pyramids
-            GameObject &standardAxes = ObjectManager::instance()->getObject(
-                ObjectManager::instance()->addObject());
-            standardAxes.addComponent(
-                Component(ComponentType::MESH, MeshManager::instance()->getDummyMesh()));
-            standardAxes.addComponent(Component(ComponentType::TRANSFORM, tId));
-
-            worldAxesShader.addObject(standardAxes);
-        }
-        for (int k = 10; k < 15; ++k)
-        {
-            const auto gameBoyCopy = ObjectManager::instance()->copyObject(gameboyModelId);
-            auto gameboyTransform = TransformManager::instance()->getTransform(
-                ObjectManager::instance()
-                    ->getObject(gameBoyCopy)
-                    .getIdentifierForComponent(ComponentType::TRANSFORM));
-            gameboyTransform->setPosition(
-                glm::vec3(-k * std::sin(k), -k * std::sin(k), k * std::cos(k)));
-            gameboyTransform->setRotation(
-                glm::rotate(gameboyTransform->rotation(), glm::radians((float)k),
-                            glm::vec3(0.0f, (float)(k % 2), (float)((1 + k) % 2))));
-            gameboyTransform->setScale(glm::vec3(30.0f));
-
-            mainPbrShader.addObjectWithChildren(gameBoyCopy);
-        }
-        {
-            GameObject &worldAxes = ObjectManager::instance()->getObject(
-                ObjectManager::instance()->addObject());
-            worldAxes.addComponent(
-                Component(ComponentType::MESH, MeshManager::instance()->getDummyMesh()));
-            worldAxes.addComponent(
-                Component(ComponentType::TRANSFORM,
-                          TransformManager::instance()->registerNewTransform(worldAxes)));
-            worldAxesShader.addObject(worldAxes);
-        }
+            t->setPosition(position);
+            t->setRotation(glm::rotate(t->rotation(), glm::radians(90.0f), rotationAxis));
+            t->setScale(glm::vec3(15.0f));
+
+            simpleTransparentShader.addObject(glassObject);
+        };
+        // the scene's glass, for the panes added at run time
+        std::vector<MaterialIdentifier> glassMaterials;
+        for (const char *materialName : { "green_glass_material", "yellow_glass_material",
+                                          "blue_glass_material", "purple_glass_material" })
         {
-            // add PBR models
-            auto gunTransform = TransformManager::instance()->getTransform(
-                ObjectManager::instance()
-                    ->getObject(gunModelId)
-                    .getIdentifierForComponent(ComponentType::TRANSFORM));
-            gunTransform->setPosition(glm::vec3(0.0f, 3.0f, 0.0f));
-            gunTransform->setRotation(glm::rotate(glm::identity<glm::mat4>(), glm::radians(-90.0f),
-                                                  glm::vec3(1.0f, 0.0f, 0.0f)));
-            gunTransform->setScale(glm::vec3(35.0f));
-
-            mainPbrShader.addObjectWithChildren(gunModelId);
-
-            auto suzukiTransform = TransformManager::instance()->getTransform(
-                ObjectManager::instance()
-                    ->getObject(suzukiModelId)
-                    .getIdentifierForComponent(ComponentType::TRANSFORM));
-            suzukiTransform->setPosition(glm::vec3(15.0f, 2.0f, -15.0f));
-            suzukiTransform->setRotation(glm::rotate(glm::identity<glm::mat4>(),
-                                                     glm::radians(-90.0f),
-                                                     glm::vec3(1.0f, 0.0f, 0.0f)));
-            suzukiTransform->setScale(glm::vec3(10.0f));
-
-            mainPbrShader.addObjectWithChildren(suzukiModelId);
+            const MaterialIdentifier materialId
+                = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+                      ->materialRegistered(materialName);
+            if (materialId != InvalidIdentifier)
+                glassMaterials.emplace_back(materialId);
         }
-        {
-            for (const auto &[materialId, rotationAxis, position] :
-                 std::initializer_list<std::tuple<MaterialIdentifier, glm::vec3, glm::vec3>>{
-                     { greenGlassMaterial, glm::vec3(0.0f, 0.0f, 1.0f),
-                       glm::vec3(-25.0f, 0.0f, 0.0f) },
-                     { yellowGlassMaterial, glm::vec3(1.0f, 0.0f, 0.0f),
-                       glm::vec3(0.0f, 0.0f, -25.0f) },
-                     { blueGlassMaterial, glm::vec3(0.0f, 0.0f, 1.0f),
-                       glm::vec3(25.0f, 0.0f, 0.0f) },
-                     { purpleGlassMaterial, glm::vec3(1.0f, 0.0f, 0.0f),
-                       glm::vec3(0.0f, 0.0f, 25.0f) } })
+        size_t numGlassPanes = scene.drawnBy(SceneDescription::Shader::Transparent).size();
+        const auto addGlassPanes = [&](size_t count, uint32_t (*random)()) {
+            for (size_t p = 0; p < count; ++p, ++numGlassPanes)
             {
-                GameObject &glassObject = ObjectManager::instance()->getObject(
-                    ObjectManager::instance()->addObject());
-
-                glassObject.addComponent(Component(ComponentType::MESH, planeMesh));
-                glassObject.addComponent(Component(ComponentType::BASIC_MATERIAL, materialId));
-
-                const TransformIdentifier tId = TransformManager::instance()->registerNewTransform(
-                    glassObject);
-                glassObject.addComponent(Component(ComponentType::TRANSFORM, tId));
-
-                Transform *t = TransformManager::instance()->getTransform(tId);
-                t->setPosition(position);
-                t->setRotation(glm::rotate(t->rotation(), glm::radians(90.0f), rotationAxis));
-                t->setScale(glm::vec3(15.0f));
-
-                simpleTransparentShader.addObject(glassObject);
+                spawnGlassPane(glassMaterials[numGlassPanes % glassMaterials.size()],
+                               glm::vec3((float)(p % 2), 0.0f, (float)((p + 1) % 2)),
+                               glm::vec3((int)(random() % 120) - 60.0f,
+                                         (int)(random() % 30) - 5.0f,
+                                         (int)(random() % 120) - 60.0f));
             }
-        }
+        };
         {
+            StartupProfiler::Phase instancingPhase("texture mapping and instancing");
             TransformManager::instance()->flushUpdates();
 
             shaderProgramMain.runTextureMapping();
@@ -792,7 +835,9 @@ int main(int argc, const char *argv[])
 
             mainPbrShader.runTextureMapping();
             mainPbrShader.runInstancing();
+            instancingPhase.end();
 
+            StartupProfiler::Phase lightsPhase("light buffers");
             LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()->setLightSourceValidator(
                 [](DirectionalLight) -> bool { return true; });
             LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()->initializeLightBuffer();
@@ -813,14 +858,102 @@ int main(int argc, const char *argv[])
             LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()->initializeLightBuffer();
             LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()->bindLightBuffer(4);
 
-            camera->moveTo(glm::vec3(35.0f, 10.0f, 35.0f));
-            camera->lookAt(glm::vec3(0.0f, -3.0f, 0.0f));
+            ViewConstantsManager::instance()->initializeViewBuffer();
+            lightsPhase.end();
+
+            if (sceneDescription->camera)
+            {
+                camera->moveTo(sceneDescription->camera->position);
+                camera->lookAt(sceneDescription->camera->target);
+            }
+
+            printMeshMemoryReport();
+            printDeduplicationReport(shaderProgramMain, mainPbrShader);
+
+            // the scene's textures are all uploaded by now
+            const PixelPool::Statistics pixelPool = PixelPool::statistics();
+            std::cout << "Pixel pool: " << pixelPool.reuses << " of " << pixelPool.allocations
+                      << " image buffers reused" << std::endl;
+            PixelPool::trim();
+
+            StartupProfiler::Phase shaderCompletionPhase("shader completion");
+            shaderBatch.complete();
+            shaderCompletionPhase.end();
+
+            GlObjectCounting::stop();
+            StartupProfiler::instance()->finish(startupTraceFromArguments(argc, argv));
+        }
+
+        // --transparency-benchmark times the sorted and the weighted blended passes over a growing
+        // number of glass panes, placed the same on every run, then exits (see the
+        // transparency_benchmark target). Each frame is waited for, so that no timing is dropped
+        const bool transparencyBenchmark = hasArgument(argc, argv, "--transparency-benchmark");
+        if (transparencyBenchmark && !glassMaterials.empty())
+        {
+            const auto runFrame = [&](int mode) {
+                ImGui_ImplOpenGL3_NewFrame();
+                ImGui_ImplGlfw_NewFrame();
+                ImGui::NewFrame();
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                ViewConstantsManager::instance()->updateCameraView(camera);
+                _standardRenderingPass.runPass();
+
+                transparencyTimers[mode].begin();
+                if (mode == 0)
+                    _sortingTransparentPass.runPass();
+                else
+                    _weightedBlendedTransparentPass.runPass();
+                transparencyTimers[mode].end();
+
+                _hdrPass.runPass();
+                ImGui::Render(); // nothing drawn, only the frame ended
+                glFinish();
+            };
+
+            std::cout << "transparent objects,sorted cpu ms,sorted gpu ms,oit cpu ms,oit gpu ms"
+                      << std::endl;
+            for (const size_t numPanes : transparencyBenchmarkPanes)
+            {
+                if (numPanes < numGlassPanes)
+                    continue;
+
+                addGlassPanes(numPanes - numGlassPanes, nextSeededInt);
+                simpleTransparentShader.updateInstancedBuffer(
+                    TransformManager::instance()->flushUpdates());
+
+                for (int mode = 0; mode < 2; ++mode)
+                {
+                    // the first frames sort from scratch and bind the scene's depth
+                    for (int f = 0; f < transparencyBenchmarkWarmUpFrames; ++f)
+                        runFrame(mode);
+                    transparencyTimers[mode].reset();
+                    for (int f = 0; f < transparencyBenchmarkFrames; ++f)
+                        runFrame(mode);
+                }
+
+                std::cout << numGlassPanes << "," << transparencyTimers[0].cpuMilliseconds()
+                          << "," << transparencyTimers[0].gpuMilliseconds() << ","
+                          << transparencyTimers[1].cpuMilliseconds() << ","
+                          << transparencyTimers[1].gpuMilliseconds() << std::endl;
+            }
+        }
+        else if (transparencyBenchmark)
+        {
+            std::cerr << "The scene has no glass materials to benchmark the transparency with"
+                      << std::endl;
         }
+
         //// Render loop
-        while (!mainWindow.shouldClose())
+        while (!headless && !transparencyBenchmark && !mainWindow.shouldClose())
         {
             TimeManager::instance()->update();
 
+            // the models requested with loadModelAsync from here on stream in
+            ModelLoader::instance()->processUploads(modelUploadBudget);
+            // for the textures the last frame requested
+            TextureStreamer::instance()->update(textureUploadBudget);
+
             const float time = TimeManager::instance()->getTime();
             const float deltaTime = TimeManager::instance()->getDeltaTime();
 
@@ -834,10 +967,19 @@ int main(int argc, const char *argv[])
 
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+            ViewConstantsManager::instance()->updateCameraView(camera);
+
             _volumetricFogPass.runPass();
             _shadowPass.runPass();
             _standardRenderingPass.runPass();
-            _sortingTransparentPass.runPass();
+
+            transparencyTimers[transparencyMode].begin();
+            if (transparencyMode == 0)
+                _sortingTransparentPass.runPass();
+            else
+                _weightedBlendedTransparentPass.runPass();
+            transparencyTimers[transparencyMode].end();
+
             _gizmosPass.runPass();
             _hdrPass.runPass();
 
@@ -847,6 +989,40 @@ int main(int argc, const char *argv[])
                 ImGui::End();
             }
 
+            {
+                ImGui::Begin("Transparency");
+                ImGui::RadioButton("Sorted", &transparencyMode, 0);
+                ImGui::SameLine();
+                ImGui::RadioButton("Weighted blended OIT", &transparencyMode, 1);
+                ImGui::Separator();
+
+                ImGui::Text("Transparent objects: %zu", numGlassPanes);
+                if (!glassMaterials.empty() && ImGui::Button("Add 100 glass panes"))
+                {
+                    addGlassPanes(100, nextRandomInt);
+                    transparencyTimers[0].reset();
+                    transparencyTimers[1].reset();
+                }
+                ImGui::Separator();
+
+                ImGui::Text("Sorted: cpu %.3f ms, gpu %.3f ms",
+                            transparencyTimers[0].cpuMilliseconds(),
+                            transparencyTimers[0].gpuMilliseconds());
+                ImGui::Text("OIT:    cpu %.3f ms, gpu %.3f ms",
+                            transparencyTimers[1].cpuMilliseconds(),
+                            transparencyTimers[1].gpuMilliseconds());
+                if (ImGui::Button("Log timings"))
+                {
+                    // csv-friendly, to plot the cost against the number of transparent objects
+                    std::cout << "transparency," << numGlassPanes << ","
+                              << transparencyTimers[0].cpuMilliseconds() << ","
+                              << transparencyTimers[0].gpuMilliseconds() << ","
+                              << transparencyTimers[1].cpuMilliseconds() << ","
+                              << transparencyTimers[1].gpuMilliseconds() << std::endl;
+                }
+                ImGui::End();
+            }
+
             {
                 FrameBufferManager::instance()->pushFrameBuffer(0);
                 ImGui::Render();
@@ -861,22 +1037,22 @@ int main(int argc, const char *argv[])
                 const glm::vec3 normalizedLightPos = glm::normalize(
                     glm::vec3(lightPosX, lightPosY, lightPosZ));
 
+                if (auto transformStruct = TransformManager::instance()->getTransform(
+                        pointLight1Transform))
                 {
-                    auto transformStruct = TransformManager::instance()->getTransform(
-                        pointLight1Transform);
                     transformStruct->setPosition(normalizedLightPos * lightRotationRadius);
                 }
 
+                if (auto transformStruct = TransformManager::instance()->getTransform(
+                        pointLight2Transform))
                 {
-                    auto transformStruct = TransformManager::instance()->getTransform(
-                        pointLight2Transform);
                     transformStruct->setPosition(-normalizedLightPos * lightRotationRadius);
                 }
 
+                // periodically rotates the textured spot light
+                if (auto transformStruct = TransformManager::instance()->getTransform(
+                        texturedLight1Transform))
                 {
-                    // periodically rotates the textured spot light
-                    auto transformStruct = TransformManager::instance()->getTransform(
-                        texturedLight1Transform);
                     transformStruct->setRotation(
                         glm::rotate(transformStruct->rotation(),
                                     (float)(glm::radians(25.0f) * deltaTime),
@@ -912,6 +1088,8 @@ int main(int argc, const char *argv[])
                     ->updateLightSourceTransform(texturedLight1Light);
 
                 shaderProgramMain.updateInstancedBuffer(objectsWithUpdatedTransforms);
+                simpleTransparentShader.updateInstancedBuffer(objectsWithUpdatedTransforms);
+                _shadowPass.updateInstancedBuffer(objectsWithUpdatedTransforms);
 
                 assert(glGetError() == GL_NO_ERROR);
                 glfwSwapBuffers(mainWindow.getRawWindow());
@@ -922,6 +1100,7 @@ int main(int argc, const char *argv[])
     MeshManager::instance()->cleanUpGracefully();
     TextureManager::instance()->cleanUpGracefully();
     CubemapManager::instance()->cleanUpGracefully();
+    ViewConstantsManager::instance()->cleanUpGracefully();
 
     {
         ImGui_ImplOpenGL3_Shutdown();
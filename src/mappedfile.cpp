@@ -0,0 +1,98 @@
+#include "mappedfile.h"
+
+#include "startupprofiler.h"
+
+#if defined(LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fstream>
+#endif
+
+#if defined(LINUX)
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+
+    // the mapping stays valid once the descriptor is closed
+    struct stat status = {};
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            _data = static_cast<const std::byte *>(mapping);
+            _size = status.st_size;
+            StartupProfiler::instance()->addBytesLoaded(_size);
+        }
+    }
+
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+        munmap(const_cast<std::byte *>(_data), _size);
+}
+#elif defined(WINDOWS)
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    _file = file;
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return;
+
+    _mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+        return;
+
+    _data = static_cast<const std::byte *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    _size = _data != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+    StartupProfiler::instance()->addBytesLoaded(_size);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return;
+
+    _contents.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (_contents.empty()
+        || !file.read(reinterpret_cast<char *>(_contents.data()), _contents.size()))
+    {
+        return;
+    }
+
+    _data = _contents.data();
+    _size = _contents.size();
+    StartupProfiler::instance()->addBytesLoaded(_size);
+}
+
+MappedFile::~MappedFile() = default;
+#endif
@@ -1,152 +1,218 @@
 #include "mesh.h"
+#include "blobfile.h"
+#include "utils.h"
 
-#include <glad/glad.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 
-#include <cstddef>
+namespace
+{
+constexpr std::array<char, 4> MeshBlobMagic = { 'M', 'S', 'H', 'C' };
+constexpr uint32_t MeshBlobVersion = 1;
+} // namespace
 
 Mesh::Mesh(std::vector<Vertex> &&meshVertices, std::vector<uint32_t> &&meshIndices,
-           std::vector<glm::vec3> &&tangentVectors)
+           std::vector<glm::vec3> &&tangentVectors, std::vector<MeshLod> &&lodChain,
+           std::vector<Meshlet> &&meshletList)
     : vertices(std::move(meshVertices)),
       indices(std::move(meshIndices)),
-      tangents(std::move(tangentVectors))
+      tangents(std::move(tangentVectors)),
+      lods(std::move(lodChain)),
+      meshlets(std::move(meshletList)),
+      vertexCount(vertices.size()),
+      indexCount(indices.size())
 {
-}
+    lodIndexCounts.reserve(lods.size());
+    for (const MeshLod &lod : lods)
+        lodIndexCounts.push_back(lod.indices.size());
 
-void Mesh::allocateMesh()
-{
-    if (id != 0)
+    if (vertices.empty())
         return;
 
-    glGenVertexArrays(1, &id);
-    glBindVertexArray(id);
+    // the LODs and the meshlets are derived from the streams
+    hash = Utilities::hashBytes(reinterpret_cast<const std::byte *>(vertices.data()),
+                                vertices.size() * sizeof(Vertex));
+    hash = Utilities::hashBytes(reinterpret_cast<const std::byte *>(indices.data()),
+                                indices.size() * sizeof(uint32_t), hash);
+    hash = Utilities::hashBytes(reinterpret_cast<const std::byte *>(tangents.data()),
+                                tangents.size() * sizeof(glm::vec3), hash);
+    hash = hash != 0 ? hash : 1;
+
+    // the sphere around the bounding box; the same one the LOD errors are measured against
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const Vertex &v : vertices)
+    {
+        const glm::vec3 p = glm::vec3(v.coordinates[0], v.coordinates[1], v.coordinates[2]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    center = (boundsMin + boundsMax) * 0.5f;
+    radius = glm::length(boundsMax - boundsMin) * 0.5f;
 
-    if (verticesSize() > 0 && indicesSize() > 0)
+    // the square root of the ratio of the areas, which texture streaming sizes the mips by
+    double uvArea = 0.0;
+    double area = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
     {
-        glGenBuffers(1, &vId);
-        glBindBuffer(GL_ARRAY_BUFFER, vId);
-        glBufferData(GL_ARRAY_BUFFER, verticesSize(), vertices.data(), GL_STATIC_DRAW);
-
-        uint32_t EBO;
-        glGenBuffers(1, &EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize(), indices.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(0); // space coords
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                              (void *)offsetof(Vertex, texCoordinates));
-        glEnableVertexAttribArray(1); // texture coords
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                              (void *)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2); // normals
-
-        if (!tangents.empty())
-        {
-            uint32_t TBO;
-            glGenBuffers(1, &TBO);
-            glBindBuffer(GL_ARRAY_BUFFER, TBO);
-            glBufferData(GL_ARRAY_BUFFER, tangentsSize(), tangents.data(), GL_STATIC_DRAW);
-
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
-            glEnableVertexAttribArray(3); // tangent vectors
-        }
+        const Vertex &a = vertices[indices[i]];
+        const Vertex &b = vertices[indices[i + 1]];
+        const Vertex &c = vertices[indices[i + 2]];
+
+        const glm::vec3 pA = glm::vec3(a.coordinates[0], a.coordinates[1], a.coordinates[2]);
+        const glm::vec3 pB = glm::vec3(b.coordinates[0], b.coordinates[1], b.coordinates[2]);
+        const glm::vec3 pC = glm::vec3(c.coordinates[0], c.coordinates[1], c.coordinates[2]);
+        area += glm::length(glm::cross(pB - pA, pC - pA));
+
+        const glm::vec2 uvA = glm::vec2(a.texCoordinates[0], a.texCoordinates[1]);
+        const glm::vec2 uvB = glm::vec2(b.texCoordinates[0], b.texCoordinates[1]);
+        const glm::vec2 uvC = glm::vec2(c.texCoordinates[0], c.texCoordinates[1]);
+        const glm::vec2 uvAB = uvB - uvA;
+        const glm::vec2 uvAC = uvC - uvA;
+        uvArea += std::abs(uvAB.x * uvAC.y - uvAB.y * uvAC.x);
     }
 
-    glBindVertexArray(0);
+    if (area > 0.0)
+        uvsPerUnit = static_cast<float>(std::sqrt(uvArea / area));
 }
 
-void Mesh::deallocateMesh()
-{
-    if (id == 0)
-        return;
+bool Mesh::isAllocated() const noexcept { return allocated; }
 
-    glDeleteBuffers(1, &vId);
-    glDeleteVertexArrays(1, &id);
-    glDeleteVertexArrays(1, &instancedId);
+MeshResidency Mesh::residency() const noexcept { return residencyPolicy; }
 
-    id = 0;
-    instancedId = 0;
-}
+bool Mesh::isCpuResident() const noexcept { return cpuResident; }
 
-void Mesh::bindMesh() const
+size_t Mesh::cpuSize() const noexcept
 {
-    if (id == 0)
-        return;
-    glBindVertexArray(id);
+    size_t size = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(uint32_t)
+                  + tangents.capacity() * sizeof(glm::vec3)
+                  + meshlets.capacity() * sizeof(Meshlet);
+    for (const MeshLod &lod : lods)
+        size += lod.indices.capacity() * sizeof(uint32_t);
+
+    return size;
 }
 
-// creates a separate VAO that allows binding instanced vertex attribute buffers to it later without
-// polluting the non-instanced buffer
-void Mesh::enableInstancing()
+uint32_t Mesh::indexByteOffset() const noexcept { return arenaIndexByteOffset; }
+
+uint32_t Mesh::indexByteOffset(size_t lod) const noexcept
 {
-    if (id == 0)
-        allocateMesh();
+    if (lod == 0 || arenaLodIndexByteOffsets.empty())
+        return arenaIndexByteOffset;
 
-    if (instancedId != 0)
-        return;
+    return arenaLodIndexByteOffsets[std::min(lod, arenaLodIndexByteOffsets.size()) - 1];
+}
 
-    glGenVertexArrays(1, &instancedId);
-    glBindVertexArray(instancedId);
+uint32_t Mesh::indexType() const noexcept { return arenaIndexType; }
 
-    if (verticesSize() > 0 && indicesSize() > 0)
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, vId); // shared
-
-        uint32_t EBO;
-        glGenBuffers(1, &EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize(), indices.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(0); // space coords
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                              (void *)offsetof(Vertex, texCoordinates));
-        glEnableVertexAttribArray(1); // texture coords
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                              (void *)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(2); // normals
-
-        if (!tangents.empty())
-        {
-            uint32_t TBO;
-            glGenBuffers(1, &TBO);
-            glBindBuffer(GL_ARRAY_BUFFER, TBO);
-            glBufferData(GL_ARRAY_BUFFER, tangentsSize(), tangents.data(), GL_STATIC_DRAW);
-
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
-            glEnableVertexAttribArray(3); // tangent vectors
-        }
-    }
+int32_t Mesh::baseVertex() const noexcept { return arenaBaseVertex; }
 
-    glBindVertexArray(0);
-}
+glm::vec3 Mesh::positionScale() const noexcept { return arenaPositionScale; }
 
-bool Mesh::instancingEnabled() const { return instancedId != 0; }
+glm::vec3 Mesh::positionOffset() const noexcept { return arenaPositionOffset; }
 
-void Mesh::bindMeshInstanced()
+// size in bytes
+uint32_t Mesh::verticesSize() const { return vertexCount * sizeof(Vertex); }
+
+uint32_t Mesh::numVertices() const { return vertexCount; }
+
+// size in bytes
+uint32_t Mesh::indicesSize() const { return indexCount * sizeof(uint32_t); }
+
+uint32_t Mesh::numIndices() const { return indexCount; }
+
+size_t Mesh::numLods() const noexcept { return lods.size() + 1; }
+
+uint32_t Mesh::numIndices(size_t lod) const
 {
-    if (instancedId == 0)
-        return;
-    glBindVertexArray(instancedId);
+    return lod == 0 || lodIndexCounts.empty()
+               ? indexCount
+               : lodIndexCounts[std::min(lod, lodIndexCounts.size()) - 1];
 }
 
-uint32_t Mesh::standardArrayId() const noexcept { return id; }
+float Mesh::lodError(size_t lod) const
+{
+    return lod == 0 || lods.empty() ? 0.0f : lods[std::min(lod, lods.size()) - 1].error;
+}
 
-uint32_t Mesh::instancedArrayId() const noexcept { return instancedId; }
+const std::vector<Meshlet> &Mesh::meshletData() const noexcept { return meshlets; }
 
-bool Mesh::isAllocated() const noexcept { return id != 0; }
+glm::vec3 Mesh::boundsCenter() const noexcept { return center; }
 
-Mesh::~Mesh() { deallocateMesh(); }
+float Mesh::boundsRadius() const noexcept { return radius; }
 
-// size in bytes
-uint32_t Mesh::verticesSize() const { return vertices.size() * sizeof(Vertex); }
+float Mesh::uvDensity() const noexcept { return uvsPerUnit; }
 
-uint32_t Mesh::numVertices() const { return vertices.size(); }
+uint64_t Mesh::contentHash() const noexcept { return hash; }
 
 // size in bytes
-uint32_t Mesh::indicesSize() const { return indices.size() * sizeof(uint32_t); }
+uint32_t Mesh::tangentsSize() const { return tangents.size() * sizeof(glm::vec3); }
 
-uint32_t Mesh::numIndices() const { return indices.size(); }
+std::vector<glm::vec3> Mesh::positions() const
+{
+    std::vector<glm::vec3> meshPositions;
+    meshPositions.reserve(vertices.size());
+    for (const Vertex &v : vertices)
+        meshPositions.emplace_back(v.coordinates[0], v.coordinates[1], v.coordinates[2]);
 
-// size in bytes
-uint32_t Mesh::tangentsSize() const { return tangents.size() * sizeof(glm::vec3); }
+    return meshPositions;
+}
+
+const std::vector<uint32_t> &Mesh::indexData() const noexcept { return indices; }
+
+void Mesh::releaseCpuData()
+{
+    // swapping with empty vectors gives the memory back; clear() would keep the capacity
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint32_t>().swap(indices);
+    std::vector<glm::vec3>().swap(tangents);
+    for (MeshLod &lod : lods)
+        std::vector<uint32_t>().swap(lod.indices);
+
+    cpuResident = false;
+}
+
+void Mesh::writeCpuData(BlobWriter &writer) const
+{
+    writer.write(MeshBlobMagic);
+    writer.write(MeshBlobVersion);
+
+    writer.writeArray(vertices);
+    writer.writeArray(indices);
+    writer.writeArray(tangents);
+    for (const MeshLod &lod : lods)
+        writer.writeArray(lod.indices);
+}
+
+bool Mesh::readCpuData(BlobReader &reader)
+{
+    std::array<char, 4> magic = {};
+    uint32_t version = 0;
+    if (!reader.read(magic) || !reader.read(version) || magic != MeshBlobMagic
+        || version != MeshBlobVersion)
+    {
+        return false;
+    }
+
+    if (!reader.readArray(vertices) || !reader.readArray(indices)
+        || !reader.readArray(tangents))
+    {
+        return false;
+    }
+
+    for (MeshLod &lod : lods)
+    {
+        if (!reader.readArray(lod.indices))
+            return false;
+    }
+
+    // the blob has to match the mesh it was written from
+    if (vertices.size() != vertexCount || indices.size() != indexCount)
+        return false;
+
+    cpuResident = true;
+    return true;
+}
@@ -0,0 +1,482 @@
+#include "meshcodec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+constexpr uint8_t VertexStreamTag = 0xa1;
+constexpr uint8_t IndexStreamTag = 0xb1;
+
+// the vertices are transposed in blocks, whose planes are encoded in groups
+constexpr size_t BlockSize = 256;
+constexpr size_t GroupSize = 16;
+
+// the code of a triangle whose edges are all new; the others name a slot of the edge FIFO
+constexpr uint8_t NoEdge = 15;
+constexpr size_t FifoSize = 16;
+
+// the kinds of the third vertex of a triangle with a known edge
+enum ThirdVertex : uint8_t
+{
+    NextVertex = 0,     // the lowest vertex not referenced yet
+    CachedVertex = 1,   // in the vertex FIFO; its slot follows
+    ExplicitVertex = 2, // a zigzag varint delta from the last explicit one follows
+};
+
+// the tags of the vertices of a triangle without a known edge: NextVertex, then CachedVertex
+// for the slots 0-15, then ExplicitVertex
+constexpr uint8_t CachedTag = 1;
+constexpr uint8_t ExplicitTag = CachedTag + FifoSize;
+
+uint32_t zigzag(uint32_t delta)
+{
+    return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+}
+
+uint32_t unzigzag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+void writeVarint(std::vector<uint8_t> &data, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t *&cursor, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+        if (cursor == end)
+            return false;
+
+        const uint8_t byte = *cursor++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// stores the bytes with the fewest bits that fit every byte of a group: a 2-bit mode per group
+// (packed four to a byte, ahead of the groups) and then the packed groups
+void encodePlane(const uint8_t *plane, size_t size, std::vector<uint8_t> &data)
+{
+    const size_t numGroups = size / GroupSize;
+    const size_t headerOffset = data.size();
+    data.resize(data.size() + (numGroups + 3) / 4, 0);
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        const uint8_t *group = plane + g * GroupSize;
+        const uint8_t maximum = *std::max_element(group, group + GroupSize);
+        const uint8_t mode = maximum == 0 ? 0 : maximum < 4 ? 1 : maximum < 16 ? 2 : 3;
+        data[headerOffset + g / 4] |= mode << (g % 4 * 2);
+
+        switch (mode)
+        {
+        case 1:
+            for (size_t b = 0; b < GroupSize; b += 4)
+            {
+                data.push_back(group[b] | group[b + 1] << 2 | group[b + 2] << 4
+                               | group[b + 3] << 6);
+            }
+            break;
+        case 2:
+            for (size_t b = 0; b < GroupSize; b += 2)
+                data.push_back(group[b] | group[b + 1] << 4);
+            break;
+        case 3:
+            data.insert(data.end(), group, group + GroupSize);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool decodePlane(const uint8_t *&cursor, const uint8_t *end, uint8_t *plane, size_t size)
+{
+    const size_t numGroups = size / GroupSize;
+    const uint8_t *header = cursor;
+    if (static_cast<size_t>(end - cursor) < (numGroups + 3) / 4)
+        return false;
+    cursor += (numGroups + 3) / 4;
+
+    // the unpacking loops have a fixed trip count, and are vectorized
+    constexpr std::array<size_t, 4> groupBytes = { 0, GroupSize / 4, GroupSize / 2, GroupSize };
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        const uint8_t mode = header[g / 4] >> (g % 4 * 2) & 3;
+        if (static_cast<size_t>(end - cursor) < groupBytes[mode])
+            return false;
+
+        uint8_t *group = plane + g * GroupSize;
+        switch (mode)
+        {
+        case 0:
+            std::memset(group, 0, GroupSize);
+            break;
+        case 1:
+            for (size_t b = 0; b < GroupSize; ++b)
+                group[b] = cursor[b / 4] >> (b % 4 * 2) & 3;
+            break;
+        case 2:
+            for (size_t b = 0; b < GroupSize; ++b)
+                group[b] = cursor[b / 2] >> (b % 2 * 4) & 15;
+            break;
+        default:
+            std::memcpy(group, cursor, GroupSize);
+            break;
+        }
+        cursor += groupBytes[mode];
+    }
+
+    return true;
+}
+
+// the last few edges and vertices, most recent first
+template <typename T>
+class Fifo
+{
+public:
+    explicit Fifo(const T &empty) { _entries.fill(empty); }
+
+    void push(const T &entry)
+    {
+        _entries[_head] = entry;
+        _head = (_head + 1) % FifoSize;
+    }
+
+    const T &at(size_t slot) const { return _entries[(_head + FifoSize - 1 - slot) % FifoSize]; }
+
+    // the slot of the entry among the first `slots`, or `slots` if it isn't there
+    size_t find(const T &entry, size_t slots = FifoSize) const
+    {
+        for (size_t slot = 0; slot < slots; ++slot)
+        {
+            if (at(slot) == entry)
+                return slot;
+        }
+        return slots;
+    }
+
+private:
+    std::array<T, FifoSize> _entries;
+    size_t _head = 0;
+};
+
+using Edge = std::pair<uint32_t, uint32_t>;
+constexpr uint32_t NoVertex = ~0u;
+
+// the state the encoder and the decoder keep in lockstep
+struct IndexCoderState
+{
+    Fifo<Edge> edges = Fifo<Edge>(Edge(NoVertex, NoVertex));
+    Fifo<uint32_t> vertices = Fifo<uint32_t>(NoVertex);
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    void reference(uint32_t vertex, bool cached)
+    {
+        if (!cached)
+            vertices.push(vertex);
+        if (vertex >= next)
+            next = vertex + 1;
+    }
+
+    // a neighbour with the same winding walks the shared edge the other way round
+    void pushTriangle(uint32_t a, uint32_t b, uint32_t c)
+    {
+        edges.push(Edge(b, a));
+        edges.push(Edge(c, b));
+        edges.push(Edge(a, c));
+    }
+};
+
+void encodeTaggedVertex(IndexCoderState &state, uint32_t vertex, std::vector<uint8_t> &data)
+{
+    if (vertex == state.next)
+    {
+        data.push_back(NextVertex);
+        state.reference(vertex, false);
+        return;
+    }
+
+    if (const size_t slot = state.vertices.find(vertex); slot < FifoSize)
+    {
+        data.push_back(static_cast<uint8_t>(CachedTag + slot));
+        state.reference(vertex, true);
+        return;
+    }
+
+    data.push_back(ExplicitTag);
+    writeVarint(data, zigzag(vertex - state.last));
+    state.last = vertex;
+    state.reference(vertex, false);
+}
+
+bool decodeTaggedVertex(IndexCoderState &state, const uint8_t *&cursor, const uint8_t *end,
+                        uint32_t &vertex)
+{
+    if (cursor == end)
+        return false;
+
+    const uint8_t tag = *cursor++;
+    if (tag == NextVertex)
+    {
+        vertex = state.next;
+        state.reference(vertex, false);
+        return true;
+    }
+
+    if (tag < ExplicitTag)
+    {
+        vertex = state.vertices.at(tag - CachedTag);
+        state.reference(vertex, true);
+        return vertex != NoVertex;
+    }
+
+    uint32_t delta = 0;
+    if (tag != ExplicitTag || !readVarint(cursor, end, delta))
+        return false;
+
+    vertex = state.last + unzigzag(delta);
+    state.last = vertex;
+    state.reference(vertex, false);
+    return true;
+}
+} // namespace
+
+namespace MeshCodec
+{
+std::vector<uint8_t> encodeVertices(const void *vertices, size_t numVertices, size_t stride)
+{
+    const size_t numWords = stride / sizeof(uint32_t);
+    const uint8_t *source = static_cast<const uint8_t *>(vertices);
+
+    std::vector<uint8_t> data = { VertexStreamTag };
+    std::vector<uint32_t> previous(numWords, 0);
+    std::vector<uint32_t> deltas(numWords * BlockSize);
+    std::array<uint8_t, BlockSize> plane;
+
+    for (size_t blockStart = 0; blockStart < numVertices; blockStart += BlockSize)
+    {
+        const size_t blockVertices = std::min(BlockSize, numVertices - blockStart);
+        const size_t planeSize = (blockVertices + GroupSize - 1) / GroupSize * GroupSize;
+
+        // word-major, so that every plane is a contiguous run
+        for (size_t v = 0; v < blockVertices; ++v)
+        {
+            for (size_t w = 0; w < numWords; ++w)
+            {
+                uint32_t word;
+                std::memcpy(&word, source + (blockStart + v) * stride + w * sizeof(uint32_t),
+                            sizeof(word));
+                deltas[w * BlockSize + v] = zigzag(word - previous[w]);
+                previous[w] = word;
+            }
+        }
+
+        for (size_t w = 0; w < numWords; ++w)
+        {
+            for (size_t byte = 0; byte < sizeof(uint32_t); ++byte)
+            {
+                plane.fill(0);
+                for (size_t v = 0; v < blockVertices; ++v)
+                    plane[v] = static_cast<uint8_t>(deltas[w * BlockSize + v] >> (byte * 8));
+                encodePlane(plane.data(), planeSize, data);
+            }
+        }
+    }
+
+    return data;
+}
+
+bool decodeVertices(void *vertices, size_t numVertices, size_t stride, const uint8_t *data,
+                    size_t size)
+{
+    if (stride % sizeof(uint32_t) != 0 || size == 0 || data[0] != VertexStreamTag)
+        return false;
+
+    const size_t numWords = stride / sizeof(uint32_t);
+    uint8_t *target = static_cast<uint8_t *>(vertices);
+    const uint8_t *cursor = data + 1;
+    const uint8_t *end = data + size;
+
+    std::vector<uint32_t> previous(numWords, 0);
+    std::vector<uint32_t> deltas(numWords * BlockSize);
+    alignas(16) std::array<std::array<uint8_t, BlockSize>, sizeof(uint32_t)> planes;
+
+    for (size_t blockStart = 0; blockStart < numVertices; blockStart += BlockSize)
+    {
+        const size_t blockVertices = std::min(BlockSize, numVertices - blockStart);
+        const size_t planeSize = (blockVertices + GroupSize - 1) / GroupSize * GroupSize;
+
+        for (size_t w = 0; w < numWords; ++w)
+        {
+            for (size_t byte = 0; byte < sizeof(uint32_t); ++byte)
+            {
+                if (!decodePlane(cursor, end, planes[byte].data(), planeSize))
+                    return false;
+            }
+
+            uint32_t *wordDeltas = deltas.data() + w * BlockSize;
+            for (size_t v = 0; v < planeSize; ++v)
+            {
+                wordDeltas[v] = unzigzag(planes[0][v] | planes[1][v] << 8 | planes[2][v] << 16
+                                         | static_cast<uint32_t>(planes[3][v]) << 24);
+            }
+        }
+
+        // the prefix sums run along the vertices; the words of a vertex are independent
+        for (size_t v = 0; v < blockVertices; ++v)
+        {
+            uint8_t *vertex = target + (blockStart + v) * stride;
+            for (size_t w = 0; w < numWords; ++w)
+            {
+                previous[w] += deltas[w * BlockSize + v];
+                std::memcpy(vertex + w * sizeof(uint32_t), &previous[w], sizeof(uint32_t));
+            }
+        }
+    }
+
+    return cursor == end;
+}
+
+std::vector<uint8_t> encodeIndices(const uint32_t *indices, size_t numIndices)
+{
+    std::vector<uint8_t> data = { IndexStreamTag };
+    data.reserve(numIndices / 3 + 1);
+
+    IndexCoderState state;
+    for (size_t i = 0; i + 2 < numIndices; i += 3)
+    {
+        const std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+
+        size_t edgeSlot = NoEdge;
+        size_t rotation = 0;
+        for (size_t r = 0; r < 3 && edgeSlot == NoEdge; ++r)
+        {
+            edgeSlot = state.edges.find(Edge(triangle[r], triangle[(r + 1) % 3]), NoEdge);
+            rotation = r;
+        }
+
+        if (edgeSlot == NoEdge)
+        {
+            data.push_back(NoEdge);
+            for (const uint32_t vertex : triangle)
+                encodeTaggedVertex(state, vertex, data);
+        }
+        else
+        {
+            const uint32_t third = triangle[(rotation + 2) % 3];
+            const uint8_t code = static_cast<uint8_t>(edgeSlot | rotation << 4);
+            if (third == state.next)
+            {
+                data.push_back(code | NextVertex << 6);
+                state.reference(third, false);
+            }
+            else if (const size_t slot = state.vertices.find(third); slot < FifoSize)
+            {
+                data.push_back(code | CachedVertex << 6);
+                data.push_back(static_cast<uint8_t>(slot));
+                state.reference(third, true);
+            }
+            else
+            {
+                data.push_back(code | ExplicitVertex << 6);
+                writeVarint(data, zigzag(third - state.last));
+                state.last = third;
+                state.reference(third, false);
+            }
+        }
+
+        state.pushTriangle(triangle[0], triangle[1], triangle[2]);
+    }
+
+    return data;
+}
+
+bool decodeIndices(uint32_t *indices, size_t numIndices, const uint8_t *data, size_t size)
+{
+    if (numIndices % 3 != 0 || size == 0 || data[0] != IndexStreamTag)
+        return false;
+
+    const uint8_t *cursor = data + 1;
+    const uint8_t *end = data + size;
+
+    IndexCoderState state;
+    for (size_t i = 0; i < numIndices; i += 3)
+    {
+        if (cursor == end)
+            return false;
+
+        const uint8_t code = *cursor++;
+        const size_t edgeSlot = code & 15;
+        std::array<uint32_t, 3> triangle;
+
+        if (edgeSlot == NoEdge)
+        {
+            for (uint32_t &vertex : triangle)
+            {
+                if (!decodeTaggedVertex(state, cursor, end, vertex))
+                    return false;
+            }
+        }
+        else
+        {
+            const size_t rotation = code >> 4 & 3;
+            const Edge &edge = state.edges.at(edgeSlot);
+            if (rotation > 2 || edge.first == NoVertex)
+                return false;
+
+            uint32_t third = 0;
+            switch (code >> 6)
+            {
+            case NextVertex:
+                third = state.next;
+                state.reference(third, false);
+                break;
+            case CachedVertex:
+                if (cursor == end || *cursor >= FifoSize)
+                    return false;
+                third = state.vertices.at(*cursor++);
+                if (third == NoVertex)
+                    return false;
+                state.reference(third, true);
+                break;
+            case ExplicitVertex:
+            {
+                uint32_t delta = 0;
+                if (!readVarint(cursor, end, delta))
+                    return false;
+                third = state.last + unzigzag(delta);
+                state.last = third;
+                state.reference(third, false);
+                break;
+            }
+            default:
+                return false;
+            }
+
+            // the edge and the third vertex are the triangle rotated by `rotation`
+            triangle[rotation] = edge.first;
+            triangle[(rotation + 1) % 3] = edge.second;
+            triangle[(rotation + 2) % 3] = third;
+        }
+
+        indices[i] = triangle[0];
+        indices[i + 1] = triangle[1];
+        indices[i + 2] = triangle[2];
+        state.pushTriangle(triangle[0], triangle[1], triangle[2]);
+    }
+
+    return cursor == end;
+}
+} // namespace MeshCodec
@@ -0,0 +1,111 @@
+#include "meshletculler.h"
+
+#include <algorithm>
+
+namespace
+{
+// the six clip planes (Gribb & Hartmann), normalized so that a sphere can be tested against them
+std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4 &clipFromModel)
+{
+    const glm::vec4 row0 = glm::vec4(clipFromModel[0][0], clipFromModel[1][0],
+                                     clipFromModel[2][0], clipFromModel[3][0]);
+    const glm::vec4 row1 = glm::vec4(clipFromModel[0][1], clipFromModel[1][1],
+                                     clipFromModel[2][1], clipFromModel[3][1]);
+    const glm::vec4 row2 = glm::vec4(clipFromModel[0][2], clipFromModel[1][2],
+                                     clipFromModel[2][2], clipFromModel[3][2]);
+    const glm::vec4 row3 = glm::vec4(clipFromModel[0][3], clipFromModel[1][3],
+                                     clipFromModel[2][3], clipFromModel[3][3]);
+
+    std::array<glm::vec4, 6> planes = { row3 + row0, row3 - row0, row3 + row1,
+                                        row3 - row1, row3 + row2, row3 - row2 };
+    for (glm::vec4 &plane : planes)
+        plane /= std::max(glm::length(glm::vec3(plane)), 1e-12f);
+
+    return planes;
+}
+
+bool sphereInFrustum(const std::array<glm::vec4, 6> &planes, const glm::vec3 &center,
+                     float radius)
+{
+    return std::ranges::all_of(planes, [&center, radius](const glm::vec4 &plane) {
+        return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+    });
+}
+} // namespace
+
+MeshletCuller::~MeshletCuller() { glDeleteBuffers(1, &_commandBuffer); }
+
+void MeshletCuller::beginFrame(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    _viewProjection = viewProjection;
+    _cameraPosition = cameraPosition;
+    _commands.clear();
+    _numMeshletsTested = _numMeshletsVisible = _numTrianglesVisible = 0;
+}
+
+size_t MeshletCuller::cullInstance(const Mesh &mesh, const glm::mat4 &modelMatrix,
+                                   GLuint instance)
+{
+    const std::vector<Meshlet> &meshlets = mesh.meshletData();
+    _numMeshletsTested += meshlets.size();
+
+    const std::array<glm::vec4, 6> planes = extractFrustumPlanes(_viewProjection * modelMatrix);
+    if (!sphereInFrustum(planes, mesh.boundsCenter(), mesh.boundsRadius()))
+        return 0;
+
+    // a mirroring transform flips the winding, and so what is back-facing
+    const bool coneCulling = glm::determinant(glm::mat3(modelMatrix)) > 0.0f;
+    const glm::vec3 camera = glm::inverse(modelMatrix) * glm::vec4(_cameraPosition, 1.0f);
+
+    const GLuint indexSize = mesh.indexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                                                   : sizeof(uint32_t);
+    const GLuint meshFirstIndex = mesh.indexByteOffset() / indexSize;
+
+    const size_t firstCommand = _commands.size();
+    for (const Meshlet &meshlet : meshlets)
+    {
+        if (!sphereInFrustum(planes, meshlet.center, meshlet.radius))
+            continue;
+
+        // every triangle faces away if the camera is outside the (sphere-widened) cone
+        const glm::vec3 toMeshlet = meshlet.center - camera;
+        if (coneCulling
+            && glm::dot(toMeshlet, meshlet.coneAxis)
+                   >= meshlet.coneCutoff * glm::length(toMeshlet) + meshlet.radius)
+        {
+            continue;
+        }
+
+        ++_numMeshletsVisible;
+        _numTrianglesVisible += meshlet.numIndices / 3;
+
+        const GLuint firstIndex = meshFirstIndex + meshlet.firstIndex;
+        if (_commands.size() > firstCommand
+            && _commands.back().firstIndex + _commands.back().count == firstIndex)
+        {
+            _commands.back().count += meshlet.numIndices;
+            continue;
+        }
+
+        _commands.emplace_back(meshlet.numIndices, 1, firstIndex, mesh.baseVertex(), instance);
+    }
+
+    return _commands.size() - firstCommand;
+}
+
+void MeshletCuller::uploadCommands()
+{
+    if (_commands.empty())
+        return;
+
+    const size_t commandsSize = _commands.size() * sizeof(MeshManager::DrawElementsIndirectCommand);
+    if (_commandBuffer == 0 || commandsSize > _commandCapacity)
+    {
+        glDeleteBuffers(1, &_commandBuffer);
+        glCreateBuffers(1, &_commandBuffer);
+        _commandCapacity = std::max(commandsSize, _commandCapacity * 2);
+        glNamedBufferData(_commandBuffer, _commandCapacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    glNamedBufferSubData(_commandBuffer, 0, commandsSize, _commands.data());
+}
@@ -1,21 +1,186 @@
 #include "meshmanager.h"
 
-#include "randomnamer.h"
+#include "blobfile.h"
+#include "mappedfile.h"
+#include "nameregistry.h"
 
 #include <glad/glad.h>
 
+#include "glm/gtc/packing.hpp"
+
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+constexpr size_t MinArenaCapacity = 1 << 16;
+
+// the identifiers are only unique within a run, and so are the cached meshes
+std::filesystem::path cachedMeshPath(MeshIdentifier id)
+{
+    return std::filesystem::path(ENGINE_CACHE) / "meshes" / (std::to_string(id) + ".mesh");
+}
+
+#if !ENGINE_FULL_FLOAT_VERTICES
+// maps the unit sphere onto the [-1, 1] square
+glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+    const float l1Norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1Norm <= 0.0f)
+        return glm::vec2(0.0f);
+
+    n /= l1Norm;
+    glm::vec2 encoded = glm::vec2(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x)))
+                  * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+std::vector<CompactVertex> encodeVertices(const std::vector<Vertex> &vertices,
+                                          const std::vector<glm::vec3> &tangents,
+                                          glm::vec3 &positionScale, glm::vec3 &positionOffset)
+{
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const Vertex &v : vertices)
+    {
+        const glm::vec3 p = glm::vec3(v.coordinates[0], v.coordinates[1], v.coordinates[2]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    // flat meshes (e.g. the plane) must not divide by zero
+    positionOffset = boundsMin;
+    positionScale = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+    std::vector<CompactVertex> encoded(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+    {
+        const Vertex &source = vertices[v];
+        CompactVertex &target = encoded[v];
+
+        const glm::vec3 p = glm::vec3(source.coordinates[0], source.coordinates[1],
+                                      source.coordinates[2]);
+        const glm::vec3 quantized = glm::round(glm::clamp((p - positionOffset) / positionScale,
+                                                          0.0f, 1.0f)
+                                               * 65535.0f);
+        for (size_t c = 0; c < 3; ++c)
+            target.position[c] = static_cast<uint16_t>(quantized[c]);
+
+        const glm::vec2 normal = encodeOctahedral(
+            glm::vec3(source.normal[0], source.normal[1], source.normal[2]));
+        target.normal[0] = static_cast<int16_t>(std::round(normal.x * 32767.0f));
+        target.normal[1] = static_cast<int16_t>(std::round(normal.y * 32767.0f));
+
+        target.texCoordinates[0] = glm::packHalf1x16(source.texCoordinates[0]);
+        target.texCoordinates[1] = glm::packHalf1x16(source.texCoordinates[1]);
+
+        if (v < tangents.size())
+        {
+            // the bitangent is rebuilt as cross(normal, tangent), i.e. the handedness is +1
+            const glm::vec2 tangent = encodeOctahedral(tangents[v]);
+            target.tangent[0] = static_cast<int8_t>(std::round(tangent.x * 127.0f));
+            target.tangent[1] = static_cast<int8_t>(std::round(tangent.y * 127.0f));
+            target.tangent[2] = 127;
+        }
+    }
+
+    return encoded;
+}
+#endif
+} // namespace
+
+MeshIdentifier MeshManager::registerMesh(Mesh &&mesh, const std::string &name)
+{
+    return registerMesh(std::move(mesh), NameRegistry::instance()->intern(name));
+}
 
-TextureIdentifier MeshManager::registerMesh(const Mesh &&mesh, const std::string &name)
+MeshIdentifier MeshManager::registerMesh(Mesh &&mesh, NameIdentifier nameId)
 {
-    if (const TextureIdentifier ti = meshRegistered(name); ti != InvalidIdentifier)
-        return ti;
+    if (const auto namePtr = _meshesByName.find(nameId); namePtr != _meshesByName.end())
+        return namePtr->second;
+
+    const uint64_t hash = mesh.contentHash();
+    if (const auto shared = _meshesByContent.find(hash);
+        _deduplicate && shared != _meshesByContent.end()
+        && sameContent(shared->second, mesh))
+    {
+        _meshesByName.emplace(nameId, shared->second);
+        ++_numReferences[shared->second];
+        ++_deduplication.numShared;
+        _deduplication.bytesSaved += gpuSize(mesh);
+        return shared->second;
+    }
 
-    _meshes.emplace(++_identifiers, NamedMesh{ name, mesh });
+    mesh.residencyPolicy = _defaultResidency;
+    _meshes.emplace(++_identifiers, NamedMesh{ nameId, std::move(mesh) });
+    _meshesByName.emplace(nameId, _identifiers);
+    _numReferences.emplace(_identifiers, 1);
+    if (hash != 0)
+        _meshesByContent.try_emplace(hash, _identifiers);
     return _identifiers;
 }
 
+bool MeshManager::sameContent(MeshIdentifier sharedId, const Mesh &mesh) const
+{
+    const Mesh &shared = _meshes.at(sharedId).componentData;
+    if (!mesh.cpuResident || shared.vertexCount != mesh.vertexCount
+        || shared.indexCount != mesh.indexCount)
+    {
+        return false;
+    }
+
+    if (shared.cpuResident)
+        return sameStreams(shared, mesh);
+
+    if (shared.residencyPolicy == MeshResidency::ReloadFromCache)
+    {
+        if (const Mesh cached = loadCachedMesh(sharedId, shared); cached.cpuResident)
+            return sameStreams(cached, mesh);
+    }
+
+    // a released mesh only has its arena ranges left, and reading those back would stall the
+    // pipeline; it isn't shared
+    return false;
+}
+
+bool MeshManager::sameStreams(const Mesh &shared, const Mesh &mesh)
+{
+    return shared.vertices.size() == mesh.vertices.size()
+           && shared.tangents.size() == mesh.tangents.size()
+           && std::memcmp(shared.vertices.data(), mesh.vertices.data(),
+                          mesh.vertices.size() * sizeof(Vertex))
+                  == 0
+           && shared.indices == mesh.indices
+           && std::memcmp(shared.tangents.data(), mesh.tangents.data(),
+                          mesh.tangents.size() * sizeof(glm::vec3))
+                  == 0;
+}
+
+size_t MeshManager::gpuSize(const Mesh &mesh)
+{
+#if ENGINE_FULL_FLOAT_VERTICES
+    size_t size = mesh.numVertices() * (sizeof(Vertex) + sizeof(glm::vec3));
+#else
+    size_t size = mesh.numVertices() * sizeof(CompactVertex);
+#endif
+    const size_t indexSize = mesh.numVertices() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+    for (size_t lod = 0; lod < mesh.numLods(); ++lod)
+        size += mesh.numIndices(lod) * indexSize;
+    return size;
+}
+
+void MeshManager::setContentDeduplication(bool enabled) { _deduplicate = enabled; }
+
 void MeshManager::unregisterMesh(MeshIdentifier id)
 {
     const auto meshPtr = _meshes.find(id);
@@ -26,22 +191,49 @@ void MeshManager::unregisterMesh(MeshIdentifier id)
     if (_boundMesh != 0 && id == _boundMesh)
         return;
 
+    if (const auto references = _numReferences.find(id);
+        references != _numReferences.end() && --references->second > 0)
+    {
+        return;
+    }
+    _numReferences.erase(id);
+
+    const Mesh &mesh = meshPtr->second.componentData;
+    if (!mesh.cpuResident)
+    {
+        std::error_code error;
+        std::filesystem::remove(cachedMeshPath(id), error);
+    }
+
+    // its ranges are free for the next meshes; nothing draws the mesh anymore
+    if (mesh.arenaIndexType != 0)
+    {
+        returnToArena(_freeVertexRanges, _numArenaVertices,
+                      { static_cast<size_t>(mesh.arenaBaseVertex), mesh.numVertices() });
+        returnToArena(_freeIndexRanges, _numArenaIndexBytes,
+                      { mesh.arenaIndexByteOffset, arenaIndexBytes(mesh) });
+    }
+
+    std::erase_if(_meshesByName, [id](const auto &name) { return name.second == id; });
+    if (const auto shared = _meshesByContent.find(mesh.contentHash());
+        shared != _meshesByContent.end() && shared->second == id)
+    {
+        _meshesByContent.erase(shared);
+    }
     _meshes.erase(id);
 }
 
-std::pair<std::string, MeshIdentifier> MeshManager::registerMesh(const Mesh &&mesh)
+std::pair<std::string, MeshIdentifier> MeshManager::registerMesh(Mesh &&mesh)
 {
-    const auto rName = RandomNamer::instance()->getRandomName(10);
-    const auto id = registerMesh(std::move(mesh), rName);
-    return std::make_pair(rName, id);
+    const NameIdentifier nameId = NameRegistry::instance()->internAnonymous("mesh");
+    const auto id = registerMesh(std::move(mesh), nameId);
+    return std::make_pair(NameRegistry::instance()->name(nameId), id);
 }
 
-MeshIdentifier MeshManager::meshRegistered(const std::string &meshName)
+MeshIdentifier MeshManager::meshRegistered(const std::string &meshName) const
 {
-    const auto meshPtr = std::ranges::find_if(_meshes, [&meshName](const auto &pair) {
-        return pair.second.componentName == meshName;
-    });
-    return meshPtr == _meshes.end() ? InvalidIdentifier : meshPtr->first;
+    const auto namePtr = _meshesByName.find(NameRegistry::instance()->find(meshName));
+    return namePtr == _meshesByName.end() ? InvalidIdentifier : namePtr->second;
 }
 
 void MeshManager::allocateMesh(MeshIdentifier id)
@@ -50,7 +242,269 @@ void MeshManager::allocateMesh(MeshIdentifier id)
     if (meshPtr == _meshes.end())
         return;
 
-    meshPtr->second.componentData.allocateMesh();
+    Mesh &mesh = meshPtr->second.componentData;
+    if (mesh.allocated)
+        return;
+
+    // a deallocated mesh still has its range, which is all a released mesh has left
+    if (mesh.arenaIndexType != 0)
+    {
+        mesh.allocated = true;
+        return;
+    }
+
+    // small meshes get 16-bit indices; the 32-bit ranges have to stay 4-byte aligned
+    const bool shortIndices = mesh.numVertices() <= std::numeric_limits<uint16_t>::max() + 1;
+    const size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // the LOD ranges follow the base range and share its base vertex
+    size_t numIndices = mesh.numIndices();
+    for (const MeshLod &lod : mesh.lods)
+        numIndices += lod.indices.size();
+
+    const size_t vertexOffset = placeInArena(_freeVertexRanges, _numArenaVertices,
+                                             mesh.numVertices(), 1);
+    const size_t indexByteOffset = placeInArena(_freeIndexRanges, _numArenaIndexBytes,
+                                                numIndices * indexSize, indexSize);
+    const size_t verticesEnd = std::max(_numArenaVertices, vertexOffset + mesh.numVertices());
+    const size_t indexBytesEnd = std::max(_numArenaIndexBytes,
+                                          indexByteOffset + numIndices * indexSize);
+
+    reserveArenas(verticesEnd, indexBytesEnd);
+
+    if (mesh.numVertices() > 0)
+    {
+#if ENGINE_FULL_FLOAT_VERTICES
+        glNamedBufferSubData(_vertexArena, vertexOffset * sizeof(Vertex), mesh.verticesSize(),
+                             mesh.vertices.data());
+
+        // the tangent stream runs parallel to the vertices; meshes without tangents get zeros
+        std::vector<glm::vec3> tangents = mesh.tangents;
+        tangents.resize(mesh.numVertices(), glm::vec3(0.0f));
+        glNamedBufferSubData(_tangentArena, vertexOffset * sizeof(glm::vec3),
+                             tangents.size() * sizeof(glm::vec3), tangents.data());
+
+        mesh.arenaPositionScale = glm::vec3(1.0f);
+        mesh.arenaPositionOffset = glm::vec3(0.0f);
+#else
+        const std::vector<CompactVertex> compactVertices = encodeVertices(mesh.vertices,
+                                                                          mesh.tangents,
+                                                                          mesh.arenaPositionScale,
+                                                                          mesh.arenaPositionOffset);
+        glNamedBufferSubData(_vertexArena, vertexOffset * sizeof(CompactVertex),
+                             compactVertices.size() * sizeof(CompactVertex),
+                             compactVertices.data());
+#endif
+    }
+
+    const auto uploadIndices = [this, shortIndices](const std::vector<uint32_t> &indices,
+                                                    size_t byteOffset) {
+        if (indices.empty())
+            return;
+
+        if (shortIndices)
+        {
+            const std::vector<uint16_t> shortIndexData(indices.cbegin(), indices.cend());
+            glNamedBufferSubData(_indexArena, byteOffset, shortIndexData.size() * sizeof(uint16_t),
+                                 shortIndexData.data());
+        }
+        else
+        {
+            glNamedBufferSubData(_indexArena, byteOffset, indices.size() * sizeof(uint32_t),
+                                 indices.data());
+        }
+    };
+
+    uploadIndices(mesh.indices, indexByteOffset);
+
+    mesh.arenaLodIndexByteOffsets.clear();
+    size_t lodByteOffset = indexByteOffset + mesh.numIndices() * indexSize;
+    for (const MeshLod &lod : mesh.lods)
+    {
+        uploadIndices(lod.indices, lodByteOffset);
+        mesh.arenaLodIndexByteOffsets.emplace_back(static_cast<uint32_t>(lodByteOffset));
+        lodByteOffset += lod.indices.size() * indexSize;
+    }
+
+    mesh.arenaBaseVertex = static_cast<int32_t>(vertexOffset);
+    mesh.arenaIndexByteOffset = static_cast<uint32_t>(indexByteOffset);
+    mesh.arenaIndexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.allocated = true;
+
+    _numArenaVertices = verticesEnd;
+    _numArenaIndexBytes = indexBytesEnd;
+
+    applyResidency(id, mesh);
+}
+
+void MeshManager::setDefaultResidency(MeshResidency residency) { _defaultResidency = residency; }
+
+void MeshManager::setMeshResidency(MeshIdentifier id, MeshResidency residency)
+{
+    const auto meshPtr = _meshes.find(id);
+    if (meshPtr == _meshes.end())
+        return;
+
+    Mesh &mesh = meshPtr->second.componentData;
+    if (!mesh.cpuResident && residency == MeshResidency::KeepCpuCopy)
+    {
+        // takes the CPU copy back from the cache; a released mesh stays released
+        Mesh cached = loadCachedMesh(id, mesh);
+        if (cached.cpuResident)
+        {
+            mesh.vertices = std::move(cached.vertices);
+            mesh.indices = std::move(cached.indices);
+            mesh.tangents = std::move(cached.tangents);
+            for (size_t lod = 0; lod < mesh.lods.size(); ++lod)
+                mesh.lods[lod].indices = std::move(cached.lods[lod].indices);
+            mesh.cpuResident = true;
+
+            std::error_code error;
+            std::filesystem::remove(cachedMeshPath(id), error);
+        }
+    }
+
+    mesh.residencyPolicy = residency;
+    if (mesh.arenaIndexType != 0)
+        applyResidency(id, mesh);
+}
+
+void MeshManager::applyResidency(MeshIdentifier id, Mesh &mesh) const
+{
+    if (!mesh.cpuResident || mesh.residencyPolicy == MeshResidency::KeepCpuCopy)
+        return;
+
+    if (mesh.residencyPolicy == MeshResidency::ReloadFromCache)
+    {
+        const std::filesystem::path path = cachedMeshPath(id);
+        if (!writeAtomically(path, [&mesh](BlobWriter &writer) {
+                mesh.writeCpuData(writer);
+                return true;
+            }))
+        {
+            std::cerr << "Failed to write the mesh cache " << path << "; keeping the CPU copy"
+                      << std::endl;
+            return;
+        }
+    }
+
+    mesh.releaseCpuData();
+}
+
+Mesh MeshManager::loadCachedMesh(MeshIdentifier id, const Mesh &mesh) const
+{
+    Mesh cached;
+    cached.cpuResident = false;
+    cached.vertexCount = mesh.vertexCount;
+    cached.indexCount = mesh.indexCount;
+    cached.lods.resize(mesh.lods.size());
+
+    const MappedFile file(cachedMeshPath(id));
+    if (!file.isOpen())
+        return cached;
+
+    BlobReader reader(file.data(), file.size());
+    if (!cached.readCpuData(reader))
+        cached.releaseCpuData();
+
+    return cached;
+}
+
+std::vector<glm::vec3> MeshManager::meshPositions(MeshIdentifier id) const
+{
+    const Mesh *mesh = getMesh(id);
+    if (mesh == nullptr)
+        return {};
+
+    if (mesh->cpuResident)
+        return mesh->positions();
+
+    if (mesh->residencyPolicy == MeshResidency::ReloadFromCache)
+    {
+        if (const Mesh cached = loadCachedMesh(id, *mesh); cached.cpuResident)
+            return cached.positions();
+    }
+
+    if (mesh->arenaIndexType == 0 || _vertexArena == 0)
+        return {};
+
+    // read back from the vertex arena, decoded the way the vertex shaders do it
+    std::vector<glm::vec3> positions;
+    positions.reserve(mesh->numVertices());
+#if ENGINE_FULL_FLOAT_VERTICES
+    std::vector<Vertex> vertices(mesh->numVertices());
+    glGetNamedBufferSubData(_vertexArena, mesh->arenaBaseVertex * sizeof(Vertex),
+                            vertices.size() * sizeof(Vertex), vertices.data());
+    for (const Vertex &v : vertices)
+        positions.emplace_back(v.coordinates[0], v.coordinates[1], v.coordinates[2]);
+#else
+    std::vector<CompactVertex> vertices(mesh->numVertices());
+    glGetNamedBufferSubData(_vertexArena, mesh->arenaBaseVertex * sizeof(CompactVertex),
+                            vertices.size() * sizeof(CompactVertex), vertices.data());
+    for (const CompactVertex &v : vertices)
+    {
+        const glm::vec3 quantized = glm::vec3(v.position[0], v.position[1], v.position[2]);
+        positions.emplace_back(mesh->arenaPositionOffset
+                               + quantized / 65535.0f * mesh->arenaPositionScale);
+    }
+#endif
+
+    return positions;
+}
+
+std::vector<uint32_t> MeshManager::meshIndices(MeshIdentifier id) const
+{
+    const Mesh *mesh = getMesh(id);
+    if (mesh == nullptr)
+        return {};
+
+    if (mesh->cpuResident)
+        return mesh->indexData();
+
+    if (mesh->residencyPolicy == MeshResidency::ReloadFromCache)
+    {
+        if (Mesh cached = loadCachedMesh(id, *mesh); cached.cpuResident)
+            return std::move(cached.indices);
+    }
+
+    if (mesh->arenaIndexType == 0 || _indexArena == 0)
+        return {};
+
+    std::vector<uint32_t> indices(mesh->numIndices());
+    if (mesh->arenaIndexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<uint16_t> shortIndices(mesh->numIndices());
+        glGetNamedBufferSubData(_indexArena, mesh->arenaIndexByteOffset,
+                                shortIndices.size() * sizeof(uint16_t), shortIndices.data());
+        std::ranges::copy(shortIndices, indices.begin());
+    }
+    else
+    {
+        glGetNamedBufferSubData(_indexArena, mesh->arenaIndexByteOffset,
+                                indices.size() * sizeof(uint32_t), indices.data());
+    }
+
+    return indices;
+}
+
+MeshManager::MemoryReport MeshManager::memoryReport() const
+{
+    MemoryReport report;
+    for (const auto &[id, namedMesh] : _meshes)
+    {
+        const size_t policy = static_cast<size_t>(namedMesh.componentData.residencyPolicy);
+        report.cpuBytes[policy] += namedMesh.componentData.cpuSize();
+        ++report.numMeshes[policy];
+    }
+
+#if ENGINE_FULL_FLOAT_VERTICES
+    report.gpuBytes = _vertexCapacity * (sizeof(Vertex) + sizeof(glm::vec3));
+#else
+    report.gpuBytes = _vertexCapacity * sizeof(CompactVertex);
+#endif
+    report.gpuBytes += _indexByteCapacity;
+
+    return report;
 }
 
 int MeshManager::bindMesh(MeshIdentifier id)
@@ -60,9 +514,11 @@ int MeshManager::bindMesh(MeshIdentifier id)
     const auto meshPtr = _meshes.find(id);
     if (meshPtr == _meshes.end())
         return -1;
-    auto &mesh = meshPtr->second.componentData;
 
-    mesh.bindMesh();
+    if (_sharedVertexArray == 0)
+        _sharedVertexArray = createVertexArray();
+
+    glBindVertexArray(_sharedVertexArray);
     _boundMesh = id;
     return 0;
 }
@@ -75,31 +531,246 @@ void MeshManager::unbindMesh()
 
 MeshIdentifier MeshManager::getDummyMesh() const { return _dummyMesh; }
 
-int MeshManager::bindMeshInstanced(MeshIdentifier id)
+void MeshManager::drawMesh(MeshIdentifier id) const
 {
-    if (_boundMesh != InvalidIdentifier)
-        return -1;
+    drawMeshInstanced(id, 1, 0);
+}
 
-    auto meshPtr = _meshes.find(id);
-    if (meshPtr == _meshes.end())
-        return -1;
+void MeshManager::drawMeshInstanced(MeshIdentifier id, GLsizei instanceCount,
+                                    GLuint baseInstance, size_t lod) const
+{
+    const Mesh *mesh = getMesh(id);
+    if (mesh == nullptr || !mesh->isAllocated())
+        return;
 
-    auto &mesh = meshPtr->second.componentData;
-    if (!mesh.instancingEnabled())
-        return -1;
+    setPositionDecoding(*mesh);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh->numIndices(lod),
+                                                  mesh->indexType(),
+                                                  (void *)(uintptr_t)mesh->indexByteOffset(lod),
+                                                  instanceCount, mesh->baseVertex(), baseInstance);
+}
 
-    mesh.bindMeshInstanced();
-    _boundMesh = id;
-    return 0;
+void MeshManager::drawMeshIndirect(MeshIdentifier id, size_t firstCommand,
+                                   GLsizei numCommands) const
+{
+    const Mesh *mesh = getMesh(id);
+    if (mesh == nullptr || !mesh->isAllocated() || numCommands == 0)
+        return;
+
+    setPositionDecoding(*mesh);
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, mesh->indexType(),
+        (void *)(uintptr_t)(firstCommand * sizeof(DrawElementsIndirectCommand)), numCommands, 0);
 }
 
-void MeshManager::enableMeshInstancing(MeshIdentifier id)
+void MeshManager::setPositionDecoding(const Mesh &mesh) const
 {
-    auto meshPtr = _meshes.find(id);
-    if (meshPtr == _meshes.end())
+    // the arrays of these are never enabled, so the current generic values are used
+    const glm::vec3 scale = mesh.positionScale();
+    const glm::vec3 offset = mesh.positionOffset();
+    glVertexAttrib3f(PositionScaleLocation, scale.x, scale.y, scale.z);
+    glVertexAttrib3f(PositionOffsetLocation, offset.x, offset.y, offset.z);
+}
+
+uint32_t MeshManager::createVertexArray()
+{
+    reserveArenas(_numArenaVertices, _numArenaIndexBytes); // makes sure the arenas exist
+
+    uint32_t vertexArray;
+    glCreateVertexArrays(1, &vertexArray);
+
+#if ENGINE_FULL_FLOAT_VERTICES
+    glVertexArrayAttribFormat(vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, coordinates));
+    glVertexArrayAttribFormat(vertexArray, 1, 2, GL_FLOAT, GL_FALSE,
+                              offsetof(Vertex, texCoordinates));
+    glVertexArrayAttribFormat(vertexArray, 2, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    glVertexArrayAttribFormat(vertexArray, 3, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(vertexArray, 3, TangentStreamBinding);
+#else
+    glVertexArrayAttribFormat(vertexArray, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                              offsetof(CompactVertex, position));
+    glVertexArrayAttribFormat(vertexArray, 1, 2, GL_HALF_FLOAT, GL_FALSE,
+                              offsetof(CompactVertex, texCoordinates));
+    glVertexArrayAttribFormat(vertexArray, 2, 2, GL_SHORT, GL_TRUE,
+                              offsetof(CompactVertex, normal));
+    glVertexArrayAttribFormat(vertexArray, 3, 4, GL_BYTE, GL_TRUE,
+                              offsetof(CompactVertex, tangent));
+    glVertexArrayAttribBinding(vertexArray, 3, VertexStreamBinding);
+#endif
+
+    glVertexArrayAttribBinding(vertexArray, 0, VertexStreamBinding);
+    glEnableVertexArrayAttrib(vertexArray, 0); // space coords
+    glVertexArrayAttribBinding(vertexArray, 1, VertexStreamBinding);
+    glEnableVertexArrayAttrib(vertexArray, 1); // texture coords
+    glVertexArrayAttribBinding(vertexArray, 2, VertexStreamBinding);
+    glEnableVertexArrayAttrib(vertexArray, 2); // normals
+    glEnableVertexArrayAttrib(vertexArray, 3); // tangent vectors
+
+    attachArenas(vertexArray);
+    _vertexArrays.emplace_back(vertexArray);
+
+    return vertexArray;
+}
+
+uint32_t MeshManager::createPositionVertexArray()
+{
+    reserveArenas(_numArenaVertices, _numArenaIndexBytes); // makes sure the arenas exist
+
+    uint32_t vertexArray;
+    glCreateVertexArrays(1, &vertexArray);
+
+#if ENGINE_FULL_FLOAT_VERTICES
+    glVertexArrayAttribFormat(vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, coordinates));
+#else
+    glVertexArrayAttribFormat(vertexArray, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                              offsetof(CompactVertex, position));
+#endif
+    glVertexArrayAttribBinding(vertexArray, 0, VertexStreamBinding);
+    glEnableVertexArrayAttrib(vertexArray, 0); // space coords
+
+    attachArenas(vertexArray);
+    _vertexArrays.emplace_back(vertexArray);
+
+    return vertexArray;
+}
+
+void MeshManager::releaseVertexArray(uint32_t vertexArray)
+{
+    const auto arrayPtr = std::ranges::find(_vertexArrays, vertexArray);
+    if (arrayPtr == _vertexArrays.end())
+        return;
+
+    _vertexArrays.erase(arrayPtr);
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+size_t MeshManager::placeInArena(std::vector<ArenaRange> &freeRanges, size_t arenaEnd,
+                                 size_t size, size_t alignment)
+{
+    const auto aligned = [alignment](size_t offset) {
+        return (offset + alignment - 1) / alignment * alignment;
+    };
+
+    if (size == 0)
+        return aligned(arenaEnd);
+
+    for (auto rangePtr = freeRanges.begin(); rangePtr != freeRanges.end(); ++rangePtr)
+    {
+        const size_t offset = aligned(rangePtr->offset);
+        const size_t rangeEnd = rangePtr->offset + rangePtr->size;
+        if (offset + size > rangeEnd)
+            continue;
+
+        // the alignment padding in front and the rest behind stay free
+        const ArenaRange front{ rangePtr->offset, offset - rangePtr->offset };
+        const ArenaRange back{ offset + size, rangeEnd - (offset + size) };
+        rangePtr = freeRanges.erase(rangePtr);
+        if (back.size > 0)
+            rangePtr = freeRanges.insert(rangePtr, back);
+        if (front.size > 0)
+            freeRanges.insert(rangePtr, front);
+        return offset;
+    }
+
+    return aligned(arenaEnd);
+}
+
+void MeshManager::returnToArena(std::vector<ArenaRange> &freeRanges, size_t &arenaEnd,
+                                ArenaRange range)
+{
+    if (range.size == 0)
         return;
 
-    meshPtr->second.componentData.enableInstancing();
+    auto rangePtr = std::ranges::lower_bound(freeRanges, range.offset, {}, &ArenaRange::offset);
+    if (rangePtr != freeRanges.end() && range.offset + range.size == rangePtr->offset)
+    {
+        range.size += rangePtr->size;
+        rangePtr = freeRanges.erase(rangePtr);
+    }
+    if (rangePtr != freeRanges.begin())
+    {
+        const auto previousPtr = std::prev(rangePtr);
+        if (previousPtr->offset + previousPtr->size == range.offset)
+        {
+            range.offset = previousPtr->offset;
+            range.size += previousPtr->size;
+            rangePtr = freeRanges.erase(previousPtr);
+        }
+    }
+
+    if (range.offset + range.size >= arenaEnd)
+        arenaEnd = range.offset;
+    else
+        freeRanges.insert(rangePtr, range);
+}
+
+size_t MeshManager::arenaIndexBytes(const Mesh &mesh)
+{
+    const size_t indexSize = mesh.arenaIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                                                      : sizeof(uint32_t);
+    size_t numIndices = 0;
+    for (size_t lod = 0; lod < mesh.numLods(); ++lod)
+        numIndices += mesh.numIndices(lod);
+    return numIndices * indexSize;
+}
+
+void MeshManager::reserveArenas(size_t numVertices, size_t numIndexBytes)
+{
+    const auto grownCapacity = [](size_t required, size_t capacity) {
+        return std::max({ required, capacity * 2, MinArenaCapacity });
+    };
+
+    // the old contents are copied over on the GPU
+    const auto reallocate = [](GLuint &buffer, size_t capacity, size_t used, size_t stride) {
+        GLuint newBuffer;
+        glCreateBuffers(1, &newBuffer);
+        glNamedBufferData(newBuffer, capacity * stride, nullptr, GL_STATIC_DRAW);
+        if (buffer != 0)
+        {
+            glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, used * stride);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = newBuffer;
+    };
+
+    bool arenasMoved = false;
+    if (_vertexArena == 0 || numVertices > _vertexCapacity)
+    {
+        _vertexCapacity = grownCapacity(numVertices, _vertexCapacity);
+#if ENGINE_FULL_FLOAT_VERTICES
+        reallocate(_vertexArena, _vertexCapacity, _numArenaVertices, sizeof(Vertex));
+        reallocate(_tangentArena, _vertexCapacity, _numArenaVertices, sizeof(glm::vec3));
+#else
+        reallocate(_vertexArena, _vertexCapacity, _numArenaVertices, sizeof(CompactVertex));
+#endif
+        arenasMoved = true;
+    }
+
+    if (_indexArena == 0 || numIndexBytes > _indexByteCapacity)
+    {
+        _indexByteCapacity = grownCapacity(numIndexBytes, _indexByteCapacity);
+        reallocate(_indexArena, _indexByteCapacity, _numArenaIndexBytes, 1);
+        arenasMoved = true;
+    }
+
+    if (!arenasMoved)
+        return;
+
+    for (const uint32_t vertexArray : _vertexArrays)
+        attachArenas(vertexArray);
+}
+
+void MeshManager::attachArenas(uint32_t vertexArray) const
+{
+#if ENGINE_FULL_FLOAT_VERTICES
+    glVertexArrayVertexBuffer(vertexArray, VertexStreamBinding, _vertexArena, 0, sizeof(Vertex));
+    glVertexArrayVertexBuffer(vertexArray, TangentStreamBinding, _tangentArena, 0,
+                              sizeof(glm::vec3));
+#else
+    glVertexArrayVertexBuffer(vertexArray, VertexStreamBinding, _vertexArena, 0,
+                              sizeof(CompactVertex));
+#endif
+    glVertexArrayElementBuffer(vertexArray, _indexArena);
 }
 
 void MeshManager::deallocateMesh(MeshIdentifier id)
@@ -108,13 +779,41 @@ void MeshManager::deallocateMesh(MeshIdentifier id)
     if (meshPtr == _meshes.end())
         return;
 
-    meshPtr->second.componentData.deallocateMesh();
+    // the range stays in the arenas; allocating the mesh again reuses it
+    meshPtr->second.componentData.allocated = false;
 }
 
 void MeshManager::cleanUpGracefully()
 {
     unbindMesh();
+
+    // the identifiers start over with the next run, and so would the cached meshes
+    for (const auto &[id, namedMesh] : _meshes)
+    {
+        if (!namedMesh.componentData.cpuResident)
+        {
+            std::error_code error;
+            std::filesystem::remove(cachedMeshPath(id), error);
+        }
+    }
     _meshes.clear();
+    _meshesByName.clear();
+    _meshesByContent.clear();
+    _numReferences.clear();
+
+    for (const uint32_t vertexArray : _vertexArrays)
+        glDeleteVertexArrays(1, &vertexArray);
+    _vertexArrays.clear();
+    _sharedVertexArray = 0;
+
+    glDeleteBuffers(1, &_vertexArena);
+    glDeleteBuffers(1, &_tangentArena);
+    glDeleteBuffers(1, &_indexArena);
+    _vertexArena = _tangentArena = _indexArena = 0;
+    _vertexCapacity = _indexByteCapacity = 0;
+    _numArenaVertices = _numArenaIndexBytes = 0;
+    _freeVertexRanges.clear();
+    _freeIndexRanges.clear();
 }
 
 const Mesh *MeshManager::getMesh(MeshIdentifier id) const
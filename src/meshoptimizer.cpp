@@ -0,0 +1,777 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+// FIFO post-transform cache, counting the misses
+struct FifoCache
+{
+    explicit FifoCache(size_t numVertices, size_t cacheSize)
+        : _cacheSize(cacheSize), _timestamps(numVertices, 0)
+    {
+    }
+
+    // returns whether the vertex had to be transformed
+    bool access(uint32_t vertex)
+    {
+        if (_timestamps[vertex] != 0 && _time - _timestamps[vertex] < _cacheSize)
+            return false;
+
+        _timestamps[vertex] = ++_time;
+        return true;
+    }
+
+    void reset() { _time += _cacheSize + 1; }
+
+private:
+    size_t _cacheSize = 0;
+    size_t _time = 0;
+    std::vector<size_t> _timestamps;
+};
+
+glm::vec3 positionOf(const Vertex &v)
+{
+    return glm::vec3(v.coordinates[0], v.coordinates[1], v.coordinates[2]);
+}
+
+// the sum of the squared distances to a set of weighted planes, as the symmetric 4x4 matrix of
+// Garland & Heckbert. The error is normalized by the total weight, i.e. it is a squared distance
+struct Quadric
+{
+    static Quadric fromPlane(const glm::dvec3 &normal, double distance, double weight)
+    {
+        Quadric q;
+        q.a2 = normal.x * normal.x * weight;
+        q.b2 = normal.y * normal.y * weight;
+        q.c2 = normal.z * normal.z * weight;
+        q.d2 = distance * distance * weight;
+        q.ab = normal.x * normal.y * weight;
+        q.ac = normal.x * normal.z * weight;
+        q.ad = normal.x * distance * weight;
+        q.bc = normal.y * normal.z * weight;
+        q.bd = normal.y * distance * weight;
+        q.cd = normal.z * distance * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+        a2 += other.a2;
+        b2 += other.b2;
+        c2 += other.c2;
+        d2 += other.d2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        bc += other.bc;
+        bd += other.bd;
+        cd += other.cd;
+        weight += other.weight;
+        return *this;
+    }
+
+    Quadric operator+(const Quadric &other) const { return Quadric(*this) += other; }
+
+    double error(const glm::dvec3 &p) const
+    {
+        const double e = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z + d2
+                         + 2.0 * (ab * p.x * p.y + ac * p.x * p.z + ad * p.x + bc * p.y * p.z
+                                  + bd * p.y + cd * p.z);
+        return weight > 0.0 ? std::abs(e) / weight : 0.0;
+    }
+
+    double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+    double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+    double weight = 0.0;
+};
+
+// how much the borders resist being pulled inwards, relative to the faces
+constexpr double BorderWeight = 10.0;
+
+enum class VertexKind : uint8_t
+{
+    Manifold, // collapses onto any neighbour
+    Border,   // on a single open border; collapses along it
+    Locked    // seams, border corners, non-manifold edges
+};
+
+// maps every vertex to the first vertex with the same position
+std::vector<uint32_t> weldPositions(const std::vector<Vertex> &vertices)
+{
+    std::vector<uint32_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&vertices](uint32_t l, uint32_t r) {
+        return std::lexicographical_compare(vertices[l].coordinates,
+                                            vertices[l].coordinates + 3,
+                                            vertices[r].coordinates,
+                                            vertices[r].coordinates + 3);
+    });
+
+    // the stable order puts the lowest index of every group first
+    std::vector<uint32_t> positionIds(vertices.size());
+    uint32_t groupLeader = 0;
+    for (size_t o = 0; o < order.size(); ++o)
+    {
+        const float *coordinates = vertices[order[o]].coordinates;
+        if (o == 0 || !std::equal(coordinates, coordinates + 3, vertices[groupLeader].coordinates))
+            groupLeader = order[o];
+
+        positionIds[order[o]] = groupLeader;
+    }
+
+    return positionIds;
+}
+
+uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+} // namespace
+
+namespace MeshOptimizer
+{
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices,
+                                         size_t numVertices, size_t cacheSize)
+{
+    if (indices.empty() || numVertices == 0)
+        return {};
+
+    FifoCache cache(numVertices, cacheSize);
+
+    size_t misses = 0;
+    std::vector<bool> referenced(numVertices, false);
+    for (const uint32_t index : indices)
+    {
+        misses += cache.access(index) ? 1 : 0;
+        referenced[index] = true;
+    }
+
+    const size_t numReferenced = std::ranges::count(referenced, true);
+    return VertexCacheStatistics{ static_cast<float>(misses) / (indices.size() / 3),
+                                  static_cast<float>(misses) / numReferenced };
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t numVertices,
+                         std::vector<uint32_t> &clusterStarts, size_t cacheSize)
+{
+    clusterStarts.clear();
+
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    // vertex -> adjacent triangles, in a compressed layout
+    std::vector<uint32_t> liveTriangles(numVertices, 0);
+    for (const uint32_t index : indices)
+        ++liveTriangles[index];
+
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    std::inclusive_scan(liveTriangles.cbegin(), liveTriangles.cend(),
+                        adjacencyOffsets.begin() + 1);
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.cbegin(), adjacencyOffsets.cend() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<size_t> cacheTimestamps(numVertices, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    size_t timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fanningVertex = 0;
+
+    const auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEndStack.empty())
+        {
+            const uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+
+        for (; cursor < numVertices; ++cursor)
+        {
+            if (liveTriangles[cursor] > 0)
+                return static_cast<int64_t>(cursor);
+        }
+
+        return -1;
+    };
+
+    clusterStarts.emplace_back(0);
+    while (fanningVertex >= 0)
+    {
+        candidates.clear();
+
+        // emits all the remaining triangles around the fanning vertex
+        for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1];
+             ++a)
+        {
+            const uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                output.emplace_back(vertex);
+                deadEndStack.emplace_back(vertex);
+                candidates.emplace_back(vertex);
+                --liveTriangles[vertex];
+
+                if (timestamp - cacheTimestamps[vertex] > cacheSize)
+                    cacheTimestamps[vertex] = timestamp++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // the next fanning vertex: the oldest candidate that will still be in the cache after
+        // its remaining triangles are emitted
+        int64_t nextVertex = -1;
+        int64_t bestPriority = -1;
+        for (const uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = static_cast<int64_t>(timestamp - cacheTimestamps[vertex]);
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        if (nextVertex == -1)
+        {
+            nextVertex = skipDeadEnd();
+            if (nextVertex >= 0 && output.size() / 3 > clusterStarts.back())
+                clusterStarts.emplace_back(static_cast<uint32_t>(output.size() / 3));
+        }
+
+        fanningVertex = nextVertex;
+    }
+
+    indices = std::move(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+                      const std::vector<uint32_t> &clusterStarts, float threshold,
+                      size_t cacheSize)
+{
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0 || clusterStarts.empty())
+        return;
+
+    // soft boundaries: a cluster is cut wherever its prefix is (almost) as cache efficient as
+    // the whole cluster, so the cut doesn't cost more than `threshold`
+    std::vector<uint32_t> clusters;
+    FifoCache cache(vertices.size(), cacheSize);
+    for (size_t c = 0; c < clusterStarts.size(); ++c)
+    {
+        const size_t start = clusterStarts[c];
+        const size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : numTriangles;
+
+        cache.reset();
+        size_t clusterMisses = 0;
+        for (size_t i = start * 3; i < end * 3; ++i)
+            clusterMisses += cache.access(indices[i]) ? 1 : 0;
+
+        const float maxAcmr = threshold * clusterMisses / (end - start);
+
+        clusters.emplace_back(static_cast<uint32_t>(start));
+        cache.reset();
+        size_t misses = 0;
+        for (size_t t = start; t < end; ++t)
+        {
+            for (size_t corner = 0; corner < 3; ++corner)
+                misses += cache.access(indices[t * 3 + corner]) ? 1 : 0;
+
+            const size_t clusterSize = t + 1 - clusters.back();
+            if (t + 1 < end && static_cast<float>(misses) <= maxAcmr * clusterSize)
+            {
+                clusters.emplace_back(static_cast<uint32_t>(t + 1));
+                cache.reset();
+                misses = 0;
+            }
+        }
+    }
+
+    // sort key: how much the cluster faces away from the mesh center
+    glm::vec3 meshCentroid = glm::vec3(0.0f);
+    for (const Vertex &v : vertices)
+        meshCentroid += positionOf(v);
+    meshCentroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+
+        glm::vec3 centroid = glm::vec3(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+        float area = 0.0f;
+        for (size_t t = start; t < end; ++t)
+        {
+            const glm::vec3 p0 = positionOf(vertices[indices[t * 3]]);
+            const glm::vec3 p1 = positionOf(vertices[indices[t * 3 + 1]]);
+            const glm::vec3 p2 = positionOf(vertices[indices[t * 3 + 2]]);
+
+            // area weighted
+            const glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            const float faceArea = glm::length(faceNormal);
+
+            centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+
+        if (area <= 0.0f || glm::dot(normal, normal) <= 0.0f)
+            continue; // degenerate, keeps the key 0
+
+        centroid /= area;
+        sortKeys[c] = glm::dot(centroid - meshCentroid, glm::normalize(normal));
+    }
+
+    std::vector<uint32_t> clusterOrder(clusters.size());
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::ranges::stable_sort(clusterOrder,
+                             [&sortKeys](uint32_t c1, uint32_t c2) {
+                                 return sortKeys[c1] > sortKeys[c2];
+                             });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const uint32_t c : clusterOrder)
+    {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+        output.insert(output.end(), indices.cbegin() + start * 3, indices.cbegin() + end * 3);
+    }
+
+    indices = std::move(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                         std::vector<glm::vec3> &tangents)
+{
+    constexpr uint32_t Unmapped = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), Unmapped);
+
+    std::vector<Vertex> newVertices;
+    std::vector<glm::vec3> newTangents;
+    newVertices.reserve(vertices.size());
+    newTangents.reserve(tangents.size());
+
+    const bool hasTangents = tangents.size() == vertices.size();
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == Unmapped)
+        {
+            remap[index] = static_cast<uint32_t>(newVertices.size());
+            newVertices.emplace_back(vertices[index]);
+            if (hasTangents)
+                newTangents.emplace_back(tangents[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(newVertices);
+    if (hasTangents)
+        tangents = std::move(newTangents);
+}
+
+float simplify(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+               size_t targetIndexCount, float maxError)
+{
+    const size_t numVertices = vertices.size();
+    if (indices.size() <= targetIndexCount || numVertices == 0)
+        return 0.0f;
+
+    // the positions relative to the bounding sphere, so that the error doesn't depend on the scale
+    glm::vec3 boundsMin = positionOf(vertices[0]);
+    glm::vec3 boundsMax = boundsMin;
+    for (const Vertex &v : vertices)
+    {
+        boundsMin = glm::min(boundsMin, positionOf(v));
+        boundsMax = glm::max(boundsMax, positionOf(v));
+    }
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    const float radius = std::max(glm::length(boundsMax - boundsMin) * 0.5f, 1e-6f);
+
+    std::vector<glm::dvec3> positions(numVertices);
+    for (size_t v = 0; v < numVertices; ++v)
+        positions[v] = glm::dvec3((positionOf(vertices[v]) - center) / radius);
+
+    // the seams split a position into several vertices; the topology is judged on the positions
+    const std::vector<uint32_t> positionIds = weldPositions(vertices);
+
+    std::vector<uint32_t> numWedges(numVertices, 0);
+    for (size_t v = 0; v < numVertices; ++v)
+        ++numWedges[positionIds[v]];
+
+    std::unordered_map<uint64_t, uint32_t> edgeFaces;
+    edgeFaces.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (size_t e = 0; e < 3; ++e)
+        {
+            ++edgeFaces[edgeKey(positionIds[indices[i + e]],
+                                positionIds[indices[i + (e + 1) % 3]])];
+        }
+    }
+
+    const auto isBorderEdge = [&edgeFaces](uint32_t a, uint32_t b) {
+        const auto edgePtr = edgeFaces.find(edgeKey(a, b));
+        return edgePtr != edgeFaces.end() && edgePtr->second == 1;
+    };
+
+    std::vector<uint32_t> numBorderEdges(numVertices, 0);
+    std::vector<bool> nonManifold(numVertices, false);
+    for (const auto &[key, numFaces] : edgeFaces)
+    {
+        const uint32_t a = static_cast<uint32_t>(key >> 32);
+        const uint32_t b = static_cast<uint32_t>(key & 0xffffffffu);
+        if (numFaces == 1)
+        {
+            ++numBorderEdges[a];
+            ++numBorderEdges[b];
+        }
+        else if (numFaces > 2)
+        {
+            nonManifold[a] = nonManifold[b] = true;
+        }
+    }
+
+    std::vector<VertexKind> kinds(numVertices, VertexKind::Locked);
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        const uint32_t p = positionIds[v];
+        if (numWedges[p] > 1 || nonManifold[p])
+            kinds[v] = VertexKind::Locked;
+        else if (numBorderEdges[p] == 0)
+            kinds[v] = VertexKind::Manifold;
+        else if (numBorderEdges[p] == 2)
+            kinds[v] = VertexKind::Border;
+    }
+
+    // the face planes weighted by the area, plus planes perpendicular to the open borders
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::dvec3 &p0 = positions[indices[i + 0]];
+        const glm::dvec3 &p1 = positions[indices[i + 1]];
+        const glm::dvec3 &p2 = positions[indices[i + 2]];
+        const glm::dvec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+        const double doubleArea = glm::length(faceNormal);
+        if (doubleArea <= 0.0)
+            continue;
+
+        const glm::dvec3 normal = faceNormal / doubleArea;
+        const Quadric face = Quadric::fromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+        for (size_t c = 0; c < 3; ++c)
+            quadrics[positionIds[indices[i + c]]] += face;
+
+        for (size_t e = 0; e < 3; ++e)
+        {
+            const uint32_t a = positionIds[indices[i + e]];
+            const uint32_t b = positionIds[indices[i + (e + 1) % 3]];
+            if (!isBorderEdge(a, b))
+                continue;
+
+            const glm::dvec3 edge = positions[b] - positions[a];
+            const double edgeLength = glm::length(edge);
+            if (edgeLength <= 0.0)
+                continue;
+
+            const glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+            const Quadric border = Quadric::fromPlane(borderNormal,
+                                                      -glm::dot(borderNormal, positions[a]),
+                                                      edgeLength * edgeLength * BorderWeight);
+            quadrics[a] += border;
+            quadrics[b] += border;
+        }
+    }
+
+    const auto canCollapse = [&](uint32_t from, uint32_t to) {
+        switch (kinds[from])
+        {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+            return kinds[to] != VertexKind::Manifold
+                   && isBorderEdge(positionIds[from], positionIds[to]);
+        default:
+            return false;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from = 0;
+        uint32_t to = 0;
+        double error = 0.0;
+    };
+
+    const double maxSquaredError = static_cast<double>(maxError) * maxError;
+    double reachedError = 0.0;
+
+    std::vector<uint32_t> collapseTargets(numVertices);
+    std::vector<bool> collapsedThisPass(numVertices);
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    // every pass collapses a set of independent edges, cheapest first, then rebuilds the indices
+    while (indices.size() > targetIndexCount)
+    {
+        // the triangles around every vertex
+        std::ranges::fill(adjacencyOffsets, 0);
+        for (const uint32_t index : indices)
+            ++adjacencyOffsets[index + 1];
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(),
+                         adjacencyOffsets.begin());
+        adjacency.resize(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (size_t e = 0; e < 3; ++e)
+            {
+                const uint32_t a = indices[i + e];
+                const uint32_t b = indices[i + (e + 1) % 3];
+                const Quadric merged = quadrics[positionIds[a]] + quadrics[positionIds[b]];
+
+                // the cheaper of the two directions
+                Collapse best{ a, b, std::numeric_limits<double>::max() };
+                if (canCollapse(a, b))
+                    best.error = merged.error(positions[b]);
+                if (canCollapse(b, a) && merged.error(positions[a]) < best.error)
+                    best = Collapse{ b, a, merged.error(positions[a]) };
+
+                if (best.error <= maxSquaredError)
+                    collapses.emplace_back(best);
+            }
+        }
+
+        if (collapses.empty())
+            break;
+
+        std::ranges::sort(collapses, {}, &Collapse::error);
+
+        std::iota(collapseTargets.begin(), collapseTargets.end(), 0);
+        std::fill(collapsedThisPass.begin(), collapsedThisPass.end(), false);
+
+        // a collapse removes two triangles, or one on a border
+        const size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        for (const Collapse &c : collapses)
+        {
+            if (trianglesRemoved >= trianglesToRemove)
+                break;
+
+            if (collapsedThisPass[positionIds[c.from]] || collapsedThisPass[positionIds[c.to]])
+                continue;
+
+            // none of the remaining triangles around the vertex may flip (or become a sliver
+            // between the wedges of a seam)
+            bool flips = false;
+            for (uint32_t t = adjacencyOffsets[c.from]; t < adjacencyOffsets[c.from + 1]; ++t)
+            {
+                const size_t triangle = adjacency[t] * 3;
+                std::array<uint32_t, 3> corners;
+                for (size_t k = 0; k < 3; ++k)
+                    corners[k] = collapseTargets[indices[triangle + k]];
+
+                if (std::ranges::find(corners, c.to) != corners.end())
+                    continue; // degenerates, i.e. is removed
+
+                const glm::dvec3 before = glm::cross(positions[corners[1]] - positions[corners[0]],
+                                                     positions[corners[2]] - positions[corners[0]]);
+                std::ranges::replace(corners, c.from, c.to);
+                const glm::dvec3 after = glm::cross(positions[corners[1]] - positions[corners[0]],
+                                                    positions[corners[2]] - positions[corners[0]]);
+                if (glm::dot(before, after) <= 0.0)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+                continue;
+
+            collapseTargets[c.from] = c.to;
+            quadrics[positionIds[c.to]] += quadrics[positionIds[c.from]];
+            collapsedThisPass[positionIds[c.from]] = collapsedThisPass[positionIds[c.to]] = true;
+            reachedError = std::max(reachedError, c.error);
+            trianglesRemoved += kinds[c.from] == VertexKind::Border ? 1 : 2;
+        }
+
+        if (trianglesRemoved == 0)
+            break;
+
+        size_t numKept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const uint32_t a = collapseTargets[indices[i + 0]];
+            const uint32_t b = collapseTargets[indices[i + 1]];
+            const uint32_t c = collapseTargets[indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+
+            indices[numKept++] = a;
+            indices[numKept++] = b;
+            indices[numKept++] = c;
+        }
+        indices.resize(numKept);
+    }
+
+    return static_cast<float>(std::sqrt(reachedError));
+}
+
+std::vector<MeshLod> generateLodChain(const std::vector<uint32_t> &indices,
+                                     const std::vector<Vertex> &vertices, size_t maxLods,
+                                     float maxError)
+{
+    // below this the draw calls cost more than the triangles
+    constexpr size_t MinLodTriangles = 64;
+
+    std::vector<MeshLod> lods;
+    size_t previousNumIndices = indices.size();
+    for (size_t level = 1; level <= maxLods; ++level)
+    {
+        const size_t targetNumTriangles = (indices.size() / 3) >> level;
+        if (targetNumTriangles < MinLodTriangles)
+            break;
+
+        MeshLod lod{ indices, 0.0f };
+        lod.error = simplify(lod.indices, vertices, targetNumTriangles * 3, maxError);
+
+        // the locked seams and borders (or the error bound) stopped the simplification
+        if (lod.indices.size() * 4 > previousNumIndices * 3)
+            break;
+
+        std::vector<uint32_t> clusterStarts;
+        optimizeVertexCache(lod.indices, vertices.size(), clusterStarts);
+
+        if (!lods.empty())
+            lod.error = std::max(lod.error, lods.back().error);
+
+        previousNumIndices = lod.indices.size();
+        lods.emplace_back(std::move(lod));
+    }
+
+    return lods;
+}
+
+std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t> &indices,
+                                   const std::vector<Vertex> &vertices)
+{
+    std::vector<Meshlet> meshlets;
+
+    const auto finishMeshlet = [&indices, &vertices](Meshlet &meshlet) {
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.numIndices; ++i)
+        {
+            boundsMin = glm::min(boundsMin, positionOf(vertices[indices[i]]));
+            boundsMax = glm::max(boundsMax, positionOf(vertices[indices[i]]));
+        }
+
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.numIndices; ++i)
+        {
+            meshlet.radius = std::max(meshlet.radius, glm::length(positionOf(vertices[indices[i]])
+                                                                  - meshlet.center));
+        }
+
+        std::vector<glm::vec3> normals;
+        glm::vec3 normalSum = glm::vec3(0.0f);
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.numIndices; i += 3)
+        {
+            const glm::vec3 p0 = positionOf(vertices[indices[i + 0]]);
+            const glm::vec3 normal = glm::cross(positionOf(vertices[indices[i + 1]]) - p0,
+                                                positionOf(vertices[indices[i + 2]]) - p0);
+            if (const float area = glm::length(normal); area > 0.0f)
+            {
+                normals.emplace_back(normal / area);
+                normalSum += normals.back();
+            }
+        }
+
+        if (normals.empty() || glm::length(normalSum) <= 0.0f)
+            return;
+
+        const glm::vec3 axis = glm::normalize(normalSum);
+        float minDot = 1.0f;
+        for (const glm::vec3 &normal : normals)
+            minDot = std::min(minDot, glm::dot(axis, normal));
+
+        // a cone of 90 degrees or more can't be back-facing as a whole
+        if (minDot <= 0.0f)
+            return;
+
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    };
+
+    std::vector<uint32_t> meshletOfVertex(vertices.size(), std::numeric_limits<uint32_t>::max());
+    size_t numMeshletVertices = 0;
+    for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        size_t numNewVertices = 0;
+        for (size_t c = 0; c < 3; ++c)
+            numNewVertices += meshletOfVertex[indices[i + c]] != meshlets.size() - 1 ? 1 : 0;
+
+        if (meshlets.empty() || numMeshletVertices + numNewVertices > MaxMeshletVertices
+            || meshlets.back().numIndices == MaxMeshletTriangles * 3)
+        {
+            if (!meshlets.empty())
+                finishMeshlet(meshlets.back());
+
+            meshlets.emplace_back().firstIndex = i;
+            numMeshletVertices = 0;
+        }
+
+        for (size_t c = 0; c < 3; ++c)
+        {
+            if (meshletOfVertex[indices[i + c]] != meshlets.size() - 1)
+            {
+                meshletOfVertex[indices[i + c]] = static_cast<uint32_t>(meshlets.size() - 1);
+                ++numMeshletVertices;
+            }
+        }
+        meshlets.back().numIndices += 3;
+    }
+
+    if (!meshlets.empty())
+        finishMeshlet(meshlets.back());
+
+    return meshlets;
+}
+} // namespace MeshOptimizer
@@ -0,0 +1,429 @@
+#include "mipchain.h"
+
+#include "threadpool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPCHAIN_SSE 1
+#else
+#define MIPCHAIN_SSE 0
+#endif
+
+namespace
+{
+using MipChain::Filter;
+
+// about this many texels per job of a level
+constexpr size_t TexelsPerBand = 64 * 1024;
+
+// the sRGB transfer functions, exactly: the decoding by table, the encoding by searching the
+// table of the values halfway between the codes
+struct SrgbTables
+{
+    SrgbTables()
+    {
+        const auto toLinear = [](float value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        };
+        for (size_t code = 0; code < 256; ++code)
+        {
+            linear[code] = toLinear(code / 255.0f);
+            if (code < 255)
+                boundaries[code] = toLinear((code + 0.5f) / 255.0f);
+        }
+    }
+
+    uint8_t encode(float value) const
+    {
+        return static_cast<uint8_t>(std::ranges::upper_bound(boundaries, value)
+                                    - boundaries.begin());
+    }
+
+    std::array<float, 256> linear;
+    std::array<float, 255> boundaries;
+};
+
+const SrgbTables &srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+// the weighted sum of RGBA texels, the four channels at once
+class Accumulator
+{
+public:
+#if MIPCHAIN_SSE
+    void add(const float *texel, float weight)
+    {
+        _sum = _mm_add_ps(_sum, _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(weight)));
+    }
+
+    void store(float *texel) const { _mm_storeu_ps(texel, _sum); }
+
+private:
+    __m128 _sum = _mm_setzero_ps();
+#else
+    void add(const float *texel, float weight)
+    {
+        for (size_t c = 0; c < 4; ++c)
+            _sum[c] += texel[c] * weight;
+    }
+
+    void store(float *texel) const { std::ranges::copy(_sum, texel); }
+
+private:
+    std::array<float, 4> _sum = {};
+#endif
+};
+
+// the source texels a destination texel i is filtered from: first + 2i onwards
+struct Kernel
+{
+    int first = 0;
+    int numTaps = 1;
+    std::array<float, 6> weights = { 1.0f };
+};
+
+float besselI0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 16; ++k)
+    {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+Kernel kernelFor(Filter filter, uint32_t sourceSize)
+{
+    // a single texel has nothing to be filtered with
+    if (sourceSize == 1)
+        return Kernel{};
+
+    if (filter == Filter::Box)
+        return Kernel{ 0, 2, { 0.5f, 0.5f } };
+
+    // the sinc cut off at the destination's Nyquist frequency, windowed over 1.5 destination
+    // texels each side; the taps sit at a quarter, three quarters and five quarters of a
+    // destination texel from its centre
+    constexpr float Radius = 1.5f, Alpha = 4.0f;
+    Kernel kernel{ -2, 6, {} };
+    float sum = 0.0f;
+    for (int tap = 0; tap < kernel.numTaps; ++tap)
+    {
+        const float x = (tap + kernel.first - 0.5f) / 2.0f;
+        const float sinc = std::sin(std::numbers::pi_v<float> * x)
+                           / (std::numbers::pi_v<float> * x);
+        const float t = x / Radius;
+        const float window = besselI0(Alpha * std::sqrt(1.0f - t * t)) / besselI0(Alpha);
+        kernel.weights[tap] = sinc * window;
+        sum += kernel.weights[tap];
+    }
+    for (float &weight : kernel.weights)
+        weight /= sum;
+    return kernel;
+}
+
+// the level being filtered from: the image itself (8 bits, decoded row by row) or a level
+// already filtered (floats)
+struct Source
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const uint8_t *encoded = nullptr;
+    const float *decoded = nullptr;
+    const MipChain::Settings *settings = nullptr;
+
+    const float *row(uint32_t y, std::vector<float> &scratch) const
+    {
+        if (decoded != nullptr)
+            return decoded + static_cast<size_t>(y) * width * 4;
+
+        scratch.resize(static_cast<size_t>(width) * 4);
+        const uint8_t *texels = encoded + static_cast<size_t>(y) * width * 4;
+        const SrgbTables &tables = srgbTables();
+        for (size_t c = 0; c < scratch.size(); ++c)
+        {
+            if (c % 4 == 3)
+                scratch[c] = texels[c] / 255.0f;
+            else if (settings->normalMap)
+                scratch[c] = texels[c] / 127.5f - 1.0f;
+            else if (settings->srgb)
+                scratch[c] = tables.linear[texels[c]];
+            else
+                scratch[c] = texels[c] / 255.0f;
+        }
+        return scratch.data();
+    }
+};
+
+void renormalize(float *texel)
+{
+    const float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1]
+                                   + texel[2] * texel[2]);
+    if (length > 1e-6f)
+    {
+        for (size_t c = 0; c < 3; ++c)
+            texel[c] /= length;
+    }
+    else
+    {
+        texel[0] = texel[1] = 0.0f;
+        texel[2] = 1.0f;
+    }
+}
+
+// the rows [firstRow, lastRow) of the next level: the source rows they need filtered
+// horizontally first, then those vertically
+void filterBand(const Source &source, const Kernel &horizontal, const Kernel &vertical,
+                uint32_t width, uint32_t firstRow, uint32_t lastRow, float *level)
+{
+    const auto sourceRow = [&source](int row) {
+        return static_cast<uint32_t>(std::clamp(row, 0, static_cast<int>(source.height) - 1));
+    };
+    const uint32_t firstSourceRow = sourceRow(2 * static_cast<int>(firstRow) + vertical.first);
+    const uint32_t lastSourceRow = sourceRow(2 * static_cast<int>(lastRow - 1) + vertical.first
+                                             + vertical.numTaps - 1);
+
+    std::vector<float> filtered(static_cast<size_t>(lastSourceRow - firstSourceRow + 1) * width
+                                * 4);
+    std::vector<float> scratch;
+    for (uint32_t y = firstSourceRow; y <= lastSourceRow; ++y)
+    {
+        const float *row = source.row(y, scratch);
+        float *filteredRow = &filtered[static_cast<size_t>(y - firstSourceRow) * width * 4];
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            Accumulator sum;
+            for (int tap = 0; tap < horizontal.numTaps; ++tap)
+            {
+                const int column = std::clamp(2 * static_cast<int>(x) + horizontal.first + tap, 0,
+                                              static_cast<int>(source.width) - 1);
+                sum.add(row + static_cast<size_t>(column) * 4, horizontal.weights[tap]);
+            }
+            sum.store(filteredRow + static_cast<size_t>(x) * 4);
+        }
+    }
+
+    for (uint32_t y = firstRow; y < lastRow; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            Accumulator sum;
+            for (int tap = 0; tap < vertical.numTaps; ++tap)
+            {
+                const uint32_t row = sourceRow(2 * static_cast<int>(y) + vertical.first + tap);
+                sum.add(&filtered[(static_cast<size_t>(row - firstSourceRow) * width + x) * 4],
+                        vertical.weights[tap]);
+            }
+            sum.store(level + (static_cast<size_t>(y) * width + x) * 4);
+        }
+    }
+}
+
+// the share of the texels passing the alpha test once scaled and stored in 8 bits
+float alphaCoverage(const std::vector<float> &texels, float cutoff, float scale)
+{
+    size_t numCovered = 0;
+    for (size_t t = 3; t < texels.size(); t += 4)
+        numCovered += std::lround(std::min(texels[t] * scale, 1.0f) * 255.0f) / 255.0f >= cutoff;
+    return static_cast<float>(numCovered) / (texels.size() / 4);
+}
+
+// the scale that brings the level's coverage the closest to the full size's; the coverage only
+// grows with the scale, in steps
+float coverageScale(const std::vector<float> &texels, float cutoff, float targetCoverage)
+{
+    float lowest = 0.0f, highest = 16.0f;
+    for (int step = 0; step < 16; ++step)
+    {
+        const float scale = (lowest + highest) / 2.0f;
+        if (alphaCoverage(texels, cutoff, scale) < targetCoverage)
+            lowest = scale;
+        else
+            highest = scale;
+    }
+    return targetCoverage - alphaCoverage(texels, cutoff, lowest)
+                   < alphaCoverage(texels, cutoff, highest) - targetCoverage
+               ? lowest
+               : highest;
+}
+
+// spreads the rows over the loader threads, in bands of about TexelsPerBand texels
+template <typename BandJob>
+void forEachBand(uint32_t width, uint32_t height, const BandJob &job)
+{
+    const uint32_t rowsPerBand = std::max<uint32_t>(static_cast<uint32_t>(TexelsPerBand / width),
+                                                    1);
+    const uint32_t numBands = (height + rowsPerBand - 1) / rowsPerBand;
+    ThreadPool::loaders().parallelFor(numBands, [&](size_t band) {
+        const uint32_t firstRow = static_cast<uint32_t>(band) * rowsPerBand;
+        job(firstRow, std::min(firstRow + rowsPerBand, height));
+    });
+}
+} // namespace
+
+namespace MipChain
+{
+uint32_t numLevels(uint32_t width, uint32_t height, uint32_t depth)
+{
+    uint32_t levels = 1;
+    for (; width > 1 || height > 1 || depth > 1; ++levels)
+    {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        depth = std::max(depth / 2, 1u);
+    }
+    return levels;
+}
+
+std::vector<std::vector<uint8_t>> generate(std::vector<uint8_t> &&rgba, uint32_t width,
+                                           uint32_t height, const Settings &settings)
+{
+    const SrgbTables &tables = srgbTables();
+
+    std::vector<std::vector<uint8_t>> levels;
+    levels.reserve(numLevels(width, height));
+    levels.emplace_back(std::move(rgba));
+
+    float targetCoverage = 0.0f;
+    if (settings.alphaCutoff > 0.0f)
+    {
+        const std::vector<uint8_t> &image = levels.front();
+        size_t numCovered = 0;
+        for (size_t t = 3; t < image.size(); t += 4)
+            numCovered += image[t] / 255.0f >= settings.alphaCutoff;
+        targetCoverage = static_cast<float>(numCovered) / (image.size() / 4);
+    }
+
+    Source source{ width, height, levels.front().data(), nullptr, &settings };
+    std::vector<float> previousLevel;
+    while (source.width > 1 || source.height > 1)
+    {
+        const uint32_t levelWidth = std::max(source.width / 2, 1u);
+        const uint32_t levelHeight = std::max(source.height / 2, 1u);
+        const Kernel horizontal = kernelFor(settings.filter, source.width);
+        const Kernel vertical = kernelFor(settings.filter, source.height);
+
+        std::vector<float> level(static_cast<size_t>(levelWidth) * levelHeight * 4);
+        forEachBand(levelWidth, levelHeight, [&](uint32_t firstRow, uint32_t lastRow) {
+            filterBand(source, horizontal, vertical, levelWidth, firstRow, lastRow, level.data());
+            if (settings.normalMap)
+            {
+                for (size_t t = static_cast<size_t>(firstRow) * levelWidth;
+                     t < static_cast<size_t>(lastRow) * levelWidth; ++t)
+                {
+                    renormalize(&level[t * 4]);
+                }
+            }
+        });
+
+        // the next level is filtered from the unscaled alpha
+        const float alphaScale = settings.alphaCutoff > 0.0f
+                                     ? coverageScale(level, settings.alphaCutoff, targetCoverage)
+                                     : 1.0f;
+
+        std::vector<uint8_t> &encoded = levels.emplace_back(level.size());
+        forEachBand(levelWidth, levelHeight, [&](uint32_t firstRow, uint32_t lastRow) {
+            const auto toByte = [](float value) {
+                return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+            };
+            for (size_t c = static_cast<size_t>(firstRow) * levelWidth * 4;
+                 c < static_cast<size_t>(lastRow) * levelWidth * 4; ++c)
+            {
+                if (c % 4 == 3)
+                    encoded[c] = toByte(level[c] * alphaScale);
+                else if (settings.normalMap)
+                    encoded[c] = toByte(level[c] * 0.5f + 0.5f);
+                else if (settings.srgb)
+                    encoded[c] = tables.encode(level[c]);
+                else
+                    encoded[c] = toByte(level[c]);
+            }
+        });
+
+        previousLevel = std::move(level);
+        source = Source{ levelWidth, levelHeight, nullptr, previousLevel.data(), &settings };
+    }
+
+    return levels;
+}
+
+std::vector<std::vector<uint8_t>> generateVolume(std::vector<uint8_t> &&texels, uint32_t width,
+                                                 uint32_t height, uint32_t depth,
+                                                 uint32_t numChannels, bool srgb)
+{
+    const SrgbTables &tables = srgbTables();
+    const uint32_t numColorChannels = srgb ? std::min(numChannels, 3u) : 0;
+
+    std::vector<std::vector<uint8_t>> levels;
+    levels.reserve(numLevels(width, height, depth));
+    levels.emplace_back(std::move(texels));
+
+    while (width > 1 || height > 1 || depth > 1)
+    {
+        const uint32_t levelWidth = std::max(width / 2, 1u);
+        const uint32_t levelHeight = std::max(height / 2, 1u);
+        const uint32_t levelDepth = std::max(depth / 2, 1u);
+
+        const std::vector<uint8_t> &source = levels.back();
+        std::vector<uint8_t> level(static_cast<size_t>(levelWidth) * levelHeight * levelDepth
+                                   * numChannels);
+        ThreadPool::loaders().parallelFor(levelDepth, [&](size_t z) {
+            // the 2x2x2 texels above, fewer along the sides of a single texel
+            const std::array<size_t, 2> slices = { std::min<size_t>(2 * z, depth - 1),
+                                                   std::min<size_t>(2 * z + 1, depth - 1) };
+            for (size_t y = 0; y < levelHeight; ++y)
+            {
+                const std::array<size_t, 2> rows = { std::min<size_t>(2 * y, height - 1),
+                                                     std::min<size_t>(2 * y + 1, height - 1) };
+                for (size_t x = 0; x < levelWidth; ++x)
+                {
+                    const std::array<size_t, 2> columns = { std::min<size_t>(2 * x, width - 1),
+                                                            std::min<size_t>(2 * x + 1,
+                                                                             width - 1) };
+                    for (size_t c = 0; c < numChannels; ++c)
+                    {
+                        float sum = 0.0f;
+                        for (const size_t slice : slices)
+                        {
+                            for (const size_t row : rows)
+                            {
+                                for (const size_t column : columns)
+                                {
+                                    const uint8_t value = source[((slice * height + row) * width
+                                                                  + column)
+                                                                     * numChannels
+                                                                 + c];
+                                    sum += c < numColorChannels ? tables.linear[value]
+                                                                : value / 255.0f;
+                                }
+                            }
+                        }
+
+                        const float average = sum / 8.0f;
+                        level[((z * levelHeight + y) * levelWidth + x) * numChannels + c]
+                            = c < numColorChannels
+                                  ? tables.encode(average)
+                                  : static_cast<uint8_t>(std::lround(average * 255.0f));
+                    }
+                }
+            }
+        });
+
+        levels.emplace_back(std::move(level));
+        width = levelWidth;
+        height = levelHeight;
+        depth = levelDepth;
+    }
+
+    return levels;
+}
+} // namespace MipChain
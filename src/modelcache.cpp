@@ -0,0 +1,353 @@
+#include "modelcache.h"
+
+#include "blobfile.h"
+#include "mappedfile.h"
+#include "meshcodec.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+
+namespace
+{
+constexpr std::array<char, 4> Magic = { 'O', 'M', 'D', 'L' };
+
+// what tells a dependency changed without reading it
+struct FileStamp
+{
+    uint64_t size = 0;
+    int64_t writeTime = 0;
+
+    bool operator==(const FileStamp &other) const = default;
+};
+
+std::optional<FileStamp> stampOf(const std::filesystem::path &path)
+{
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+        return std::nullopt;
+
+    const auto writeTime = std::filesystem::last_write_time(path, error);
+    if (error)
+        return std::nullopt;
+
+    return FileStamp{ size, static_cast<int64_t>(writeTime.time_since_epoch().count()) };
+}
+
+// the vertex streams and the triangle lists go through the mesh codec
+template <typename T>
+void writeVertices(BlobWriter &writer, const std::vector<T> &vertices)
+{
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % sizeof(uint32_t) == 0);
+    writer.write(static_cast<uint32_t>(vertices.size()));
+    writer.writeArray(MeshCodec::encodeVertices(vertices.data(), vertices.size(), sizeof(T)));
+}
+
+void writeIndices(BlobWriter &writer, const std::vector<uint32_t> &indices)
+{
+    const bool triangles = indices.size() % 3 == 0;
+    writer.write(static_cast<uint8_t>(triangles));
+    if (triangles)
+    {
+        writer.write(static_cast<uint32_t>(indices.size()));
+        writer.writeArray(MeshCodec::encodeIndices(indices.data(), indices.size()));
+    }
+    else
+    {
+        writer.writeArray(indices);
+    }
+}
+
+template <typename T>
+bool readVertices(BlobReader &reader, std::vector<T> &vertices)
+{
+    uint32_t numVertices = 0, size = 0;
+    const std::byte *encoded = nullptr;
+    if (!reader.read(numVertices) || (encoded = reader.readArray(size)) == nullptr)
+        return false;
+
+    // every block of vertices takes at least a header per plane; don't trust a damaged count
+    constexpr size_t MinBlockSize = sizeof(T) * 4;
+    if (numVertices > (size / MinBlockSize + 1) * 256)
+        return false;
+
+    vertices.resize(numVertices);
+    return MeshCodec::decodeVertices(vertices.data(), numVertices, sizeof(T),
+                                     reinterpret_cast<const uint8_t *>(encoded), size);
+}
+
+bool readIndices(BlobReader &reader, std::vector<uint32_t> &indices)
+{
+    uint8_t triangles = 0;
+    if (!reader.read(triangles))
+        return false;
+    if (!triangles)
+        return reader.readArray(indices);
+
+    uint32_t numIndices = 0, size = 0;
+    const std::byte *encoded = nullptr;
+    if (!reader.read(numIndices) || (encoded = reader.readArray(size)) == nullptr)
+        return false;
+
+    // a triangle takes at least a byte
+    if (numIndices / 3 > size)
+        return false;
+
+    indices.resize(numIndices);
+    return MeshCodec::decodeIndices(indices.data(), numIndices,
+                                    reinterpret_cast<const uint8_t *>(encoded), size);
+}
+
+bool readMesh(BlobReader &reader, BakedModel::MeshData &mesh)
+{
+    uint32_t numLods = 0;
+    if (!reader.readString(mesh.name) || !reader.read(mesh.material)
+        || !readVertices(reader, mesh.vertices) || !readIndices(reader, mesh.indices)
+        || !readVertices(reader, mesh.tangents) || !reader.read(numLods))
+    {
+        return false;
+    }
+
+    mesh.lods.resize(numLods);
+    for (MeshLod &lod : mesh.lods)
+    {
+        if (!reader.read(lod.error) || !readIndices(reader, lod.indices))
+            return false;
+    }
+
+    return reader.readArray(mesh.meshlets);
+}
+
+// the references between the parts have to hold before anything gets instantiated
+bool isConsistent(const BakedModel &model)
+{
+    if (model.nodes.empty())
+        return false;
+
+    const auto meshIsValid = [&model](const BakedModel::MeshData &mesh) {
+        const auto indexIsValid = [&mesh](uint32_t index) { return index < mesh.vertices.size(); };
+        return mesh.material < model.materials.size()
+               && std::ranges::all_of(mesh.indices, indexIsValid)
+               && std::ranges::all_of(mesh.lods, [&indexIsValid](const MeshLod &lod) {
+                      return std::ranges::all_of(lod.indices, indexIsValid);
+                  });
+    };
+    if (!std::ranges::all_of(model.meshes, meshIsValid))
+        return false;
+
+    for (uint32_t node = 0; node < model.nodes.size(); ++node)
+    {
+        const BakedModel::Node &bakedNode = model.nodes[node];
+        if (!std::ranges::all_of(bakedNode.meshes, [&model](uint32_t mesh) {
+                return mesh < model.meshes.size();
+            }))
+        {
+            return false;
+        }
+
+        // children after their parent keep the hierarchy free of cycles
+        if (!std::ranges::all_of(bakedNode.children, [&model, node](uint32_t child) {
+                return child > node && child < model.nodes.size();
+            }))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+namespace ModelCache
+{
+uint64_t sourceKey(const std::filesystem::path &source, uint64_t settings)
+{
+    const MappedFile file(source);
+    if (!file.isOpen())
+        return 0;
+
+    uint64_t hash = Utilities::hashBytes(file.data(), file.size());
+    hash = Utilities::hashCombine(hash, settings);
+    hash = Utilities::hashCombine(hash, Version);
+    return hash != 0 ? hash : 1;
+}
+
+std::filesystem::path cachePath(const std::filesystem::path &source)
+{
+    std::error_code error;
+    const std::string sourcePath = std::filesystem::absolute(source, error).generic_string();
+    const uint64_t pathHash = Utilities::hashBytes(
+        reinterpret_cast<const std::byte *>(sourcePath.data()), sourcePath.size());
+
+    std::ostringstream fileName;
+    fileName << source.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0')
+             << pathHash << ".model";
+    return std::filesystem::path(ENGINE_CACHE) / "models" / fileName.str();
+}
+
+std::optional<BakedModel> load(const std::filesystem::path &cacheFile, uint64_t key)
+{
+    if (key == 0)
+        return std::nullopt;
+
+    const MappedFile file(cacheFile);
+    if (!file.isOpen())
+        return std::nullopt;
+
+    BlobReader reader(file.data(), file.size());
+
+    std::array<char, 4> magic = {};
+    uint32_t version = 0, vertexSize = 0, meshletSize = 0;
+    uint64_t fileKey = 0;
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(vertexSize)
+        || !reader.read(meshletSize) || !reader.read(fileKey))
+    {
+        return std::nullopt;
+    }
+
+    if (magic != Magic || version != Version || vertexSize != sizeof(Vertex)
+        || meshletSize != sizeof(Meshlet) || fileKey != key)
+    {
+        return std::nullopt;
+    }
+
+    uint32_t numDependencies = 0;
+    if (!reader.read(numDependencies))
+        return std::nullopt;
+
+    for (uint32_t d = 0; d < numDependencies; ++d)
+    {
+        std::string path;
+        FileStamp stamp;
+        if (!reader.readString(path) || !reader.read(stamp.size) || !reader.read(stamp.writeTime))
+            return std::nullopt;
+
+        if (stampOf(path) != stamp)
+            return std::nullopt;
+    }
+
+    BakedModel model;
+
+    uint32_t numMaterials = 0;
+    if (!reader.read(numMaterials))
+        return std::nullopt;
+
+    model.materials.resize(numMaterials);
+    for (BakedModel::Material &material : model.materials)
+    {
+        uint32_t numTextures = 0;
+        if (!reader.read(numTextures))
+            return std::nullopt;
+
+        material.textures.resize(numTextures);
+        for (auto &[type, path] : material.textures)
+        {
+            if (!reader.read(type) || !reader.readString(path))
+                return std::nullopt;
+        }
+    }
+
+    uint32_t numMeshes = 0;
+    if (!reader.read(numMeshes))
+        return std::nullopt;
+
+    model.meshes.resize(numMeshes);
+    for (BakedModel::MeshData &mesh : model.meshes)
+    {
+        if (!readMesh(reader, mesh))
+            return std::nullopt;
+    }
+
+    uint32_t numNodes = 0;
+    if (!reader.read(numNodes))
+        return std::nullopt;
+
+    model.nodes.resize(numNodes);
+    for (BakedModel::Node &node : model.nodes)
+    {
+        if (!reader.readArray(node.meshes) || !reader.readArray(node.children))
+            return std::nullopt;
+    }
+
+    if (!isConsistent(model))
+        return std::nullopt;
+
+    return model;
+}
+
+bool store(const std::filesystem::path &cacheFile, uint64_t key,
+           const std::vector<std::filesystem::path> &dependencies, const BakedModel &model)
+{
+    if (key == 0)
+        return false;
+
+    return writeAtomically(cacheFile, [&](BlobWriter &writer) {
+        writer.write(Magic);
+        writer.write(Version);
+        writer.write(static_cast<uint32_t>(sizeof(Vertex)));
+        writer.write(static_cast<uint32_t>(sizeof(Meshlet)));
+        writer.write(key);
+
+        std::error_code error;
+        std::vector<std::string> dependencyPaths;
+        for (const std::filesystem::path &dependency : dependencies)
+            dependencyPaths.emplace_back(std::filesystem::absolute(dependency, error).string());
+        std::ranges::sort(dependencyPaths);
+        const auto [duplicates, end] = std::ranges::unique(dependencyPaths);
+        dependencyPaths.erase(duplicates, end);
+
+        writer.write(static_cast<uint32_t>(dependencyPaths.size()));
+        for (const std::string &path : dependencyPaths)
+        {
+            const std::optional<FileStamp> stamp = stampOf(path);
+            if (!stamp)
+                return false;
+
+            writer.writeString(path);
+            writer.write(stamp->size);
+            writer.write(stamp->writeTime);
+        }
+
+        writer.write(static_cast<uint32_t>(model.materials.size()));
+        for (const BakedModel::Material &material : model.materials)
+        {
+            writer.write(static_cast<uint32_t>(material.textures.size()));
+            for (const auto &[type, path] : material.textures)
+            {
+                writer.write(type);
+                writer.writeString(path);
+            }
+        }
+
+        writer.write(static_cast<uint32_t>(model.meshes.size()));
+        for (const BakedModel::MeshData &mesh : model.meshes)
+        {
+            writer.writeString(mesh.name);
+            writer.write(mesh.material);
+            writeVertices(writer, mesh.vertices);
+            writeIndices(writer, mesh.indices);
+            writeVertices(writer, mesh.tangents);
+            writer.write(static_cast<uint32_t>(mesh.lods.size()));
+            for (const MeshLod &lod : mesh.lods)
+            {
+                writer.write(lod.error);
+                writeIndices(writer, lod.indices);
+            }
+            writer.writeArray(mesh.meshlets);
+        }
+
+        writer.write(static_cast<uint32_t>(model.nodes.size()));
+        for (const BakedModel::Node &node : model.nodes)
+        {
+            writer.writeArray(node.meshes);
+            writer.writeArray(node.children);
+        }
+
+        return true;
+    });
+}
+} // namespace ModelCache
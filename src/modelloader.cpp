@@ -1,149 +1,513 @@
 #include "modelloader.h"
 #include "materialmanager.h"
+#include "meshoptimizer.h"
 #include "objectmanager.h"
+#include "startupprofiler.h"
+#include "texturestreamer.h"
+#include "threadpool.h"
 #include "transformmanager.h"
 
+#include <assimp/DefaultIOSystem.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
+#include <unordered_map>
+
+namespace
+{
+constexpr unsigned int ImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals
+                                     | aiProcess_FlipUVs | aiProcess_CalcTangentSpace
+                                     | aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph;
+
+// every texture type the materials are built from (see processMesh)
+constexpr std::array<aiTextureType, 10> BakedTextureTypes = {
+    aiTextureType_DIFFUSE,   aiTextureType_BASE_COLOR,     aiTextureType_SPECULAR,
+    aiTextureType_METALNESS, aiTextureType_EMISSION_COLOR, aiTextureType_NORMAL_CAMERA,
+    aiTextureType_NORMALS,   aiTextureType_HEIGHT,         aiTextureType_DIFFUSE_ROUGHNESS,
+    aiTextureType_AMBIENT_OCCLUSION,
+};
+
+// notes the files an import reads besides the source, so that the cache knows its dependencies
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    explicit RecordingIOSystem(std::vector<std::filesystem::path> &openedFiles)
+        : _openedFiles(openedFiles)
+    {
+    }
+
+    using DefaultIOSystem::Open;
+    Assimp::IOStream *Open(const char *file, const char *mode = "rb") override
+    {
+        Assimp::IOStream *stream = DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr)
+        {
+            _openedFiles.emplace_back(file);
+            StartupProfiler::instance()->addBytesLoaded(stream->FileSize());
+        }
+        return stream;
+    }
+
+private:
+    std::vector<std::filesystem::path> &_openedFiles;
+};
+
+// the directory the texture paths of the materials are relative to
+std::string modelRoot(const std::string &path) { return path.substr(0, path.find_last_of('/')); }
+
+// what the shaders read from the textures of each type (see processMesh)
+TextureUsage usageOf(aiTextureType type)
+{
+    switch (type)
+    {
+    case aiTextureType_NORMAL_CAMERA:
+    case aiTextureType_NORMALS:
+    case aiTextureType_HEIGHT:
+        return TextureUsage::Normal;
+    case aiTextureType_AMBIENT_OCCLUSION:
+        return TextureUsage::Occlusion;
+    case aiTextureType_DIFFUSE_ROUGHNESS:
+        return TextureUsage::Roughness;
+    case aiTextureType_METALNESS:
+        return TextureUsage::Metalness;
+    default:
+        return TextureUsage::Color;
+    }
+}
+
+// the settings of every texture the materials reference, by the texture names, although some
+// of them may end up unused (e.g. a height map next to a normal map). A texture read in several
+// ways (e.g. glTF's packed metalness and roughness) keeps all of its usages; only the colours
+// are in sRGB
+std::vector<std::pair<std::string, TextureSettings>> textureSettings(
+    const BakedModel &model, bool flipTextures, TextureCompression compression)
+{
+    std::unordered_map<std::string, TextureSettings> settings;
+    for (const BakedModel::Material &material : model.materials)
+    {
+        for (const auto &[type, texName] : material.textures)
+        {
+            TextureSettings &textureSettings = settings[texName];
+            textureSettings.addUsage(usageOf(static_cast<aiTextureType>(type)));
+            textureSettings.srgb = textureSettings.hasUsage(TextureUsage::Color);
+            textureSettings.flipVertically = flipTextures;
+            textureSettings.compression = compression;
+        }
+    }
+    return { settings.begin(), settings.end() };
+}
+
+void reportLoadTime(const std::string &path, bool fromCache,
+                    std::chrono::steady_clock::time_point loadStart, size_t numTextures = 0,
+                    std::chrono::duration<double, std::milli> prepareTime = {})
+{
+    const std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now()
+                                                               - loadStart;
+    std::cout << "Model '" << path << "' " << (fromCache ? "loaded from the cache" : "imported")
+              << " in " << loadTime.count() << " ms";
+    if (numTextures > 0)
+    {
+        std::cout << " (" << numTextures << " textures prepared in " << prepareTime.count()
+                  << " ms)";
+    }
+    std::cout << std::endl;
+}
+} // namespace
 
 ModelLoader::ModelLoader() = default;
 
 GameObjectIdentifier ModelLoader::loadModel(std::string const &path, bool flipTexturesOnLoad,
                                             bool loadAsPbr)
 {
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path,
-                                             aiProcess_Triangulate | aiProcess_GenSmoothNormals
-                                                 | aiProcess_FlipUVs | aiProcess_CalcTangentSpace
-                                                 | aiProcess_OptimizeMeshes
-                                                 | aiProcess_OptimizeGraph);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-    {
-        std::cerr << "Failed to load model wit assimp: " << importer.GetErrorString()
-                  << ". Model: " << path << std::endl;
+    const auto loadStart = std::chrono::steady_clock::now();
+
+    bool fromCache = false;
+    std::optional<BakedModel> model = bakeModel(path, loadAsPbr, fromCache);
+    if (!model)
         return InvalidIdentifier;
-    }
 
-    if (flipTexturesOnLoad)
-        stbi_set_flip_vertically_on_load(true);
-    Utilities::ScopeGuard backFlipper([ifFlip = flipTexturesOnLoad]() {
-        if (ifFlip)
-            stbi_set_flip_vertically_on_load(false);
+    const std::vector<MeshIdentifier> meshIds = registerMeshes(*model);
+    const GameObjectIdentifier loadedObject
+        = instantiateModel(*model, meshIds, path, flipTexturesOnLoad, loadAsPbr,
+                           TextureStreamer::instance()->enabled());
+
+    reportLoadTime(path, fromCache, loadStart);
+
+    return loadedObject;
+}
+
+std::future<GameObjectIdentifier> ModelLoader::loadModelAsync(std::string const &path,
+                                                              bool flipTexturesOnLoad,
+                                                              bool loadAsPbr)
+{
+    const auto pending = std::make_shared<PendingModel>();
+    pending->path = path;
+    pending->loadAsPbr = loadAsPbr;
+    pending->flipTextures = flipTexturesOnLoad;
+    pending->textureCompression = TextureManager::instance()->compression();
+    pending->streamTextures = TextureStreamer::instance()->enabled();
+    pending->loadStart = std::chrono::steady_clock::now();
+
+    std::future<GameObjectIdentifier> loaded = pending->loaded.get_future();
+
+    ThreadPool::loaders().enqueue([this, pending]() {
+        pending->model = bakeModel(pending->path, pending->loadAsPbr, pending->fromCache);
+        if (pending->model)
+            prepareTextures(pending);
+        else
+            queueInstantiation(pending);
     });
 
+    return loaded;
+}
+
+bool ModelLoader::processUploads(std::chrono::microseconds budget)
+{
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+
+    {
+        std::lock_guard lock(_bakedModelsMutex);
+        for (std::shared_ptr<PendingModel> &pending : _bakedModels)
+            _uploads.emplace_back([this, pending]() { instantiatePending(pending); });
+        _bakedModels.clear();
+    }
+
+    while (!_uploads.empty())
+    {
+        const std::function<void()> upload = std::move(_uploads.front());
+        _uploads.pop_front();
+        upload();
+
+        if (std::chrono::steady_clock::now() >= deadline)
+            break;
+    }
+
+    return !_uploads.empty();
+}
+
+std::optional<BakedModel> ModelLoader::bakeModel(const std::string &path, bool loadAsPbr,
+                                                 bool &fromCache)
+{
+    // the tangents are only imported for PBR
+    const uint64_t settings = ImportFlags | static_cast<uint64_t>(loadAsPbr) << 32;
+    const uint64_t key = ModelCache::sourceKey(path, settings);
+    const std::filesystem::path cacheFile = ModelCache::cachePath(path);
+
+    std::optional<BakedModel> model = ModelCache::load(cacheFile, key);
+    fromCache = model.has_value();
+    if (fromCache)
+        return model;
+
+    std::vector<std::filesystem::path> dependencies;
+    model = importModel(path, loadAsPbr, dependencies);
+    if (model && !ModelCache::store(cacheFile, key, dependencies, *model))
+        std::cerr << "Failed to write the model cache " << cacheFile << std::endl;
+
+    return model;
+}
+
+// a job per texture, so that they are prepared (read back from the texture cache, or decoded
+// and compressed) in parallel on the loader threads that are free; the last one to finish hands
+// the model over. The textures already uploaded for other models are prepared again, since the
+// loader threads can't look into the texture manager
+void ModelLoader::prepareTextures(const std::shared_ptr<PendingModel> &pending)
+{
+    for (auto &[texName, settings] :
+         textureSettings(*pending->model, pending->flipTextures, pending->textureCompression))
+    {
+        TextureData data;
+        data.settings = settings;
+        pending->textures.emplace_back(std::move(texName), std::move(data));
+    }
+    if (pending->textures.empty())
+    {
+        queueInstantiation(pending);
+        return;
+    }
+
+    const auto prepareStart = std::chrono::steady_clock::now();
+    pending->texturesLeft = pending->textures.size();
+    for (size_t i = 0; i < pending->textures.size(); ++i)
+    {
+        ThreadPool::loaders().enqueue([this, pending, i, prepareStart]() {
+            auto &[texName, data] = pending->textures[i];
+            data = TextureCache::prepare(modelRoot(pending->path) + '/' + texName, data.settings,
+                                         pending->streamTextures ? TextureStreamer::TailSize : 0);
+            if (!data)
+                std::cerr << "Failed to decode the texture " << texName << " of "
+                          << pending->path << std::endl;
+
+            if (pending->texturesLeft.fetch_sub(1) == 1)
+            {
+                pending->prepareTime = std::chrono::steady_clock::now() - prepareStart;
+                queueInstantiation(pending);
+            }
+        });
+    }
+}
+
+void ModelLoader::queueInstantiation(const std::shared_ptr<PendingModel> &pending)
+{
+    std::lock_guard lock(_bakedModelsMutex);
+    _bakedModels.emplace_back(pending);
+}
+
+std::vector<MeshIdentifier> ModelLoader::registerMeshes(BakedModel &model)
+{
+    std::vector<MeshIdentifier> meshIds;
+    meshIds.reserve(model.meshes.size());
+    for (BakedModel::MeshData &bakedMesh : model.meshes)
+    {
+        MeshIdentifier meshId = bakedMesh.name.empty()
+                                    ? InvalidIdentifier
+                                    : MeshManager::instance()->meshRegistered(bakedMesh.name);
+        if (meshId == InvalidIdentifier)
+        {
+            Mesh loadedMesh{ std::move(bakedMesh.vertices), std::move(bakedMesh.indices),
+                             std::move(bakedMesh.tangents), std::move(bakedMesh.lods),
+                             std::move(bakedMesh.meshlets) };
+            meshId = bakedMesh.name.empty()
+                         ? MeshManager::instance()->registerMesh(std::move(loadedMesh)).second
+                         : MeshManager::instance()->registerMesh(std::move(loadedMesh),
+                                                                 bakedMesh.name);
+        }
+        meshIds.emplace_back(meshId);
+    }
+
+    return meshIds;
+}
+
+GameObjectIdentifier ModelLoader::instantiateModel(const BakedModel &model,
+                                                   const std::vector<MeshIdentifier> &meshIds,
+                                                   const std::string &path, bool flipTextures,
+                                                   bool loadAsPbr, bool streamTextures)
+{
     GameObject &loadedObject = ObjectManager::instance()->getObject(
         ObjectManager::instance()->addObject());
 
-    processNode(scene->mRootNode, scene, path.substr(0, path.find_last_of('/')), loadedObject,
-                loadAsPbr);
+    processNode(model, 0, meshIds, modelRoot(path), loadedObject, loadAsPbr);
     loadedObject.addComponent(
         Component(ComponentType::TRANSFORM,
                   TransformManager::instance()->registerNewTransform(loadedObject)));
 
+    // the same settings the loader threads prepare the textures with (see prepareTextures)
+    for (const auto &[texName, settings] :
+         textureSettings(model, flipTextures, TextureManager::instance()->compression()))
+    {
+        const TextureIdentifier texture = TextureManager::instance()->textureRegistered(texName);
+        if (texture == InvalidIdentifier)
+            continue;
+
+        Texture2D *texture2D = TextureManager::instance()->getTexture(texture);
+        texture2D->setSettings(settings);
+        texture2D->setStreamed(streamTextures);
+    }
+
     return loadedObject;
 }
 
-GameObjectIdentifier ModelLoader::processNode(aiNode *node, const aiScene *scene,
-                                              const std::string &modelRoot,
-                                              GameObjectIdentifier parentObject, bool loadAsPbr)
+// creates the objects, then queues the uploads behind the steps already queued, and the
+// completion of the load behind the uploads
+void ModelLoader::instantiatePending(const std::shared_ptr<PendingModel> &pending)
 {
-    GameObject &nodeObject = ObjectManager::instance()->getObject(
-        ObjectManager::instance()->addObject());
+    if (!pending->model)
+    {
+        pending->loaded.set_value(InvalidIdentifier);
+        return;
+    }
+
+    // the textures are registered with the hashes the loader threads computed, rather than
+    // have their files hashed again here
+    for (const auto &[texName, data] : pending->textures)
+        _preparedContentHashes.emplace(texName, data.contentHash);
+
+    const std::vector<MeshIdentifier> meshIds = registerMeshes(*pending->model);
+    const GameObjectIdentifier loadedObject = instantiateModel(*pending->model, meshIds,
+                                                               pending->path,
+                                                               pending->flipTextures,
+                                                               pending->loadAsPbr,
+                                                               pending->streamTextures);
+    _preparedContentHashes.clear();
 
-    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+    for (const MeshIdentifier meshId : meshIds)
+        _uploads.emplace_back([meshId]() { MeshManager::instance()->allocateMesh(meshId); });
+
+    // the textures are registered by their names (see loadMaterialTextures)
+    for (auto &[texName, data] : pending->textures)
     {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        nodeObject.addChildObject(processMesh(mesh, scene, modelRoot, loadAsPbr));
+        const TextureIdentifier texture = TextureManager::instance()->textureRegistered(texName);
+        if (texture == InvalidIdentifier || !data)
+            continue;
+
+        TextureManager::instance()->provideData(texture, std::move(data));
+        _uploads.emplace_back(
+            [texture]() { TextureManager::instance()->allocateTexture(texture); });
     }
-    for (unsigned int i = 0; i < node->mNumChildren; i++)
+
+    const size_t numTextures = pending->textures.size();
+    pending->textures.clear();
+
+    _uploads.emplace_back([pending, loadedObject, numTextures]() {
+        reportLoadTime(pending->path, pending->fromCache, pending->loadStart, numTextures,
+                       pending->prepareTime);
+        pending->model.reset();
+        pending->loaded.set_value(loadedObject);
+    });
+}
+
+std::optional<BakedModel> ModelLoader::importModel(
+    const std::string &path, bool loadAsPbr, std::vector<std::filesystem::path> &dependencies)
+{
+    Assimp::Importer importer;
+    importer.SetIOHandler(new RecordingIOSystem(dependencies)); // the importer deletes it
+
+    const aiScene *scene = importer.ReadFile(path, ImportFlags);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
-        nodeObject.addChildObject(
-            processNode(node->mChildren[i], scene, modelRoot, nodeObject, loadAsPbr));
+        std::cerr << "Failed to load model wit assimp: " << importer.GetErrorString()
+                  << ". Model: " << path << std::endl;
+        return std::nullopt;
     }
 
-    nodeObject.addComponent(
-        Component(ComponentType::TRANSFORM,
-                  TransformManager::instance()->registerNewTransform(nodeObject)));
-    ObjectManager::instance()->getObject(parentObject).addChildObject(nodeObject);
+    BakedModel model;
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+        model.materials.emplace_back(bakeMaterial(scene->mMaterials[i]));
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+        model.meshes.emplace_back(bakeMesh(scene->mMeshes[i], loadAsPbr));
+    bakeNode(scene->mRootNode, model);
 
-    return nodeObject;
+    return model;
 }
 
-GameObjectIdentifier ModelLoader::processMesh(aiMesh *mesh, const aiScene *scene,
-                                              const std::string &modelRoot, bool loadAsPbr)
+uint32_t ModelLoader::bakeNode(const aiNode *node, BakedModel &model)
 {
-    GameObject &meshContainer = ObjectManager::instance()->getObject(
-        ObjectManager::instance()->addObject());
+    const uint32_t nodeIndex = model.nodes.size();
+    model.nodes.emplace_back();
+    model.nodes[nodeIndex].meshes.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
 
-    MeshIdentifier meshId = InvalidIdentifier;
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+        const uint32_t child = bakeNode(node->mChildren[i], model);
+        model.nodes[nodeIndex].children.emplace_back(child);
+    }
 
-    if (meshId = MeshManager::instance()->meshRegistered(mesh->mName.C_Str());
-        meshId == InvalidIdentifier)
+    return nodeIndex;
+}
+
+BakedModel::MeshData ModelLoader::bakeMesh(const aiMesh *mesh, bool loadAsPbr)
+{
+    BakedModel::MeshData bakedMesh;
+    bakedMesh.name = mesh->mName.C_Str();
+    bakedMesh.material = mesh->mMaterialIndex;
+
+    std::vector<Vertex> &vertices = bakedMesh.vertices;
+    std::vector<uint32_t> &indices = bakedMesh.indices;
+    std::vector<glm::vec3> &tangents = bakedMesh.tangents;
+
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
-        std::vector<glm::vec3> tangents;
+        Vertex vertex;
+        vertex.coordinates[0] = mesh->mVertices[i].x;
+        vertex.coordinates[1] = mesh->mVertices[i].y;
+        vertex.coordinates[2] = mesh->mVertices[i].z;
 
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        // normals
+        if (mesh->HasNormals())
         {
-            Vertex vertex;
-            vertex.coordinates[0] = mesh->mVertices[i].x;
-            vertex.coordinates[1] = mesh->mVertices[i].y;
-            vertex.coordinates[2] = mesh->mVertices[i].z;
-
-            // normals
-            if (mesh->HasNormals())
-            {
-                vertex.normal[0] = mesh->mNormals[i].x;
-                vertex.normal[1] = mesh->mNormals[i].y;
-                vertex.normal[2] = mesh->mNormals[i].z;
-            }
-            // texture coordinates
-            if (mesh->mTextureCoords[0])
-            {
-                vertex.texCoordinates[0] = mesh->mTextureCoords[0][i].x;
-                vertex.texCoordinates[1] = mesh->mTextureCoords[0][i].y;
-            }
+            vertex.normal[0] = mesh->mNormals[i].x;
+            vertex.normal[1] = mesh->mNormals[i].y;
+            vertex.normal[2] = mesh->mNormals[i].z;
+        }
+        // texture coordinates
+        if (mesh->mTextureCoords[0])
+        {
+            vertex.texCoordinates[0] = mesh->mTextureCoords[0][i].x;
+            vertex.texCoordinates[1] = mesh->mTextureCoords[0][i].y;
+        }
 
-            vertices.push_back(vertex);
+        vertices.push_back(vertex);
 
-            if (loadAsPbr && mesh->HasTangentsAndBitangents())
-            {
-                // bitangents will be computed on the fly to reduce traffic
-                tangents.emplace_back(mesh->mTangents[i].x, mesh->mTangents[i].y,
-                                      mesh->mTangents[i].z);
-            }
+        if (loadAsPbr && mesh->HasTangentsAndBitangents())
+        {
+            // bitangents will be computed on the fly to reduce traffic
+            tangents.emplace_back(mesh->mTangents[i].x, mesh->mTangents[i].y,
+                                  mesh->mTangents[i].z);
         }
+    }
+
+    bool onlyTriangles = true;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace &face = mesh->mFaces[i];
+        onlyTriangles &= face.mNumIndices == 3;
+        for (unsigned int j = 0; j < face.mNumIndices; j++)
+            indices.push_back(face.mIndices[j]);
+    }
+
+    if (onlyTriangles)
+    {
+        // assimp keeps the authored triangle order, which is poor for the vertex cache
+        optimizeForGpu(bakedMesh.name, vertices, indices, tangents);
+        bakedMesh.lods = buildLodChain(bakedMesh.name, vertices, indices);
+        bakedMesh.meshlets = MeshOptimizer::buildMeshlets(indices, vertices);
+    }
+
+    return bakedMesh;
+}
 
-        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+BakedModel::Material ModelLoader::bakeMaterial(const aiMaterial *material)
+{
+    // only one texture of a particular type is used
+    BakedModel::Material bakedMaterial;
+    for (const aiTextureType type : BakedTextureTypes)
+    {
+        aiString texturePath;
+        if (material->GetTextureCount(type) > 0
+            && material->GetTexture(type, 0, &texturePath) == aiReturn_SUCCESS)
         {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            bakedMaterial.textures.emplace_back(type, texturePath.C_Str());
         }
+    }
+
+    return bakedMaterial;
+}
+
+GameObjectIdentifier ModelLoader::processNode(const BakedModel &model, uint32_t node,
+                                              const std::vector<MeshIdentifier> &meshIds,
+                                              const std::string &modelRoot,
+                                              GameObjectIdentifier parentObject, bool loadAsPbr)
+{
+    GameObject &nodeObject = ObjectManager::instance()->getObject(
+        ObjectManager::instance()->addObject());
+
+    const BakedModel::Node &bakedNode = model.nodes[node];
+    for (const uint32_t mesh : bakedNode.meshes)
+    {
+        const BakedModel::Material &material = model.materials[model.meshes[mesh].material];
+        nodeObject.addChildObject(processMesh(material, meshIds[mesh], modelRoot, loadAsPbr));
+    }
+    for (const uint32_t child : bakedNode.children)
+    {
+        nodeObject.addChildObject(
+            processNode(model, child, meshIds, modelRoot, nodeObject, loadAsPbr));
+    }
+
+    nodeObject.addComponent(
+        Component(ComponentType::TRANSFORM,
+                  TransformManager::instance()->registerNewTransform(nodeObject)));
+    ObjectManager::instance()->getObject(parentObject).addChildObject(nodeObject);
+
+    return nodeObject;
+}
 
-        meshId = mesh->mName.length == 0
-                     ? MeshManager::instance()
-                           ->registerMesh(
-                               Mesh{ std::move(vertices), std::move(indices), std::move(tangents) })
-                           .second
-                     : MeshManager::instance()->registerMesh(Mesh{ std::move(vertices),
-                                                                   std::move(indices),
-                                                                   std::move(tangents) },
-                                                             std::string(mesh->mName.C_Str()));
-    }
-
-    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-
-    TextureIdentifier diffuseMap = loadMaterialTextures(material,
-                                                        { aiTextureType_DIFFUSE,
-                                                          aiTextureType_BASE_COLOR },
-                                                        modelRoot);
-    TextureIdentifier specularMap = loadMaterialTextures(material,
-                                                         { aiTextureType_SPECULAR,
-                                                           aiTextureType_METALNESS },
-                                                         modelRoot);
-    TextureIdentifier emissionMap = loadMaterialTextures(material, { aiTextureType_EMISSION_COLOR },
-                                                         modelRoot);
+GameObjectIdentifier ModelLoader::processMesh(const BakedModel::Material &material,
+                                              MeshIdentifier meshId, const std::string &modelRoot,
+                                              bool loadAsPbr)
+{
+    GameObject &meshContainer = ObjectManager::instance()->getObject(
+        ObjectManager::instance()->addObject());
 
     if (loadAsPbr)
     {
@@ -155,15 +519,15 @@ GameObjectIdentifier ModelLoader::processMesh(aiMesh *mesh, const aiScene *scene
                                                               { aiTextureType_NORMAL_CAMERA,
                                                                 aiTextureType_NORMALS,
                                                                 aiTextureType_HEIGHT },
-                                                              modelRoot, false);
+                                                              modelRoot);
         const TextureIdentifier roughness
-            = loadMaterialTextures(material, { aiTextureType_DIFFUSE_ROUGHNESS }, modelRoot, false);
+            = loadMaterialTextures(material, { aiTextureType_DIFFUSE_ROUGHNESS }, modelRoot);
         const TextureIdentifier ambientOcclusion
-            = loadMaterialTextures(material, { aiTextureType_AMBIENT_OCCLUSION }, modelRoot, false);
+            = loadMaterialTextures(material, { aiTextureType_AMBIENT_OCCLUSION }, modelRoot);
         const TextureIdentifier metalness = loadMaterialTextures(material,
                                                                  { aiTextureType_METALNESS,
                                                                    aiTextureType_SPECULAR },
-                                                                 modelRoot, false);
+                                                                 modelRoot);
 
         if (metalness != InvalidIdentifier && roughness != InvalidIdentifier
             && normal != InvalidIdentifier)
@@ -185,19 +549,35 @@ GameObjectIdentifier ModelLoader::processMesh(aiMesh *mesh, const aiScene *scene
         }
     }
 
-    const auto [mName,
-                mi] = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-                          ->registerMaterial(BasicMaterial{
-                              diffuseMap,
-                              specularMap != InvalidIdentifier
-                                  ? specularMap
-                                  : TextureManager::instance()->textureRegistered("black"),
-                              emissionMap != InvalidIdentifier
-                                  ? emissionMap
-                                  : TextureManager::instance()->textureRegistered("black") });
+    // the Blinn-Phong material only where there is no PBR one
+    if (meshContainer.getIdentifierForComponent(ComponentType::PBR_MATERIAL) == InvalidIdentifier)
+    {
+        const TextureIdentifier diffuseMap = loadMaterialTextures(material,
+                                                                  { aiTextureType_DIFFUSE,
+                                                                    aiTextureType_BASE_COLOR },
+                                                                  modelRoot);
+        const TextureIdentifier specularMap = loadMaterialTextures(material,
+                                                                   { aiTextureType_SPECULAR,
+                                                                     aiTextureType_METALNESS },
+                                                                   modelRoot);
+        const TextureIdentifier emissionMap
+            = loadMaterialTextures(material, { aiTextureType_EMISSION_COLOR }, modelRoot);
+
+        const MaterialIdentifier mi
+            = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+                  ->registerMaterial(BasicMaterial{
+                      diffuseMap,
+                      specularMap != InvalidIdentifier
+                          ? specularMap
+                          : TextureManager::instance()->textureRegistered("black"),
+                      emissionMap != InvalidIdentifier
+                          ? emissionMap
+                          : TextureManager::instance()->textureRegistered("black") })
+                  .second;
+        meshContainer.addComponent(Component(ComponentType::BASIC_MATERIAL, mi));
+    }
 
     meshContainer.addComponent(Component(ComponentType::MESH, meshId));
-    meshContainer.addComponent(Component(ComponentType::BASIC_MATERIAL, mi));
     meshContainer.addComponent(
         Component(ComponentType::TRANSFORM,
                   TransformManager::instance()->registerNewTransform(meshContainer)));
@@ -205,31 +585,69 @@ GameObjectIdentifier ModelLoader::processMesh(aiMesh *mesh, const aiScene *scene
     return meshContainer;
 }
 
-// allows only one texture of a particular type
+void ModelLoader::optimizeForGpu(const std::string &meshName, std::vector<Vertex> &vertices,
+                                 std::vector<uint32_t> &indices, std::vector<glm::vec3> &tangents)
+{
+    const MeshOptimizer::VertexCacheStatistics before
+        = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> clusterStarts;
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size(), clusterStarts);
+    MeshOptimizer::optimizeOverdraw(indices, vertices, clusterStarts);
+    MeshOptimizer::optimizeVertexFetch(vertices, indices, tangents);
+
+    const MeshOptimizer::VertexCacheStatistics after
+        = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+    std::cout << "Mesh '" << meshName << "' (" << indices.size() / 3
+              << " triangles) ACMR: " << before.acmr << " -> " << after.acmr
+              << ", ATVR: " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+std::vector<MeshLod> ModelLoader::buildLodChain(const std::string &meshName,
+                                               const std::vector<Vertex> &vertices,
+                                               const std::vector<uint32_t> &indices)
+{
+    std::vector<MeshLod> lods = MeshOptimizer::generateLodChain(indices, vertices);
+    if (lods.empty())
+        return lods;
+
+    std::cout << "Mesh '" << meshName << "' LODs: " << indices.size() / 3;
+    for (const MeshLod &lod : lods)
+        std::cout << " -> " << lod.indices.size() / 3 << " (error " << lod.error << ")";
+    std::cout << " triangles" << std::endl;
+
+    return lods;
+}
+
+// the first of the types the material has a texture of
 TextureIdentifier ModelLoader::loadMaterialTextures(
-    aiMaterial *mat, const std::initializer_list<aiTextureType> &types,
-    const std::string &modelRoot, bool loadAsSrgb)
+    const BakedModel::Material &material, const std::initializer_list<aiTextureType> &types,
+    const std::string &modelRoot)
 {
     TextureIdentifier texture = InvalidIdentifier;
 
     for (const auto type : types)
     {
-        for (unsigned int i = 0; i < mat->GetTextureCount(type) && i < 1;
-             i++) // limit to one texture currently
+        const auto texturePtr = std::ranges::find_if(material.textures,
+                                                     [type](const auto &typedTexture) {
+                                                         return typedTexture.first == type;
+                                                     });
+        if (texturePtr == material.textures.end())
+            continue;
+
+        const std::string &texName = texturePtr->second;
+        if (texture = TextureManager::instance()->textureRegistered(texName);
+            texture == InvalidIdentifier)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            const std::string texName = str.C_Str();
-            if (texture = TextureManager::instance()->textureRegistered(texName);
-                texture == InvalidIdentifier)
-            {
-                texture = TextureManager::instance()
-                              ->registerTexture((modelRoot + '/' + str.C_Str()).c_str(), texName);
-                TextureManager::instance()->getTexture(texture)->setUseSrgb(loadAsSrgb);
-            }
-            if (texture != InvalidIdentifier)
-                return texture;
+            const auto hashPtr = _preparedContentHashes.find(texName);
+            texture = TextureManager::instance()->registerTexture(
+                (modelRoot + '/' + texName).c_str(), texName,
+                hashPtr != _preparedContentHashes.end() ? std::optional(hashPtr->second)
+                                                        : std::nullopt);
         }
+        if (texture != InvalidIdentifier)
+            return texture;
     }
     return texture;
 }
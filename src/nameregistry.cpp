@@ -0,0 +1,39 @@
+#include "nameregistry.h"
+
+#include <cassert>
+
+NameIdentifier NameRegistry::intern(std::string_view name)
+{
+    if (const NameIdentifier id = find(name); id != InvalidName)
+        return id;
+
+    const auto [namePtr, inserted] = _identifiers.emplace(
+        std::string(name), static_cast<NameIdentifier>(_names.size() + 1));
+    _names.emplace_back(&namePtr->first);
+    return namePtr->second;
+}
+
+NameIdentifier NameRegistry::find(std::string_view name) const
+{
+    const auto namePtr = _identifiers.find(name);
+    return namePtr == _identifiers.end() ? InvalidName : namePtr->second;
+}
+
+NameIdentifier NameRegistry::internAnonymous(std::string_view kind)
+{
+    // skips the (unlikely) names that were already given explicitly
+    std::string anonymousName;
+    do
+    {
+        anonymousName = '#' + std::string(kind) + std::to_string(++_numAnonymous);
+    } while (find(anonymousName) != InvalidName);
+
+    return intern(anonymousName);
+}
+
+const std::string &NameRegistry::name(NameIdentifier id) const
+{
+    static const std::string noName;
+    assert(id <= _names.size());
+    return id == InvalidName || id > _names.size() ? noName : *_names[id - 1];
+}
@@ -8,6 +8,17 @@ GameObjectIdentifier ObjectManager::addObject()
     return _identifiers;
 }
 
+GameObjectIdentifier ObjectManager::addObjects(size_t count)
+{
+    _gameObjects.reserve(_gameObjects.size() + count);
+    for (size_t o = 0; o < count; ++o)
+        _gameObjects.emplace_back(new GameObject(_identifiers + 1 + o));
+
+    const GameObjectIdentifier first = _identifiers + 1;
+    _identifiers += count;
+    return first;
+}
+
 GameObjectIdentifier ObjectManager::copyObject(GameObjectIdentifier gTemplate)
 {
     GameObjectIdentifier parentCopy = copyBase(gTemplate);
@@ -29,6 +40,7 @@ GameObjectIdentifier ObjectManager::copyBase(GameObjectIdentifier oldMe)
 {
     GameObject &newMe = getObject(addObject());
     newMe._objectComponents = getObject(oldMe)._objectComponents;
+    newMe._castsShadows = getObject(oldMe)._castsShadows;
 
     const TransformIdentifier newTransform = TransformManager::instance()->registerNewTransform(
         newMe);
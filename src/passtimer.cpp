@@ -0,0 +1,58 @@
+#include "passtimer.h"
+
+namespace
+{
+double smooth(double previous, double sample, double factor)
+{
+    return previous == 0.0 ? sample : previous + (sample - previous) * factor;
+}
+} // namespace
+
+PassTimer::~PassTimer()
+{
+    if (_queries[0] != 0)
+        glDeleteQueries(QueriesInFlight, _queries.data());
+}
+
+void PassTimer::begin()
+{
+    if (_queries[0] == 0)
+        glGenQueries(QueriesInFlight, _queries.data());
+
+    // collects the oldest result before its query object is reused
+    if (_queryPending[_currentQuery])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(_queries[_currentQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 elapsedNanoseconds = 0;
+            glGetQueryObjectui64v(_queries[_currentQuery], GL_QUERY_RESULT, &elapsedNanoseconds);
+            _gpuMilliseconds = smooth(_gpuMilliseconds, elapsedNanoseconds / 1.0e6,
+                                      SmoothingFactor);
+        }
+        _queryPending[_currentQuery] = false; // dropped if not ready, better than stalling
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, _queries[_currentQuery]);
+    _cpuStart = std::chrono::steady_clock::now();
+}
+
+void PassTimer::end()
+{
+    const auto cpuEnd = std::chrono::steady_clock::now();
+    glEndQuery(GL_TIME_ELAPSED);
+
+    _queryPending[_currentQuery] = true;
+    _currentQuery = (_currentQuery + 1) % QueriesInFlight;
+
+    _cpuMilliseconds = smooth(_cpuMilliseconds,
+                              std::chrono::duration<double, std::milli>(cpuEnd - _cpuStart).count(),
+                              SmoothingFactor);
+}
+
+void PassTimer::reset()
+{
+    _cpuMilliseconds = 0.0;
+    _gpuMilliseconds = 0.0;
+}
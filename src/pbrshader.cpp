@@ -12,26 +12,6 @@ PbrShader::PbrShader(const char *vertexPath, const char *fragmentPath)
     _textureHandlesbindingPoint = 1;
 }
 
-void PbrShader::runShader()
-{
-    use();
-
-    for (auto &[meshId, count] : _instancedMeshes)
-    {
-        MeshManager::instance()->enableMeshInstancing(meshId);
-        const Mesh &mesh = *MeshManager::instance()->getMesh(meshId);
-
-        MeshManager::instance()->bindMeshInstanced(meshId);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _texturesSSBO);
-
-        glDrawElementsInstanced(GL_TRIANGLES, mesh.indicesSize(), GL_UNSIGNED_INT, 0, count);
-
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
-
-        MeshManager::instance()->unbindMesh();
-    }
-}
-
 std::vector<InstancedDataGenerator> PbrShader::getDataGenerators()
 {
     // TODO: these generators are quite inefficient -> rework
@@ -0,0 +1,169 @@
+#include "pixelpool.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+// the smaller blocks (the decoders' tables and rows) are left to malloc
+constexpr size_t MinPooledOctave = 16;
+constexpr size_t MinPooledSize = size_t(1) << MinPooledOctave;
+constexpr size_t MaxBlockSize = size_t(1) << (sizeof(size_t) * 8 - 2);
+
+// four classes per power of two, so that a block wastes at most a fifth of its size
+constexpr size_t ClassesPerOctave = 4;
+constexpr size_t NumClasses = (sizeof(size_t) * 8 - MinPooledOctave) * ClassesPerOctave;
+
+// past this, the released blocks go back to the system
+constexpr size_t MaxHeldBytes = 256 * 1024 * 1024;
+
+// in front of every block, so that the data stays as aligned as malloc's
+struct alignas(std::max_align_t) BlockHeader
+{
+    size_t capacity = 0;
+};
+
+struct SizeClass
+{
+    size_t index = 0;
+    size_t capacity = 0;
+};
+
+// the capacity is 4, 5, 6 or 7 quarters of a power of two
+SizeClass sizeClass(size_t size)
+{
+    size_t octave = std::bit_width(size) - 1;
+    size_t quarter = size_t(1) << (octave - 2);
+    size_t quarters = (size + quarter - 1) / quarter;
+    if (quarters == 2 * ClassesPerOctave)
+    {
+        ++octave;
+        quarter <<= 1;
+        quarters = ClassesPerOctave;
+    }
+
+    return SizeClass{ (octave - MinPooledOctave) * ClassesPerOctave + quarters - ClassesPerOctave,
+                      quarters * quarter };
+}
+
+struct Pool
+{
+    std::mutex mutex;
+    std::array<std::vector<BlockHeader *>, NumClasses> freeBlocks;
+    PixelPool::Statistics statistics;
+};
+
+Pool &pool()
+{
+    // never destroyed, since the images may outlive the static objects
+    static Pool *pool = new Pool;
+    return *pool;
+}
+
+void *allocateBlock(size_t capacity)
+{
+    auto *header = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + capacity));
+    if (header == nullptr)
+        return nullptr;
+
+    header->capacity = capacity;
+    return header + 1;
+}
+
+BlockHeader *headerOf(void *block) { return static_cast<BlockHeader *>(block) - 1; }
+} // namespace
+
+namespace PixelPool
+{
+void *allocate(size_t size)
+{
+    if (size > MaxBlockSize)
+        return nullptr;
+    if (size < MinPooledSize)
+        return allocateBlock(size);
+
+    const SizeClass sizeClass = ::sizeClass(size);
+    {
+        Pool &blockPool = pool();
+        std::lock_guard lock(blockPool.mutex);
+        ++blockPool.statistics.allocations;
+
+        std::vector<BlockHeader *> &freeBlocks = blockPool.freeBlocks[sizeClass.index];
+        if (!freeBlocks.empty())
+        {
+            BlockHeader *header = freeBlocks.back();
+            freeBlocks.pop_back();
+            blockPool.statistics.heldBytes -= header->capacity;
+            ++blockPool.statistics.reuses;
+            return header + 1;
+        }
+    }
+
+    return allocateBlock(sizeClass.capacity);
+}
+
+void *reallocate(void *block, size_t size)
+{
+    if (block == nullptr)
+        return allocate(size);
+
+    const size_t capacity = headerOf(block)->capacity;
+    if (size <= capacity)
+        return block;
+
+    // like realloc, the block stays valid if the new one can't be allocated
+    void *grownBlock = allocate(size);
+    if (grownBlock == nullptr)
+        return nullptr;
+
+    std::memcpy(grownBlock, block, capacity);
+    release(block);
+    return grownBlock;
+}
+
+void release(void *block)
+{
+    if (block == nullptr)
+        return;
+
+    BlockHeader *header = headerOf(block);
+    if (header->capacity >= MinPooledSize)
+    {
+        Pool &blockPool = pool();
+        std::lock_guard lock(blockPool.mutex);
+        if (blockPool.statistics.heldBytes + header->capacity <= MaxHeldBytes)
+        {
+            blockPool.freeBlocks[sizeClass(header->capacity).index].emplace_back(header);
+            blockPool.statistics.heldBytes += header->capacity;
+            return;
+        }
+    }
+
+    std::free(header);
+}
+
+Statistics statistics()
+{
+    Pool &blockPool = pool();
+    std::lock_guard lock(blockPool.mutex);
+    return blockPool.statistics;
+}
+
+void trim()
+{
+    Pool &blockPool = pool();
+    std::lock_guard lock(blockPool.mutex);
+    for (std::vector<BlockHeader *> &freeBlocks : blockPool.freeBlocks)
+    {
+        for (BlockHeader *header : freeBlocks)
+            std::free(header);
+        freeBlocks.clear();
+    }
+    blockPool.statistics.heldBytes = 0;
+}
+} // namespace PixelPool
@@ -0,0 +1,170 @@
+#include "programcache.h"
+
+#include "blobfile.h"
+#include "mappedfile.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr std::array<char, 4> Magic = { 'O', 'P', 'R', 'G' };
+
+bool enabled = true;
+
+uint64_t hashString(std::string_view text, uint64_t hash = Utilities::HashBasis)
+{
+    return Utilities::hashBytes(reinterpret_cast<const std::byte *>(text.data()), text.size(),
+                                hash);
+}
+
+// the binaries are only good for the driver that wrote them
+uint64_t driverHash()
+{
+    static const uint64_t hash = [] {
+        uint64_t driver = Utilities::HashBasis;
+        for (const GLenum name :
+             { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+        {
+            const auto *value = reinterpret_cast<const char *>(glGetString(name));
+            driver = hashString(value != nullptr ? value : "", driver);
+        }
+        return driver;
+    }();
+    return hash;
+}
+} // namespace
+
+namespace ProgramCache
+{
+void setEnabled(bool enable) { enabled = enable; }
+
+bool isEnabled()
+{
+    if (!enabled)
+        return false;
+
+    static const bool hasBinaryFormats = [] {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }();
+    return hasBinaryFormats;
+}
+
+uint64_t programKey(GLuint program)
+{
+    GLint numShaders = 0;
+    glGetProgramiv(program, GL_ATTACHED_SHADERS, &numShaders);
+    std::vector<GLuint> shaders(numShaders);
+    if (numShaders > 0)
+        glGetAttachedShaders(program, numShaders, nullptr, shaders.data());
+
+    // the stages in whatever order the driver lists them
+    std::vector<uint64_t> stageHashes;
+    std::string source;
+    for (const GLuint shader : shaders)
+    {
+        GLint type = 0, length = 0;
+        glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+        glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+
+        source.resize(std::max(length, 1));
+        GLsizei written = 0;
+        glGetShaderSource(shader, static_cast<GLsizei>(source.size()), &written, source.data());
+        stageHashes.emplace_back(Utilities::hashCombine(
+            hashString(std::string_view(source.data(), written)), static_cast<uint64_t>(type)));
+    }
+    std::ranges::sort(stageHashes);
+
+    uint64_t key = Utilities::hashCombine(driverHash(), Version);
+    for (const uint64_t stageHash : stageHashes)
+        key = Utilities::hashCombine(key, stageHash);
+    return key != 0 ? key : 1;
+}
+
+std::filesystem::path cachePath(uint64_t key)
+{
+    std::ostringstream fileName;
+    fileName << std::hex << std::setw(16) << std::setfill('0') << key << ".program";
+    return std::filesystem::path(ENGINE_CACHE) / "programs" / fileName.str();
+}
+
+bool load(GLuint program, uint64_t key)
+{
+    if (!isEnabled())
+        return false;
+
+    const MappedFile file(cachePath(key));
+    if (!file.isOpen())
+        return false;
+
+    BlobReader reader(file.data(), file.size());
+
+    std::array<char, 4> magic = {};
+    uint32_t version = 0;
+    uint64_t fileKey = 0;
+    GLenum format = 0;
+    uint32_t size = 0;
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(fileKey) || magic != Magic
+        || version != Version || fileKey != key || !reader.read(format))
+    {
+        return false;
+    }
+
+    const std::byte *binary = reader.readArray(size);
+    if (binary == nullptr || size == 0)
+        return false;
+
+    glProgramBinary(program, format, binary, static_cast<GLsizei>(size));
+
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+        return false;
+
+    GLint numShaders = 0;
+    glGetProgramiv(program, GL_ATTACHED_SHADERS, &numShaders);
+    std::vector<GLuint> shaders(numShaders);
+    if (numShaders > 0)
+        glGetAttachedShaders(program, numShaders, nullptr, shaders.data());
+    for (const GLuint shader : shaders)
+        glDetachShader(program, shader);
+
+    return true;
+}
+
+bool store(GLuint program, uint64_t key)
+{
+    if (!isEnabled())
+        return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return false;
+
+    return writeAtomically(cachePath(key), [&](BlobWriter &writer) {
+        writer.write(Magic);
+        writer.write(Version);
+        writer.write(key);
+        writer.write(format);
+        writer.writeArray(binary.data(), static_cast<size_t>(written));
+
+        return true;
+    });
+}
+} // namespace ProgramCache
@@ -0,0 +1,699 @@
+#include "scenefile.h"
+
+#include "blobfile.h"
+#include "mappedfile.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+constexpr std::array<char, 4> Magic = { 'O', 'S', 'C', 'N' };
+
+constexpr std::string_view Whitespace = " \t\r";
+
+// appends the whitespace separated tokens of a line
+void tokenize(std::string_view line, std::vector<std::string_view> &tokens)
+{
+    size_t start = line.find_first_not_of(Whitespace);
+    while (start != std::string_view::npos)
+    {
+        const size_t end = line.find_first_of(Whitespace, start);
+        tokens.emplace_back(line.substr(start, end - start));
+        start = line.find_first_not_of(Whitespace, end);
+    }
+}
+
+// exactly N comma separated numbers
+template <size_t N>
+bool parseNumbers(std::string_view text, std::array<float, N> &values)
+{
+    const char *cursor = text.data();
+    const char *const end = text.data() + text.size();
+    for (size_t v = 0; v < N; ++v)
+    {
+        if (v > 0 && (cursor == end || *cursor++ != ','))
+            return false;
+
+        const auto [next, error] = std::from_chars(cursor, end, values[v]);
+        if (error != std::errc{})
+            return false;
+        cursor = next;
+    }
+    return cursor == end;
+}
+
+bool parseVector(std::string_view text, glm::vec3 &value)
+{
+    std::array<float, 3> values;
+    if (!parseNumbers(text, values))
+        return false;
+
+    value = glm::vec3(values[0], values[1], values[2]);
+    return true;
+}
+
+bool parseUnsigned(std::string_view text, uint32_t &value)
+{
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} && end == text.data() + text.size();
+}
+
+// "key=value", or a bare flag with an empty value
+std::pair<std::string_view, std::string_view> splitOption(std::string_view token)
+{
+    const size_t equals = token.find('=');
+    if (equals == std::string_view::npos)
+        return { token, std::string_view() };
+    return { token.substr(0, equals), token.substr(equals + 1) };
+}
+
+// the records of the text form, line after line; the names resolve to the indices of the records
+// defined above
+class TextParser
+{
+public:
+    explicit TextParser(const std::filesystem::path &source)
+        : _source(source), _root(source.parent_path())
+    {
+    }
+
+    std::optional<SceneDescription> parse(std::string_view text)
+    {
+        std::vector<std::string_view> tokens; // of the record so far
+        size_t line = 0;
+        while (!text.empty())
+        {
+            ++line;
+            const size_t lineEnd = text.find('\n');
+            std::string_view lineText = text.substr(0, lineEnd);
+            lineText = lineText.substr(0, lineText.find('#'));
+            text = lineEnd == std::string_view::npos ? std::string_view()
+                                                     : text.substr(lineEnd + 1);
+
+            // the indented lines continue the record above
+            const bool continues = !lineText.empty()
+                                   && Whitespace.find(lineText[0]) != std::string_view::npos;
+            if (!continues && lineText.find_first_not_of(Whitespace) != std::string_view::npos)
+            {
+                if (!tokens.empty() && !parseRecord(tokens))
+                    return std::nullopt;
+                tokens.clear();
+            }
+            if (tokens.empty())
+                _line = line;
+            tokenize(lineText, tokens);
+        }
+
+        if (!tokens.empty() && !parseRecord(tokens))
+            return std::nullopt;
+        return std::move(_scene);
+    }
+
+private:
+    using Tokens = std::vector<std::string_view>;
+
+    struct NameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+    using NameMap = std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>>;
+
+    bool parseRecord(const Tokens &tokens)
+    {
+        const std::string_view kind = tokens[0];
+        if (kind == "object")
+            return parseObject(tokens);
+        if (kind == "texture")
+            return parseTexture(tokens);
+        if (kind == "cubemap")
+            return parseCubemap(tokens);
+        if (kind == "material")
+            return parseMaterial(tokens);
+        if (kind == "model")
+            return parseModel(tokens);
+        if (kind == "light")
+            return parseLight(tokens);
+        if (kind == "camera")
+            return parseCamera(tokens);
+        if (kind == "skybox")
+            return parseSkybox(tokens);
+        return fail("unknown record '" + std::string(kind) + "'");
+    }
+
+    bool parseTexture(const Tokens &tokens)
+    {
+        SceneDescription::Texture texture;
+        if (tokens.size() < 3 || !define(_textures, tokens[1], _scene.textures.size()))
+            return fail("expected a new texture name and a path");
+        texture.name = intern(tokens[1]);
+        texture.path = path(tokens[2]);
+
+        for (size_t t = 3; t < tokens.size(); ++t)
+        {
+            const auto [key, value] = splitOption(tokens[t]);
+            if (key == "anisotropy" && parseUnsigned(value, texture.anisotropy))
+                continue;
+            if (key == "wrap" && value == "repeat")
+                texture.wrapping = SceneDescription::Wrapping::Repeat;
+            else if (key == "wrap" && value == "mirrored-repeat")
+                texture.wrapping = SceneDescription::Wrapping::MirroredRepeat;
+            else if (key == "wrap" && value == "clamp")
+                texture.wrapping = SceneDescription::Wrapping::Clamp;
+            else
+                return invalidOption(tokens[t]);
+        }
+
+        _scene.textures.emplace_back(texture);
+        return true;
+    }
+
+    bool parseCubemap(const Tokens &tokens)
+    {
+        SceneDescription::Cubemap cubemap;
+        if (tokens.size() != 2 + cubemap.faces.size()
+            || !define(_cubemaps, tokens[1], _scene.cubemaps.size()))
+        {
+            return fail("expected a new cubemap name and its six faces");
+        }
+        cubemap.name = intern(tokens[1]);
+        for (size_t f = 0; f < cubemap.faces.size(); ++f)
+            cubemap.faces[f] = path(tokens[2 + f]);
+
+        _scene.cubemaps.emplace_back(cubemap);
+        return true;
+    }
+
+    bool parseMaterial(const Tokens &tokens)
+    {
+        SceneDescription::Material material;
+        if (tokens.size() < 2 || !define(_materials, tokens[1], _scene.materials.size()))
+            return fail("expected a new material name");
+        material.name = intern(tokens[1]);
+        material.pbr = std::ranges::find(tokens, "pbr") != tokens.end();
+
+        constexpr std::array<std::string_view, 3> BasicSlots = { "diffuse", "specular",
+                                                                 "emission" };
+        constexpr std::array<std::string_view, 5> PbrSlots = { "albedo", "normal", "roughness",
+                                                               "metallic", "ao" };
+        for (size_t t = 2; t < tokens.size(); ++t)
+        {
+            const auto [key, value] = splitOption(tokens[t]);
+            if (key == "pbr" && value.empty())
+                continue;
+
+            const auto slotIn = [key](const auto &slots) -> size_t {
+                return std::ranges::find(slots, key) - slots.begin();
+            };
+            const size_t slot = material.pbr ? slotIn(PbrSlots) : slotIn(BasicSlots);
+            const size_t numSlots = material.pbr ? PbrSlots.size() : BasicSlots.size();
+            if (slot == numSlots || !find(_textures, value, "texture", material.textures[slot]))
+                return invalidOption(tokens[t]);
+        }
+
+        _scene.materials.emplace_back(material);
+        return true;
+    }
+
+    bool parseModel(const Tokens &tokens)
+    {
+        SceneDescription::Model model;
+        if (tokens.size() < 3 || !define(_models, tokens[1], _scene.models.size()))
+            return fail("expected a new model name and a path");
+        model.name = intern(tokens[1]);
+        model.path = path(tokens[2]);
+
+        for (size_t t = 3; t < tokens.size(); ++t)
+        {
+            if (tokens[t] == "pbr")
+                model.pbr = true;
+            else if (tokens[t] == "flip-textures")
+                model.flipTextures = true;
+            else
+                return invalidOption(tokens[t]);
+        }
+
+        _scene.models.emplace_back(model);
+        return true;
+    }
+
+    bool parseLight(const Tokens &tokens)
+    {
+        SceneDescription::Light light;
+        if (tokens.size() < 3 || !define(_lights, tokens[1], _scene.lights.size()))
+            return fail("expected a new light name and its type");
+        light.name = intern(tokens[1]);
+
+        using LightType = SceneDescription::LightType;
+        if (tokens[2] == "point")
+            light.type = LightType::Point;
+        else if (tokens[2] == "directional")
+            light.type = LightType::Directional;
+        else if (tokens[2] == "spot")
+            light.type = LightType::Spot;
+        else if (tokens[2] == "textured-spot")
+            light.type = LightType::TexturedSpot;
+        else
+            return fail("unknown light type '" + std::string(tokens[2]) + "'");
+
+        for (size_t t = 3; t < tokens.size(); ++t)
+        {
+            const auto [key, value] = splitOption(tokens[t]);
+            std::array<float, 2> cutOff;
+            const bool parsed
+                = (key == "ambient" && parseVector(value, light.ambient))
+                  || (key == "diffuse" && parseVector(value, light.diffuse))
+                  || (key == "specular" && parseVector(value, light.specular))
+                  || (key == "attenuation" && parseVector(value, light.attenuation))
+                  || (key == "cut-off" && parseNumbers(value, cutOff))
+                  || (key == "shadow-map" && parseUnsigned(value, light.shadowMapSize))
+                  || (key == "ortho" && parseNumbers(value, light.ortho))
+                  || (key == "texture" && find(_textures, value, "texture", light.texture));
+            if (!parsed)
+                return invalidOption(tokens[t]);
+
+            if (key == "cut-off")
+                light.cutOff = glm::vec2(cutOff[0], cutOff[1]);
+        }
+
+        _scene.lights.emplace_back(light);
+        return true;
+    }
+
+    bool parseObject(const Tokens &tokens)
+    {
+        SceneDescription::Object object;
+        size_t t = 1;
+        if (tokens.size() > 1 && tokens[1].find('=') == std::string_view::npos)
+        {
+            if (!define(_objects, tokens[1], _scene.objects.size()))
+                return fail("the object '" + std::string(tokens[1]) + "' is already defined");
+            object.name = intern(tokens[1]);
+            ++t;
+        }
+
+        for (; t < tokens.size(); ++t)
+        {
+            const auto [key, value] = splitOption(tokens[t]);
+            bool parsed = false;
+            if (key == "position")
+            {
+                parsed = parseVector(value, object.position);
+            }
+            else if (key == "rotation")
+            {
+                std::array<float, 4> angleAxis;
+                if (parseNumbers(value, angleAxis))
+                {
+                    const glm::vec3 axis(angleAxis[1], angleAxis[2], angleAxis[3]);
+                    parsed = glm::length(axis) > 0.0f;
+                    if (parsed)
+                    {
+                        object.rotation = glm::angleAxis(glm::radians(angleAxis[0]),
+                                                         glm::normalize(axis));
+                    }
+                }
+            }
+            else if (key == "scale")
+            {
+                std::array<float, 1> uniform;
+                parsed = parseVector(value, object.scale);
+                if (!parsed && parseNumbers(value, uniform))
+                {
+                    object.scale = glm::vec3(uniform[0]);
+                    parsed = true;
+                }
+            }
+            else if (key == "mesh")
+            {
+                object.mesh = intern(value);
+                parsed = !value.empty();
+            }
+            else if (key == "shader")
+            {
+                parsed = parseShader(value, object.shader);
+            }
+            else if (key == "shadows")
+            {
+                object.castsShadows = value == "on";
+                parsed = value == "on" || value == "off";
+            }
+            else
+            {
+                parsed = (key == "parent" && find(_objects, value, "object", object.parent))
+                         || (key == "model" && find(_models, value, "model", object.model))
+                         || (key == "material"
+                             && find(_materials, value, "material", object.material))
+                         || (key == "light" && find(_lights, value, "light", object.light));
+            }
+
+            if (!parsed)
+                return invalidOption(tokens[t]);
+        }
+
+        _scene.objects.emplace_back(object);
+        return true;
+    }
+
+    bool parseCamera(const Tokens &tokens)
+    {
+        SceneDescription::Camera camera;
+        for (size_t t = 1; t < tokens.size(); ++t)
+        {
+            const auto [key, value] = splitOption(tokens[t]);
+            if (!(key == "position" && parseVector(value, camera.position))
+                && !(key == "look-at" && parseVector(value, camera.target)))
+            {
+                return invalidOption(tokens[t]);
+            }
+        }
+
+        _scene.camera = camera;
+        return true;
+    }
+
+    bool parseSkybox(const Tokens &tokens)
+    {
+        if (tokens.size() != 2)
+            return fail("expected a cubemap");
+        return find(_cubemaps, tokens[1], "cubemap", _scene.skybox);
+    }
+
+    static bool parseShader(std::string_view name, SceneDescription::Shader &shader)
+    {
+        using Shader = SceneDescription::Shader;
+        constexpr std::array<std::pair<std::string_view, Shader>, 5> Shaders = {
+            { { "blinn-phong", Shader::BlinnPhong },
+              { "pbr", Shader::Pbr },
+              { "transparent", Shader::Transparent },
+              { "light", Shader::LightGizmo },
+              { "axes", Shader::Axes } }
+        };
+
+        for (const auto &[shaderName, value] : Shaders)
+        {
+            if (shaderName == name)
+            {
+                shader = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // whether the name was new
+    static bool define(NameMap &names, std::string_view name, size_t index)
+    {
+        return names.emplace(std::string(name), static_cast<uint32_t>(index)).second;
+    }
+
+    bool find(const NameMap &names, std::string_view name, std::string_view kind,
+              uint32_t &index)
+    {
+        const auto found = names.find(name);
+        if (found == names.end())
+        {
+            fail("unknown " + std::string(kind) + " '" + std::string(name) + "'");
+            return false;
+        }
+
+        index = found->second;
+        return true;
+    }
+
+    uint32_t intern(std::string_view string)
+    {
+        const auto [interned, added] = _strings.try_emplace(
+            std::string(string), static_cast<uint32_t>(_scene.strings.size()));
+        if (added)
+            _scene.strings.emplace_back(string);
+        return interned->second;
+    }
+
+    // relative to the scene file
+    uint32_t path(std::string_view relative)
+    {
+        return intern((_root / relative).lexically_normal().generic_string());
+    }
+
+    bool invalidOption(std::string_view token)
+    {
+        return fail("invalid option '" + std::string(token) + "'");
+    }
+
+    bool fail(const std::string &message)
+    {
+        // the first error is the one that counts
+        if (!_failed)
+            std::cerr << _source.string() << ":" << _line << ": " << message << std::endl;
+        _failed = true;
+        return false;
+    }
+
+private:
+    std::filesystem::path _source;
+    std::filesystem::path _root;
+    size_t _line = 0;
+    bool _failed = false;
+
+    SceneDescription _scene;
+    NameMap _strings;
+    NameMap _textures;
+    NameMap _cubemaps;
+    NameMap _materials;
+    NameMap _models;
+    NameMap _lights;
+    NameMap _objects;
+};
+
+// the references between the records have to hold before anything gets instantiated
+bool isConsistent(const SceneDescription &scene)
+{
+    const auto refersTo = [](uint32_t index, size_t size) { return index < size; };
+    const auto mayReferTo = [](uint32_t index, size_t size) {
+        return index == SceneDescription::None || index < size;
+    };
+    const size_t numStrings = scene.strings.size();
+
+    for (const SceneDescription::Texture &texture : scene.textures)
+    {
+        if (!refersTo(texture.name, numStrings) || !refersTo(texture.path, numStrings)
+            || texture.wrapping > SceneDescription::Wrapping::Clamp)
+        {
+            return false;
+        }
+    }
+
+    for (const SceneDescription::Cubemap &cubemap : scene.cubemaps)
+    {
+        if (!refersTo(cubemap.name, numStrings)
+            || !std::ranges::all_of(cubemap.faces, [&](uint32_t face) {
+                   return refersTo(face, numStrings);
+               }))
+        {
+            return false;
+        }
+    }
+
+    for (const SceneDescription::Material &material : scene.materials)
+    {
+        if (!refersTo(material.name, numStrings)
+            || !std::ranges::all_of(material.textures, [&](uint32_t texture) {
+                   return mayReferTo(texture, scene.textures.size());
+               }))
+        {
+            return false;
+        }
+    }
+
+    for (const SceneDescription::Model &model : scene.models)
+    {
+        if (!refersTo(model.name, numStrings) || !refersTo(model.path, numStrings))
+            return false;
+    }
+
+    for (const SceneDescription::Light &light : scene.lights)
+    {
+        if (!refersTo(light.name, numStrings) || !mayReferTo(light.texture, scene.textures.size())
+            || light.type > SceneDescription::LightType::TexturedSpot)
+        {
+            return false;
+        }
+    }
+
+    for (size_t o = 0; o < scene.objects.size(); ++o)
+    {
+        const SceneDescription::Object &object = scene.objects[o];
+        // parents before their children keep the hierarchy free of cycles
+        if (!mayReferTo(object.name, numStrings) || !mayReferTo(object.parent, o)
+            || !mayReferTo(object.model, scene.models.size())
+            || !mayReferTo(object.mesh, numStrings)
+            || !mayReferTo(object.material, scene.materials.size())
+            || !mayReferTo(object.light, scene.lights.size())
+            || static_cast<size_t>(object.shader) >= SceneDescription::NumShaders)
+        {
+            return false;
+        }
+    }
+
+    return mayReferTo(scene.skybox, scene.cubemaps.size());
+}
+
+// the cached binary forms carry the key of their source; the others (key 0) load as they are
+std::optional<SceneDescription> read(const std::byte *data, size_t size, uint64_t key)
+{
+    BlobReader reader(data, size);
+
+    std::array<char, 4> magic = {};
+    uint32_t version = 0, objectSize = 0;
+    uint64_t fileKey = 0;
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(objectSize)
+        || !reader.read(fileKey))
+    {
+        return std::nullopt;
+    }
+
+    if (magic != Magic || version != SceneFile::Version
+        || objectSize != sizeof(SceneDescription::Object) || (key != 0 && fileKey != key))
+    {
+        return std::nullopt;
+    }
+
+    SceneDescription scene;
+
+    uint32_t numStrings = 0;
+    if (!reader.read(numStrings) || numStrings > size / sizeof(uint32_t))
+        return std::nullopt;
+
+    scene.strings.resize(numStrings);
+    for (std::string &string : scene.strings)
+    {
+        if (!reader.readString(string))
+            return std::nullopt;
+    }
+
+    uint8_t hasCamera = false;
+    SceneDescription::Camera camera;
+    if (!reader.readArray(scene.textures) || !reader.readArray(scene.cubemaps)
+        || !reader.readArray(scene.materials) || !reader.readArray(scene.models)
+        || !reader.readArray(scene.lights) || !reader.readArray(scene.objects)
+        || !reader.read(hasCamera) || !reader.read(camera) || !reader.read(scene.skybox))
+    {
+        return std::nullopt;
+    }
+    if (hasCamera)
+        scene.camera = camera;
+
+    if (!isConsistent(scene))
+        return std::nullopt;
+
+    return scene;
+}
+
+bool write(const std::filesystem::path &file, uint64_t key, const SceneDescription &scene)
+{
+    return writeAtomically(file, [&](BlobWriter &writer) {
+        writer.write(Magic);
+        writer.write(SceneFile::Version);
+        writer.write(static_cast<uint32_t>(sizeof(SceneDescription::Object)));
+        writer.write(key);
+
+        writer.write(static_cast<uint32_t>(scene.strings.size()));
+        for (const std::string &string : scene.strings)
+            writer.writeString(string);
+
+        writer.writeArray(scene.textures);
+        writer.writeArray(scene.cubemaps);
+        writer.writeArray(scene.materials);
+        writer.writeArray(scene.models);
+        writer.writeArray(scene.lights);
+        writer.writeArray(scene.objects);
+        writer.write(static_cast<uint8_t>(scene.camera.has_value()));
+        writer.write(scene.camera.value_or(SceneDescription::Camera{}));
+        writer.write(scene.skybox);
+
+        return true;
+    });
+}
+
+uint64_t sourceKey(std::string_view text)
+{
+    uint64_t hash = Utilities::hashBytes(reinterpret_cast<const std::byte *>(text.data()),
+                                         text.size());
+    hash = Utilities::hashCombine(hash, SceneFile::Version);
+    return hash != 0 ? hash : 1;
+}
+} // namespace
+
+namespace SceneFile
+{
+std::optional<SceneDescription> parse(std::string_view text, const std::filesystem::path &source)
+{
+    return TextParser(source).parse(text);
+}
+
+std::optional<SceneDescription> load(const std::filesystem::path &source)
+{
+    const MappedFile file(source);
+    if (!file.isOpen())
+    {
+        std::cerr << "Failed to open the scene " << source.string() << std::endl;
+        return std::nullopt;
+    }
+
+    if (file.size() >= Magic.size()
+        && std::memcmp(file.data(), Magic.data(), Magic.size()) == 0)
+    {
+        std::optional<SceneDescription> scene = read(file.data(), file.size(), 0);
+        if (!scene)
+            std::cerr << "The scene " << source.string() << " is damaged or outdated" << std::endl;
+        return scene;
+    }
+
+    const std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+    const uint64_t key = sourceKey(text);
+    const std::filesystem::path cacheFile = cachePath(source);
+    {
+        const MappedFile cached(cacheFile);
+        if (cached.isOpen())
+        {
+            if (std::optional<SceneDescription> scene = read(cached.data(), cached.size(), key))
+                return scene;
+        }
+    }
+
+    std::optional<SceneDescription> scene = parse(text, source);
+    if (scene && !write(cacheFile, key, *scene))
+        std::cerr << "Failed to cache the scene " << source.string() << std::endl;
+    return scene;
+}
+
+std::filesystem::path cachePath(const std::filesystem::path &source)
+{
+    std::error_code error;
+    const std::string sourcePath = std::filesystem::absolute(source, error).generic_string();
+    const uint64_t pathHash = Utilities::hashBytes(
+        reinterpret_cast<const std::byte *>(sourcePath.data()), sourcePath.size());
+
+    std::ostringstream fileName;
+    fileName << source.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0')
+             << pathHash << ".bin";
+    return std::filesystem::path(ENGINE_CACHE) / "scenes" / fileName.str();
+}
+
+bool store(const std::filesystem::path &file, const SceneDescription &scene)
+{
+    return write(file, 0, scene);
+}
+} // namespace SceneFile
@@ -0,0 +1,310 @@
+#include "sceneloader.h"
+
+#include "lightmanager.h"
+#include "materialmanager.h"
+#include "meshmanager.h"
+#include "objectmanager.h"
+#include "startupprofiler.h"
+#include "texturemanager.h"
+#include "texturemanager3d.h"
+#include "transformmanager.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+GLenum wrappingMode(SceneDescription::Wrapping wrapping)
+{
+    switch (wrapping)
+    {
+    case SceneDescription::Wrapping::Repeat:
+        return GL_REPEAT;
+    case SceneDescription::Wrapping::Clamp:
+        return GL_CLAMP_TO_EDGE;
+    default:
+        return GL_MIRRORED_REPEAT;
+    }
+}
+
+std::vector<TextureIdentifier> registerTextures(const SceneDescription &scene)
+{
+    std::vector<TextureIdentifier> textureIds;
+    textureIds.reserve(scene.textures.size());
+    for (const SceneDescription::Texture &texture : scene.textures)
+    {
+        const TextureIdentifier id = TextureManager::instance()->registerTexture(
+            scene.string(texture.path).c_str(), scene.string(texture.name));
+        textureIds.emplace_back(id);
+
+        Texture2D *texture2D = TextureManager::instance()->getTexture(id);
+        if (texture.anisotropy > 0)
+            texture2D->setUseAnisotropic(true, texture.anisotropy);
+        if (texture.wrapping != SceneDescription::Wrapping::Default)
+        {
+            const GLenum mode = wrappingMode(texture.wrapping);
+            texture2D->setParameters(Texture2DParameters{ .wrappingS = mode,
+                                                          .wrappingT = mode,
+                                                          .filteringMin = GL_LINEAR_MIPMAP_LINEAR,
+                                                          .filteringMag = GL_LINEAR });
+        }
+    }
+    return textureIds;
+}
+
+std::vector<Component> registerMaterials(const SceneDescription &scene,
+                                         const std::vector<TextureIdentifier> &textureIds)
+{
+    std::vector<Component> materials;
+    materials.reserve(scene.materials.size());
+    for (const SceneDescription::Material &material : scene.materials)
+    {
+        std::array<TextureIdentifier, 5> textures;
+        std::ranges::transform(material.textures, textures.begin(), [&textureIds](uint32_t t) {
+            return t == SceneDescription::None ? InvalidIdentifier : textureIds[t];
+        });
+
+        const std::string &name = scene.string(material.name);
+        if (material.pbr)
+        {
+            materials.emplace_back(
+                ComponentType::PBR_MATERIAL,
+                MaterialManager<PbrMaterial, ComponentType::PBR_MATERIAL>::instance()
+                    ->registerMaterial(PbrMaterial{ textures[0], textures[1], textures[2],
+                                                    textures[3], textures[4] },
+                                       name));
+        }
+        else
+        {
+            materials.emplace_back(
+                ComponentType::BASIC_MATERIAL,
+                MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+                    ->registerMaterial(BasicMaterial{ textures[0], textures[1], textures[2] },
+                                       name));
+        }
+    }
+    return materials;
+}
+
+// the light of an object, once its transform is set
+template <ComponentType LightType>
+Component registerLight(const SceneDescription &scene, const SceneDescription::Light &light,
+                        TransformIdentifier tId, const std::vector<TextureIdentifier> &textureIds)
+{
+    auto *manager = LightManager<LightType>::instance();
+    const LightSourceIdentifier lId = manager->registerNewLight(scene.string(light.name), tId);
+    auto *lightStruct = manager->getLight(lId);
+
+    lightStruct->ambient = light.ambient;
+    lightStruct->specular = light.specular;
+    if constexpr (LightType != ComponentType::LIGHT_TEXTURED_SPOT)
+        lightStruct->diffuse = light.diffuse;
+    if constexpr (LightType != ComponentType::LIGHT_DIRECTIONAL)
+    {
+        lightStruct->attenuationConstantTerm = light.attenuation.x;
+        lightStruct->attenuationLinearTerm = light.attenuation.y;
+        lightStruct->attenuationQuadraticTerm = light.attenuation.z;
+    }
+
+    if constexpr (LightType == ComponentType::LIGHT_DIRECTIONAL)
+    {
+        if (light.shadowMapSize > 0)
+        {
+            const auto [bufId, textureIdentifier] = manager->createShadowMapPremises(
+                light.shadowMapSize, light.shadowMapSize);
+            lightStruct->frameBufferId = bufId;
+            lightStruct->shadowMapIdentifier = textureIdentifier;
+        }
+
+        const auto &[left, right, bottom, top, near, far] = light.ortho;
+        lightStruct->setProjectionMatrix(glm::ortho(left, right, bottom, top, near, far));
+    }
+    else if constexpr (LightType == ComponentType::LIGHT_SPOT)
+    {
+        lightStruct->computeIntrinsics(light.cutOff.x, light.cutOff.y);
+    }
+    else if constexpr (LightType == ComponentType::LIGHT_TEXTURED_SPOT)
+    {
+        lightStruct->computeIntrinsics(light.cutOff.x, light.cutOff.y, tId);
+
+        if (light.texture != SceneDescription::None)
+        {
+            const TextureIdentifier texture = textureIds[light.texture];
+            TextureManager::instance()->allocateTexture(texture);
+#if ENGINE_DISABLE_BINDLESS_TEXTURES
+            lightStruct->textureIdx = 0xFF00FF00FF00FF00;
+#else
+            const auto texHandle = glGetTextureHandleARB(
+                *TextureManager::instance()->getTexture(texture));
+            glMakeTextureHandleResidentARB(texHandle);
+            lightStruct->textureIdx = texHandle;
+#endif
+        }
+    }
+
+    return Component(LightType, lId);
+}
+
+Component registerLight(const SceneDescription &scene, const SceneDescription::Light &light,
+                        TransformIdentifier tId, const std::vector<TextureIdentifier> &textureIds)
+{
+    switch (light.type)
+    {
+    case SceneDescription::LightType::Directional:
+        return registerLight<ComponentType::LIGHT_DIRECTIONAL>(scene, light, tId, textureIds);
+    case SceneDescription::LightType::Spot:
+        return registerLight<ComponentType::LIGHT_SPOT>(scene, light, tId, textureIds);
+    case SceneDescription::LightType::TexturedSpot:
+        return registerLight<ComponentType::LIGHT_TEXTURED_SPOT>(scene, light, tId, textureIds);
+    default:
+        return registerLight<ComponentType::LIGHT_POINT>(scene, light, tId, textureIds);
+    }
+}
+
+// the children first, like ShaderProgram::addObjectWithChildren
+void collectWithChildren(GameObjectIdentifier gId, std::vector<GameObjectIdentifier> &objects)
+{
+    for (const GameObjectIdentifier child : ObjectManager::instance()->getObject(gId).children())
+        collectWithChildren(child, objects);
+    objects.emplace_back(gId);
+}
+} // namespace
+
+GameObjectIdentifier LoadedScene::object(const std::string &name) const
+{
+    const auto namePtr = namedObjects.find(name);
+    return namePtr == namedObjects.end() ? InvalidIdentifier : namePtr->second;
+}
+
+namespace SceneLoader
+{
+LoadedScene instantiate(const SceneDescription &scene,
+                        const std::vector<GameObjectIdentifier> &models)
+{
+    LoadedScene loaded;
+
+    StartupProfiler::Phase texturesPhase("textures and materials");
+    const std::vector<TextureIdentifier> textureIds = registerTextures(scene);
+    const std::vector<Component> materials = registerMaterials(scene, textureIds);
+    texturesPhase.end();
+
+    StartupProfiler::Phase cubemapsPhase("cubemaps");
+    for (uint32_t c = 0; c < scene.cubemaps.size(); ++c)
+    {
+        const SceneDescription::Cubemap &cubemap = scene.cubemaps[c];
+        std::array<const char *, 6> faces;
+        std::ranges::transform(cubemap.faces, faces.begin(),
+                               [&scene](uint32_t face) { return scene.string(face).c_str(); });
+
+        const TextureIdentifier3D id = CubemapManager::instance()->registerTexture(
+            faces, scene.string(cubemap.name));
+        if (c == scene.skybox)
+            loaded.skybox = id;
+    }
+    cubemapsPhase.end();
+
+    const StartupProfiler::Phase objectsPhase("objects");
+
+    // the objects of their own are created together, with their transforms; the model
+    // instances are copied from the loaded models as they come
+    const size_t numObjects = std::ranges::count(scene.objects, SceneDescription::None,
+                                                 &SceneDescription::Object::model);
+    const GameObjectIdentifier firstObject = ObjectManager::instance()->addObjects(numObjects);
+    const TransformIdentifier firstTransform = TransformManager::instance()
+                                                   ->registerNewTransforms(firstObject,
+                                                                           numObjects);
+    size_t numCreated = 0;
+
+    std::vector<bool> modelsTaken(scene.models.size(), false);
+    std::unordered_map<uint32_t, MeshIdentifier> meshIds; // by the mesh names
+    loaded.objects.reserve(scene.objects.size());
+    for (const SceneDescription::Object &object : scene.objects)
+    {
+        GameObjectIdentifier gId = InvalidIdentifier;
+        TransformIdentifier tId = InvalidIdentifier;
+        if (object.model == SceneDescription::None)
+        {
+            gId = firstObject + numCreated;
+            tId = firstTransform + numCreated;
+            ++numCreated;
+            ObjectManager::instance()->getObject(gId).addComponent(
+                Component(ComponentType::TRANSFORM, tId));
+        }
+        else
+        {
+            // the failed loads are reported by the model loader
+            const GameObjectIdentifier root = models[object.model];
+            if (root == InvalidIdentifier)
+            {
+                loaded.objects.emplace_back(InvalidIdentifier);
+                continue;
+            }
+
+            gId = modelsTaken[object.model] ? ObjectManager::instance()->copyObject(root) : root;
+            modelsTaken[object.model] = true;
+            tId = ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+                ComponentType::TRANSFORM);
+        }
+        GameObject &gameObject = ObjectManager::instance()->getObject(gId);
+
+        Transform *transform = TransformManager::instance()->getTransform(tId);
+        transform->setPosition(object.position);
+        transform->setRotation(glm::mat4_cast(object.rotation));
+        transform->setScale(object.scale);
+
+        if (object.mesh != SceneDescription::None)
+        {
+            auto meshPtr = meshIds.find(object.mesh);
+            if (meshPtr == meshIds.end())
+            {
+                const std::string &meshName = scene.string(object.mesh);
+                meshPtr = meshIds.emplace(object.mesh,
+                                          MeshManager::instance()->meshRegistered(meshName))
+                              .first;
+                if (meshPtr->second == InvalidIdentifier)
+                    std::cerr << "The scene refers to the unknown mesh " << meshName << std::endl;
+            }
+            if (meshPtr->second != InvalidIdentifier)
+                gameObject.addComponent(Component(ComponentType::MESH, meshPtr->second), true);
+        }
+        else if (object.shader == SceneDescription::Shader::Axes)
+        {
+            gameObject.addComponent(
+                Component(ComponentType::MESH, MeshManager::instance()->getDummyMesh()), true);
+        }
+
+        if (object.material != SceneDescription::None)
+            gameObject.addComponent(materials[object.material], true);
+        if (object.light != SceneDescription::None)
+            gameObject.addComponent(registerLight(scene, scene.lights[object.light], tId,
+                                                  textureIds));
+        gameObject.setCastsShadows(object.castsShadows);
+
+        if (object.parent != SceneDescription::None
+            && loaded.objects[object.parent] != InvalidIdentifier)
+        {
+            ObjectManager::instance()->getObject(loaded.objects[object.parent])
+                .addChildObject(gId);
+        }
+
+        // the children so far are the model's nodes
+        if (object.shader != SceneDescription::Shader::None)
+        {
+            std::vector<GameObjectIdentifier> &shaderObjects
+                = loaded.shaderObjects[static_cast<size_t>(object.shader)];
+            if (object.model != SceneDescription::None)
+                collectWithChildren(gId, shaderObjects);
+            else
+                shaderObjects.emplace_back(gId);
+        }
+
+        if (object.name != SceneDescription::None)
+            loaded.namedObjects.emplace(scene.string(object.name), gId);
+        loaded.objects.emplace_back(gId);
+    }
+
+    return loaded;
+}
+} // namespace SceneLoader
@@ -2,25 +2,120 @@
 
 #include "instancer.h"
 #include "materialmanager.h"
+#include "programcache.h"
+#include "startupprofiler.h"
 #include "transformmanager.h"
+#include "viewconstantsmanager.h"
 
 #include "glad/glad.h"
 
 #include <cstdint>
 #include <span>
+#include <string_view>
+
+namespace
+{
+// GL_KHR_parallel_shader_compile, which glad wasn't generated with
+constexpr GLenum CompletionStatus = 0x91B1;
+using MaxShaderCompilerThreadsProc = void(APIENTRYP)(GLuint count);
+
+bool parallelCompilation = false;
+} // namespace
 
 ShaderProgram::ShaderProgram() {}
 
 void ShaderProgram::initializeShaderProgram()
 {
+    // a program a batch submitted is only left to complete
     if (_id != 0)
+    {
+        completeShaderProgram();
         return;
+    }
+    const StartupProfiler::Phase phase("shader program");
+
+    submitShaderProgram();
+    completeShaderProgram();
+}
+
+void ShaderProgram::submitShaderProgram()
+{
+    if (_id != 0)
+        return;
+
     _id = glCreateProgram();
+    // the stages get their sources, and are only compiled if the cache doesn't have the program
     compileAndAttachNecessaryShaders(_id);
-    linkProgram(_id);
+
+    _cacheKey = ProgramCache::programKey(_id);
+    if (ProgramCache::load(_id, _cacheKey))
+    {
+        _deferredShaders.clear();
+        deleteShaders();
+        return;
+    }
+
+    // no status is asked for here, which would wait for the driver
+    for (const uint32_t shaderId : _deferredShaders)
+        glCompileShader(shaderId);
+    if (ProgramCache::isEnabled())
+        glProgramParameteri(_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(_id);
+    _linkPending = true;
+}
+
+bool ShaderProgram::isShaderProgramCompleted() const
+{
+    if (!_linkPending || !parallelCompilation)
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(_id, CompletionStatus, &completed);
+    return completed == GL_TRUE;
+}
+
+void ShaderProgram::completeShaderProgram()
+{
+    if (!_linkPending)
+        return;
+    const StartupProfiler::Phase phase("compile and link");
+
+    for (const uint32_t shaderId : _deferredShaders)
+        checkCompileStatus(shaderId);
+    if (checkLinkStatus(_id))
+        ProgramCache::store(_id, _cacheKey);
+
+    _deferredShaders.clear();
+    _linkPending = false;
     deleteShaders();
 }
 
+void ShaderProgram::enableParallelCompilation(GLADloadproc load)
+{
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint e = 0; e < numExtensions && !parallelCompilation; ++e)
+    {
+        const std::string_view extension = reinterpret_cast<const char *>(
+            glGetStringi(GL_EXTENSIONS, e));
+        parallelCompilation = extension == "GL_KHR_parallel_shader_compile"
+                              || extension == "GL_ARB_parallel_shader_compile";
+    }
+    if (!parallelCompilation)
+        return;
+
+    // the same entry point under either name; as many threads as the driver sees fit
+    auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(
+        load("glMaxShaderCompilerThreadsKHR"));
+    if (maxShaderCompilerThreads == nullptr)
+    {
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(
+            load("glMaxShaderCompilerThreadsARB"));
+    }
+    if (maxShaderCompilerThreads != nullptr)
+        maxShaderCompilerThreads(0xFFFFFFFF);
+}
+
 ShaderProgram::~ShaderProgram() { glDeleteProgram(_id); }
 
 void ShaderProgram::use() const { glUseProgram(programId()); }
@@ -81,10 +176,10 @@ void ShaderProgram::addObjectWithChildren(GameObjectIdentifier gId)
     addObject(gId);
 }
 
-void ShaderProgram::compileShader(uint32_t shaderId)
-{
-    glCompileShader(shaderId);
+void ShaderProgram::deferShader(uint32_t shaderId) { _deferredShaders.emplace_back(shaderId); }
 
+bool ShaderProgram::checkCompileStatus(uint32_t shaderId)
+{
     int success;
     glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
     if (!success)
@@ -92,12 +187,11 @@ void ShaderProgram::compileShader(uint32_t shaderId)
         glGetShaderInfoLog(shaderId, sizeof(_infoLog), NULL, _infoLog);
         std::cerr << "Shader compilation failed. Details: " << _infoLog;
     }
+    return success;
 }
 
-void ShaderProgram::linkProgram(uint32_t programId)
+bool ShaderProgram::checkLinkStatus(uint32_t programId)
 {
-    glLinkProgram(programId);
-
     int success;
     glGetProgramiv(programId, GL_LINK_STATUS, &success);
     if (!success)
@@ -105,6 +199,7 @@ void ShaderProgram::linkProgram(uint32_t programId)
         glGetProgramInfoLog(programId, sizeof(_infoLog), NULL, _infoLog);
         std::cerr << "Program linking failed. Details: " << _infoLog;
     }
+    return success;
 }
 
 std::string ShaderProgram::readShaderSource(const char *shaderSource)
@@ -122,10 +217,59 @@ std::string ShaderProgram::readShaderSource(const char *shaderSource)
         shaderFile.close();
 
         shaderCode = shaderStream.str();
+        StartupProfiler::instance()->addBytesLoaded(shaderCode.size());
     }
     catch (std::ifstream::failure &e)
     {
         std::cout << "Failed to read the shader file: " << e.what() << std::endl;
     }
+
+    // the preamble goes after the #version and #extension lines, which have to come first
+    size_t preamblePos = std::string::npos;
+    if (const size_t versionPos = shaderCode.find("#version"); versionPos != std::string::npos)
+    {
+        const size_t extensionPos = shaderCode.rfind("#extension");
+        const size_t lastDirective =
+            extensionPos != std::string::npos && extensionPos > versionPos ? extensionPos
+                                                                           : versionPos;
+        if (const size_t lineEnd = shaderCode.find('\n', lastDirective);
+            lineEnd != std::string::npos)
+        {
+            preamblePos = lineEnd + 1;
+        }
+    }
+
+    if (preamblePos != std::string::npos)
+    {
+        std::string preamble;
+#if !ENGINE_FULL_FLOAT_VERTICES
+        // lets the vertex shaders pick the decode matching the mesh arenas (see MeshManager)
+        preamble += "#define ENGINE_COMPACT_VERTICES\n";
+#endif
+        preamble += ViewConstantsDeclaration;
+        shaderCode.insert(preamblePos, preamble);
+    }
     return shaderCode;
-}
\ No newline at end of file
+}
+
+void ShaderProgramBatch::add(ShaderProgram &program)
+{
+    const StartupProfiler::Phase phase("shader program submission");
+    program.submitShaderProgram();
+    _programs.emplace_back(&program);
+}
+
+void ShaderProgramBatch::complete()
+{
+    // the ones the driver is done with first, so that they're stored in the cache while it works
+    // on the rest
+    std::erase_if(_programs, [](ShaderProgram *program) {
+        if (!program->isShaderProgramCompleted())
+            return false;
+        program->completeShaderProgram();
+        return true;
+    });
+    for (ShaderProgram *program : _programs)
+        program->completeShaderProgram();
+    _programs.clear();
+}
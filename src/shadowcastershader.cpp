@@ -0,0 +1,259 @@
+#include "shadowcastershader.h"
+
+#include "glad/glad.h"
+
+#include "meshmanager.h"
+#include "objectmanager.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+MeshIdentifier meshForObject(GameObjectIdentifier gId)
+{
+    return ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+        ComponentType::MESH);
+}
+
+// the model matrix is the only per-instance data of the depth path
+InstancedDataGenerator modelMatrixColumnGenerator(size_t column)
+{
+    return InstancedDataGenerator{
+        sizeof(glm::vec4),
+        4,
+        1 + column,
+        GL_FLOAT,
+        false,
+        [column](void *destination, GameObjectIdentifier gId) {
+            const glm::mat4 modelMat
+                = TransformManager::instance()
+                      ->getTransform(
+                          ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+                              ComponentType::TRANSFORM))
+                      ->computeModelMatrix();
+
+            std::memcpy(destination,
+                        reinterpret_cast<const int8_t *>(&modelMat) + (column * sizeof(glm::vec4)),
+                        sizeof(glm::vec4));
+        }
+    };
+}
+
+#if !ENGINE_FULL_FLOAT_VERTICES
+// the compact positions' decode is per mesh, and a multi-draw spans many of them, so each
+// instance carries its mesh's
+InstancedDataGenerator positionDecodingGenerator(size_t location, bool offset)
+{
+    return InstancedDataGenerator{
+        sizeof(glm::vec3),
+        3,
+        location,
+        GL_FLOAT,
+        false,
+        [offset](void *destination, GameObjectIdentifier gId) {
+            const Mesh *mesh = MeshManager::instance()->getMesh(meshForObject(gId));
+            const glm::vec3 decoding = offset ? mesh->positionOffset() : mesh->positionScale();
+            std::memcpy(destination, &decoding, sizeof(glm::vec3));
+        }
+    };
+}
+#endif
+
+std::vector<InstancedDataGenerator> getDataGenerators()
+{
+    return { modelMatrixColumnGenerator(0), modelMatrixColumnGenerator(1),
+             modelMatrixColumnGenerator(2), modelMatrixColumnGenerator(3),
+#if !ENGINE_FULL_FLOAT_VERTICES
+             positionDecodingGenerator(5, false), positionDecodingGenerator(6, true)
+#endif
+    };
+}
+} // namespace
+
+ShadowCasterShader::~ShadowCasterShader()
+{
+    glDeleteBuffers(1, &_indirectBuffer);
+    glDeleteBuffers(1, &_instancedBufferId);
+    MeshManager::instance()->releaseVertexArray(_vertexArray);
+}
+
+void ShadowCasterShader::addCasterSource(const ShaderProgram *source)
+{
+    _sources.emplace_back(source);
+    _numSourceObjects = static_cast<size_t>(-1); // forces regathering
+}
+
+void ShadowCasterShader::runShader()
+{
+    size_t numSourceObjects = 0;
+    for (const ShaderProgram *source : _sources)
+        numSourceObjects += source->shaderObjects().size();
+
+    if (numSourceObjects != _numSourceObjects)
+    {
+        _numSourceObjects = numSourceObjects;
+        rebuildCasters();
+    }
+
+    if (_drawCommands.empty())
+        return;
+
+    if (_instancesDirty)
+        rebuildInstances();
+
+    use();
+
+    glBindVertexArray(_vertexArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+
+    // a multi-draw takes a single index type, and the arenas mix 16 and 32-bit ranges
+    const auto numShortCommands = static_cast<GLsizei>(_numShortIndexCommands);
+    const auto numIntCommands = static_cast<GLsizei>(_drawCommands.size()
+                                                     - _numShortIndexCommands);
+    if (numShortCommands > 0)
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, numShortCommands, 0);
+    if (numIntCommands > 0)
+    {
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void *)(uintptr_t)(_numShortIndexCommands * sizeof(DrawElementsIndirectCommand)),
+            numIntCommands, 0);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void ShadowCasterShader::updateInstancedBuffer(
+    const std::unordered_set<GameObjectIdentifier> &objsToUpdate)
+{
+    if (_instancesDirty)
+        return;
+
+    _instancesDirty = std::ranges::any_of(
+        objsToUpdate, [this](GameObjectIdentifier gId) { return _casterSet.contains(gId); });
+}
+
+void ShadowCasterShader::rebuildCasters()
+{
+    _casters.clear();
+    _casterSet.clear();
+    for (const ShaderProgram *source : _sources)
+    {
+        for (const GameObjectIdentifier gId : source->shaderObjects())
+        {
+            const GameObject &object = ObjectManager::instance()->getObject(gId);
+            const MeshIdentifier meshId = meshForObject(gId);
+            if (!object.castsShadows() || meshId == InvalidIdentifier)
+                continue;
+
+            // the sources may not have drawn it yet; the range is needed now
+            MeshManager::instance()->allocateMesh(meshId);
+            const Mesh *mesh = MeshManager::instance()->getMesh(meshId);
+            if (mesh == nullptr || !mesh->isAllocated() || mesh->numIndices() == 0)
+                continue;
+
+            if (_casterSet.emplace(gId).second)
+                _casters.emplace_back(gId);
+        }
+    }
+
+    // the sources are each ordered by mesh, but the same mesh may appear in several of them
+    std::ranges::stable_sort(_casters, [](GameObjectIdentifier gId1, GameObjectIdentifier gId2) {
+        const MeshIdentifier mId1 = meshForObject(gId1);
+        const MeshIdentifier mId2 = meshForObject(gId2);
+        const bool shortIndices1 = MeshManager::instance()->getMesh(mId1)->indexType()
+                                   == GL_UNSIGNED_SHORT;
+        const bool shortIndices2 = MeshManager::instance()->getMesh(mId2)->indexType()
+                                   == GL_UNSIGNED_SHORT;
+        return shortIndices1 != shortIndices2 ? shortIndices1 : mId1 < mId2;
+    });
+
+    rebuildCommands();
+    _instancesDirty = true;
+}
+
+void ShadowCasterShader::rebuildCommands()
+{
+    if (_vertexArray == 0)
+    {
+        _vertexArray = MeshManager::instance()->createPositionVertexArray();
+        glGenBuffers(1, &_indirectBuffer);
+        glGenBuffers(1, &_instancedBufferId);
+
+        Instancer::instance()->attachInstancedBuffer(_instancedBufferId, getDataGenerators(),
+                                                     _vertexArray);
+    }
+
+    // one command per run of casters sharing a mesh; the instances follow the same order
+    _drawCommands.clear();
+    _numShortIndexCommands = 0;
+    for (size_t c = 0; c < _casters.size(); ++c)
+    {
+        const MeshIdentifier meshId = meshForObject(_casters[c]);
+        if (c > 0 && meshForObject(_casters[c - 1]) == meshId)
+        {
+            ++_drawCommands.back().instanceCount;
+            continue;
+        }
+
+        const Mesh &mesh = *MeshManager::instance()->getMesh(meshId);
+        const bool shortIndices = mesh.indexType() == GL_UNSIGNED_SHORT;
+        const GLuint indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+        _drawCommands.emplace_back(mesh.numIndices(), 1, mesh.indexByteOffset() / indexSize,
+                                   mesh.baseVertex(), static_cast<GLuint>(c));
+        _numShortIndexCommands += shortIndices ? 1 : 0;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 _drawCommands.size() * sizeof(DrawElementsIndirectCommand),
+                 _drawCommands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void ShadowCasterShader::rebuildInstances()
+{
+    Instancer::instance()->rewriteInstancedData(_instancedBufferId, _casters, getDataGenerators(),
+                                                _instancedBufferCapacity);
+    _instancesDirty = false;
+}
+
+void ShadowCasterShader::compileAndAttachNecessaryShaders(uint32_t id)
+{
+    if (_vertexShaderId == 0)
+    {
+        const std::string &vShaderCode = readShaderSource(_vertexPath);
+
+        const char *vPtr = vShaderCode.c_str();
+
+        _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
+        deferShader(_vertexShaderId);
+    }
+
+    glAttachShader(id, _vertexShaderId);
+
+    if (_fragmentShaderId == 0)
+    {
+        const std::string &fShaderCode = readShaderSource(_fragmentPath);
+
+        const char *fPtr = fShaderCode.c_str();
+
+        _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
+        deferShader(_fragmentShaderId);
+    }
+
+    glAttachShader(id, _fragmentShaderId);
+}
+
+void ShadowCasterShader::deleteShaders()
+{
+    glDeleteShader(_vertexShaderId);
+    _vertexShaderId = 0;
+
+    glDeleteShader(_fragmentShaderId);
+    _fragmentShaderId = 0;
+}
@@ -5,23 +5,24 @@
 #include "lightmanager.h"
 #include "lightvisualizationshader.h"
 #include "pbrshader.h"
+#include "viewconstantsmanager.h"
 
 ShadowPass::ShadowPass(InstancedBlinnPhongShader *ins, LightVisualizationShader *lightVis,
-                       PbrShader *pbrShader)
-    : _shaderProgramMain(ins),
-      _lightVisualizationShader(lightVis),
-      _pbrShader(pbrShader),
-      _passThroughOverride(ENGINE_SHADERS "/depth_pass_through.vs",
-                           ENGINE_SHADERS "/depth_pass_through.fs"),
-      _passThroughOverridePbr(ENGINE_SHADERS "/depth_pass_through_pbr.vs",
-                           ENGINE_SHADERS "/depth_pass_through.fs")
+                       PbrShader *pbrShader, ShaderProgramBatch &batch)
+    : _shaderProgramMain(ins), _lightVisualizationShader(lightVis), _pbrShader(pbrShader)
 {
-    _passThroughOverride.initializeShaderProgram();
-    _passThroughOverridePbr.initializeShaderProgram();
+    batch.add(_shadowCasters);
+
+    // the light gizmos are flagged as non-casters (and have no mesh of their own), they are
+    // skipped when the casters are gathered
+    _shadowCasters.addCasterSource(_shaderProgramMain);
+    _shadowCasters.addCasterSource(_lightVisualizationShader);
+    _shadowCasters.addCasterSource(_pbrShader);
 }
 
 void ShadowPass::runPass()
 {
+    size_t lightCounter = 0;
     for (const DirectionalLight &l :
          LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()->getLights())
     {
@@ -31,37 +32,21 @@ void ShadowPass::runPass()
 
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        const glm::mat4 &projection = l.dummyProjectionMatrix;
-        const glm::mat4 &view = l.dummyViewMatrix;
-
-        _shaderProgramMain->setShaderProgramOverride(_passThroughOverride);
-        _lightVisualizationShader->setShaderProgramOverride(_passThroughOverride);
-        _pbrShader->setShaderProgramOverride(_passThroughOverridePbr);
-
-        {
-            _shaderProgramMain->use();
-            _shaderProgramMain->setMatrix4("view", view);
-            _shaderProgramMain->setMatrix4("projection", projection);
-            _shaderProgramMain->runShader();
-        }
-
-        {
-            _lightVisualizationShader->use();
-            _lightVisualizationShader->setMatrix4("view", view);
-            _lightVisualizationShader->setMatrix4("projection", projection);
-            _lightVisualizationShader->runShader();
-        }
-
-        {
-            _pbrShader->use();
-            _pbrShader->setMatrix4("view", view);
-            _pbrShader->setMatrix4("projection", projection);
-            _pbrShader->runShader();
-        }
+        // one upload per light view, the depth shaders read it from the shared view block
+        const size_t lightView = ViewConstantsManager::directionalLightView(lightCounter++);
+        ViewConstantsManager::instance()->updateView(lightView, l.dummyViewMatrix,
+                                                     l.dummyProjectionMatrix, l.dummyPosition);
+        ViewConstantsManager::instance()->bindView(lightView);
 
-        _shaderProgramMain->removeShaderProgramOverride();
-        _lightVisualizationShader->removeShaderProgramOverride();
-        _pbrShader->removeShaderProgramOverride();
+        // every caster of every source in one multi-draw
+        _shadowCasters.runShader();
     }
     FrameBufferManager::instance()->unbindFrameBuffer(GL_FRAMEBUFFER);
-}
\ No newline at end of file
+    ViewConstantsManager::instance()->bindView(ViewConstantsManager::CameraView);
+}
+
+void ShadowPass::updateInstancedBuffer(
+    const std::unordered_set<GameObjectIdentifier> &objsToUpdate)
+{
+    _shadowCasters.updateInstancedBuffer(objsToUpdate);
+}
@@ -20,14 +20,12 @@ void SkyboxShader::runShader()
 
         if (bindPoint != -1)
         {
-            const Mesh *skyMesh = MeshManager::instance()->getMesh(_skyboxMesh);
-
             const glm::mat4 skyboxModel = glm::scale(glm::identity<glm::mat4>(),
                                                       glm::vec3(-1.0f, -1.0f, -1.0f));
             setInt("skyboxSampler", bindPoint);
             setMatrix4("model", skyboxModel);
 
-            glDrawElements(GL_TRIANGLES, skyMesh->numIndices(), GL_UNSIGNED_INT, 0);
+            MeshManager::instance()->drawMesh(_skyboxMesh);
             CubemapManager::instance()->unbindTexture(_skyboxTexture);
         }
 
@@ -44,7 +42,7 @@ void SkyboxShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -57,7 +55,7 @@ void SkyboxShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
@@ -12,6 +12,8 @@
 #include "pbrshader.h"
 #include "skyboxshader.h"
 #include "texturemanager.h"
+#include "texturestreamer.h"
+#include "viewconstantsmanager.h"
 #include "window.h"
 #include "worldplaneshader.h"
 
@@ -47,11 +49,8 @@ void StandardPass::runPass()
 {
     _currentWindow->resetViewport();
 
-    const glm::mat4 projection = _currentCamera->projectionMatrix();
-    const glm::mat4 view = _currentCamera->getViewMatrix();
-
-    static float directionalShadowBias = 0.0f;
     {
+        float directionalShadowBias = ViewConstantsManager::instance()->directionalShadowBias();
         {
             const auto [viewportX, viewportY] = _currentWindow->currentWindowDimensions();
             ImGui::SetNextWindowPos(ImVec2(viewportX * 0.05, viewportY * 0.07), ImGuiCond_Always,
@@ -60,52 +59,76 @@ void StandardPass::runPass()
         ImGui::Begin("Standard pass parameters", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
         ImGui::Text("Shadow mapping");
         ImGui::Separator();
-        ImGui::SliderFloat("Directional shadow bias", &directionalShadowBias, 0.001f, 0.35f);
+        if (ImGui::SliderFloat("Directional shadow bias", &directionalShadowBias, 0.001f, 0.35f))
+            ViewConstantsManager::instance()->setDirectionalShadowBias(
+                directionalShadowBias); // picked up with the next view upload
+
+        ImGui::Text("Mesh LODs and meshlets");
+        ImGui::Separator();
+        bool lodsEnabled = _pbrShader->lodsEnabled();
+        float lodPixelError = _pbrShader->lodPixelError();
+        const bool lodsToggled = ImGui::Checkbox("LODs", &lodsEnabled);
+        const bool errorChanged = ImGui::SliderFloat("Max error (pixels)", &lodPixelError, 0.25f,
+                                                     8.0f, "%.2f");
+        if (lodsToggled || errorChanged)
+        {
+            _shaderProgramMain->setLodsEnabled(lodsEnabled);
+            _shaderProgramMain->setLodPixelError(lodPixelError);
+            _pbrShader->setLodsEnabled(lodsEnabled);
+            _pbrShader->setLodPixelError(lodPixelError);
+        }
+
+        bool meshletCulling = _pbrShader->meshletCullingEnabled();
+        if (ImGui::Checkbox("Meshlet culling", &meshletCulling))
+        {
+            _shaderProgramMain->setMeshletCullingEnabled(meshletCulling);
+            _pbrShader->setMeshletCullingEnabled(meshletCulling);
+        }
+        ImGui::Text("Meshlets: %zu of %zu",
+                    _shaderProgramMain->numMeshletsVisible() + _pbrShader->numMeshletsVisible(),
+                    _shaderProgramMain->numMeshletsTested() + _pbrShader->numMeshletsTested());
+        ImGui::Text("Triangles: %zu of %zu",
+                    _shaderProgramMain->numTrianglesDrawn() + _pbrShader->numTrianglesDrawn(),
+                    _shaderProgramMain->numTrianglesAtFullDetail()
+                        + _pbrShader->numTrianglesAtFullDetail());
+
+        ImGui::Text("Texture streaming");
+        ImGui::Separator();
+        const TextureStreamer::Statistics streaming = TextureStreamer::instance()->statistics();
+        constexpr size_t MiB = 1024 * 1024;
+        int budget = static_cast<int>(TextureStreamer::instance()->budget() / MiB);
+        if (ImGui::SliderInt("Budget (MiB)", &budget, 16, 4096))
+            TextureStreamer::instance()->setBudget(static_cast<size_t>(budget) * MiB);
+        ImGui::Text("Resident: %zu of %zu MiB in %zu textures, %zu loading",
+                    streaming.residentBytes / MiB, streaming.fullBytes / MiB,
+                    streaming.numTextures, streaming.numLoading);
+        ImGui::Text("Loads: %zu, evictions: %zu", streaming.numLoads, streaming.numEvictions);
         ImGui::End();
     }
 
+    // view, projection, light counts etc. come from the shared view block
+    ViewConstantsManager::instance()->bindView(ViewConstantsManager::CameraView);
+
+    const float viewportHeight
+        = static_cast<float>(_currentWindow->currentWindowDimensions().second);
+
     {
+        _shaderProgramMain->selectLods(_currentCamera, viewportHeight);
+        _shaderProgramMain->requestTextureResolutions(_currentCamera, viewportHeight);
+        _shaderProgramMain->cullMeshlets(_currentCamera);
         _shaderProgramMain->use();
         bindDirectionalShadowMaps(_shaderProgramMain);
-        _shaderProgramMain->setMatrix4("view", view);
-        _shaderProgramMain->setMatrix4("projection", projection);
-        _shaderProgramMain->setVec3("viewPos", _currentCamera->position());
-        _shaderProgramMain->setFloat("directionalShadowBias", directionalShadowBias);
-        _shaderProgramMain->setInt("numDirectionalLightsBound",
-                                   LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                                       ->getNumberOfBoundLights());
-        _shaderProgramMain->setInt("numPointLightsBound",
-                                   LightManager<ComponentType::LIGHT_POINT>::instance()
-                                       ->getNumberOfBoundLights());
-        _shaderProgramMain
-            ->setInt("numSpotLightsBound",
-                     LightManager<ComponentType::LIGHT_SPOT>::instance()->getNumberOfBoundLights());
-        _shaderProgramMain->setInt("numTexturedLightsBound",
-                                   LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()
-                                       ->getNumberOfBoundLights());
         _shaderProgramMain->runShader();
         // TextureManager::instance()->unbindAllTextures();
         MeshManager::instance()->unbindMesh();
     }
 
     {
+        _pbrShader->selectLods(_currentCamera, viewportHeight);
+        _pbrShader->requestTextureResolutions(_currentCamera, viewportHeight);
+        _pbrShader->cullMeshlets(_currentCamera);
         _pbrShader->use();
         bindDirectionalShadowMaps(_pbrShader);
-        _pbrShader->setMatrix4("view", view);
-        _pbrShader->setMatrix4("projection", projection);
-        _pbrShader->setVec3("viewPos", _currentCamera->position());
-        _pbrShader->setFloat("directionalShadowBias", directionalShadowBias);
-        _pbrShader->setInt("numDirectionalLightsBound",
-                           LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                               ->getNumberOfBoundLights());
-        _pbrShader->setInt("numPointLightsBound",
-                           LightManager<ComponentType::LIGHT_POINT>::instance()
-                               ->getNumberOfBoundLights());
-        _pbrShader->setInt("numSpotLightsBound", LightManager<ComponentType::LIGHT_SPOT>::instance()
-                                                     ->getNumberOfBoundLights());
-        _pbrShader->setInt("numTexturedLightsBound",
-                           LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()
-                               ->getNumberOfBoundLights());
         _pbrShader->runShader();
         // TextureManager::instance()->unbindAllTextures();
         MeshManager::instance()->unbindMesh();
@@ -114,21 +137,12 @@ void StandardPass::runPass()
     {
         _worldPlaneShader->use();
         bindDirectionalShadowMaps(_worldPlaneShader);
-        _worldPlaneShader->setMatrix4("view", view);
-        _worldPlaneShader->setMatrix4("projection", projection);
-        _worldPlaneShader->setVec3("viewPos", _currentCamera->position());
-        _worldPlaneShader->setFloat("directionalShadowBias", directionalShadowBias);
-        _worldPlaneShader->setInt("numDirectionalLightsBound",
-                                  LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                                      ->getNumberOfBoundLights());
         _worldPlaneShader->runShader();
         // TextureManager::instance()->unbindAllTextures();
         MeshManager::instance()->unbindMesh();
     }
     {
         _lightVisualizationShader->use();
-        _lightVisualizationShader->setMatrix4("view", view);
-        _lightVisualizationShader->setMatrix4("projection", projection);
         _lightVisualizationShader->runShader();
         // TextureManager::instance()->unbindAllTextures();
         MeshManager::instance()->unbindMesh();
@@ -137,8 +151,6 @@ void StandardPass::runPass()
     {
         glDepthFunc(GL_LEQUAL);
         _mainSkybox->use();
-        _mainSkybox->setMatrix4("view", glm::mat4(glm::mat3(view)));
-        _mainSkybox->setMatrix4("projection", projection);
         _mainSkybox->runShader();
         glDepthFunc(GL_LESS);
         // TextureManager::instance()->unbindAllTextures();
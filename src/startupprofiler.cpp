@@ -0,0 +1,205 @@
+#include "startupprofiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+template <typename Duration>
+double milliseconds(Duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+template <typename Duration>
+double microseconds(Duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// the phase names are ours, but a quote would still break the trace
+std::string jsonEscaped(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+} // namespace
+
+void StartupProfiler::start()
+{
+    _records.clear();
+    _openRecords.clear();
+    _running = true;
+    begin("startup");
+}
+
+void StartupProfiler::finish(const std::filesystem::path &tracePath)
+{
+    if (!_running)
+        return;
+
+    while (!_openRecords.empty())
+        end();
+    _running = false;
+
+    printReport();
+    if (!tracePath.empty())
+    {
+        if (writeTrace(tracePath))
+            std::cout << "Startup trace written to " << tracePath.string() << std::endl;
+        else
+            std::cerr << "Failed to write the startup trace " << tracePath.string() << std::endl;
+    }
+}
+
+bool StartupProfiler::begin(std::string_view name)
+{
+    if (!_running)
+        return false;
+
+    Record &record = _records.emplace_back();
+    record.name = name;
+    record.parent = _openRecords.empty() ? NoParent : _openRecords.back();
+    record.bytesAtStart = _bytesLoaded.load(std::memory_order_relaxed);
+    record.glObjectsAtStart = _glObjects.load(std::memory_order_relaxed);
+    record.start = Clock::now();
+
+    _openRecords.emplace_back(_records.size() - 1);
+    return true;
+}
+
+void StartupProfiler::end()
+{
+    if (_openRecords.empty())
+        return;
+
+    Record &record = _records[_openRecords.back()];
+    record.end = Clock::now();
+    record.bytesAtEnd = _bytesLoaded.load(std::memory_order_relaxed);
+    record.glObjectsAtEnd = _glObjects.load(std::memory_order_relaxed);
+
+    _openRecords.pop_back();
+}
+
+void StartupProfiler::addFileLoaded(const std::filesystem::path &path) noexcept
+{
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    if (!error)
+        addBytesLoaded(static_cast<size_t>(size));
+}
+
+void StartupProfiler::printReport() const
+{
+    if (_records.empty())
+        return;
+
+    std::vector<std::vector<size_t>> children(_records.size());
+    for (size_t r = 1; r < _records.size(); ++r)
+        children[_records[r].parent].emplace_back(r);
+
+    // the columns' formatting isn't left behind
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+
+    std::cout << std::left << std::setw(44) << "Startup phase" << std::right << std::setw(11)
+              << "total ms" << std::setw(11) << "self ms" << std::setw(11) << "MiB read"
+              << std::setw(12) << "GL objects" << '\n';
+    printGroup({ 0 }, children, 0);
+    std::cout << std::flush;
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+void StartupProfiler::printGroup(const std::vector<size_t> &group,
+                                 const std::vector<std::vector<size_t>> &children,
+                                 size_t depth) const
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    double totalMilliseconds = 0.0;
+    double childMilliseconds = 0.0;
+    uint64_t bytes = 0;
+    uint64_t glObjects = 0;
+    std::vector<size_t> groupChildren;
+    for (const size_t r : group)
+    {
+        const Record &record = _records[r];
+        totalMilliseconds += milliseconds(record.end - record.start);
+        bytes += record.bytesAtEnd - record.bytesAtStart;
+        glObjects += record.glObjectsAtEnd - record.glObjectsAtStart;
+        for (const size_t child : children[r])
+        {
+            childMilliseconds += milliseconds(_records[child].end - _records[child].start);
+            groupChildren.emplace_back(child);
+        }
+    }
+
+    std::string name = std::string(depth * 2, ' ') + _records[group.front()].name;
+    if (group.size() > 1)
+        name += " (x" + std::to_string(group.size()) + ")";
+
+    std::cout << std::left << std::setw(44) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(11) << totalMilliseconds << std::setw(11)
+              << totalMilliseconds - childMilliseconds << std::setw(11) << bytes / MiB
+              << std::setw(12) << glObjects << '\n';
+
+    // the children grouped by name, in the order their names first came up
+    std::ranges::sort(groupChildren);
+    std::vector<bool> printed(groupChildren.size(), false);
+    for (size_t c = 0; c < groupChildren.size(); ++c)
+    {
+        if (printed[c])
+            continue;
+
+        std::vector<size_t> childGroup;
+        for (size_t other = c; other < groupChildren.size(); ++other)
+        {
+            if (!printed[other]
+                && _records[groupChildren[other]].name == _records[groupChildren[c]].name)
+            {
+                childGroup.emplace_back(groupChildren[other]);
+                printed[other] = true;
+            }
+        }
+        printGroup(childGroup, children, depth + 1);
+    }
+}
+
+// the Trace Event Format, with a complete event per phase
+bool StartupProfiler::writeTrace(const std::filesystem::path &tracePath) const
+{
+    std::error_code error;
+    if (tracePath.has_parent_path())
+        std::filesystem::create_directories(tracePath.parent_path(), error);
+
+    std::ofstream trace(tracePath);
+    if (!trace)
+        return false;
+
+    const Clock::time_point origin = _records.front().start;
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t r = 0; r < _records.size(); ++r)
+    {
+        const Record &record = _records[r];
+        trace << (r == 0 ? "\n" : ",\n") << "{\"name\":\"" << jsonEscaped(record.name)
+              << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << std::fixed
+              << std::setprecision(3) << microseconds(record.start - origin)
+              << ",\"dur\":" << microseconds(record.end - record.start)
+              << ",\"args\":{\"bytes\":" << record.bytesAtEnd - record.bytesAtStart
+              << ",\"glObjects\":" << record.glObjectsAtEnd - record.glObjectsAtStart << "}}";
+    }
+    trace << "\n]}\n";
+
+    return static_cast<bool>(trace);
+}
@@ -1,2 +1,9 @@
+#include "pixelpool.h"
+
+// the decoded images and the decoders' buffers come from the pool (see pixelpool.h)
+#define STBI_MALLOC(size) PixelPool::allocate(size)
+#define STBI_REALLOC(block, size) PixelPool::reallocate(block, size)
+#define STBI_FREE(block) PixelPool::release(block)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
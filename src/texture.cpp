@@ -1,10 +1,59 @@
 #include "texture.h"
 
 #include "glad/glad.h"
+#include "texturestreamer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <cassert>
+#include <utility>
+
+// the S3TC formats are an extension, which the bundled glad leaves out
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace
+{
+GLenum compressedFormat(BlockCompression::BlockFormat format, bool srgb)
+{
+    using BlockCompression::BlockFormat;
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool isFormatSupported(GLenum internalFormat)
+{
+    GLint supported = GL_FALSE;
+    glGetInternalformativ(GL_TEXTURE_2D, internalFormat, GL_INTERNALFORMAT_SUPPORTED, 1,
+                          &supported);
+    return supported == GL_TRUE;
+}
+
+GLenum internalFormatOf(const BakedTexture &texture, bool srgb)
+{
+    if (texture.format)
+        return compressedFormat(*texture.format, srgb);
+    return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+}
+
+} // namespace
 
 Texture2D::Texture2D(const char *textureSourcePath, bool enableAnisotropicFiltering,
                      Texture2DParameters params)
@@ -21,35 +70,73 @@ void Texture2D::allocateTexture()
     if (_textureId != 0)
         return;
 
-    int width, height, numChannels;
-    auto *imageData = stbi_load(_textureSourcePath.c_str(), &width, &height, &numChannels, 0);
+    TextureData data = _data ? std::move(_data) : prepareSource();
+    _data = TextureData{};
 
-    assert(numChannels > 0 && imageData != nullptr) ;
-
-    GLenum format = 0;
-    GLenum internalFormat = 0;
-    if (numChannels == 1)
+    // RGBA8, whose support is required, where the GL lacks the block format
+    if (data && data.texture->format
+        && !isFormatSupported(internalFormatOf(*data.texture, _settings.srgb)))
     {
-        format = GL_RED;
-        internalFormat = GL_RED;
+        TextureSettings uncompressed = _settings;
+        uncompressed.compression = TextureCompression::None;
+        data = TextureCache::prepare(_textureSourcePath, uncompressed,
+                                     _streamed ? TextureStreamer::TailSize : 0);
     }
-    else if (numChannels == 3)
+
+    assert(data);
+
+    // the mips come with the data: nothing is generated
+    BakedTexture &texture = *data.texture;
+    _internalFormat = internalFormatOf(texture, _settings.srgb);
+    _residentLevel = texture.firstLevel;
+    _cacheFile = std::move(data.cacheFile);
+    _cacheKey = data.cacheKey;
+    _layout = std::move(texture);
+    const std::vector<std::vector<uint8_t>> levels = std::move(_layout.levels);
+    _layout.levels.clear();
+
+    _textureId = createTexture(_residentLevel);
+    for (uint32_t level = 0; level < levels.size(); ++level)
+        uploadLevel(_residentLevel + level, _residentLevel, levels[level]);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool Texture2D::setResidentLevel(uint32_t level, const BakedTexture *finerLevels)
+{
+    const uint32_t numLevels = _layout.numLevels();
+    if (_textureId == 0 || level >= numLevels || level == _residentLevel)
+        return false;
+    if (level < _residentLevel
+        && (finerLevels == nullptr || finerLevels->firstLevel != level
+            || finerLevels->levels.size() < _residentLevel - level))
     {
-        format = GL_RGB;
-        internalFormat = GL_SRGB;
+        return false;
     }
-    else if (numChannels == 4)
+
+    const GLuint texture = createTexture(level);
+    for (uint32_t finer = level; finer < _residentLevel; ++finer)
+        uploadLevel(finer, level, finerLevels->levels[finer - level]);
+    for (uint32_t coarser = std::max(level, _residentLevel); coarser < numLevels; ++coarser)
     {
-        format = GL_RGBA;
-        internalFormat = GL_SRGB_ALPHA;
+        glCopyImageSubData(_textureId, GL_TEXTURE_2D, coarser - _residentLevel, 0, 0, 0, texture,
+                           GL_TEXTURE_2D, coarser - level, 0, 0, 0, _layout.levelWidth(coarser),
+                           _layout.levelHeight(coarser), 1);
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    if (!_useSrgb)
-        internalFormat = format;
+    deallocateTexture();
+    _textureId = texture;
+    _residentLevel = level;
+    return true;
+}
 
-    glGenTextures(1, &_textureId);
+GLuint Texture2D::createTexture(uint32_t firstLevel) const
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    glBindTexture(GL_TEXTURE_2D, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _params.wrappingS);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _params.wrappingT);
@@ -66,13 +153,60 @@ void Texture2D::allocateTexture()
                         std::min(_anisoLevel, maxAnisoLevel));
     }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE,
-                 imageData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    constexpr std::array<GLint, 6> Channels = { GL_RED, GL_GREEN, GL_BLUE,
+                                                GL_ALPHA, GL_ZERO, GL_ONE };
+    std::array<GLint, 4> swizzle;
+    std::ranges::transform(_layout.swizzle, swizzle.begin(), [&Channels](TextureChannel channel) {
+        return Channels[static_cast<size_t>(channel)];
+    });
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle.data());
+
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(_layout.numLevels() - firstLevel),
+                   _internalFormat, _layout.levelWidth(firstLevel),
+                   _layout.levelHeight(firstLevel));
+    return texture;
+}
+
+void Texture2D::uploadLevel(uint32_t level, uint32_t firstLevel,
+                            const std::vector<uint8_t> &data) const
+{
+    const GLint textureLevel = static_cast<GLint>(level - firstLevel);
+    if (_layout.format)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, 0, _layout.levelWidth(level),
+                                  _layout.levelHeight(level), _internalFormat,
+                                  static_cast<GLsizei>(data.size()), data.data());
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, 0, _layout.levelWidth(level),
+                        _layout.levelHeight(level), GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    }
+}
+
+size_t Texture2D::levelsBytes(uint32_t level) const
+{
+    size_t bytes = 0;
+    for (; _textureId != 0 && level < _layout.numLevels(); ++level)
+        bytes += _layout.levelBytes(level);
+    return bytes;
+}
 
-    stbi_image_free(imageData);
+void Texture2D::setData(TextureData &&data)
+{
+    if (_textureId == 0 && data.settings == _settings)
+        _data = std::move(data);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+bool Texture2D::needsPreparing() const noexcept
+{
+    return _textureId == 0 && !_data && !_textureSourcePath.empty();
+}
+
+TextureData Texture2D::prepareSource() const
+{
+    return TextureCache::prepare(_textureSourcePath, _settings,
+                                 _streamed ? TextureStreamer::TailSize : 0);
 }
 
 void Texture2D::deallocateTexture()
@@ -97,6 +231,25 @@ void Texture2D::setUseAnisotropic(bool useAniso, size_t level)
     _anisoLevel = level;
 }
 
-void Texture2D::setUseSrgb(bool ifUseSrgb) { _useSrgb = ifUseSrgb; }
+void Texture2D::setUseSrgb(bool ifUseSrgb) { _settings.srgb = ifUseSrgb; }
+
+void Texture2D::setFlipOnLoad(bool ifFlip) { _settings.flipVertically = ifFlip; }
+
+void Texture2D::addUsage(TextureUsage usage) { _settings.addUsage(usage); }
+
+void Texture2D::setCompression(TextureCompression compression)
+{
+    _settings.compression = compression;
+}
+
+void Texture2D::setSettings(const TextureSettings &settings) { _settings = settings; }
 
 void Texture2D::setParameters(Texture2DParameters params) { _params = params; }
+
+void Texture2D::setStreamed(bool streamed)
+{
+    if (_textureId == 0)
+        _streamed = streamed;
+}
+
+bool Texture2D::isStreamed() const noexcept { return _streamed && _cacheKey != 0; }
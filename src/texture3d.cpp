@@ -1,5 +1,7 @@
 #include "texture3d.h"
 
+#include "startupprofiler.h"
+
 Cubemap::Cubemap(const std::array<const char *, 6> &cubemapPaths, bool enableAnisotropicFiltering,
                  const Texture3DParameters &params)
     : _params(params), _useAnisotropic(enableAnisotropicFiltering)
@@ -22,6 +24,7 @@ void Cubemap::allocateTexture()
     for (unsigned int i = 0; i < 6; i++)
     {
         unsigned char *data = stbi_load(_cubemapPaths[i].c_str(), &width, &height, &numChannels, 0);
+        StartupProfiler::instance()->addFileLoaded(_cubemapPaths[i]);
         if (data)
         {
             GLenum format = GL_RGBA;
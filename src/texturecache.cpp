@@ -0,0 +1,384 @@
+#include "texturecache.h"
+
+#include "blobfile.h"
+#include "mappedfile.h"
+#include "startupprofiler.h"
+#include "threadpool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+using BlockCompression::BlockFormat;
+
+constexpr std::array<char, 4> Magic = { 'O', 'T', 'E', 'X' };
+constexpr uint8_t Uncompressed = 0xff; // the format of the RGBA8 textures in the files
+
+// about this many blocks per job of a level's compression
+constexpr uint32_t BlocksPerBand = 4096;
+
+uint64_t settingsBits(const TextureSettings &settings)
+{
+    return settings.usages | static_cast<uint64_t>(settings.srgb) << 8
+           | static_cast<uint64_t>(settings.flipVertically) << 9
+           | static_cast<uint64_t>(settings.compression) << 10
+           | static_cast<uint64_t>(settings.mipFilter) << 12
+           | static_cast<uint64_t>(settings.alphaCutoff) << 16;
+}
+
+// the first level of the chain no larger than maxSize
+uint32_t levelWithin(uint32_t width, uint32_t height, uint32_t maxSize)
+{
+    uint32_t level = 0;
+    for (uint32_t size = std::max(width, height); maxSize != 0 && size > maxSize; size /= 2)
+        ++level;
+    return level;
+}
+
+// the encoders take RGBA; the grey sources are spread over the colour channels
+std::vector<uint8_t> expandToRgba(const DecodedImage &image)
+{
+    const size_t numTexels = static_cast<size_t>(image.width) * image.height;
+    std::vector<uint8_t> rgba(numTexels * 4);
+
+    const stbi_uc *source = image.pixels.get();
+    for (size_t t = 0; t < numTexels; ++t, source += image.numChannels)
+    {
+        uint8_t *texel = &rgba[t * 4];
+        switch (image.numChannels)
+        {
+        case 1:
+        case 2:
+            texel[0] = texel[1] = texel[2] = source[0];
+            texel[3] = image.numChannels == 2 ? source[1] : 255;
+            break;
+        case 3:
+            std::memcpy(texel, source, 3);
+            texel[3] = 255;
+            break;
+        default:
+            std::memcpy(texel, source, 4);
+            break;
+        }
+    }
+
+    return rgba;
+}
+
+struct Encoding
+{
+    BlockFormat format = BlockFormat::BC7;
+    std::array<uint8_t, 2> channels = { 0, 1 }; // the ones BC4 and BC5 keep
+    std::array<TextureChannel, 4> swizzle = { TextureChannel::Red, TextureChannel::Green,
+                                              TextureChannel::Blue, TextureChannel::Alpha };
+};
+
+// the normals keep their X and Y in BC5; the data textures keep the channels their usages read
+// in BC4 or BC5, swizzled back to where the shaders look for them. The rest are colours
+Encoding chooseEncoding(const std::vector<uint8_t> &rgba, const TextureSettings &settings)
+{
+    using enum TextureChannel;
+
+    if (settings.usages != 0 && !settings.hasUsage(TextureUsage::Color))
+    {
+        if (settings.hasUsage(TextureUsage::Normal))
+            return Encoding{ BlockFormat::BC5, { 0, 1 }, { Red, Green, Zero, One } };
+
+        constexpr std::array<std::pair<TextureUsage, uint8_t>, 3> DataChannels = {
+            std::pair{ TextureUsage::Occlusion, 0 },
+            std::pair{ TextureUsage::Roughness, 1 },
+            std::pair{ TextureUsage::Metalness, 2 },
+        };
+        std::vector<uint8_t> channels;
+        for (const auto &[usage, channel] : DataChannels)
+        {
+            if (settings.hasUsage(usage))
+                channels.emplace_back(channel);
+        }
+
+        if (channels.size() == 1)
+        {
+            return Encoding{ BlockFormat::BC4, { channels[0], channels[0] },
+                             { Red, Red, Red, One } };
+        }
+        if (channels.size() == 2)
+        {
+            Encoding encoding{ BlockFormat::BC5, { channels[0], channels[1] }, {} };
+            for (uint8_t c = 0; c < 3; ++c)
+                encoding.swizzle[c] = c == channels[0] ? Red : c == channels[1] ? Green : Zero;
+            encoding.swizzle[3] = One;
+            return encoding;
+        }
+    }
+
+    if (settings.compression == TextureCompression::High)
+        return Encoding{ BlockFormat::BC7 };
+
+    for (size_t t = 3; t < rgba.size(); t += 4)
+    {
+        if (rgba[t] != 255)
+            return Encoding{ BlockFormat::BC3 };
+    }
+    return Encoding{ BlockFormat::BC1 };
+}
+
+// the block rows are compressed in bands on the loader threads, each into its own part of the
+// level: the blocks are stored row after row
+std::vector<uint8_t> compressLevel(const std::vector<uint8_t> &rgba, uint32_t width,
+                                   uint32_t height, const Encoding &encoding)
+{
+    const uint32_t blocksPerRow = (width + 3) / 4;
+    const uint32_t blockRows = (height + 3) / 4;
+    const uint32_t blockRowsPerBand = std::max(BlocksPerBand / blocksPerRow, 1u);
+    const uint32_t numBands = (blockRows + blockRowsPerBand - 1) / blockRowsPerBand;
+
+    std::vector<uint8_t> level(BlockCompression::compressedSize(encoding.format, width, height));
+    ThreadPool::loaders().parallelFor(numBands, [&](size_t band) {
+        const uint32_t firstRow = static_cast<uint32_t>(band) * blockRowsPerBand * 4;
+        const uint32_t bandHeight = std::min(blockRowsPerBand * 4, height - firstRow);
+        const std::vector<uint8_t> blocks = BlockCompression::compress(
+            &rgba[static_cast<size_t>(firstRow) * width * 4], width, bandHeight, encoding.format,
+            encoding.channels);
+        std::ranges::copy(blocks,
+                          level.begin()
+                              + static_cast<ptrdiff_t>(band) * blockRowsPerBand * blocksPerRow
+                                    * BlockCompression::blockSize(encoding.format));
+    });
+
+    return level;
+}
+
+} // namespace
+
+uint32_t BakedTexture::numLevels() const { return MipChain::numLevels(width, height); }
+
+uint32_t BakedTexture::levelWidth(uint32_t level) const { return std::max(width >> level, 1u); }
+
+uint32_t BakedTexture::levelHeight(uint32_t level) const { return std::max(height >> level, 1u); }
+
+size_t BakedTexture::levelBytes(uint32_t level) const
+{
+    const uint32_t levelWidth = this->levelWidth(level), levelHeight = this->levelHeight(level);
+    return format ? BlockCompression::compressedSize(*format, levelWidth, levelHeight)
+                  : static_cast<size_t>(levelWidth) * levelHeight * 4;
+}
+
+DecodedImage DecodedImage::decode(const std::string &path, bool flipVertically)
+{
+    // the flag of the calling thread only, so that the loader threads don't race on it; it is
+    // reset afterwards, since it then overrides the global one for the thread
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+
+    DecodedImage image;
+    image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.numChannels, 0));
+    StartupProfiler::instance()->addFileLoaded(path);
+
+    stbi_set_flip_vertically_on_load_thread(false);
+    return image;
+}
+
+namespace TextureCache
+{
+uint64_t contentHash(const std::filesystem::path &source)
+{
+    const MappedFile file(source);
+    if (!file.isOpen())
+        return 0;
+
+    const uint64_t hash = Utilities::hashBytes(file.data(), file.size());
+    return hash != 0 ? hash : 1;
+}
+
+uint64_t sourceKey(uint64_t contentHash, const TextureSettings &settings)
+{
+    if (contentHash == 0)
+        return 0;
+
+    uint64_t hash = Utilities::hashCombine(contentHash, settingsBits(settings));
+    hash = Utilities::hashCombine(hash, Version);
+    return hash != 0 ? hash : 1;
+}
+
+std::filesystem::path cachePath(const std::filesystem::path &source,
+                                const TextureSettings &settings)
+{
+    std::error_code error;
+    const std::string sourcePath = std::filesystem::absolute(source, error).generic_string();
+    const uint64_t pathHash = Utilities::hashCombine(
+        Utilities::hashBytes(reinterpret_cast<const std::byte *>(sourcePath.data()),
+                             sourcePath.size()),
+        settingsBits(settings));
+
+    std::ostringstream fileName;
+    fileName << source.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0')
+             << pathHash << ".texture";
+    return std::filesystem::path(ENGINE_CACHE) / "textures" / fileName.str();
+}
+
+std::optional<BakedTexture> load(const std::filesystem::path &cacheFile, uint64_t key,
+                                 uint32_t maxSize, uint32_t endLevel)
+{
+    if (key == 0)
+        return std::nullopt;
+
+    const MappedFile file(cacheFile);
+    if (!file.isOpen())
+        return std::nullopt;
+
+    BlobReader reader(file.data(), file.size());
+
+    std::array<char, 4> magic = {};
+    uint32_t version = 0;
+    uint64_t fileKey = 0;
+    if (!reader.read(magic) || !reader.read(version) || !reader.read(fileKey) || magic != Magic
+        || version != Version || fileKey != key)
+    {
+        return std::nullopt;
+    }
+
+    BakedTexture texture;
+    uint8_t format = 0;
+    uint32_t levels = 0;
+    if (!reader.read(format) || !reader.read(texture.swizzle) || !reader.read(texture.width)
+        || !reader.read(texture.height) || !reader.read(levels))
+    {
+        return std::nullopt;
+    }
+
+    if (format != Uncompressed)
+        texture.format = static_cast<BlockFormat>(format);
+    if ((texture.format && texture.format > BlockFormat::BC7)
+        || std::ranges::any_of(texture.swizzle,
+                               [](TextureChannel channel) { return channel > TextureChannel::One; })
+        || texture.width == 0 || texture.height == 0
+        || levels != MipChain::numLevels(texture.width, texture.height))
+    {
+        return std::nullopt;
+    }
+
+    // the levels are stored the finest first; the ones before the first wanted are skipped over
+    texture.firstLevel = std::min(levelWithin(texture.width, texture.height, maxSize),
+                                  levels - 1);
+    endLevel = std::clamp(endLevel, texture.firstLevel + 1, levels);
+    for (uint32_t level = 0; level < texture.firstLevel; ++level)
+    {
+        uint32_t size = 0;
+        if (reader.readArray(size) == nullptr)
+            return std::nullopt;
+    }
+
+    texture.levels.resize(endLevel - texture.firstLevel);
+    for (uint32_t level = texture.firstLevel; level < endLevel; ++level)
+    {
+        std::vector<uint8_t> &levelData = texture.levels[level - texture.firstLevel];
+        if (!reader.readArray(levelData) || levelData.size() != texture.levelBytes(level))
+            return std::nullopt;
+    }
+
+    return texture;
+}
+
+bool store(const std::filesystem::path &cacheFile, uint64_t key, const BakedTexture &texture)
+{
+    // only the whole chains
+    if (key == 0 || texture.firstLevel != 0 || texture.levels.size() != texture.numLevels())
+        return false;
+
+    return writeAtomically(cacheFile, [&](BlobWriter &writer) {
+        writer.write(Magic);
+        writer.write(Version);
+        writer.write(key);
+        writer.write(texture.format ? static_cast<uint8_t>(*texture.format) : Uncompressed);
+        writer.write(texture.swizzle);
+        writer.write(texture.width);
+        writer.write(texture.height);
+        writer.write(static_cast<uint32_t>(texture.levels.size()));
+        for (const std::vector<uint8_t> &level : texture.levels)
+            writer.writeArray(level);
+
+        return true;
+    });
+}
+
+BakedTexture bake(const DecodedImage &image, const TextureSettings &settings)
+{
+    BakedTexture texture;
+    texture.width = static_cast<uint32_t>(image.width);
+    texture.height = static_cast<uint32_t>(image.height);
+
+    std::vector<uint8_t> rgba = expandToRgba(image);
+    const std::optional<Encoding> encoding = settings.compression != TextureCompression::None
+                                                 ? std::optional(chooseEncoding(rgba, settings))
+                                                 : std::nullopt;
+
+    const MipChain::Settings mipSettings{ settings.mipFilter, settings.srgb,
+                                          settings.hasUsage(TextureUsage::Normal),
+                                          settings.alphaCutoff / 255.0f };
+    texture.levels = MipChain::generate(std::move(rgba), texture.width, texture.height,
+                                        mipSettings);
+    if (!encoding)
+        return texture;
+
+    texture.format = encoding->format;
+    texture.swizzle = encoding->swizzle;
+    uint32_t width = texture.width, height = texture.height;
+    for (std::vector<uint8_t> &level : texture.levels)
+    {
+        level = compressLevel(level, width, height, *encoding);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return texture;
+}
+
+TextureData prepare(const std::filesystem::path &source, const TextureSettings &settings,
+                    uint32_t maxSize)
+{
+    TextureData data;
+    data.settings = settings;
+
+    data.contentHash = contentHash(source);
+    const uint64_t key = sourceKey(data.contentHash, settings);
+    const std::filesystem::path cacheFile = cachePath(source, settings);
+    data.texture = load(cacheFile, key, maxSize);
+    if (data.texture)
+    {
+        data.cacheFile = cacheFile;
+        data.cacheKey = key;
+        return data;
+    }
+
+    const DecodedImage image = DecodedImage::decode(source.string(), settings.flipVertically);
+    if (!image)
+        return data;
+
+    data.texture = bake(image, settings);
+    if (store(cacheFile, key, *data.texture))
+    {
+        data.cacheFile = cacheFile;
+        data.cacheKey = key;
+    }
+    else
+    {
+        std::cerr << "Failed to write the texture cache " << cacheFile << std::endl;
+    }
+
+    // the levels left out can only be read back from the cache
+    BakedTexture &texture = *data.texture;
+    if (data.cacheKey != 0)
+    {
+        texture.firstLevel = std::min(levelWithin(texture.width, texture.height, maxSize),
+                                      texture.numLevels() - 1);
+        texture.levels.erase(texture.levels.begin(), texture.levels.begin() + texture.firstLevel);
+    }
+
+    return data;
+}
+} // namespace TextureCache
@@ -1,17 +1,19 @@
 #include "texturemanager.h"
-#include "randomnamer.h"
+#include "nameregistry.h"
+#include "threadpool.h"
 
 #include <glad/glad.h>
 
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <latch>
 
 std::pair<std::string, TextureIdentifier> TextureManager::registerTexture(const char *textureSource)
 {
-    const auto rName = RandomNamer::instance()->getRandomName(10);
-    const auto id = registerTexture(textureSource, rName);
-    return std::make_pair(rName, id);
+    const NameIdentifier nameId = NameRegistry::instance()->internAnonymous("texture");
+    const auto id = registerTexture(textureSource, nameId);
+    return std::make_pair(NameRegistry::instance()->name(nameId), id);
 }
 
 TextureManager::TextureManager()
@@ -31,28 +33,75 @@ TextureManager::TextureManager()
 }
 
 TextureIdentifier TextureManager::registerTexture(const char *textureSource,
-                                                  const std::string &texName)
+                                                  const std::string &texName,
+                                                  std::optional<uint64_t> contentHash)
 {
-    if (const TextureIdentifier ti = textureRegistered(texName); ti != InvalidIdentifier)
-        return ti;
+    return registerTexture(textureSource, NameRegistry::instance()->intern(texName), contentHash);
+}
+
+TextureIdentifier TextureManager::registerTexture(const char *textureSource,
+                                                  NameIdentifier nameId,
+                                                  std::optional<uint64_t> contentHash)
+{
+    if (const auto namePtr = _texturesByName.find(nameId); namePtr != _texturesByName.end())
+        return namePtr->second;
+
+    // the whole file is hashed, once per name, unless the loader threads did it already
+    uint64_t hash = 0;
+    if (_deduplicate)
+        hash = contentHash ? *contentHash : TextureCache::contentHash(textureSource);
+    if (const auto shared = _texturesByContent.find(hash); shared != _texturesByContent.end())
+    {
+        _texturesByName.emplace(nameId, shared->second);
+        ++_numSharedRegistrations[shared->second];
+        return shared->second;
+    }
 
-    _textures.emplace(++_identifiers, NamedTexture{ texName, Texture2D(textureSource) });
+    Texture2D texture(textureSource);
+    texture.setCompression(_compression);
+    _textures.emplace(++_identifiers, NamedTexture{ nameId, std::move(texture) });
+    _texturesByName.emplace(nameId, _identifiers);
+    if (hash != 0)
+        _texturesByContent.emplace(hash, _identifiers);
     return _identifiers;
 }
 
 TextureIdentifier TextureManager::registerTexture(uint32_t textureId)
 {
-    _textures.emplace(++_identifiers, NamedTexture{ RandomNamer::instance()->getRandomName(10),
-                                                    Texture2D(textureId) });
+    const NameIdentifier nameId = NameRegistry::instance()->internAnonymous("texture");
+    _textures.emplace(++_identifiers, NamedTexture{ nameId, Texture2D(textureId) });
+    _texturesByName.emplace(nameId, _identifiers);
     return _identifiers;
 }
 
 TextureIdentifier TextureManager::textureRegistered(const std::string &texName) const
 {
-    const auto texPtr = std::ranges::find_if(_textures, [&texName](const auto &pair) {
-        return pair.second.componentName == texName;
-    });
-    return texPtr == _textures.end() ? InvalidIdentifier : texPtr->first;
+    const auto namePtr = _texturesByName.find(NameRegistry::instance()->find(texName));
+    return namePtr == _texturesByName.end() ? InvalidIdentifier : namePtr->second;
+}
+
+void TextureManager::setCompression(TextureCompression compression)
+{
+    _compression = compression;
+    for (auto &[id, texture] : _textures)
+    {
+        if (!texture.componentData.isAllocated())
+            texture.componentData.setCompression(compression);
+    }
+}
+
+void TextureManager::setContentDeduplication(bool enabled) { _deduplicate = enabled; }
+
+DeduplicationStatistics TextureManager::deduplicationStatistics() const
+{
+    DeduplicationStatistics statistics;
+    for (const auto &[id, numShared] : _numSharedRegistrations)
+    {
+        const Texture2D &texture = _textures.at(id).componentData;
+        statistics.numShared += numShared;
+        statistics.bytesSaved += numShared * texture.levelsBytes(texture.residentLevel());
+    }
+    return statistics;
 }
 
 void TextureManager::allocateTexture(TextureIdentifier id)
@@ -61,7 +110,50 @@ void TextureManager::allocateTexture(TextureIdentifier id)
     if (texture == _textures.end())
         return;
 
+    const bool wasAllocated = texture->second.componentData.isAllocated();
     texture->second.componentData.allocateTexture();
+    if (!wasAllocated)
+        writeHandle(id);
+}
+
+void TextureManager::provideData(TextureIdentifier id, TextureData &&data)
+{
+    const auto texture = _textures.find(id);
+    if (texture == _textures.end())
+        return;
+
+    texture->second.componentData.setData(std::move(data));
+}
+
+void TextureManager::prefetchTextures(const std::vector<TextureIdentifier> &ids)
+{
+    std::vector<Texture2D *> textures;
+    for (const TextureIdentifier id : ids)
+    {
+        const auto texture = _textures.find(id);
+        if (texture != _textures.end() && texture->second.componentData.needsPreparing()
+            && std::ranges::find(textures, &texture->second.componentData) == textures.end())
+        {
+            textures.emplace_back(&texture->second.componentData);
+        }
+    }
+    if (textures.empty())
+        return;
+
+    // the workers only read the textures; the data is handed over once all are prepared
+    std::vector<TextureData> data(textures.size());
+    std::latch prepared(static_cast<std::ptrdiff_t>(textures.size()));
+    for (size_t t = 0; t < textures.size(); ++t)
+    {
+        ThreadPool::loaders().enqueue([&, t]() {
+            data[t] = textures[t]->prepareSource();
+            prepared.count_down();
+        });
+    }
+    prepared.wait();
+
+    for (size_t t = 0; t < textures.size(); ++t)
+        textures[t]->setData(std::move(data[t]));
 }
 
 int TextureManager::bindTexture(TextureIdentifier id, GLuint bindingType)
@@ -138,6 +230,142 @@ void TextureManager::deallocateTexture(TextureIdentifier id)
         return;
 
     texture.deallocateTexture();
+    writeHandle(id);
+}
+
+bool TextureManager::setResidentLevel(TextureIdentifier id, uint32_t level,
+                                      const BakedTexture *finerLevels)
+{
+    const auto texturePtr = _textures.find(id);
+    if (texturePtr == _textures.end())
+        return false;
+    auto &texture = texturePtr->second.componentData;
+
+    const uint32_t oldTexture = texture;
+    if (!texture.setResidentLevel(level, finerLevels))
+        return false;
+
+    // the old texture is gone, and so are its bindings
+    for (uint32_t &bound : _boundTextures)
+    {
+        if (bound == oldTexture)
+        {
+            bound = 0;
+            --_numBoundTextures;
+        }
+    }
+
+    writeHandle(id);
+    return true;
+}
+
+int TextureManager::acquireHandleSlot(TextureIdentifier id)
+{
+    if (!_textures.contains(id))
+        return -1;
+
+    if (const auto slot = _handleSlots.find(id); slot != _handleSlots.end())
+    {
+        ++slot->second.references;
+        return static_cast<int>(slot->second.index);
+    }
+
+    uint32_t index = _numHandleSlots;
+    if (!_freeHandleSlots.empty())
+    {
+        index = _freeHandleSlots.back();
+        _freeHandleSlots.pop_back();
+    }
+    else
+    {
+        ++_numHandleSlots;
+        if (_numHandleSlots > _handleCapacity)
+            growHandleTable(_numHandleSlots);
+    }
+
+    _handleSlots.emplace(id, HandleSlot{ index, 1 });
+    writeHandle(id);
+    return static_cast<int>(index);
+}
+
+void TextureManager::releaseHandleSlot(TextureIdentifier id)
+{
+    const auto slot = _handleSlots.find(id);
+    if (slot == _handleSlots.end() || --slot->second.references > 0)
+        return;
+
+    const uint32_t index = slot->second.index;
+#if !ENGINE_DISABLE_BINDLESS_TEXTURES
+    if (const auto texture = _textures.find(id);
+        texture != _textures.end() && texture->second.componentData.isAllocated())
+    {
+        const GLuint64 handle = glGetTextureHandleARB(texture->second.componentData);
+        if (glIsTextureHandleResidentARB(handle))
+            glMakeTextureHandleNonResidentARB(handle);
+    }
+#endif
+    _handleSlots.erase(slot);
+    _freeHandleSlots.emplace_back(index);
+
+    const GLuint64 noHandle = 0;
+    glNamedBufferSubData(_handleBuffer, index * sizeof(GLuint64), sizeof(GLuint64), &noHandle);
+}
+
+int TextureManager::handleSlot(TextureIdentifier id) const
+{
+    const auto slot = _handleSlots.find(id);
+    return slot == _handleSlots.end() ? -1 : static_cast<int>(slot->second.index);
+}
+
+void TextureManager::bindHandleTable(uint32_t bindingPoint) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, _handleBuffer);
+}
+
+void TextureManager::writeHandle(TextureIdentifier id)
+{
+    const auto slot = _handleSlots.find(id);
+    if (slot == _handleSlots.end())
+        return;
+
+    // 0 until the texture is uploaded; the slot is written again then
+    GLuint64 handle = 0;
+    const auto texture = _textures.find(id);
+    if (texture != _textures.end() && texture->second.componentData.isAllocated())
+    {
+#if ENGINE_DISABLE_BINDLESS_TEXTURES
+        handle = id;
+#else
+        handle = glGetTextureHandleARB(texture->second.componentData);
+        assert(handle != 0);
+        // the same texture can be sampled outside the table (e.g. by a light)
+        if (!glIsTextureHandleResidentARB(handle))
+            glMakeTextureHandleResidentARB(handle);
+#endif
+    }
+
+    glNamedBufferSubData(_handleBuffer, slot->second.index * sizeof(GLuint64), sizeof(GLuint64),
+                         &handle);
+}
+
+void TextureManager::growHandleTable(uint32_t numSlots)
+{
+    uint32_t capacity = std::max(_handleCapacity, MinHandleSlots);
+    while (capacity < numSlots)
+        capacity *= 2;
+
+    // the slots keep their indices; the buffers bound before have to be bound again
+    GLuint buffer = 0;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, capacity * sizeof(GLuint64), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (_handleBuffer != 0)
+    {
+        glCopyNamedBufferSubData(_handleBuffer, buffer, 0, 0, _handleCapacity * sizeof(GLuint64));
+        glDeleteBuffers(1, &_handleBuffer);
+    }
+
+    _handleBuffer = buffer;
+    _handleCapacity = capacity;
 }
 
 void TextureManager::unregisterTexture(TextureIdentifier id)
@@ -151,7 +379,12 @@ void TextureManager::unregisterTexture(TextureIdentifier id)
     if (isTextureBound(texture) != -1)
         return;
 
+    std::erase_if(_texturesByName, [id](const auto &name) { return name.second == id; });
+    std::erase_if(_texturesByContent, [id](const auto &shared) { return shared.second == id; });
+    _numSharedRegistrations.erase(id);
     _textures.erase(id);
+    // the slot stays empty until the materials holding it release it
+    writeHandle(id);
 }
 
 void TextureManager::cleanUpGracefully()
@@ -168,6 +401,15 @@ void TextureManager::cleanUpGracefully()
                   [](auto &pair) { pair.second.componentData.deallocateTexture(); });
 
     _textures.clear(); // just for future me
+    _texturesByName.clear();
+    _texturesByContent.clear();
+    _numSharedRegistrations.clear();
+
+    glDeleteBuffers(1, &_handleBuffer);
+    _handleBuffer = 0;
+    _handleCapacity = _numHandleSlots = 0;
+    _handleSlots.clear();
+    _freeHandleSlots.clear();
 }
 
 Texture2D *TextureManager::getTexture(TextureIdentifier tId)
@@ -1,5 +1,5 @@
 #include "texturemanager3d.h"
-#include "randomnamer.h"
+#include "nameregistry.h"
 
 #include <glad/glad.h>
 
@@ -10,9 +10,9 @@
 std::pair<std::string, TextureIdentifier3D> CubemapManager::registerTexture(
     const std::array<const char *, 6> &cubemapSources)
 {
-    const auto rName = RandomNamer::instance()->getRandomName(10);
-    const auto id = registerTexture(cubemapSources, rName);
-    return std::make_pair(rName, id);
+    const NameIdentifier nameId = NameRegistry::instance()->internAnonymous("cubemap");
+    const auto id = registerTexture(cubemapSources, nameId);
+    return std::make_pair(NameRegistry::instance()->name(nameId), id);
 }
 
 CubemapManager::CubemapManager() { std::memset(_boundTextures, 0, MAX_TEXTURES); }
@@ -20,19 +20,24 @@ CubemapManager::CubemapManager() { std::memset(_boundTextures, 0, MAX_TEXTURES);
 TextureIdentifier3D CubemapManager::registerTexture(
     const std::array<const char *, 6> &cubemapSources, const std::string &texName)
 {
-    if (const TextureIdentifier3D ti = textureRegistered(texName); ti != InvalidIdentifier)
-        return ti;
+    return registerTexture(cubemapSources, NameRegistry::instance()->intern(texName));
+}
+
+TextureIdentifier3D CubemapManager::registerTexture(
+    const std::array<const char *, 6> &cubemapSources, NameIdentifier nameId)
+{
+    if (const auto namePtr = _texturesByName.find(nameId); namePtr != _texturesByName.end())
+        return namePtr->second;
 
-    _textures.emplace(++_identifiers, NamedTexture{ texName, Cubemap(cubemapSources) });
+    _textures.emplace(++_identifiers, NamedTexture{ nameId, Cubemap(cubemapSources) });
+    _texturesByName.emplace(nameId, _identifiers);
     return _identifiers;
 }
 
 TextureIdentifier3D CubemapManager::textureRegistered(const std::string &texName) const
 {
-    const auto texPtr = std::ranges::find_if(_textures, [&texName](const auto &pair) {
-        return pair.second.componentName == texName;
-    });
-    return texPtr == _textures.end() ? InvalidIdentifier : texPtr->first;
+    const auto namePtr = _texturesByName.find(NameRegistry::instance()->find(texName));
+    return namePtr == _texturesByName.end() ? InvalidIdentifier : namePtr->second;
 }
 
 void CubemapManager::allocateTexture(TextureIdentifier3D id)
@@ -131,6 +136,7 @@ void CubemapManager::unregisterTexture(TextureIdentifier3D id)
     if (isTextureBound(texture) != -1)
         return;
 
+    _texturesByName.erase(texturePtr->second.componentName);
     _textures.erase(id);
 }
 
@@ -148,6 +154,7 @@ void CubemapManager::cleanUpGracefully()
                   [](auto &pair) { pair.second.componentData.deallocateTexture(); });
 
     _textures.clear(); // just for future me
+    _texturesByName.clear();
 }
 
 Cubemap *CubemapManager::getTexture(TextureIdentifier3D tId)
@@ -0,0 +1,241 @@
+#include "texturestreamer.h"
+
+#include "texturemanager.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace
+{
+// the loads queued at once, each one for all the levels a texture misses
+constexpr size_t MaxLoadsInFlight = 8;
+
+// the first level no larger than TailSize, which is what the streamed textures start with
+uint32_t tailLevel(const BakedTexture &layout)
+{
+    uint32_t level = 0;
+    for (uint32_t size = std::max(layout.width, layout.height); size > TextureStreamer::TailSize;
+         size /= 2)
+    {
+        ++level;
+    }
+    return std::min(level, layout.numLevels() - 1);
+}
+
+// the level with about a texel per pixel, or the finest one
+uint32_t levelFor(const BakedTexture &layout, float pixelsPerUv)
+{
+    const float size = static_cast<float>(std::max(layout.width, layout.height));
+    if (!(pixelsPerUv < size))
+        return 0;
+    if (pixelsPerUv <= 0.0f)
+        return layout.numLevels() - 1;
+
+    return std::min(static_cast<uint32_t>(std::log2(size / pixelsPerUv)),
+                    layout.numLevels() - 1);
+}
+
+Texture2D *streamedTexture(TextureIdentifier id)
+{
+    Texture2D *texture = TextureManager::instance()->getTexture(id);
+    return texture != nullptr && texture->isStreamed() ? texture : nullptr;
+}
+} // namespace
+
+void TextureStreamer::setEnabled(bool enabled) { _enabled = enabled; }
+
+void TextureStreamer::setBudget(size_t bytes) { _budget = bytes; }
+
+void TextureStreamer::requestResolution(TextureIdentifier id, float pixelsPerUv)
+{
+    auto streamed = _textures.find(id);
+    if (streamed == _textures.end())
+    {
+        // the textures that don't stream, or aren't uploaded yet, aren't tracked
+        if (streamedTexture(id) == nullptr)
+            return;
+        streamed = _textures.emplace(id, StreamedTexture{}).first;
+    }
+
+    StreamedTexture &texture = streamed->second;
+    texture.pixelsPerUv = texture.lastRequested == _frame
+                              ? std::max(texture.pixelsPerUv, pixelsPerUv)
+                              : pixelsPerUv;
+    texture.lastRequested = _frame;
+}
+
+void TextureStreamer::update(std::chrono::microseconds uploadBudget)
+{
+    applyLoads(uploadBudget);
+
+    // the levels wanted this frame; the textures not requested keep theirs until the budget
+    // needs them back
+    std::vector<std::pair<uint32_t, TextureIdentifier>> missing; // the levels missing first
+    _residentBytes = 0;
+    for (auto streamed = _textures.begin(); streamed != _textures.end();)
+    {
+        const Texture2D *texture = streamedTexture(streamed->first);
+        if (texture == nullptr)
+        {
+            streamed = _textures.erase(streamed);
+            continue;
+        }
+
+        StreamedTexture &state = streamed->second;
+        const uint32_t tail = tailLevel(texture->layout());
+        state.wantedLevel = state.lastRequested == _frame
+                                ? std::min(levelFor(texture->layout(), state.pixelsPerUv), tail)
+                                : tail;
+        _residentBytes += texture->levelsBytes(texture->residentLevel());
+
+        if (state.wantedLevel < texture->residentLevel() && !state.loading && !state.failed)
+            missing.emplace_back(texture->residentLevel() - state.wantedLevel, streamed->first);
+        ++streamed;
+    }
+    std::ranges::sort(missing, std::greater{});
+
+    size_t numLoading = std::ranges::count_if(
+        _textures, [](const auto &streamed) { return streamed.second.loading; });
+    for (const auto &[numMissing, id] : missing)
+    {
+        if (numLoading == MaxLoadsInFlight)
+            break;
+
+        // as fine as the budget allows
+        StreamedTexture &state = _textures.at(id);
+        const Texture2D *texture = streamedTexture(id);
+        const size_t residentBytes = texture->levelsBytes(texture->residentLevel());
+        for (uint32_t level = state.wantedLevel; level < texture->residentLevel(); ++level)
+        {
+            const size_t bytes = texture->levelsBytes(level) - residentBytes;
+            if (makeRoom(bytes))
+            {
+                queueLoad(id, state, level, bytes);
+                ++numLoading;
+                break;
+            }
+        }
+    }
+
+    ++_frame;
+}
+
+TextureStreamer::Statistics TextureStreamer::statistics() const
+{
+    Statistics statistics;
+    statistics.residentBytes = _residentBytes;
+    statistics.numLoads = _numLoads;
+    statistics.numEvictions = _numEvictions;
+    for (const auto &[id, state] : _textures)
+    {
+        const Texture2D *texture = streamedTexture(id);
+        if (texture == nullptr)
+            continue;
+
+        ++statistics.numTextures;
+        statistics.numLoading += state.loading;
+        statistics.fullBytes += texture->levelsBytes(0);
+    }
+    return statistics;
+}
+
+void TextureStreamer::applyLoads(std::chrono::microseconds uploadBudget)
+{
+    {
+        std::lock_guard lock(_loadedMutex);
+        std::ranges::move(_loaded, std::back_inserter(_uploads));
+        _loaded.clear();
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + uploadBudget;
+    size_t numApplied = 0;
+    while (!_uploads.empty()
+           && (numApplied == 0 || std::chrono::steady_clock::now() < deadline))
+    {
+        LoadedLevels loaded = std::move(_uploads.back());
+        _uploads.pop_back();
+        _reservedBytes -= loaded.reservedBytes;
+
+        const auto streamed = _textures.find(loaded.id);
+        if (streamed == _textures.end())
+            continue;
+        streamed->second.loading = false;
+
+        const Texture2D *texture = streamedTexture(loaded.id);
+        if (texture == nullptr)
+            continue;
+
+        if (!loaded.levels)
+        {
+            std::cerr << "Failed to stream the texture " << loaded.id << " from "
+                      << texture->cacheFile() << std::endl;
+            streamed->second.failed = true;
+            continue;
+        }
+
+        // evicted meanwhile
+        if (texture->residentLevel() != loaded.residentLevel)
+            continue;
+
+        if (TextureManager::instance()->setResidentLevel(loaded.id, loaded.levels->firstLevel,
+                                                         &*loaded.levels))
+        {
+            ++_numLoads;
+            ++numApplied;
+        }
+    }
+}
+
+bool TextureStreamer::makeRoom(size_t bytes)
+{
+    if (_residentBytes + _reservedBytes + bytes <= _budget)
+        return true;
+
+    // the textures holding levels they don't need right now, the least recently requested first
+    std::vector<std::pair<uint64_t, TextureIdentifier>> candidates;
+    for (const auto &[id, state] : _textures)
+    {
+        const Texture2D *texture = streamedTexture(id);
+        if (texture != nullptr && !state.loading && texture->residentLevel() < state.wantedLevel)
+            candidates.emplace_back(state.lastRequested, id);
+    }
+    std::ranges::sort(candidates);
+
+    for (const auto &[lastRequested, id] : candidates)
+    {
+        const Texture2D *texture = streamedTexture(id);
+        const size_t residentBytes = texture->levelsBytes(texture->residentLevel());
+        const uint32_t level = _textures.at(id).wantedLevel;
+        if (TextureManager::instance()->setResidentLevel(id, level, nullptr))
+        {
+            _residentBytes -= residentBytes - texture->levelsBytes(level);
+            ++_numEvictions;
+        }
+
+        if (_residentBytes + _reservedBytes + bytes <= _budget)
+            return true;
+    }
+    return false;
+}
+
+void TextureStreamer::queueLoad(TextureIdentifier id, StreamedTexture &streamed, uint32_t level,
+                                size_t bytes)
+{
+    const Texture2D *texture = streamedTexture(id);
+    const uint32_t maxSize = std::max(texture->layout().width, texture->layout().height) >> level;
+
+    streamed.loading = true;
+    _reservedBytes += bytes;
+    ThreadPool::loaders().enqueue([this, id, residentLevel = texture->residentLevel(), bytes,
+                                   cacheFile = texture->cacheFile(), key = texture->cacheKey(),
+                                   maxSize]() {
+        LoadedLevels loaded{ id, residentLevel, bytes,
+                             TextureCache::load(cacheFile, key, maxSize, residentLevel) };
+
+        std::lock_guard lock(_loadedMutex);
+        _loaded.emplace_back(std::move(loaded));
+    });
+}
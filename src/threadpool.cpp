@@ -0,0 +1,104 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+size_t loaderThreadCount = 0; // the default one
+} // namespace
+
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    _threads.reserve(numThreads);
+    for (size_t t = 0; t < numThreads; ++t)
+        _threads.emplace_back([this](std::stop_token stopToken) { work(stopToken); });
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard lock(_mutex);
+        _jobs.emplace_back(std::move(job));
+    }
+    _jobQueued.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+    if (count == 0)
+        return;
+
+    // shared with the helpers, since they may only start once the loop is over; they then find
+    // no index left, and don't touch the job
+    struct Loop
+    {
+        const std::function<void(size_t)> *job = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    const auto loop = std::make_shared<Loop>();
+    loop->job = &job;
+    loop->count = count;
+
+    const auto runJobs = [](Loop &loop) {
+        for (size_t index = loop.next++; index < loop.count; index = loop.next++)
+        {
+            (*loop.job)(index);
+            if (++loop.done == loop.count)
+            {
+                std::lock_guard lock(loop.mutex);
+                loop.finished.notify_all();
+            }
+        }
+    };
+
+    const size_t numHelpers = std::min(count - 1, _threads.size());
+    for (size_t h = 0; h < numHelpers; ++h)
+        enqueue([loop, runJobs]() { runJobs(*loop); });
+
+    runJobs(*loop);
+
+    std::unique_lock lock(loop->mutex);
+    loop->finished.wait(lock, [&loop]() { return loop->done == loop->count; });
+}
+
+size_t ThreadPool::defaultThreadCount()
+{
+    const unsigned int cores = std::thread::hardware_concurrency(); // 0 if unknown
+    return cores > 2 ? cores - 1 : 1;
+}
+
+ThreadPool &ThreadPool::loaders()
+{
+    static ThreadPool pool(loaderThreadCount > 0 ? loaderThreadCount : defaultThreadCount());
+    return pool;
+}
+
+void ThreadPool::setLoaderThreadCount(size_t numThreads)
+{
+    loaderThreadCount = std::max<size_t>(numThreads, 1);
+}
+
+void ThreadPool::work(std::stop_token stopToken)
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(_mutex);
+            _jobQueued.wait(lock, stopToken, [this]() { return !_jobs.empty(); });
+            if (stopToken.stop_requested())
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
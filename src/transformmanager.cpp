@@ -116,6 +116,18 @@ TransformIdentifier TransformManager::registerNewTransform(GameObjectIdentifier
     return _identifiers;
 }
 
+TransformIdentifier TransformManager::registerNewTransforms(GameObjectIdentifier firstParentId,
+                                                           size_t count)
+{
+    _transforms.reserve(_transforms.size() + count);
+    for (size_t t = 0; t < count; ++t)
+        _transforms.emplace(_identifiers + 1 + t, Transform(firstParentId + t));
+
+    const TransformIdentifier first = _identifiers + 1;
+    _identifiers += count;
+    return first;
+}
+
 Transform *TransformManager::getTransform(TransformIdentifier tId)
 {
     auto t = _transforms.find(tId);
@@ -1,10 +1,45 @@
 #include "transparentpass.h"
 
+#include "framebuffermanager.h"
 #include "fullscreenfogshader.h"
+#include "meshmanager.h"
+#include "texturemanager.h"
 #include "transparentshader.h"
 
 #include "glad/glad.h"
 
+#include <cassert>
+#include <iostream>
+
+namespace
+{
+constexpr float accumulationClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+constexpr float revealageClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+// the storage comes with the scene's size (see allocateTarget)
+GLuint createTarget()
+{
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// respecified in place, so that the framebuffer and the registered texture keep it
+void allocateTarget(GLuint texture, GLenum internalFormat, GLenum format, GLsizei width,
+                    GLsizei height)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+} // namespace
+
 SortingTransparentPass::SortingTransparentPass(TransparentShader *transparentShader,
                                                FullscreenFogShader *fogShader)
     : _transparentShader(transparentShader), _fogShader(fogShader)
@@ -15,6 +50,10 @@ void SortingTransparentPass::runPass()
 {
     glEnable(GL_BLEND);
 
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBlendEquation(GL_FUNC_ADD);
+
+    _transparentShader->setSortingEnabled(true);
     _transparentShader->runShader();
 
     {
@@ -30,3 +69,193 @@ void SortingTransparentPass::setCamera(const Camera *currentCamera)
     _currentCamera = currentCamera;
     _transparentShader->setCamera(currentCamera);
 }
+
+WeightedBlendedTransparentPass::WeightedBlendedTransparentPass(
+    TransparentShader *transparentShader, FullscreenFogShader *fogShader, ShaderProgramBatch &batch)
+    : _transparentShader(transparentShader), _fogShader(fogShader)
+{
+    batch.add(_accumulationOverride);
+
+    _accumulationBuf = createTarget();
+    _revealageBuf = createTarget();
+    _accumulationTexture = TextureManager::instance()->registerTexture(_accumulationBuf);
+    _revealageTexture = TextureManager::instance()->registerTexture(_revealageBuf);
+
+    glGenFramebuffers(1, &_oitFb);
+    FrameBufferManager::instance()->bindFrameBuffer(GL_FRAMEBUFFER, _oitFb);
+    FrameBufferManager::instance()->bindColorTexture(GL_FRAMEBUFFER, GL_TEXTURE_2D,
+                                                     _accumulationBuf, 0);
+    FrameBufferManager::instance()->bindColorTexture(GL_FRAMEBUFFER, GL_TEXTURE_2D,
+                                                     _revealageBuf, 1);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    FrameBufferManager::instance()->unbindFrameBuffer(GL_FRAMEBUFFER);
+}
+
+WeightedBlendedTransparentPass::~WeightedBlendedTransparentPass()
+{
+    glDeleteFramebuffers(1, &_oitFb);
+}
+
+void WeightedBlendedTransparentPass::sceneResized() { _sceneFb = 0; }
+
+bool WeightedBlendedTransparentPass::attachSceneDepth(GLuint sceneFrameBuffer)
+{
+    if (sceneFrameBuffer == _sceneFb)
+        return true;
+
+    if (sceneFrameBuffer == 0)
+        return false; // the depth of the default framebuffer can't be shared
+
+    GLint depthType = GL_NONE;
+    GLint depthName = 0;
+    glGetNamedFramebufferAttachmentParameteriv(sceneFrameBuffer, GL_DEPTH_ATTACHMENT,
+                                               GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depthType);
+    glGetNamedFramebufferAttachmentParameteriv(sceneFrameBuffer, GL_DEPTH_ATTACHMENT,
+                                               GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &depthName);
+
+    // the targets are composited over the scene one texel to one pixel, so they take its size
+    GLint width = 0;
+    GLint height = 0;
+    if (depthType == GL_RENDERBUFFER)
+    {
+        glGetNamedRenderbufferParameteriv(depthName, GL_RENDERBUFFER_WIDTH, &width);
+        glGetNamedRenderbufferParameteriv(depthName, GL_RENDERBUFFER_HEIGHT, &height);
+    }
+    else if (depthType == GL_TEXTURE)
+    {
+        glGetTextureLevelParameteriv(depthName, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(depthName, 0, GL_TEXTURE_HEIGHT, &height);
+    }
+    if (width != _targetWidth || height != _targetHeight)
+    {
+        allocateTarget(_accumulationBuf, GL_RGBA16F, GL_RGBA, width, height);
+        allocateTarget(_revealageBuf, GL_R8, GL_RED, width, height);
+        _targetWidth = width;
+        _targetHeight = height;
+    }
+
+    FrameBufferManager::instance()->bindFrameBuffer(GL_FRAMEBUFFER, _oitFb);
+    if (depthType == GL_RENDERBUFFER)
+        FrameBufferManager::instance()->bindDepthBuffer(GL_FRAMEBUFFER, depthName);
+    else if (depthType == GL_TEXTURE)
+        FrameBufferManager::instance()->bindDepthTexture(GL_FRAMEBUFFER, GL_TEXTURE_2D, depthName);
+
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+    {
+        std::cout << "OIT framebuffer not complete!" << std::endl;
+    }
+    FrameBufferManager::instance()->unbindFrameBuffer(GL_FRAMEBUFFER);
+
+    _sceneFb = complete ? sceneFrameBuffer : 0;
+    return complete;
+}
+
+void WeightedBlendedTransparentPass::runPass()
+{
+    const GLuint sceneFb = FrameBufferManager::instance()->getCurrentFramebuffer();
+    if (!attachSceneDepth(sceneFb))
+        return;
+
+    glEnable(GL_BLEND);
+
+    // accumulation
+    {
+        FrameBufferManager::instance()->pushFrameBuffer(_oitFb);
+        glClearBufferfv(GL_COLOR, 0, accumulationClear);
+        glClearBufferfv(GL_COLOR, 1, revealageClear);
+
+        glDepthMask(GL_FALSE);
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunci(0, GL_ONE, GL_ONE);
+        glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+        _transparentShader->setSortingEnabled(false); // the whole point
+        _transparentShader->setShaderProgramOverride(_accumulationOverride);
+        _transparentShader->runShader();
+        _transparentShader->removeShaderProgramOverride();
+
+        glDepthMask(GL_TRUE);
+        FrameBufferManager::instance()->popFrameBuffer();
+    }
+
+    // composite over the opaque image
+    {
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        runShader();
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    {
+        _fogShader->use();
+        _fogShader->runShader();
+    }
+
+    glDisable(GL_BLEND);
+}
+
+void WeightedBlendedTransparentPass::setCamera(const Camera *currentCamera)
+{
+    _currentCamera = currentCamera;
+    _transparentShader->setCamera(currentCamera);
+}
+
+void WeightedBlendedTransparentPass::runShader()
+{
+    use();
+
+    const int accumulationBinding = TextureManager::instance()->bindTexture(
+        _accumulationTexture);
+    const int revealageBinding = TextureManager::instance()->bindTexture(_revealageTexture);
+    assert(accumulationBinding != -1 && revealageBinding != -1);
+
+    setInt("accumulationTexture", accumulationBinding);
+    setInt("revealageTexture", revealageBinding);
+
+    MeshManager::instance()->bindMesh(MeshManager::instance()->getDummyMesh());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    MeshManager::instance()->unbindMesh();
+
+    TextureManager::instance()->unbindTexture(_accumulationTexture);
+    TextureManager::instance()->unbindTexture(_revealageTexture);
+}
+
+void WeightedBlendedTransparentPass::compileAndAttachNecessaryShaders(uint32_t id)
+{
+    if (_vertexShaderId == 0)
+    {
+        const std::string &vShaderCode = readShaderSource(_vertexPath);
+
+        const char *vPtr = vShaderCode.c_str();
+
+        _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
+        deferShader(_vertexShaderId);
+    }
+
+    glAttachShader(id, _vertexShaderId);
+
+    if (_fragmentShaderId == 0)
+    {
+        const std::string &fShaderCode = readShaderSource(_fragmentPath);
+
+        const char *fPtr = fShaderCode.c_str();
+
+        _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
+        deferShader(_fragmentShaderId);
+    }
+
+    glAttachShader(id, _fragmentShaderId);
+}
+
+void WeightedBlendedTransparentPass::deleteShaders()
+{
+    glDeleteShader(_vertexShaderId);
+    _vertexShaderId = 0;
+
+    glDeleteShader(_fragmentShaderId);
+    _fragmentShaderId = 0;
+}
@@ -4,147 +4,214 @@
 
 #include "materialmanager.h"
 #include "objectmanager.h"
-#include "lightmanager.h"
 
-#include <array>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <ranges>
 
 namespace
 {
-const std::array<std::string, 2> textureUniformNames = { "diffuseTextureHandle",
-                                                         "specularTextureHandle" };
+InstancedDataGenerator modelMatrixColumnGenerator(size_t column, size_t location)
+{
+    return InstancedDataGenerator{
+        sizeof(glm::vec4),
+        4,
+        location,
+        GL_FLOAT,
+        false,
+        [column](void *destination, GameObjectIdentifier gId) {
+            const glm::mat4 modelMat
+                = TransformManager::instance()
+                      ->getTransform(
+                          ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+                              ComponentType::TRANSFORM))
+                      ->computeModelMatrix();
+
+            std::memcpy(destination,
+                        reinterpret_cast<const int8_t *>(&modelMat) + (column * sizeof(glm::vec4)),
+                        sizeof(glm::vec4));
+        }
+    };
 }
 
+} // namespace
+
 TransparentShader::TransparentShader(const char *vertexPath, const char *fragmentPath)
     : _vertexPath(vertexPath), _fragmentPath(fragmentPath)
 {
 }
 
+TransparentShader::~TransparentShader()
+{
+    glDeleteBuffers(1, &_instancedBufferId);
+    MeshManager::instance()->releaseVertexArray(_vertexArray);
+}
+
 void TransparentShader::runShader()
 {
-    if (_sortedObjects.size() != _orderedShaderObjects.size())
+    if (_numShaderObjects != _orderedShaderObjects.size())
+        rebuildObjects();
+
+    if (_sortedObjects.empty())
+        return;
+
+    if (_sortingEnabled)
     {
-        _sortedObjects = std::vector<GameObjectIdentifier>{ _orderedShaderObjects.cbegin(),
-                                                            _orderedShaderObjects.cend() };
+        // a view that hasn't changed over static objects can't change the order either
+        const glm::mat4 view = _currentCamera->getViewMatrix();
+        if (_needsResorting || view != _previousView)
+        {
+            const bool orderChanged = _depthSorter.sortBackToFront(view);
+            if (orderChanged || _needsResorting)
+            {
+                _depthSorter.writeOrder(_sortedObjects);
+                _instancesDirty = true;
+            }
 
-        _minimalPreviousDistance = 0;
+            _previousView = view;
+            _needsResorting = false;
+        }
     }
 
-    if (_sortedObjects.empty())
-        return;
+    if (_instancesDirty)
+        rebuildBatches();
 
-    const auto currentCameraPosition = _currentCamera->position();
-    const auto currentDelta = currentCameraPosition - _previousCameraPosition;
-    bool objectsNeedResorting
-        = glm::dot(currentDelta, currentDelta)
-          > _minimalPreviousDistance; // if camera has moved further than the closest object -> only
-                                      // then do we need to resort objects (well, it can further be
-                                      // optimized)
+    use(); // the blending is set up by the pass
 
-    if (objectsNeedResorting)
+    TextureManager::instance()->bindHandleTable(_textureHandlesbindingPoint);
+
+    // when sorted (back to front), only the neighbours with the same mesh can be merged, otherwise
+    // the blending order would break
+    glBindVertexArray(_vertexArray);
+    for (const DrawBatch &batch : _drawBatches)
     {
-        std::ranges::sort(
-            _sortedObjects,
-            [currentCameraPosition](Transform *t1, Transform *t2) -> bool {
-                const auto delta1 = currentCameraPosition - t1->position();
-                const auto delta2 = currentCameraPosition - t2->position();
-                return glm::dot(delta1, delta1) < glm::dot(delta2, delta2);
-            },
-            [](GameObjectIdentifier id) -> Transform * {
-                const auto tId = ObjectManager::instance()->getObject(id).getIdentifierForComponent(
-                    ComponentType::TRANSFORM);
-                Transform *tPtr = TransformManager::instance()->getTransform(tId);
-                return tPtr;
-            });
-
-        // updates the closest object
-        const auto minDelta = currentCameraPosition
-                              - TransformManager::instance()
-                                    ->getTransform(
-                                        ObjectManager::instance()
-                                            ->getObject(_sortedObjects[0])
-                                            .getIdentifierForComponent(ComponentType::TRANSFORM))
-                                    ->position();
-        _minimalPreviousDistance = glm::dot(minDelta, minDelta);
-        _previousCameraPosition = currentCameraPosition;
+        MeshManager::instance()->drawMeshInstanced(batch.meshId, batch.instanceCount,
+                                                   batch.baseInstance);
     }
 
-    use();
+    glBindVertexArray(0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, _textureHandlesbindingPoint, 0);
+}
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBlendEquation(GL_FUNC_ADD);
+void TransparentShader::setCamera(const Camera *newCamera) { _currentCamera = newCamera; }
 
-    setVec3("viewPos", currentCameraPosition);
-    setMatrix4("view", _currentCamera->getViewMatrix());
-    setMatrix4("projection", _currentCamera->projectionMatrix());
-    setInt("numPointLightsBound",
-           LightManager<ComponentType::LIGHT_POINT>::instance()->getNumberOfBoundLights());
+void TransparentShader::setSortingEnabled(bool sortingEnabled)
+{
+    if (_sortingEnabled == sortingEnabled)
+        return;
 
-    for (const GameObjectIdentifier gId : std::ranges::reverse_view(_sortedObjects))
+    _sortingEnabled = sortingEnabled;
+    if (_sortingEnabled)
     {
-        const MeshIdentifier objectMeshId = ObjectManager::instance()
-                                                ->getObject(gId)
-                                                .getIdentifierForComponent(ComponentType::MESH);
-        if (objectMeshId != InvalidIdentifier)
-        {
-            // painfully draw objects one by one with no instancing or batching whatsoever
-            // TODO: fix this inefficiency
-            MeshManager::instance()->allocateMesh(objectMeshId);
-            MeshManager::instance()->bindMesh(objectMeshId);
-            const Mesh &mesh = *MeshManager::instance()->getMesh(objectMeshId);
+        _needsResorting = true;
+        return;
+    }
 
-            const MaterialIdentifier mId
-                = ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
-                    ComponentType::BASIC_MATERIAL);
+    // back to the mesh order of _orderedShaderObjects
+    std::ranges::stable_sort(_sortedObjects, MeshOrderer{});
+    _instancesDirty = true;
+}
 
-            if (mId == InvalidIdentifier)
-                return; // some objects may not have materials on them
+void TransparentShader::updateInstancedBuffer(
+    const std::unordered_set<GameObjectIdentifier> &objsToUpdate)
+{
+    const bool anyUpdated = std::ranges::any_of(objsToUpdate, [this](GameObjectIdentifier gId) {
+        return _objectsTextureMappings.contains(gId);
+    });
+    if (!anyUpdated)
+        return;
 
-            const BasicMaterial &mS
-                = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
-                      ->getMaterial(mId);
+    _depthSorter.refreshPositions();
+    _needsResorting = true;
+    _instancesDirty = true;
+}
 
-            const auto textureIdentifiers = mS.textures();
+void TransparentShader::rebuildObjects()
+{
+    _numShaderObjects = _orderedShaderObjects.size();
 
-            for (int t = 0; t < 2; ++t)
-            {
-#if ENGINE_DISABLE_BINDLESS_TEXTURES
-                setUvec2(textureUniformNames[t], 0);
-#else
-                const TextureIdentifier tId = textureIdentifiers[t];
-                if (tId == InvalidIdentifier)
-                {
-                    setUvec2(textureUniformNames[t], 0);
-                }
-                else
-                {
-                    TextureManager::instance()->allocateTexture(tId);
-                    const auto texHandle = glGetTextureHandleARB(
-                        *TextureManager::instance()->getTexture(tId));
-                    assert(texHandle != 0);
-                    if (!glIsTextureHandleResidentARB(texHandle))
-                        glMakeTextureHandleResidentARB(texHandle);
-                    setUvec2(textureUniformNames[t], texHandle);
-                }
-#endif
-            }
+    _sortedObjects.clear();
+    for (const GameObjectIdentifier gId : _orderedShaderObjects)
+    {
+        const GameObject &object = ObjectManager::instance()->getObject(gId);
+        if (object.getIdentifierForComponent(ComponentType::MESH) == InvalidIdentifier
+            || object.getIdentifierForComponent(ComponentType::BASIC_MATERIAL)
+                   == InvalidIdentifier)
+            continue; // some objects may not have materials on them
 
-            setMatrix4("model",
-                       TransformManager::instance()
-                           ->getTransform(
-                               ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
-                                   ComponentType::TRANSFORM))
-                           ->computeModelMatrix());
+        _sortedObjects.emplace_back(gId);
+    }
 
-            glDrawElements(GL_TRIANGLES, mesh.numIndices(), GL_UNSIGNED_INT, 0);
+    _objectsTextureMappings.clear();
 
-            MeshManager::instance()->unbindMesh();
-        }
+    if (_sortedObjects.empty())
+        return;
+
+    // the slots of the textures in the handle table, which stay put
+    _objectsTextureMappings
+        = MaterialManager<BasicMaterial, ComponentType::BASIC_MATERIAL>::instance()
+              ->textureSlots(_sortedObjects);
+
+    if (_instancedBufferId == 0)
+    {
+        glGenBuffers(1, &_instancedBufferId);
+        _vertexArray = MeshManager::instance()->createVertexArray();
+        Instancer::instance()->attachInstancedBuffer(_instancedBufferId, getDataGenerators(),
+                                                     _vertexArray);
+    }
+
+    for (const GameObjectIdentifier gId : _sortedObjects)
+    {
+        MeshManager::instance()->allocateMesh(
+            ObjectManager::instance()->getObject(gId).getIdentifierForComponent(
+                ComponentType::MESH));
     }
+
+    _depthSorter.setObjects(_sortedObjects);
+    _needsResorting = true;
+    _instancesDirty = true;
 }
 
-void TransparentShader::setCamera(const Camera *newCamera) { _currentCamera = newCamera; }
+void TransparentShader::rebuildBatches()
+{
+    Instancer::instance()->rewriteInstancedData(_instancedBufferId, _sortedObjects,
+                                                getDataGenerators(), _instancedBufferCapacity);
+
+    _drawBatches.clear();
+    for (size_t o = 0; o < _sortedObjects.size(); ++o)
+    {
+        const MeshIdentifier meshId = ObjectManager::instance()
+                                          ->getObject(_sortedObjects[o])
+                                          .getIdentifierForComponent(ComponentType::MESH);
+
+        if (!_drawBatches.empty() && _drawBatches.back().meshId == meshId)
+            ++_drawBatches.back().instanceCount;
+        else
+            _drawBatches.emplace_back(meshId, static_cast<GLuint>(o), 1);
+    }
+
+    _instancesDirty = false;
+}
+
+std::vector<InstancedDataGenerator> TransparentShader::getDataGenerators()
+{
+    constexpr auto numTexturesInMaterial = getNumTexturesInMaterial<BasicMaterial>();
+
+    const InstancedDataGenerator materialIndices = InstancedDataGenerator{
+        sizeof(int) * 4, // to preserve the 16-byte alignment
+        numTexturesInMaterial,
+        8,
+        GL_INT,
+        false,
+        [this, numTexturesInMaterial](void *destination, GameObjectIdentifier gId) {
+            std::memcpy(destination, _objectsTextureMappings.at(gId).data(),
+                        sizeof(int) * numTexturesInMaterial);
+        }
+    };
+
+    return { modelMatrixColumnGenerator(0, 4), modelMatrixColumnGenerator(1, 5),
+             modelMatrixColumnGenerator(2, 6), modelMatrixColumnGenerator(3, 7), materialIndices };
+}
 
 void TransparentShader::compileAndAttachNecessaryShaders(uint32_t id)
 {
@@ -156,7 +223,7 @@ void TransparentShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -169,7 +236,7 @@ void TransparentShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
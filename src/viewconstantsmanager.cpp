@@ -0,0 +1,99 @@
+#include "viewconstantsmanager.h"
+
+#include "camera.h"
+#include "lightdefs.h"
+#include "lightmanager.h"
+
+#include <cassert>
+
+void ViewConstantsManager::initializeViewBuffer()
+{
+    GLint offsetAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    offsetAlignment = offsetAlignment > 0 ? offsetAlignment : 1;
+
+    _slotStride = ((sizeof(ViewConstants) + offsetAlignment - 1) / offsetAlignment)
+                  * offsetAlignment;
+    // the main camera + one view per directional shadow map
+    _maxViews = directionalLightView(getMaxLightsForLightType(ComponentType::LIGHT_DIRECTIONAL));
+
+    glGenBuffers(1, &_vBufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, _vBufferId);
+    glBufferData(GL_UNIFORM_BUFFER, _maxViews * _slotStride, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    _uploadedViews.assign(_maxViews, std::nullopt);
+
+    bindView(CameraView);
+}
+
+void ViewConstantsManager::updateView(size_t viewSlot, const glm::mat4 &view,
+                                      const glm::mat4 &projection, const glm::vec3 &viewPos)
+{
+    if (_vBufferId == 0)
+        return;
+
+    assert(viewSlot < _maxViews);
+
+    ViewConstants constants{
+        .view = view,
+        .projection = projection,
+        // computed below, only if the view is uploaded
+        .inverseView = glm::mat4(1.0f),
+        .inverseProjection = glm::mat4(1.0f),
+        .viewPos = viewPos,
+        .directionalShadowBias = _directionalShadowBias,
+        .numDirectionalLightsBound = static_cast<int>(
+            LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()->getNumberOfBoundLights()),
+        .numPointLightsBound = static_cast<int>(
+            LightManager<ComponentType::LIGHT_POINT>::instance()->getNumberOfBoundLights()),
+        .numSpotLightsBound = static_cast<int>(
+            LightManager<ComponentType::LIGHT_SPOT>::instance()->getNumberOfBoundLights()),
+        .numTexturedLightsBound = static_cast<int>(
+            LightManager<ComponentType::LIGHT_TEXTURED_SPOT>::instance()->getNumberOfBoundLights()),
+    };
+
+    // the inverses follow from the rest, so they're left out of the comparison
+    std::optional<ViewConstants> &uploaded = _uploadedViews[viewSlot];
+    if (uploaded && uploaded->view == constants.view
+        && uploaded->projection == constants.projection && uploaded->viewPos == constants.viewPos
+        && uploaded->directionalShadowBias == constants.directionalShadowBias
+        && uploaded->numDirectionalLightsBound == constants.numDirectionalLightsBound
+        && uploaded->numPointLightsBound == constants.numPointLightsBound
+        && uploaded->numSpotLightsBound == constants.numSpotLightsBound
+        && uploaded->numTexturedLightsBound == constants.numTexturedLightsBound)
+    {
+        return;
+    }
+
+    constants.inverseView = glm::inverse(view);
+    constants.inverseProjection = glm::inverse(projection);
+    uploaded = constants;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _vBufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, viewSlot * _slotStride, sizeof(ViewConstants), &constants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void ViewConstantsManager::updateCameraView(const Camera *camera)
+{
+    updateView(CameraView, camera->getViewMatrix(), camera->projectionMatrix(),
+               camera->position());
+}
+
+void ViewConstantsManager::bindView(size_t viewSlot) const
+{
+    if (_vBufferId == 0)
+        return;
+
+    assert(viewSlot < _maxViews);
+    glBindBufferRange(GL_UNIFORM_BUFFER, ViewConstantsBindingPoint, _vBufferId,
+                      viewSlot * _slotStride, sizeof(ViewConstants));
+}
+
+void ViewConstantsManager::cleanUpGracefully()
+{
+    glDeleteBuffers(1, &_vBufferId);
+    _vBufferId = 0;
+    _uploadedViews.clear();
+}
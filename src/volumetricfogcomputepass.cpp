@@ -1,12 +1,14 @@
 #include "volumetricfogcomputepass.h"
 #include "camera.h"
-#include "lightmanager.h"
+#include "mipchain.h"
+#include "startupprofiler.h"
 #include "texturemanager.h"
 #include "timemanager.h"
 
 #include "glad/glad.h"
 #include "imgui/imgui.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace
@@ -35,9 +37,9 @@ constexpr float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
 } // namespace
 
-VolumetricFogPass::VolumetricFogPass()
+VolumetricFogPass::VolumetricFogPass(ShaderProgramBatch &batch)
 {
-    _fogSphereShader.initializeShaderProgram();
+    batch.add(_fogSphereShader);
 
     const auto colorImageCreator = []() {
         unsigned int texture;
@@ -86,6 +88,7 @@ VolumetricFogPass::VolumetricFogPass()
 
         int width, height, numChannels;
         auto *imageData = stbi_load(ENGINE_TEXTURES "/fog.png", &width, &height, &numChannels, 0);
+        StartupProfiler::instance()->addFileLoaded(ENGINE_TEXTURES "/fog.png");
         assert(numChannels > 0 && imageData != nullptr);
 
         const int slicesPerDimension = 4;
@@ -123,17 +126,17 @@ VolumetricFogPass::VolumetricFogPass()
         if (numChannels == 1)
         {
             format = GL_RED;
-            internalFormat = GL_RED;
+            internalFormat = GL_R8;
         }
         else if (numChannels == 3)
         {
             format = GL_RGB;
-            internalFormat = GL_SRGB;
+            internalFormat = GL_SRGB8;
         }
         else if (numChannels == 4)
         {
             format = GL_RGBA;
-            internalFormat = GL_SRGB_ALPHA;
+            internalFormat = GL_SRGB8_ALPHA8;
         }
 
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -146,13 +149,26 @@ VolumetricFogPass::VolumetricFogPass()
         const float borderColor[4] = { 0.0, 0.0, 0.0, 0.0 };
         glTexParameterfv(GL_TEXTURE_3D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-        glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, texelsPerX, texelsPerY, numSlices, 0, format,
-                     GL_UNSIGNED_BYTE, atlasedTexture.data());
-        glGenerateMipmap(GL_TEXTURE_3D);
+        stbi_image_free(imageData);
+
+        // the mips filtered on the CPU, the colours in linear light
+        const std::vector<std::vector<uint8_t>> levels = MipChain::generateVolume(
+            std::move(atlasedTexture), texelsPerX, texelsPerY, numSlices, numChannels,
+            numChannels >= 3);
+        glTexStorage3D(GL_TEXTURE_3D, static_cast<GLsizei>(levels.size()), internalFormat,
+                       texelsPerX, texelsPerY, numSlices);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            glTexSubImage3D(GL_TEXTURE_3D, static_cast<GLint>(level), 0, 0, 0,
+                            std::max(texelsPerX >> level, 1), std::max(texelsPerY >> level, 1),
+                            std::max(numSlices >> level, 1), format, GL_UNSIGNED_BYTE,
+                            levels[level].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glBindTexture(GL_TEXTURE_3D, 0);
 
-        _numMipLeves = glm::floor(glm::log2(static_cast<float>(texelsPerX))) + 1;
-        stbi_image_free(imageData);
+        _numMipLeves = static_cast<int>(levels.size());
 
         _fogTexture = TextureManager::instance()->registerTexture(fogTexture);
     }
@@ -190,7 +206,6 @@ void VolumetricFogPass::runPass()
 
     {
         const auto currentViewMatrix = _currentCamera->getViewMatrix();
-        const auto currentProjectionMatrix = _currentCamera->projectionMatrix();
 
         const glm::vec3 sphereViewPosition = currentViewMatrix * glm::vec4(5.0f, 5.0f, 5.0f, 1.0f);
         const float zDistanceToSphereCenter = glm::abs(sphereViewPosition.z);
@@ -277,11 +292,6 @@ void VolumetricFogPass::runPass()
                                                         - (float)(static_cast<int>(currentTime) / 2)
                                                               * 360.0f),
                                                     glm::vec3(1.0f, 1.0f, 1.0f))));
-        _fogSphereShader.setMatrix4("inverseViewMatrix", glm::inverse(currentViewMatrix));
-
-        _fogSphereShader.setMatrix4("viewMatrix", currentViewMatrix);
-        _fogSphereShader.setMatrix4("projectionMatrix", currentProjectionMatrix);
-        _fogSphereShader.setMatrix4("clipToView", glm::inverse(currentProjectionMatrix));
 
         _fogSphereShader.setVec3("viewSpherePos", sphereViewPosition);
         _fogSphereShader.setFloat("sphereRadius", sphereRadius);
@@ -291,19 +301,6 @@ void VolumetricFogPass::runPass()
         _fogSphereShader.setVec3("fogColor", fogColor);
         _fogSphereShader.setVec3("lightAbsorb", lightAbsorbtion);
 
-        // lights
-        {
-            _fogSphereShader.setInt("numDirectionalLightsBound",
-                                    LightManager<ComponentType::LIGHT_DIRECTIONAL>::instance()
-                                        ->getNumberOfBoundLights());
-            _fogSphereShader.setInt("numPointLightsBound",
-                                    LightManager<ComponentType::LIGHT_POINT>::instance()
-                                        ->getNumberOfBoundLights());
-            _fogSphereShader.setInt("numSpotLightsBound",
-                                    LightManager<ComponentType::LIGHT_SPOT>::instance()
-                                        ->getNumberOfBoundLights());
-        }
-
         const auto fogBindingUnit = TextureManager::instance()->bindTexture(_fogTexture,
                                                                             GL_TEXTURE_3D);
         assert(fogBindingUnit != -1);
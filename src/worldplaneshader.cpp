@@ -20,8 +20,6 @@ void WorldPlaneShader::runShader()
 
         if (bindPoint != -1)
         {
-            const Mesh *planeMesh = MeshManager::instance()->getMesh(_planeMesh);
-
             setInt("planeTexture", bindPoint);
             glm::mat4 squashedCubeMatrix = glm::scale(glm::identity<glm::mat4>(),
                                                       glm::vec3(500.0f, 0.05f, 500.0f));
@@ -33,7 +31,7 @@ void WorldPlaneShader::runShader()
             if (!_planeEnabled)
                 glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-            glDrawElements(GL_TRIANGLES, planeMesh->numIndices(), GL_UNSIGNED_INT, 0);
+            MeshManager::instance()->drawMesh(_planeMesh);
             TextureManager::instance()->unbindTexture(_planeTexture);
 
             if (!_planeEnabled)
@@ -57,7 +55,7 @@ void WorldPlaneShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(_vertexShaderId, 1, &vPtr, NULL);
-        compileShader(_vertexShaderId);
+        deferShader(_vertexShaderId);
     }
 
     glAttachShader(id, _vertexShaderId);
@@ -70,7 +68,7 @@ void WorldPlaneShader::compileAndAttachNecessaryShaders(uint32_t id)
 
         _fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(_fragmentShaderId, 1, &fPtr, NULL);
-        compileShader(_fragmentShaderId);
+        deferShader(_fragmentShaderId);
     }
 
     glAttachShader(id, _fragmentShaderId);
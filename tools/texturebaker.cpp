@@ -0,0 +1,121 @@
+// fills the texture cache ahead of time, without a GPU, e.g. on the build machines:
+//   texture_baker [--usage=color,normal,occlusion,roughness,metalness] [--srgb] [--flip]
+//                 [--compression=none|fast|high] [--mip-filter=box|kaiser]
+//                 [--alpha-cutoff=<0 to 255>] <texture>...
+// The options apply to the textures after them, and have to match the settings the engine loads
+// the textures with (see ModelLoader's textureSettings) for the cache files to be found
+
+#include "texturecache.h"
+
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+bool parseUsages(std::string_view value, TextureSettings &settings)
+{
+    settings.usages = 0;
+    while (!value.empty())
+    {
+        const size_t comma = value.find(',');
+        const std::string_view usage = value.substr(0, comma);
+        if (usage == "color")
+            settings.addUsage(TextureUsage::Color);
+        else if (usage == "normal")
+            settings.addUsage(TextureUsage::Normal);
+        else if (usage == "occlusion")
+            settings.addUsage(TextureUsage::Occlusion);
+        else if (usage == "roughness")
+            settings.addUsage(TextureUsage::Roughness);
+        else if (usage == "metalness")
+            settings.addUsage(TextureUsage::Metalness);
+        else
+            return false;
+
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, const char *argv[])
+{
+    TextureSettings settings;
+    int numFailed = 0;
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string_view argument = argv[a];
+        if (argument.starts_with("--usage="))
+        {
+            if (!parseUsages(argument.substr(std::string_view("--usage=").size()), settings))
+            {
+                std::cerr << "Unknown usage in '" << argument << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (argument == "--srgb")
+        {
+            settings.srgb = true;
+        }
+        else if (argument == "--flip")
+        {
+            settings.flipVertically = true;
+        }
+        else if (argument == "--compression=none")
+        {
+            settings.compression = TextureCompression::None;
+        }
+        else if (argument == "--compression=fast")
+        {
+            settings.compression = TextureCompression::Fast;
+        }
+        else if (argument == "--compression=high")
+        {
+            settings.compression = TextureCompression::High;
+        }
+        else if (argument == "--mip-filter=box")
+        {
+            settings.mipFilter = MipChain::Filter::Box;
+        }
+        else if (argument == "--mip-filter=kaiser")
+        {
+            settings.mipFilter = MipChain::Filter::Kaiser;
+        }
+        else if (argument.starts_with("--alpha-cutoff="))
+        {
+            const std::string_view value = argument.substr(argument.find('=') + 1);
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                                                      settings.alphaCutoff);
+            if (error != std::errc() || end != value.data() + value.size())
+            {
+                std::cerr << "Invalid alpha cutoff in '" << argument << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (argument.starts_with("--"))
+        {
+            std::cerr << "Unknown option '" << argument << "'" << std::endl;
+            return 1;
+        }
+        else
+        {
+            const auto bakeStart = std::chrono::steady_clock::now();
+            const TextureData data = TextureCache::prepare(argument, settings);
+            const std::chrono::duration<double, std::milli> bakeTime
+                = std::chrono::steady_clock::now() - bakeStart;
+
+            if (!data)
+            {
+                std::cerr << "Failed to decode the texture " << argument << std::endl;
+                ++numFailed;
+                continue;
+            }
+            std::cout << argument << " -> " << TextureCache::cachePath(argument, settings).string()
+                      << " in " << bakeTime.count() << " ms" << std::endl;
+        }
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}